@@ -0,0 +1,246 @@
+#!/usr/bin/env python3
+"""
+build_assets.py
+
+Builds the web UI under WebFiles/www for the device file system:
+
+  * pages (*.html) are minified and keep their names, the NWP HTTP server
+    keeps serving them from /www
+  * every other asset is minified when it is text, gzip precompressed when
+    that pays off, and renamed to /static/<name>.<content hash>.<ext>.
+    /static is outside /www, so the NWP forwards those requests to the link
+    local task, which sets Content-Encoding and an ETag from the manifest
+  * references to assets in pages and style sheets are rewritten to the
+    fingerprinted names
+
+Outputs:
+  WebFiles/dist/www/...        pages, flash them under /www
+  WebFiles/dist/static/...     assets, flash them under /static
+  WebFiles/dist/manifest.json  uri -> file, type, encoding, size, etag
+  web_manifest.h               the same table for the firmware
+
+Usage: python3 WebFiles/build_assets.py [--src DIR] [--dist DIR] [--header FILE]
+"""
+
+import argparse
+import gzip
+import hashlib
+import json
+import os
+import posixpath
+import re
+import shutil
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+STATIC_PREFIX = "/static/"
+HASH_LEN = 8
+
+# extension -> (HttpContentTypeList entry, text asset)
+CONTENT_TYPES = {
+    ".css": ("HttpContentTypeList_TextCSS", True),
+    ".js": ("HttpContentTypeList_ApplicationJavascript", True),
+    ".json": ("HttpContentTypeList_ApplicationJson", True),
+    ".txt": ("HttpContentTypeList_TextPlain", True),
+    ".xml": ("HttpContentTypeList_TextXML", True),
+    ".png": ("HttpContentTypeList_ImagePNG", False),
+    ".gif": ("HttpContentTypeList_ImageGIF", False),
+    ".jpg": ("HttpContentTypeList_ImageJPEG", False),
+    ".ico": ("HttpContentTypeList_ImageXIcon", False),
+}
+
+# only keep the gzip copy when it saves at least this much
+GZIP_MIN_RATIO = 0.9
+
+URL_RE = re.compile(r"""url\(\s*(['"]?)([^'")]+)\1\s*\)""")
+ATTR_RE = re.compile(r"""\b(href|src)\s*=\s*(['"])([^'"]+)\2""")
+
+
+def decode_text(raw):
+    """style.css is stored as UTF-16, everything is served as UTF-8"""
+    if raw.startswith(b"\xff\xfe") or raw.startswith(b"\xfe\xff"):
+        return raw.decode("utf-16")
+    if raw.startswith(b"\xef\xbb\xbf"):
+        return raw[3:].decode("utf-8")
+    return raw.decode("utf-8")
+
+
+def minify_css(text):
+    text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+    text = re.sub(r"\s+", " ", text)
+    text = re.sub(r"\s*([{};:,>])\s*", r"\1", text)
+    text = text.replace(";}", "}")
+    return text.strip()
+
+
+def minify_lines(text):
+    """drops indentation and blank lines only, safe for inline scripts that
+    rely on line breaks ('//' comments, missing semicolons)"""
+    lines = (line.strip() for line in text.splitlines())
+    return "\n".join(line for line in lines if line) + "\n"
+
+
+def minify_html(text):
+    text = re.sub(r"<!--(?!\[if).*?-->", "", text, flags=re.S)
+    return minify_lines(text)
+
+
+def source_path(rel):
+    """Uniflash exports nested files as '-www-<dir>-<name>', map them back to
+    the path the pages reference"""
+    directory, name = posixpath.split(rel)
+    prefix = "-www-" + directory.replace("/", "-") + "-"
+    if directory and name.startswith(prefix):
+        name = name[len(prefix):]
+    return posixpath.join(directory, name)
+
+
+def rewrite_refs(text, base_dir, uris, regex, group):
+    def repl(match):
+        ref = match.group(group)
+        if re.match(r"^(?:[a-z]+:|/|#|data:)", ref):
+            return match.group(0)
+        target = posixpath.normpath(posixpath.join(base_dir, ref))
+        if posixpath.splitext(target)[1] not in CONTENT_TYPES:
+            # links to pages stay as they are
+            return match.group(0)
+        if target not in uris:
+            print("warning: %s references missing asset %s"
+                  % (base_dir or ".", ref), file=sys.stderr)
+            return match.group(0)
+        return match.group(0).replace(ref, uris[target])
+    return regex.sub(repl, text)
+
+
+def collect(src):
+    files = {}
+    for root, _, names in os.walk(src):
+        for name in names:
+            full = os.path.join(root, name)
+            rel = os.path.relpath(full, src).replace(os.sep, "/")
+            files[source_path(rel)] = full
+    return files
+
+
+def build(src, dist, header):
+    files = collect(src)
+    pages = sorted(p for p in files if p.endswith(".html"))
+    assets = sorted(p for p in files
+                    if posixpath.splitext(p)[1] in CONTENT_TYPES)
+    skipped = sorted(set(files) - set(pages) - set(assets))
+    for path in skipped:
+        print("skipping %s" % path, file=sys.stderr)
+
+    shutil.rmtree(dist, ignore_errors=True)
+    os.makedirs(os.path.join(dist, "www"))
+    os.makedirs(os.path.join(dist, "static"))
+
+    # binary assets first, style sheets reference them
+    assets.sort(key=lambda p: CONTENT_TYPES[posixpath.splitext(p)[1]][1])
+
+    uris = {}
+    manifest = {}
+    for path in assets:
+        stem, ext = posixpath.splitext(posixpath.basename(path))
+        content_type, is_text = CONTENT_TYPES[ext]
+        with open(files[path], "rb") as f:
+            data = f.read()
+
+        if is_text:
+            text = decode_text(data)
+            if ext == ".css":
+                text = rewrite_refs(minify_css(text), posixpath.dirname(path),
+                                    uris, URL_RE, 2)
+            elif not stem.endswith(".min"):
+                text = minify_lines(text)
+            data = text.encode("utf-8")
+
+        digest = hashlib.sha1(data).hexdigest()[:HASH_LEN]
+        uri = "%s%s.%s%s" % (STATIC_PREFIX, stem, digest, ext)
+
+        encoded = data
+        is_gzip = False
+        if is_text:
+            packed = gzip.compress(data, compresslevel=9, mtime=0)
+            if len(packed) < len(data) * GZIP_MIN_RATIO:
+                encoded, is_gzip = packed, True
+
+        with open(os.path.join(dist, uri.lstrip("/")), "wb") as f:
+            f.write(encoded)
+
+        uris[path] = uri
+        manifest[uri] = {
+            "source": path,
+            "contentType": content_type,
+            "gzip": is_gzip,
+            "size": len(encoded),
+            "etag": '"%s"' % digest,
+        }
+        print("%-28s -> %s (%d -> %d bytes%s)"
+              % (path, uri, os.path.getsize(files[path]), len(encoded),
+                 ", gzip" if is_gzip else ""))
+
+    for path in pages:
+        with open(files[path], "rb") as f:
+            text = decode_text(f.read())
+        base_dir = posixpath.dirname(path)
+        text = rewrite_refs(text, base_dir, uris, ATTR_RE, 3)
+        text = rewrite_refs(text, base_dir, uris, URL_RE, 2)
+        data = minify_html(text).encode("utf-8")
+        out = os.path.join(dist, "www", path)
+        os.makedirs(os.path.dirname(out), exist_ok=True)
+        with open(out, "wb") as f:
+            f.write(data)
+        print("%-28s -> /www/%s (%d -> %d bytes)"
+              % (path, path, os.path.getsize(files[path]), len(data)))
+
+    with open(os.path.join(dist, "manifest.json"), "w") as f:
+        json.dump(manifest, f, indent=2, sort_keys=True)
+        f.write("\n")
+
+    write_header(header, manifest)
+
+
+def write_header(header, manifest):
+    # same order as the firmware binary search: length, then bytes
+    ordered = sorted(manifest, key=lambda u: (len(u), u.encode()))
+    lines = [
+        "/*",
+        " * web_manifest.h",
+        " *",
+        " *  Generated by WebFiles/build_assets.py, do not edit. Fingerprinted",
+        " *  web assets served by the link local task, sorted by URI length and",
+        " *  then by URI bytes. Only link_local_task.c includes it.",
+        " */",
+        "",
+        "#ifndef WEB_MANIFEST_H_",
+        "#define WEB_MANIFEST_H_",
+        "",
+        "#define WEB_ASSET_NUM                  (%d)" % len(ordered),
+        "",
+        "const http_WebAsset_t gWebAssets[WEB_ASSET_NUM] =",
+        "{",
+    ]
+    for uri in ordered:
+        entry = manifest[uri]
+        lines.append('    {HTTP_STR("%s"), %s, %d, %d, "\\"%s\\""},'
+                     % (uri, entry["contentType"], int(entry["gzip"]),
+                        entry["size"], entry["etag"].strip('"')))
+    lines += ["};", "", "#endif /* WEB_MANIFEST_H_ */", ""]
+    with open(header, "w") as f:
+        f.write("\n".join(lines))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("--src", default=os.path.join(HERE, "www"))
+    parser.add_argument("--dist", default=os.path.join(HERE, "dist"))
+    parser.add_argument("--header",
+                        default=os.path.join(HERE, "..", "web_manifest.h"))
+    args = parser.parse_args()
+    build(args.src, args.dist, args.header)
+
+
+if __name__ == "__main__":
+    main()
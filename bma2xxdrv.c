@@ -46,6 +46,7 @@
 /* Example/Board Header files */
 #include "bma2xxdrv.h"
 #include "out_of_box.h"
+#include "i2c_bus.h"
 
 #define FAILURE                 -1
 #define SUCCESS                 0
@@ -121,7 +122,7 @@ GetRegisterValue(I2C_Handle i2cHandle,
     i2cTransaction.readBuf = pucRegValue;
     i2cTransaction.readCount = 1;
 
-    status = I2C_transfer(i2cHandle, &i2cTransaction);
+    status = I2CBus_transfer(i2cHandle, &i2cTransaction);
 
     if(status != true)
     {
@@ -160,7 +161,7 @@ BlockRead(I2C_Handle i2cHandle,
     i2cTransaction.readBuf = pucBlkData;
     i2cTransaction.readCount = ucBlkDataSz;
 
-    status = I2C_transfer(i2cHandle, &i2cTransaction);
+    status = I2CBus_transfer(i2cHandle, &i2cTransaction);
 
     if(status != true)
     {
@@ -206,7 +207,7 @@ SetRegisterValue(I2C_Handle i2cHandle,
     i2cTransaction.readBuf = NULL;
     i2cTransaction.readCount = 0;
 
-    status = I2C_transfer(i2cHandle, &i2cTransaction);
+    status = I2CBus_transfer(i2cHandle, &i2cTransaction);
 
     if(status != true)
     {
@@ -280,35 +281,19 @@ BMA2xxRead(I2C_Handle i2cHandle,
            signed char *pcAccZ)
 {
     signed char status;
-    char cAccX = 0;
-    char cAccY = 0;
-    char cAccZ = 0;
+    signed char cAccData[5];
 
-    /* Read the accelerometer output registers LSB and MSB */
-    status = BlockRead(i2cHandle, BMA2XX_ACC_DATA_X, (unsigned char *)&cAccX,
-                       sizeof(cAccX));
-    if(status != 0)
-    {
-        return(FAILURE);
-    }
-
-    status = BlockRead(i2cHandle, BMA2XX_ACC_DATA_Y, (unsigned char *)&cAccY,
-                       sizeof(cAccY));
-    if(status != 0)
-    {
-        return(FAILURE);
-    }
-
-    status = BlockRead(i2cHandle, BMA2XX_ACC_DATA_Z, (unsigned char *)&cAccZ,
-                       sizeof(cAccZ));
+    /* X MSB up to Z MSB in one burst, the LSBs in between are not used */
+    status = BlockRead(i2cHandle, BMA2XX_ACC_DATA_X, (unsigned char *)cAccData,
+                       sizeof(cAccData));
     if(status != 0)
     {
         return(FAILURE);
     }
 
-    *pcAccX = cAccX / 6;
-    *pcAccY = cAccY / 6;
-    *pcAccZ = cAccZ / 6;
+    *pcAccX = cAccData[0] / 6;
+    *pcAccY = cAccData[2] / 6;
+    *pcAccZ = cAccData[4] / 6;
 
     return(SUCCESS);
 }
@@ -334,7 +319,7 @@ BMA2xxReadNew(I2C_Handle i2cHandle,
               signed char *pcAccZ)
 {
     signed char status;
-    char cAccX[6];
+    signed char cAccX[6];
 
     /* Read the accelerometer output registers LSB and MSB */
     status = BlockRead(i2cHandle, BMA2XX_ACC_DATA_X_NEW,(unsigned char *)cAccX,
@@ -359,6 +344,107 @@ BMA2xxReadNew(I2C_Handle i2cHandle,
     return(FAILURE);
 }
 
+//****************************************************************************
+//
+//! \brief Streams the accelerometer readings through its FIFO
+//!         1. Sets the filter bandwidth, hence the data rate.
+//!         2. Raises INT1 when the FIFO reaches the watermark.
+//!         3. Puts the FIFO in stream mode, which also empties it.
+//!
+//! \param[in]  i2cHandle   the handle to the opened i2c device
+//! \param[in]  ucBandwidth the BMA2XX_BW_xxx filter bandwidth
+//! \param[in]  ucWatermark the frame count raising INT1
+//!
+//! \return 0: Success, < 0: Failure.
+//
+//****************************************************************************
+int
+BMA2xxFifoConfig(I2C_Handle i2cHandle,
+                 unsigned char ucBandwidth,
+                 unsigned char ucWatermark)
+{
+    if(ucWatermark > BMA2XX_FIFO_MAX_FRAMES)
+    {
+        return(FAILURE);
+    }
+
+    if((SetRegisterValue(i2cHandle, BMA2XX_PMU_BW, ucBandwidth) != 0) ||
+       (SetRegisterValue(i2cHandle, BMA2XX_FIFO_CONFIG_0, ucWatermark) != 0) ||
+       (SetRegisterValue(i2cHandle, BMA2XX_INT_MAP_1,
+                         BMA2XX_INT_MAP_1_FWM) != 0) ||
+       (SetRegisterValue(i2cHandle, BMA2XX_INT_EN_1,
+                         BMA2XX_INT_EN_1_FWM) != 0) ||
+       (SetRegisterValue(i2cHandle, BMA2XX_FIFO_CONFIG_1,
+                         BMA2XX_FIFO_MODE_STREAM) != 0))
+    {
+        return(FAILURE);
+    }
+
+    return(SUCCESS);
+}
+
+//****************************************************************************
+//
+//! \brief Drains the FIFO in a single burst
+//!         1. Reads the frame count.
+//!         2. Reads the frames, oldest first.
+//!         3. Packs them in place to X, Y, Z raw readings.
+//!
+//! \param[in]  i2cHandle   the handle to the opened i2c device
+//! \param[out]     pcFrames    the frame store, BMA2XX_FIFO_FRAME_LEN bytes
+//!                             per frame, holds 3 readings per frame on return
+//! \param[in]  ucMaxFrames the number of frames the store holds
+//! \param[out]     pucOverrun  set when frames were dropped since the last
+//!                             drain
+//!
+//! \return the number of frames read: Success, < 0: Failure.
+//
+//****************************************************************************
+int
+BMA2xxFifoRead(I2C_Handle i2cHandle,
+               signed char *pcFrames,
+               unsigned char ucMaxFrames,
+               unsigned char *pucOverrun)
+{
+    unsigned char ucStatus, ucFrames, ucIdx;
+    signed char status;
+
+    status = GetRegisterValue(i2cHandle, BMA2XX_FIFO_STATUS, &ucStatus);
+    if(status != 0)
+    {
+        return(FAILURE);
+    }
+
+    *pucOverrun = ((ucStatus & BMA2XX_FIFO_OVERRUN) != 0);
+    ucFrames = ucStatus & BMA2XX_FIFO_FRAMES_MASK;
+    if(ucFrames > ucMaxFrames)
+    {
+        /* the rest stays queued for the next drain */
+        ucFrames = ucMaxFrames;
+    }
+    if(ucFrames == 0)
+    {
+        return(0);
+    }
+
+    /* the FIFO data register does not auto-increment, every byte of the
+       burst pops the next one */
+    status = BlockRead(i2cHandle, BMA2XX_FIFO_DATA, (unsigned char *)pcFrames,
+                       ucFrames * BMA2XX_FIFO_FRAME_LEN);
+    if(status != 0)
+    {
+        return(FAILURE);
+    }
+
+    /* keep the MSBs, a reading never moves past the byte it is read from */
+    for(ucIdx = 0; ucIdx < (ucFrames * 3); ucIdx++)
+    {
+        pcFrames[ucIdx] = pcFrames[(ucIdx * 2) + 1];
+    }
+
+    return(ucFrames);
+}
+
 //*****************************************************************************
 //
 // Close the Doxygen group.
@@ -67,6 +67,33 @@ extern "C"
 #define BMA2XX_ACC_DATA_Z_NEW   (0x6)
 #define BMA2XX_ACC_DATA_Z       (0x7)
 
+//*****************************************************************************
+// BMA2xx FIFO related macros
+//*****************************************************************************
+#define BMA2XX_FIFO_STATUS      (0x0E)
+#define BMA2XX_PMU_BW           (0x10)
+#define BMA2XX_INT_EN_1         (0x17)
+#define BMA2XX_INT_MAP_1        (0x1A)
+#define BMA2XX_FIFO_CONFIG_0    (0x30)
+#define BMA2XX_FIFO_CONFIG_1    (0x3E)
+#define BMA2XX_FIFO_DATA        (0x3F)
+
+#define BMA2XX_FIFO_OVERRUN     (0x80)
+#define BMA2XX_FIFO_FRAMES_MASK (0x7F)
+#define BMA2XX_INT_EN_1_FWM     (0x40)
+#define BMA2XX_INT_MAP_1_FWM    (0x02)      /* watermark on INT1 */
+#define BMA2XX_FIFO_MODE_STREAM (0x80)      /* XYZ frames, oldest dropped */
+
+/* filter bandwidth, the data rate is twice the bandwidth */
+#define BMA2XX_BW_31_25HZ       (0x0A)
+#define BMA2XX_BW_62_5HZ        (0x0B)
+#define BMA2XX_BW_125HZ         (0x0C)
+
+/* a frame is the LSB and MSB of the three axes, only the MSB holds data
+   in 8 bit resolution */
+#define BMA2XX_FIFO_FRAME_LEN   (6)
+#define BMA2XX_FIFO_MAX_FRAMES  (32)
+
 //*****************************************************************************
 // BMA2xx Data Interpretation macros
 //*****************************************************************************
@@ -140,6 +167,46 @@ int BMA2xxReadNew(I2C_Handle i2cHandle,
 //****************************************************************************
 int BMA2xxClose();
 
+//****************************************************************************
+//
+//! \brief Streams the accelerometer readings through its FIFO
+//!         1. Sets the filter bandwidth, hence the data rate.
+//!         2. Raises INT1 when the FIFO reaches the watermark.
+//!         3. Puts the FIFO in stream mode, which also empties it.
+//!
+//! \param[in]  i2cHandle   the handle to the opened i2c device
+//! \param[in]  ucBandwidth the BMA2XX_BW_xxx filter bandwidth
+//! \param[in]  ucWatermark the frame count raising INT1
+//!
+//! \return 0: Success, < 0: Failure.
+//
+//****************************************************************************
+int BMA2xxFifoConfig(I2C_Handle i2cHandle,
+                     unsigned char ucBandwidth,
+                     unsigned char ucWatermark);
+
+//****************************************************************************
+//
+//! \brief Drains the FIFO in a single burst
+//!         1. Reads the frame count.
+//!         2. Reads the frames, oldest first.
+//!         3. Packs them in place to X, Y, Z raw readings.
+//!
+//! \param[in]  i2cHandle   the handle to the opened i2c device
+//! \param[out]     pcFrames    the frame store, BMA2XX_FIFO_FRAME_LEN bytes
+//!                             per frame, holds 3 readings per frame on return
+//! \param[in]  ucMaxFrames the number of frames the store holds
+//! \param[out]     pucOverrun  set when frames were dropped since the last
+//!                             drain
+//!
+//! \return the number of frames read: Success, < 0: Failure.
+//
+//****************************************************************************
+int BMA2xxFifoRead(I2C_Handle i2cHandle,
+                   signed char *pcFrames,
+                   unsigned char ucMaxFrames,
+                   unsigned char *pucOverrun);
+
 //*****************************************************************************
 //
 // Mark the end of the C bindings section for C++ compilers.
@@ -41,6 +41,7 @@
 #include <ti/drivers/I2C.h>
 #include <ti/display/Display.h>
 #include "bme280.h"
+#include "i2c_bus.h"
 
 
 #include <stdint.h>
@@ -49,24 +50,50 @@
 
 
 
-static I2C_Handle i2cbus;  /// @brief Local persistent copy of the I2C Handle passed during BME280_init()
-static uint8_t i2cAddr;  /// @brief Local persistent copy of the I2C slave address specified during BME280_init()
-static uint8_t _bme280_calibration[33];  /// @brief Local persistent copy of the BME280's unique calibration values discovered during BME280_open()
-static uint8_t _bme280_ctrl_meas;  /// @brief Local copy of CTRL_MEAS settings, to save current OSRS params when modifying CTRL_MEAS:mode[]
+/// @brief Register settings of a profile, CTRL_MEAS without the mode bits
+typedef struct {
+	uint8_t ctrl_hum;
+	uint8_t ctrl_meas;
+	uint8_t config;
+} BME280_ProfileSettings;
+
+/// @brief Settings follow the datasheet section 3.5 recommendations, adapted to an indoor enclosure
+static const BME280_ProfileSettings _bme280_profiles[BME280_Profile_Max] = {
+	[BME280_Profile_LowPower] = {
+		BME280_CTRL_HUM_OSRS__1,
+		BME280_CTRL_MEAS_OSRS_T__1 | BME280_CTRL_MEAS_OSRS_P__1,
+		BME280_CONFIG_STANDBY_TIME__1000 | (BME280_CONFIG_IIR_FILTER_COEF__OFF << BME280_CONFIG_IIR_FILTER_SHIFT)
+	},
+	[BME280_Profile_Balanced] = {
+		BME280_CTRL_HUM_OSRS__2,
+		BME280_CTRL_MEAS_OSRS_T__2 | BME280_CTRL_MEAS_OSRS_P__4,
+		BME280_CONFIG_STANDBY_TIME__250 | (BME280_CONFIG_IIR_FILTER_COEF__4 << BME280_CONFIG_IIR_FILTER_SHIFT)
+	},
+	[BME280_Profile_HighResolution] = {
+		BME280_CTRL_HUM_OSRS__4,
+		BME280_CTRL_MEAS_OSRS_T__4 | BME280_CTRL_MEAS_OSRS_P__16,
+		BME280_CONFIG_STANDBY_TIME__62_5 | (BME280_CONFIG_IIR_FILTER_COEF__16 << BME280_CONFIG_IIR_FILTER_SHIFT)
+	},
+};
 
 /// @brief Driver initialization
-/// @details Performed by user with a known-valid I2C_Handle and slave address
-void BME280_init(I2C_Handle hand, uint8_t addr)
+/// @details Performed by user with a known-valid I2C_Handle and slave address, once per device.
+///          The object behind <handle> is owned by the caller and must outlive the driver use.
+void BME280_init(BME280_Handle handle, I2C_Handle hand, uint8_t addr)
 {
-	i2cbus = hand;
-	i2cAddr = addr;
+	handle->i2cbus = hand;
+	handle->i2cAddr = addr;
+	handle->ctrl_meas = 0;
+	handle->ctrl_hum = 0;
+	handle->profile = BME280_Profile_Max;
+	handle->txnError = false;
 }
 
 /// @brief Make contact with the chip and read calibration registers
 /// @details This function checks the CHIP_ID register to verify we're talking to a Bosch Sensortec BME280
 ///          and then pulls the calibration constants into a local persistent buffer.
 /// @returns true if everything goes well, false if I2C communication fails or if the CHIP_ID is not correct.
-bool BME280_open()
+bool BME280_open(BME280_Handle handle)
 {
 	uint8_t readId;
 
@@ -74,42 +101,58 @@ bool BME280_open()
 	vTaskDelay(BME280_RESET_SETTLING_TIME);
 
 	// Find Chip ID
-	readId = BME280_readReg(BME280_REG_ID);
+	readId = BME280_readReg(handle, BME280_REG_ID);
 	if (readId != 0x60) { // Not a BME280?
         #ifdef BME280_DEBUG_OPEN
 	    UART_PRINT("Error: BME280_open() read I2C bus for CHIP_ID and found invalid ID!\r\n");
         #endif
 		return false;
 	}
-	BME280_writeReg(BME280_REG_RESET, BME280_RESET_ASSERT);
+	BME280_writeReg(handle, BME280_REG_RESET, BME280_RESET_ASSERT);
 	vTaskDelay(BME280_RESET_SETTLING_TIME);
 	#ifdef BME280_DEBUG_OPEN
-	UART_PRINT("BME280_open: post-softreset ctrl_meas: %u\r\n", BME280_readReg(BME280_REG_CTRL_MEAS));
+	UART_PRINT("BME280_open: post-softreset ctrl_meas: %u\r\n", BME280_readReg(handle, BME280_REG_CTRL_MEAS));
 	#endif
 
 	// Read calibration constants and init chip parameters
 	I2C_Transaction txn;
 	uint8_t regAddr;
-	txn.slaveAddress = i2cAddr;
+	uint8_t calib[BME280_CALIB00_LEN + BME280_CALIB26_LEN];
+	txn.slaveAddress = handle->i2cAddr;
 	txn.writeBuf = &regAddr;
 	txn.writeCount = 1;
 
+	handle->txnError = false;
 	regAddr = BME280_REG_CALIB00;
-	txn.readBuf = &_bme280_calibration[0];
-	txn.readCount = 26;
-	I2C_transfer(i2cbus, &txn);
+	txn.readBuf = &calib[0];
+	txn.readCount = BME280_CALIB00_LEN;
+	if (!I2CBus_transfer(handle->i2cbus, &txn)) {
+		handle->txnError = true;
+	}
 	regAddr = BME280_REG_CALIB26;
-	txn.readBuf = &_bme280_calibration[26];
-	txn.readCount = 6;
-	I2C_transfer(i2cbus, &txn);
+	txn.readBuf = &calib[BME280_CALIB00_LEN];
+	txn.readCount = BME280_CALIB26_LEN;
+	if (!I2CBus_transfer(handle->i2cbus, &txn)) {
+		handle->txnError = true;
+	}
+	if (handle->txnError) {  // a partial block would compensate every reading wrong
+        #ifdef BME280_DEBUG_OPEN
+	    UART_PRINT("Error: BME280_open() could not read the calibration registers!\r\n");
+        #endif
+		return false;
+	}
+	BME280_parseCalibration(calib, &calib[BME280_CALIB00_LEN], &handle->cal);
 
-	BME280_writeReg(BME280_REG_CTRL_HUM, BME280_CTRL_HUM_OSRS__4);                // defaults we're using
-	_bme280_ctrl_meas = BME280_CTRL_MEAS_OSRS_T__4 | BME280_CTRL_MEAS_OSRS_P__4;  //
-	BME280_writeReg(BME280_REG_CTRL_MEAS, _bme280_ctrl_meas | BME280_CTRL_MEAS_MODE_SLEEP);
+	if (!BME280_setProfile(handle, BME280_PROFILE_DEFAULT)) {
+        #ifdef BME280_DEBUG_OPEN
+	    UART_PRINT("Error: BME280_open() could not apply the default profile!\r\n");
+        #endif
+		return false;
+	}
 
 	#ifdef BME280_DEBUG_OPEN
-	UART_PRINT("BME280_open: post-config ctrl_meas: %u\r\n", BME280_readReg(BME280_REG_CTRL_MEAS));
-	UART_PRINT("BME280_open: post-config status: %u\r\n", BME280_readReg(BME280_REG_STATUS));
+	UART_PRINT("BME280_open: post-config ctrl_meas: %u\r\n", BME280_readReg(handle, BME280_REG_CTRL_MEAS));
+	UART_PRINT("BME280_open: post-config status: %u\r\n", BME280_readReg(handle, BME280_REG_STATUS));
 
 	#endif
 
@@ -117,15 +160,17 @@ bool BME280_open()
 }
 
 /// @brief Reset chip
-bool BME280_close()
+bool BME280_close(BME280_Handle handle)
 {
-	BME280_writeReg(BME280_REG_RESET, BME280_RESET_ASSERT);
-	_bme280_ctrl_meas = 0;
+	BME280_writeReg(handle, BME280_REG_RESET, BME280_RESET_ASSERT);
+	handle->ctrl_meas = 0;
+	handle->ctrl_hum = 0;
+	handle->profile = BME280_Profile_Max;
 	return true;
 }
 
 /// @brief Internal API call for setting the current memory pointer.  Not used anywhere though...
-void BME280_setAddress(uint8_t memAddress)
+void BME280_setAddress(BME280_Handle handle, uint8_t memAddress)
 {
 	I2C_Transaction txn;
 	uint8_t regAddr = memAddress;
@@ -134,13 +179,15 @@ void BME280_setAddress(uint8_t memAddress)
 	txn.readCount = 0;
 	txn.writeBuf = &regAddr;
 	txn.writeCount = 1;
-	txn.slaveAddress = i2cAddr;
+	txn.slaveAddress = handle->i2cAddr;
 
-	I2C_transfer(i2cbus, &txn);
+	if (!I2CBus_transfer(handle->i2cbus, &txn)) {
+		handle->txnError = true;
+	}
 }
 
 /// @brief Write a single 8-bit value to a specified memory address
-void BME280_writeReg(uint8_t memAddress, uint8_t value)
+void BME280_writeReg(BME280_Handle handle, uint8_t memAddress, uint8_t value)
 {
 	I2C_Transaction txn;
 	uint8_t wrBuf[2];
@@ -149,16 +196,18 @@ void BME280_writeReg(uint8_t memAddress, uint8_t value)
 	txn.readCount = 0;
 	txn.writeBuf = wrBuf;
 	txn.writeCount = 2;
-	txn.slaveAddress = i2cAddr;
+	txn.slaveAddress = handle->i2cAddr;
 
 	wrBuf[0] = memAddress;
 	wrBuf[1] = value;
 
-	I2C_transfer(i2cbus, &txn);
+	if (!I2CBus_transfer(handle->i2cbus, &txn)) {
+		handle->txnError = true;
+	}
 }
 
 /// @brief Read a single 8-bit value from the specified memory address
-uint8_t BME280_readReg(uint8_t memAddress)
+uint8_t BME280_readReg(BME280_Handle handle, uint8_t memAddress)
 {
 	I2C_Transaction txn;
 	uint8_t regAddr = memAddress;
@@ -168,14 +217,16 @@ uint8_t BME280_readReg(uint8_t memAddress)
 	txn.readCount = 1;
 	txn.writeBuf = &regAddr;
 	txn.writeCount = 1;
-	txn.slaveAddress = i2cAddr;
+	txn.slaveAddress = handle->i2cAddr;
 
-	I2C_transfer(i2cbus, &txn);
+	if (!I2CBus_transfer(handle->i2cbus, &txn)) {
+		handle->txnError = true;
+	}
 	return rdBuf;
 }
 
 /// @brief Read a 16-bit value Big-Endian from the specified memory address
-uint16_t BME280_readWord(uint8_t memAddress)
+uint16_t BME280_readWord(BME280_Handle handle, uint8_t memAddress)
 {
 	I2C_Transaction txn;
 	uint8_t regAddr = memAddress;
@@ -185,14 +236,16 @@ uint16_t BME280_readWord(uint8_t memAddress)
 	txn.readCount = 2;
 	txn.writeBuf = &regAddr;
 	txn.writeCount = 1;
-	txn.slaveAddress = i2cAddr;
+	txn.slaveAddress = handle->i2cAddr;
 
-	I2C_transfer(i2cbus, &txn);
+	if (!I2CBus_transfer(handle->i2cbus, &txn)) {
+		handle->txnError = true;
+	}
 	return ((uint16_t)rdBuf[0] << 8) | (uint16_t)rdBuf[1];
 }
 
 /// @brief Read a 20-bit (MSB/LSB/XLSB) Big-Endian value from the specified memory address
-uint32_t BME280_readWord20(uint8_t memAddress)
+uint32_t BME280_readWord20(BME280_Handle handle, uint8_t memAddress)
 {
 	I2C_Transaction txn;
 	uint8_t regAddr = memAddress;
@@ -202,16 +255,49 @@ uint32_t BME280_readWord20(uint8_t memAddress)
 	txn.readCount = 3;
 	txn.writeBuf = &regAddr;
 	txn.writeCount = 1;
-	txn.slaveAddress = i2cAddr;
+	txn.slaveAddress = handle->i2cAddr;
 
-	I2C_transfer(i2cbus, &txn);
+	if (!I2CBus_transfer(handle->i2cbus, &txn)) {
+		handle->txnError = true;
+	}
 	return ((uint32_t)rdBuf[0] << 12) | ((uint32_t)rdBuf[1] << 4) | ((uint32_t)rdBuf[2] >> 4);
 }
 
-/// @brief Internal buffer used to hold last-known raw data
-/// @details When BME280_readMeasurements() returns a pointer to a BME280_RawData struct, it always
-///          returns a pointer to this buffer.
-static BME280_RawData _rawData;
+
+/// @brief Burst read of the data registers into handle->rawData
+static BME280_RawData * _bme280_readData(BME280_Handle handle)
+{
+	I2C_Transaction txn;
+	uint8_t regAddr = BME280_REG_PRESSURE;
+	uint8_t rdBuf[8];
+
+	txn.readBuf = &rdBuf;
+	txn.readCount = 8;
+	txn.writeBuf = &regAddr;
+	txn.writeCount = 1;
+	txn.slaveAddress = handle->i2cAddr;
+
+	if (!I2CBus_transfer(handle->i2cbus, &txn)) {
+		handle->txnError = true;
+		return NULL;
+	}
+
+	// Fan out results
+	handle->rawData.humidity_raw = ((uint16_t)rdBuf[6] << 8) | (uint16_t)rdBuf[7];
+	handle->rawData.temperature_raw = ((uint32_t)rdBuf[3] << 12) | ((uint32_t)rdBuf[4] << 4) | ((uint32_t)rdBuf[5] >> 4);
+	handle->rawData.pressure_raw = ((uint32_t)rdBuf[0] << 12) | ((uint32_t)rdBuf[1] << 4) | ((uint32_t)rdBuf[2] >> 4);
+
+	return &handle->rawData;
+}
+
+/// @brief Oversampling ratio encoded by a 3-bit OSRS field
+static uint16_t _bme280_osrs_ratio(uint8_t osrs)
+{
+	if (osrs == 0) {
+		return 0;
+	}
+	return (osrs >= 5) ? 16 : (1 << (osrs - 1));
+}
 
 /// @brief Collect current data
 /// @details This will first poll the STATUS register to ascertain no measurements are in progress; if they are, it
@@ -219,13 +305,16 @@ static BME280_RawData _rawData;
 ///          be run within Task context e.g. not within a Swi or a Clock callback.
 ///          The STATUS register poll will start with a 2ms sleep and double the time until <timeout> is exceeded.
 ///          When timeout = 0, it will poll indefinitely.
-BME280_RawData * BME280_readMeasurements(uint16_t timeout)
+BME280_RawData * BME280_readMeasurements(BME280_Handle handle, uint16_t timeout)
 {
 	uint16_t status_delay = BME280_STATUS_MINIMUM_WAIT;
 	uint32_t total_delay = 0;
 
-
-	while (  BME280_readReg(BME280_REG_STATUS) & (BME280_STATUS_MEASURING | BME280_STATUS_IM_UPDATE) ) {
+	handle->txnError = false;
+	while (  BME280_readReg(handle, BME280_REG_STATUS) & (BME280_STATUS_MEASURING | BME280_STATUS_IM_UPDATE) ) {
+		if (handle->txnError) {
+			return NULL;  // a chip that does not answer is never done
+		}
 
 		vTaskDelay(status_delay);  // Poll until complete or timeout
 		total_delay += status_delay;
@@ -240,181 +329,255 @@ BME280_RawData * BME280_readMeasurements(uint16_t timeout)
 
 	}
 
-	I2C_Transaction txn;
-	uint8_t regAddr = BME280_REG_PRESSURE;
-	uint8_t rdBuf[8];
+	return _bme280_readData(handle);
+}
 
-	txn.readBuf = &rdBuf;
-	txn.readCount = 8;
-	txn.writeBuf = &regAddr;
-	txn.writeCount = 1;
-	txn.slaveAddress = i2cAddr;
+/// @brief Initiate a Forced measurement, poll to completion, read & return raw data
+/// @details By default after BME280_open(), measurement is 4x oversampling, no IIR filter on Pressure.
+BME280_RawData * BME280_read(BME280_Handle handle)
+{
+	if (handle->profile != BME280_Profile_Max) {
+		return _bme280_readData(handle);  // normal mode, the data registers always hold a complete result
+	}
 
-	I2C_transfer(i2cbus, &txn);
+	vTaskDelay(pdMS_TO_TICKS(BME280_startMeasurement(handle)));
+	if (handle->txnError) {
+		return NULL;
+	}
 
-	// Fan out results
-	_rawData.humidity_raw = ((uint16_t)rdBuf[6] << 8) | (uint16_t)rdBuf[7];
-	_rawData.temperature_raw = ((uint32_t)rdBuf[3] << 12) | ((uint32_t)rdBuf[4] << 4) | ((uint32_t)rdBuf[5] >> 4);
-	_rawData.pressure_raw = ((uint32_t)rdBuf[0] << 12) | ((uint32_t)rdBuf[1] << 4) | ((uint32_t)rdBuf[2] >> 4);
+	return BME280_readMeasurements(handle, BME280_READ_TIMEOUT);
+}
 
-	return &_rawData;
+/// @brief Worst case conversion time in milliseconds of a Forced measurement
+/// @details t_max = 1.25 + 2.3 * T_osrs + (2.3 * P_osrs + 0.575) + (2.3 * H_osrs + 0.575) ms,
+///          a skipped measurement adds nothing.  Rounded up to whole milliseconds.
+uint16_t BME280_measurementTime(BME280_Handle handle)
+{
+	uint16_t osrs_t = _bme280_osrs_ratio((handle->ctrl_meas >> 5) & 0x07);
+	uint16_t osrs_p = _bme280_osrs_ratio((handle->ctrl_meas >> 2) & 0x07);
+	uint16_t osrs_h = _bme280_osrs_ratio(handle->ctrl_hum & 0x07);
+	uint32_t time_us = 1250 + 2300 * osrs_t;
+
+	if (osrs_p) {
+		time_us += 2300 * osrs_p + 575;
+	}
+	if (osrs_h) {
+		time_us += 2300 * osrs_h + 575;
+	}
+
+	return (time_us + 999) / 1000;
 }
 
-/// @brief Initiate a Forced measurement, poll to completion, read & return raw data
-/// @details By default after BME280_open(), measurement is 4x oversampling, no IIR filter on Pressure.
-BME280_RawData * BME280_read()
+/// @brief Initiate a Forced measurement and return without waiting for it
+/// @details The chip returns to sleep mode by itself when the conversion is done.
+uint16_t BME280_startMeasurement(BME280_Handle handle)
 {
-	BME280_writeReg(BME280_REG_CTRL_MEAS, BME280_CTRL_MEAS_MODE_FORCED | _bme280_ctrl_meas);
-	vTaskDelay(BME280_STATUS_MINIMUM_WAIT);
+	handle->txnError = false;
+	if (handle->profile != BME280_Profile_Max) {
+		return 0;  // free-running
+	}
 
-	return BME280_readMeasurements(0);
+	BME280_writeReg(handle, BME280_REG_CTRL_MEAS, BME280_CTRL_MEAS_MODE_FORCED | handle->ctrl_meas);
+
+	return BME280_measurementTime(handle);
+}
+
+/// @brief Collect the results of a measurement started with BME280_startMeasurement()
+/// @details Single STATUS poll, returns NULL while MEASURING or IM_UPDATE is set, or if a transfer failed
+///          (handle->txnError tells them apart).
+BME280_RawData * BME280_collect(BME280_Handle handle)
+{
+	handle->txnError = false;
+	if (handle->profile != BME280_Profile_Max) {
+		return _bme280_readData(handle);
+	}
+
+	if (BME280_readReg(handle, BME280_REG_STATUS) & (BME280_STATUS_MEASURING | BME280_STATUS_IM_UPDATE)) {
+		return NULL;
+	}
+
+	return _bme280_readData(handle);
+}
+
+/// @brief Put the chip in normal mode with the settings of a profile
+/// @details CONFIG writes are only reliable in sleep mode, and CTRL_HUM only takes effect on the next
+///          CTRL_MEAS write, so the chip is stopped first and restarted last.
+bool BME280_setProfile(BME280_Handle handle, BME280_Profile profile)
+{
+	const BME280_ProfileSettings *settings;
+	uint8_t ctrl_meas;
+
+	if (profile >= BME280_Profile_Max) {
+		return false;
+	}
+	settings = &_bme280_profiles[profile];
+
+	BME280_writeReg(handle, BME280_REG_CTRL_MEAS, handle->ctrl_meas | BME280_CTRL_MEAS_MODE_SLEEP);
+	BME280_writeReg(handle, BME280_REG_CONFIG, settings->config);
+	BME280_writeReg(handle, BME280_REG_CTRL_HUM, settings->ctrl_hum);
+	BME280_writeReg(handle, BME280_REG_CTRL_MEAS, settings->ctrl_meas | BME280_CTRL_MEAS_MODE_NORMAL);
+
+	ctrl_meas = BME280_readReg(handle, BME280_REG_CTRL_MEAS);
+	if (ctrl_meas != (settings->ctrl_meas | BME280_CTRL_MEAS_MODE_NORMAL)) {
+		#ifdef BME280_DEBUG_OPEN
+		UART_PRINT("BME280_setProfile: ctrl_meas readback %u\r\n", ctrl_meas);
+		#endif
+		handle->profile = BME280_Profile_Max;
+		return false;
+	}
+
+	handle->ctrl_hum = settings->ctrl_hum;
+	handle->ctrl_meas = settings->ctrl_meas;
+	handle->profile = profile;
+
+	return true;
 }
 
-/* Calibration positions */
-#define BME280_CALIBOFFSET_U16LE_dig_T1          0
-#define BME280_CALIBOFFSET_S16LE_dig_T2          2
-#define BME280_CALIBOFFSET_S16LE_dig_T3          4
-#define BME280_CALIBOFFSET_U16LE_dig_P1          6
-#define BME280_CALIBOFFSET_S16LE_dig_P2          8
-#define BME280_CALIBOFFSET_S16LE_dig_P3          10
-#define BME280_CALIBOFFSET_S16LE_dig_P4          12
-#define BME280_CALIBOFFSET_S16LE_dig_P5          14
-#define BME280_CALIBOFFSET_S16LE_dig_P6          16
-#define BME280_CALIBOFFSET_S16LE_dig_P7          18
-#define BME280_CALIBOFFSET_S16LE_dig_P8          20
-#define BME280_CALIBOFFSET_S16LE_dig_P9          22
-#define BME280_CALIBOFFSET_U8_dig_H1             25
-#define BME280_CALIBOFFSET_S16LE_dig_H2          26
-#define BME280_CALIBOFFSET_U8_dig_H3             28
-#define BME280_CALIBOFFSET_S16LE_dig_H4          29
-#define BME280_CALIBOFFSET_S16LE_dig_H5          30
-#define BME280_CALIBOFFSET_S8_dig_H6             32
-
-#define BME280_dig_T1 ( _bme280_compute_U16LE(_bme280_calibration[BME280_CALIBOFFSET_U16LE_dig_T1], _bme280_calibration[BME280_CALIBOFFSET_U16LE_dig_T1+1]) )
-#define BME280_dig_T2 ( _bme280_compute_S16LE(_bme280_calibration[BME280_CALIBOFFSET_S16LE_dig_T2], _bme280_calibration[BME280_CALIBOFFSET_S16LE_dig_T2+1]) )
-#define BME280_dig_T3 ( _bme280_compute_S16LE(_bme280_calibration[BME280_CALIBOFFSET_S16LE_dig_T3], _bme280_calibration[BME280_CALIBOFFSET_S16LE_dig_T3+1]) )
-#define BME280_dig_P1 ( _bme280_compute_U16LE(_bme280_calibration[BME280_CALIBOFFSET_U16LE_dig_P1], _bme280_calibration[BME280_CALIBOFFSET_U16LE_dig_P1+1]) )
-#define BME280_dig_P2 ( _bme280_compute_S16LE(_bme280_calibration[BME280_CALIBOFFSET_S16LE_dig_P2], _bme280_calibration[BME280_CALIBOFFSET_S16LE_dig_P2+1]) )
-#define BME280_dig_P3 ( _bme280_compute_S16LE(_bme280_calibration[BME280_CALIBOFFSET_S16LE_dig_P3], _bme280_calibration[BME280_CALIBOFFSET_S16LE_dig_P3+1]) )
-#define BME280_dig_P4 ( _bme280_compute_S16LE(_bme280_calibration[BME280_CALIBOFFSET_S16LE_dig_P4], _bme280_calibration[BME280_CALIBOFFSET_S16LE_dig_P4+1]) )
-#define BME280_dig_P5 ( _bme280_compute_S16LE(_bme280_calibration[BME280_CALIBOFFSET_S16LE_dig_P5], _bme280_calibration[BME280_CALIBOFFSET_S16LE_dig_P5+1]) )
-#define BME280_dig_P6 ( _bme280_compute_S16LE(_bme280_calibration[BME280_CALIBOFFSET_S16LE_dig_P6], _bme280_calibration[BME280_CALIBOFFSET_S16LE_dig_P6+1]) )
-#define BME280_dig_P7 ( _bme280_compute_S16LE(_bme280_calibration[BME280_CALIBOFFSET_S16LE_dig_P7], _bme280_calibration[BME280_CALIBOFFSET_S16LE_dig_P7+1]) )
-#define BME280_dig_P8 ( _bme280_compute_S16LE(_bme280_calibration[BME280_CALIBOFFSET_S16LE_dig_P8], _bme280_calibration[BME280_CALIBOFFSET_S16LE_dig_P8+1]) )
-#define BME280_dig_P9 ( _bme280_compute_S16LE(_bme280_calibration[BME280_CALIBOFFSET_S16LE_dig_P9], _bme280_calibration[BME280_CALIBOFFSET_S16LE_dig_P9+1]) )
-#define BME280_dig_H1 ( (uint8_t)_bme280_calibration[BME280_CALIBOFFSET_U8_dig_H1] )
-#define BME280_dig_H2 ( _bme280_compute_S16LE(_bme280_calibration[BME280_CALIBOFFSET_S16LE_dig_H2], _bme280_calibration[BME280_CALIBOFFSET_S16LE_dig_H2+1]) )
-#define BME280_dig_H3 ( (uint8_t)_bme280_calibration[BME280_CALIBOFFSET_U8_dig_H3] )
-#define BME280_dig_H4 ( _bme280_compute_H4(_bme280_calibration[BME280_CALIBOFFSET_S16LE_dig_H4], _bme280_calibration[BME280_CALIBOFFSET_S16LE_dig_H4+1]) )
-#define BME280_dig_H5 ( _bme280_compute_H5(_bme280_calibration[BME280_CALIBOFFSET_S16LE_dig_H5], _bme280_calibration[BME280_CALIBOFFSET_S16LE_dig_H5+1]) )
-#define BME280_dig_H6 ( (int8_t)_bme280_calibration[BME280_CALIBOFFSET_S8_dig_H6] )
-
-inline int16_t _bme280_compute_S16LE(uint8_t r0, uint8_t r1)
+/// @brief Profile currently applied, BME280_Profile_Max if the chip is in sleep/forced mode
+BME280_Profile BME280_getProfile(BME280_Handle handle)
 {
-	int16_t value = 0;
-	uint16_t w0 = (uint16_t)r0, w1 = (uint16_t)r1;
+	return handle->profile;
+}
+
+/// @brief Little-endian 16-bit words of the calibration block
+#define _BME280_U16LE(b, i) ( (uint16_t)(((uint16_t)(b)[(i) + 1] << 8) | (b)[(i)]) )
+#define _BME280_S16LE(b, i) ( (int16_t)_BME280_U16LE(b, i) )
 
-	value = w1 << 8 | w0;
-	return value;
+/// @brief Decode the calibration registers
+/// @details Layout from the datasheet table 16.  dig_H4 and dig_H5 are signed 12-bit values sharing
+///          register 0xE5, their upper byte (0xE4, 0xE6) carries the sign.
+void BME280_parseCalibration(const uint8_t *calib00, const uint8_t *calib26, BME280_Calibration *cal)
+{
+	cal->dig_T1 = _BME280_U16LE(calib00, 0);
+	cal->dig_T2 = _BME280_S16LE(calib00, 2);
+	cal->dig_T3 = _BME280_S16LE(calib00, 4);
+	cal->dig_P1 = _BME280_U16LE(calib00, 6);
+	cal->dig_P2 = _BME280_S16LE(calib00, 8);
+	cal->dig_P3 = _BME280_S16LE(calib00, 10);
+	cal->dig_P4 = _BME280_S16LE(calib00, 12);
+	cal->dig_P5 = _BME280_S16LE(calib00, 14);
+	cal->dig_P6 = _BME280_S16LE(calib00, 16);
+	cal->dig_P7 = _BME280_S16LE(calib00, 18);
+	cal->dig_P8 = _BME280_S16LE(calib00, 20);
+	cal->dig_P9 = _BME280_S16LE(calib00, 22);
+	cal->dig_H1 = calib00[25];
+
+	cal->dig_H2 = _BME280_S16LE(calib26, 0);
+	cal->dig_H3 = calib26[2];
+	cal->dig_H4 = (int16_t)(((int16_t)(int8_t)calib26[3] * 16) | (calib26[4] & 0x0F));
+	cal->dig_H5 = (int16_t)(((int16_t)(int8_t)calib26[5] * 16) | (calib26[4] >> 4));
+	cal->dig_H6 = (int8_t)calib26[6];
 }
 
-inline uint16_t _bme280_compute_U16LE(uint8_t r0, uint8_t r1)
+/// @brief Calibration decoded by BME280_open()
+const BME280_Calibration * BME280_getCalibration(BME280_Handle handle)
 {
-	uint16_t value = 0;
-	uint16_t w0 = (uint16_t)r0, w1 = (uint16_t)r1;
+	return &handle->cal;
+}
 
-	value = w1 << 8 | w0;
-	return value;
+/* These compensation equations are derived from BME280 datasheet pseudocode, page 23 & 24.
+   Every step takes t_fine as an argument, so one sample never depends on another. */
+
+/// @brief Fine resolution temperature, shared by the three compensations
+static inline int32_t _bme280_t_fine(const BME280_Calibration *cal, int32_t adc_T)
+{
+	int32_t var1, var2;
+
+	var1 = ((((adc_T >> 3) - ((int32_t)cal->dig_T1 << 1))) * ((int32_t)cal->dig_T2)) >> 11;
+	var2 = (((((adc_T >> 4) - (int32_t)cal->dig_T1) * ((adc_T >> 4) - (int32_t)cal->dig_T1)) >> 12) * (int32_t)cal->dig_T3) >> 14;
+
+	return var1 + var2;
 }
 
-inline int16_t _bme280_compute_H4(uint8_t e4, uint8_t e5)
+/// @brief Pressure in Pa, Q24.8
+static inline uint32_t _bme280_pressure(const BME280_Calibration *cal, int32_t t_fine, int32_t adc_P)
 {
-	int16_t value = 0;
-	// No sign extension necessary per empirical testing...
-	value |= ((uint16_t)e4) << 4;
-	value |= e5 & 0x0F;
-	return value;
+	int64_t var1, var2, p;
+
+	var1 = (int64_t)t_fine - 128000;
+	var2 = var1 * var1 * (int64_t)cal->dig_P6;
+	var2 = var2 + ((var1 * (int64_t)cal->dig_P5) << 17);
+	var2 = var2 + (((int64_t)cal->dig_P4) << 35);
+	var1 = ((var1 * var1 * (int64_t)cal->dig_P3) >> 8) + ((var1 * (int64_t)cal->dig_P2) << 12);
+	var1 = (((((int64_t)1) << 47) + var1)) * ((int64_t)cal->dig_P1) >> 33;
+	if (var1 == 0) {
+		return 0;  // avoid exception caused by divide by zero
+	}
+	p = 1048576 - adc_P;
+	p = (((p << 31) - var2) * 3125) / var1;
+	var1 = (((int64_t)cal->dig_P9) * (p >> 13) * (p >> 13)) >> 25;
+	var2 = (((int64_t)cal->dig_P8) * p) >> 19;
+	p = ((p + var1 + var2) >> 8) + (((int64_t)cal->dig_P7) << 4);
+
+	return (uint32_t)p;
 }
 
-inline int16_t _bme280_compute_H5(uint8_t e5, uint8_t e6)
+/// @brief Relative humidity in %, Q22.10
+static inline uint32_t _bme280_humidity(const BME280_Calibration *cal, int32_t t_fine, int32_t adc_H)
 {
-	int16_t value = 0;
-	// No sign extension necessary per empirical testing...
-	value |= ((uint16_t)e6) << 4;
-	value |= e5 >> 4;
-	return value;
+	int32_t v_x1_u32r;
+
+	v_x1_u32r = t_fine - ((int32_t)76800);
+	v_x1_u32r = (((((adc_H << 14) - (((int32_t)cal->dig_H4) << 20) - (((int32_t)cal->dig_H5) * v_x1_u32r)) \
+			+ ((int32_t)16384)) >> 15) * (((((((v_x1_u32r * ((int32_t)cal->dig_H6)) >> 10) \
+			* (((v_x1_u32r * ((int32_t)cal->dig_H3)) >> 11) + ((int32_t)32768))) >> 10) + ((int32_t)2097152)) \
+			* ((int32_t)cal->dig_H2) + 8192) >> 14));
+	v_x1_u32r = (v_x1_u32r - (((((v_x1_u32r >> 15) * (v_x1_u32r >> 15)) >> 7) \
+			* ((int32_t)cal->dig_H1)) >> 4));
+	v_x1_u32r = (v_x1_u32r < 0 ? 0 : v_x1_u32r);
+	v_x1_u32r = (v_x1_u32r > 419430400 ? 419430400 : v_x1_u32r);
+
+	return (uint32_t)(v_x1_u32r >> 12);
 }
 
-/* These compensation equations are derived from BME280 datasheet pseudocode, page 23 & 24 */
-static int32_t _t_fine;
+/// @brief Compensate raw samples into temperature, pressure and humidity
+/// @details Pure function, safe to call from any task and on samples of any BME280 given its calibration.
+///          Raw values are 20/16-bit unsigned, no sign extension is needed.
+void BME280_compensate(const BME280_Calibration *cal, const BME280_RawData *raw, BME280_Compensated *out, uint16_t count)
+{
+	int32_t t_fine;
+
+	while (count--) {
+		t_fine = _bme280_t_fine(cal, (int32_t)raw->temperature_raw);
+		out->temperature = (t_fine * 5 + 128) >> 8;
+		out->pressure = _bme280_pressure(cal, t_fine, (int32_t)raw->pressure_raw);
+		out->humidity = _bme280_humidity(cal, t_fine, (int32_t)raw->humidity_raw);
+		raw++;
+		out++;
+	}
+}
 
 /// @brief Compute Temperature from BME280_RawData struct
 /// @details Output degrees Celsius with 0.01C resolution.  Divide by 100 for whole degrees.
-///          This function needs to be run before computing Pressure or Humidity to compute
-///          the _t_fine constant used by the Pressure and Humidity compensation functions below.
-int32_t BME280_compensated_Temperature(BME280_RawData *rd)
+int32_t BME280_compensated_Temperature(BME280_Handle handle, BME280_RawData *rd)
 {
 	if (rd == NULL) {
 		return -32768;
 	}
-	int32_t adc_T = rd->temperature_raw; // No sign extension will be performed as the raw value is expected to be positive.
-
-	int32_t var1, var2, T;
 
-	var1 = ((((adc_T >> 3) - ((int32_t)BME280_dig_T1 << 1))) * ((int32_t)BME280_dig_T2)) >> 11;
-	var2 = (((((adc_T >> 4) - (int32_t)BME280_dig_T1) * ((adc_T >> 4) - (int32_t)BME280_dig_T1)) >> 12) * (int32_t)BME280_dig_T3) >> 14;
-	_t_fine = var1 + var2;
-	T = (_t_fine * 5 + 128) >> 8;
-
-	return T;
+	return (_bme280_t_fine(&handle->cal, (int32_t)rd->temperature_raw) * 5 + 128) >> 8;
 }
 
 /// @brief Compute Pressure from BME280_RawData struct
 /// @details Pressure in Pascals as unsigned 32-bit integer in Q24.8 format; divide by 256 for whole Pascals
-uint32_t BME280_compensated_Pressure(BME280_RawData *rd)
+uint32_t BME280_compensated_Pressure(BME280_Handle handle, BME280_RawData *rd)
 {
 	if (rd == NULL) {
 		return 0;
 	}
-	int32_t adc_P = rd->pressure_raw; // No sign extension will be performed as the raw value is expected to be positive.
 
-	int64_t var1, var2, p;
-	var1 = (int64_t)_t_fine - 128000;
-	var2 = var1 * var1 * (int64_t)BME280_dig_P6;
-	var2 = var2 + ((var1 * (int64_t)BME280_dig_P5) << 17);
-	//var2 = var2 + (((int64_t)BME280_dig_P3) >> 8) + ((var1 * (int64_t)BME280_dig_P2) << 12);
-	var2 = var2 +(((int64_t)BME280_dig_P4)<<35);
-	var1 = ((var1 * var1 * (int64_t)BME280_dig_P3) >> 8) + ((var1 * (int64_t)BME280_dig_P2) << 12);
-	var1 = (((((int64_t)1) << 47) + var1)) * ((int64_t)BME280_dig_P1) >> 33;
-	if (var1 == 0) {
-		return 0;  // avoid exception caused by divide by zero
-	}
-	p = 1048576 - adc_P;
-	p = (((p << 31) - var2) * 3125) / var1;
-	var1 = (((int64_t)BME280_dig_P9) * (p >> 13) * (p >> 13)) >> 25;
-	var2 = (((int64_t)BME280_dig_P8) * p) >> 19;
-	p = ((p + var1 + var2) >> 8) + (((int64_t)BME280_dig_P7) << 4);
-	return (uint32_t)p;
+	return _bme280_pressure(&handle->cal, _bme280_t_fine(&handle->cal, (int32_t)rd->temperature_raw),
+	                        (int32_t)rd->pressure_raw);
 }
 
 /// @brief Compute Relative Humidity from BME280_RawData struct
 /// @details Humidity in %relativehumidity as unsigned 32-bit integer in Q22.10 format; divide by 1024 for whole %RH
-uint32_t BME280_compensated_Humidity(BME280_RawData *rd)
+uint32_t BME280_compensated_Humidity(BME280_Handle handle, BME280_RawData *rd)
 {
 	if (rd == NULL) {
 		return 0;
 	}
-	int32_t adc_H = (uint32_t)rd->humidity_raw; // No sign extension will be performed as the raw value is expected to be positive.
 
-	int32_t v_x1_u32r;
-	v_x1_u32r = _t_fine - ((int32_t)76800);
-	v_x1_u32r = (((((adc_H << 14) - (((int32_t)BME280_dig_H4) << 20) - (((int32_t)BME280_dig_H5) * v_x1_u32r)) \
-			+ ((int32_t)16384)) >> 15) * (((((((v_x1_u32r * ((int32_t)BME280_dig_H6)) >> 10) \
-			* (((v_x1_u32r * ((int32_t)BME280_dig_H3)) >> 11) + ((int32_t)32768))) >> 10) + ((int32_t)2097152)) \
-			* ((int32_t)BME280_dig_H2) + 8192) >> 14));
-	v_x1_u32r = (v_x1_u32r - (((((v_x1_u32r >> 15) * (v_x1_u32r >> 15)) >> 7) \
-			* ((int32_t)BME280_dig_H1)) >> 4));
-	v_x1_u32r = (v_x1_u32r < 0 ? 0 : v_x1_u32r);
-	v_x1_u32r = (v_x1_u32r > 419430400 ? 419430400 : v_x1_u32r);
-	return (uint32_t)(v_x1_u32r >> 12);
+	return _bme280_humidity(&handle->cal, _bme280_t_fine(&handle->cal, (int32_t)rd->temperature_raw),
+	                        (int32_t)rd->humidity_raw);
 }
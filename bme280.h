@@ -40,8 +40,10 @@
 #include <stdint.h>
 #include <uart_term.h>
 
-/// @brief Default I2C Slave address for the BME280
+/// @brief Default I2C Slave address for the BME280 (SDO high)
 #define BOSCH_SENSORTEC_BME280_I2CSLAVE_DEFAULT 0x77
+/// @brief Alternate I2C Slave address for the BME280 (SDO low)
+#define BOSCH_SENSORTEC_BME280_I2CSLAVE_ALT 0x76
 
 /// @brief Time between RESET and communication ready (actually 2ms)
 #define BME280_RESET_SETTLING_TIME 3
@@ -54,6 +56,18 @@
 #define BME280_DEBUG_OPEN 1
 
 /* Data types */
+/// @brief Named oversampling/filter/standby settings, the chip free-runs in normal mode with all of them
+typedef enum {
+	BME280_Profile_LowPower,        /// @brief 1x oversampling, no IIR filter, 1000ms standby
+	BME280_Profile_Balanced,        /// @brief T 2x, P 4x, H 2x, IIR 4, 250ms standby
+	BME280_Profile_HighResolution,  /// @brief T 4x, P 16x, H 4x, IIR 16, 62.5ms standby
+	BME280_Profile_Max
+} BME280_Profile;
+
+/// @brief Profile applied by BME280_open()
+#define BME280_PROFILE_DEFAULT BME280_Profile_Balanced
+
+
 /// @brief Holds raw register values for measurements
 /// @details This struct type is returned in pointer form by any BME280 API calls
 ///          which pull measurement data from the device; it is used as a parameter
@@ -65,11 +79,76 @@ typedef struct {
 	uint32_t pressure_raw;
 } BME280_RawData;
 
+/// @brief Calibration constants, decoded once from the CALIB00..25 and CALIB26..32 registers
+typedef struct {
+	uint16_t dig_T1;
+	int16_t  dig_T2;
+	int16_t  dig_T3;
+	uint16_t dig_P1;
+	int16_t  dig_P2;
+	int16_t  dig_P3;
+	int16_t  dig_P4;
+	int16_t  dig_P5;
+	int16_t  dig_P6;
+	int16_t  dig_P7;
+	int16_t  dig_P8;
+	int16_t  dig_P9;
+	uint8_t  dig_H1;
+	int16_t  dig_H2;
+	uint8_t  dig_H3;
+	int16_t  dig_H4;
+	int16_t  dig_H5;
+	int8_t   dig_H6;
+} BME280_Calibration;
+
+/// @brief Compensated measurements, same units as the BME280_compensated_*() functions
+typedef struct {
+	int32_t  temperature;  /// @brief 0.01 degrees Celsius
+	uint32_t pressure;     /// @brief Pascals, Q24.8
+	uint32_t humidity;     /// @brief %RH, Q22.10
+} BME280_Compensated;
+
+/// @brief Per device driver state, allocated by the caller (one per chip on the bus)
+typedef struct {
+	I2C_Handle i2cbus;            /// @brief I2C Handle passed during BME280_init()
+	uint8_t i2cAddr;              /// @brief I2C slave address specified during BME280_init()
+	uint8_t ctrl_meas;            /// @brief CTRL_MEAS settings, to save current OSRS params when modifying CTRL_MEAS:mode[]
+	uint8_t ctrl_hum;             /// @brief CTRL_HUM settings, used to compute the conversion time
+	BME280_Profile profile;       /// @brief Profile applied, BME280_Profile_Max in sleep/forced mode
+	BME280_Calibration cal;       /// @brief Unique calibration values, decoded once during BME280_open()
+	BME280_RawData rawData;       /// @brief Last-known raw data, the read/collect functions return a pointer to it
+	bool txnError;                /// @brief An I2C transfer failed since the last start/collect/read call
+} BME280_Object;
+
+typedef BME280_Object *BME280_Handle;
+
 /* Basic API */
-void BME280_init(I2C_Handle, uint8_t slaveaddr); /// @brief Driver initialization
-bool BME280_open();                            /// @brief Make contact with the chip and read calibration registers
-bool BME280_close();                           /// @brief Reset chip
-BME280_RawData *BME280_read();                 /// @brief Initiate a Forced measurement, poll to completion, read & return raw data
+void BME280_init(BME280_Handle, I2C_Handle, uint8_t slaveaddr); /// @brief Driver initialization
+bool BME280_open(BME280_Handle);               /// @brief Make contact with the chip, read calibration registers, apply BME280_PROFILE_DEFAULT
+bool BME280_close(BME280_Handle);              /// @brief Reset chip
+BME280_RawData *BME280_read(BME280_Handle);    /// @brief Initiate a Forced measurement, poll to completion, read & return raw data
+
+/* Split measurement API */
+/// @brief Initiate a Forced measurement and return without waiting for it
+/// @details Returns the worst case conversion time in milliseconds for the current oversampling settings
+///          (datasheet section 9.1).  The caller is free to use the I2C bus for other devices meanwhile
+///          and should call BME280_collect() once that time has elapsed.
+uint16_t BME280_startMeasurement(BME280_Handle);
+/// @brief Collect the results of a measurement started with BME280_startMeasurement()
+/// @details Polls the STATUS register once and never sleeps.  Returns NULL while the chip is still
+///          measuring, otherwise reads and returns the raw data.
+BME280_RawData *BME280_collect(BME280_Handle);
+/// @brief Worst case conversion time in milliseconds of a Forced measurement
+uint16_t BME280_measurementTime(BME280_Handle);
+
+/* Profile API */
+/// @brief Put the chip in normal mode with the settings of a profile
+/// @details In normal mode BME280_startMeasurement() has nothing to do and returns 0, and BME280_collect()
+///          and BME280_read() are a single burst read of the latest filtered results.
+///          Returns false if the profile is unknown or the chip did not take the settings.
+bool BME280_setProfile(BME280_Handle, BME280_Profile profile);
+/// @brief Profile currently applied, BME280_Profile_Max if the chip is in sleep/forced mode
+BME280_Profile BME280_getProfile(BME280_Handle);
 /// @brief Collect current data
 /// @details This will first poll the STATUS register to ascertain no measurements are in progress; if they are, it
 ///          will perform Task_sleep() and poll again.  Since this uses Task_sleep(), this function must ALWAYS
@@ -78,33 +157,44 @@ BME280_RawData *BME280_read();                 /// @brief Initiate a Forced meas
 ///          until <timeout> is exceeded.
 ///          When timeout = 0, it will poll indefinitely.
 #define BME280_STATUS_MINIMUM_WAIT 8
-BME280_RawData *BME280_readMeasurements(uint16_t timeout);
+/// @brief Timeout of the STATUS poll of BME280_read(), a Forced conversion takes 113 ms at most
+#define BME280_READ_TIMEOUT 128
+BME280_RawData *BME280_readMeasurements(BME280_Handle, uint16_t timeout);
 
 /* Numeric interpretation/compensation API for extracting results */
 
+/// @brief Decode the calibration registers read from CALIB00 (26 bytes) and CALIB26 (7 bytes)
+void BME280_parseCalibration(const uint8_t *calib00, const uint8_t *calib26, BME280_Calibration *cal);
+
+/// @brief Calibration decoded by BME280_open()
+const BME280_Calibration *BME280_getCalibration(BME280_Handle);
+
+/// @brief Compensate <count> raw samples into <out> in one pass
+/// @details Pure function: it only reads <cal> and <raw>, so samples may be compensated in any order,
+///          from any task, and long after they were collected.
+void BME280_compensate(const BME280_Calibration *cal, const BME280_RawData *raw, BME280_Compensated *out, uint16_t count);
+
 /// @brief Compute Temperature from BME280_RawData struct
 /// @details Output degrees Celsius with 0.01C resolution.  Divide by 100 for whole degrees.
-///          This function needs to be run before computing Pressure or Humidity to compute
-///          the _t_fine constant used by the Pressure and Humidity compensation functions below.
-int32_t BME280_compensated_Temperature(BME280_RawData *);
+int32_t BME280_compensated_Temperature(BME280_Handle, BME280_RawData *);
 
 /// @brief Compute Pressure from BME280_RawData struct
 /// @details Pressure in Pascals as unsigned 32-bit integer in Q24.8 format; divide by 256 for whole Pascals
-uint32_t BME280_compensated_Pressure(BME280_RawData *);
+uint32_t BME280_compensated_Pressure(BME280_Handle, BME280_RawData *);
 
 /// @brief Compute Relative Humidity from BME280_RawData struct
 /// @details Humidity in %relativehumidity as unsigned 32-bit integer in Q22.10 format; divide by 1024 for whole %RH
-uint32_t BME280_compensated_Humidity(BME280_RawData *);
+uint32_t BME280_compensated_Humidity(BME280_Handle, BME280_RawData *);
 
 /* Look at the bottom of this header file for the Periodic Polling API. */
 
 
 /* Internal API */
-void BME280_setAddress(uint8_t memAddress);
-void BME280_writeReg(uint8_t memAddress, uint8_t value);
-uint8_t BME280_readReg(uint8_t memAddress);
-uint16_t BME280_readWord(uint8_t memAddress); // Interprets Big-Endian format of the BME280
-uint32_t BME280_readWord20(uint8_t memAddress); // Interprets Big-Endian with four LSB bits present in MSB of last byte
+void BME280_setAddress(BME280_Handle, uint8_t memAddress);
+void BME280_writeReg(BME280_Handle, uint8_t memAddress, uint8_t value);
+uint8_t BME280_readReg(BME280_Handle, uint8_t memAddress);
+uint16_t BME280_readWord(BME280_Handle, uint8_t memAddress); // Interprets Big-Endian format of the BME280
+uint32_t BME280_readWord20(BME280_Handle, uint8_t memAddress); // Interprets Big-Endian with four LSB bits present in MSB of last byte
 
 
 /* Register defines and constants from BME280 datasheet */
@@ -112,6 +202,8 @@ uint32_t BME280_readWord20(uint8_t memAddress); // Interprets Big-Endian with fo
 #define BME280_REG_CALIB00 0x88
 #define BME280_REG_RESET 0xE0
 #define BME280_REG_CALIB26 0xE1
+#define BME280_CALIB00_LEN 26  /* 0x88..0xA1 */
+#define BME280_CALIB26_LEN 7   /* 0xE1..0xE7 */
 #define BME280_REG_CTRL_HUM 0xF2
 #define BME280_REG_STATUS 0xF3
 #define BME280_REG_CTRL_MEAS 0xF4
@@ -162,6 +254,7 @@ uint32_t BME280_readWord20(uint8_t memAddress); // Interprets Big-Endian with fo
 
 #define BME280_CONFIG_SPI3WIRE              (1)
 
+#define BME280_CONFIG_IIR_FILTER_SHIFT      (2)
 #define BME280_CONFIG_IIR_FILTER_COEF__OFF  (0)
 #define BME280_CONFIG_IIR_FILTER_COEF__2    (1)
 #define BME280_CONFIG_IIR_FILTER_COEF__4    (2)
@@ -49,6 +49,7 @@
 #include <stdlib.h>
 
 #include "ccs811.h"
+#include "i2c_bus.h"
 
 extern Display_Handle    displayHandle;
 //#define CCS811_DEBUG_LEVEL_1
@@ -328,6 +329,37 @@ bool ccs811_get_results (ccs811_sensor_t* dev,
     return true;
 }
 
+bool ccs811_data_ready (ccs811_sensor_t* dev)
+{
+    if (!dev) return false;
+
+    dev->error_code = CCS811_OK;
+
+    uint8_t status;
+
+    // the same condition drives nINT, one byte instead of the whole result
+    if (!ccs811_reg_read(dev, CCS811_REG_STATUS, &status, 1))
+    {
+        error_dev ("Could not read status register.", __FUNCTION__, dev);
+        dev->error_code |= CCS811_DRV_RD_STAT_FAILED;
+        return false;
+    }
+
+    if (status & CCS811_STATUS_ERROR)
+    {
+        ccs811_check_error_status (dev);
+        return false;
+    }
+
+    if (!(status & CCS811_STATUS_DATA_RDY))
+    {
+        dev->error_code = CCS811_DRV_NO_NEW_DATA;
+        return false;
+    }
+
+    return true;
+}
+
 uint32_t ccs811_get_ntc_resistance (ccs811_sensor_t* dev, uint32_t r_ref)
 {
     if (!dev) return 0;
@@ -657,7 +689,7 @@ bool i2c_slave_write(I2C_Handle bus, uint8_t deviceId, uint8_t reg, uint8_t *dat
     i2cTransaction.readBuf = NULL;
     i2cTransaction.readCount = 0;
 
-    return !I2C_transfer(bus, &i2cTransaction);
+    return !I2CBus_transfer(bus, &i2cTransaction);
 
 
 }
@@ -674,7 +706,7 @@ bool i2c_slave_read(I2C_Handle bus, uint8_t deviceId, uint8_t reg, uint8_t *data
     i2cTransaction.readBuf = data;
     i2cTransaction.readCount = len;
 
-    return !I2C_transfer(bus, &i2cTransaction);
+    return !I2CBus_transfer(bus, &i2cTransaction);
 
 
 }
@@ -207,6 +207,23 @@ bool ccs811_get_results (ccs811_sensor_t* sensor,
                          uint16_t* raw_v);
 
 
+/**
+ * @brief   Check whether a new sample is ready
+ *
+ * The function reads the status register only. It is the condition that
+ * drives *nINT* low when the data ready interrupt is enabled, so it can be
+ * polled in place of the interrupt signal, before *ccs811_get_results*
+ * reads the whole result.
+ *
+ * @param  sensor    pointer to the sensor device data structure
+ *
+ * @return           true if a new sample is ready, false otherwise. The
+ *                   error code is CCS811_DRV_NO_NEW_DATA when the sensor
+ *                   is fine but has no new sample
+ */
+bool ccs811_data_ready (ccs811_sensor_t* sensor);
+
+
 /**
  * brief    Get the resistance of connected NTC thermistor
  *
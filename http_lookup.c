@@ -0,0 +1,154 @@
+/*
+ * http_lookup.c
+ *
+ *  Exact match lookup of routes and characteristics. Kept free of
+ *  SimpleLink calls so it builds on a host, see tests/host.
+ */
+
+/* standard includes */
+#include <stddef.h>
+#include <string.h>
+
+#include "http_lookup.h"
+
+#define HTTP_LOOKUP_KEY(pTable, entrySize, idx) \
+    ((const HttpLookup_Key_t *)((const uint8_t *)(pTable) + \
+                                (uint32_t)(entrySize) * (idx)))
+
+//*****************************************************************************
+//
+//! \brief Orders a name and method against a table key
+//!
+//! \param[in]  pName         name, not necessarily NULL terminated
+//!
+//! \param[in]  nameLen       name length
+//!
+//! \param[in]  method        method
+//!
+//! \param[in]  pKey          table key
+//!
+//! \return 0 if equal, negative if the name sorts first, else positive
+//!
+//****************************************************************************
+static int32_t httpLookupOrder(const uint8_t *pName, uint16_t nameLen,
+                               uint8_t method, const HttpLookup_Key_t *pKey)
+{
+    int32_t order;
+
+    order = HttpLookup_compare(pName, nameLen, pKey->pName, pKey->nameLen);
+    if(order == 0)
+    {
+        order = (int32_t)method - (int32_t)pKey->method;
+    }
+
+    return(order);
+}
+
+int32_t HttpLookup_compare(const uint8_t *pKey, uint16_t keyLen,
+                           const char *pName, uint8_t nameLen)
+{
+    if(keyLen != nameLen)
+    {
+        return((int32_t)keyLen - (int32_t)nameLen);
+    }
+
+    return(memcmp(pKey, pName, keyLen));
+}
+
+int32_t HttpLookup_find(const void *pTable, uint16_t entrySize,
+                        const uint8_t *pOrder, uint8_t orderNum,
+                        const uint8_t *pName, uint16_t nameLen,
+                        uint8_t method)
+{
+    int32_t low = 0;
+    int32_t high = (int32_t)orderNum - 1;
+    int32_t mid, order;
+
+    while(low <= high)
+    {
+        mid = (low + high) >> 1;
+        order = httpLookupOrder(pName, nameLen, method,
+                                HTTP_LOOKUP_KEY(pTable, entrySize,
+                                                pOrder[mid]));
+        if(order == 0)
+        {
+            return(pOrder[mid]);
+        }
+        else if(order < 0)
+        {
+            high = mid - 1;
+        }
+        else
+        {
+            low = mid + 1;
+        }
+    }
+
+    return(-1);
+}
+
+int32_t HttpLookup_scan(const void *pTable, uint16_t entrySize,
+                        uint8_t tableNum, const uint8_t *pName,
+                        uint16_t nameLen, uint8_t method)
+{
+    const HttpLookup_Key_t *pKey;
+    uint8_t idx;
+
+    for(idx = 0; idx < tableNum; idx++)
+    {
+        pKey = HTTP_LOOKUP_KEY(pTable, entrySize, idx);
+        if((pKey->pName != NULL) &&
+           (httpLookupOrder(pName, nameLen, method, pKey) == 0))
+        {
+            return(idx);
+        }
+    }
+
+    return(-1);
+}
+
+int32_t HttpLookup_checkOrder(const void *pTable, uint16_t entrySize,
+                              uint8_t tableNum, const uint8_t *pOrder,
+                              uint8_t orderNum)
+{
+    const HttpLookup_Key_t *pPrev, *pCurr;
+    uint32_t seen = 0;
+    uint8_t idx;
+
+    if(tableNum > HTTP_LOOKUP_MAX_ENTRIES)
+    {
+        return(HTTP_LOOKUP_BAD_ORDER);
+    }
+
+    /* every used entry once, none left out */
+    for(idx = 0; idx < orderNum; idx++)
+    {
+        if((pOrder[idx] >= tableNum) || (seen & (1UL << pOrder[idx])) ||
+           (HTTP_LOOKUP_KEY(pTable, entrySize, pOrder[idx])->pName == NULL))
+        {
+            return(HTTP_LOOKUP_BAD_ORDER);
+        }
+        seen |= 1UL << pOrder[idx];
+    }
+    for(idx = 0; idx < tableNum; idx++)
+    {
+        if(!(seen & (1UL << idx)) &&
+           (HTTP_LOOKUP_KEY(pTable, entrySize, idx)->pName != NULL))
+        {
+            return(HTTP_LOOKUP_BAD_ORDER);
+        }
+    }
+
+    for(idx = 1; idx < orderNum; idx++)
+    {
+        pPrev = HTTP_LOOKUP_KEY(pTable, entrySize, pOrder[idx - 1]);
+        pCurr = HTTP_LOOKUP_KEY(pTable, entrySize, pOrder[idx]);
+        if(httpLookupOrder((const uint8_t *)pPrev->pName, pPrev->nameLen,
+                           pPrev->method, pCurr) >= 0)
+        {
+            return(HTTP_LOOKUP_NOT_SORTED);
+        }
+    }
+
+    return(0);
+}
@@ -0,0 +1,125 @@
+/*
+ * http_lookup.h
+ *
+ *  Exact match lookup of routes and characteristics in the link local
+ *  tables. Every table entry starts with its key, and an order array lists
+ *  the entries sorted by name length, name bytes and then method, so an
+ *  entry is found by binary search instead of comparing every name.
+ */
+
+#ifndef HTTP_LOOKUP_H_
+#define HTTP_LOOKUP_H_
+
+#include <stdint.h>
+
+/* HttpLookup_checkOrder() tracks the entries in a 32 bit mask */
+#define HTTP_LOOKUP_MAX_ENTRIES     (32)
+
+/* HttpLookup_checkOrder() results */
+#define HTTP_LOOKUP_BAD_ORDER       (-1)    /* entry missing or repeated */
+#define HTTP_LOOKUP_NOT_SORTED      (-2)
+
+typedef struct
+{
+    char    *pName;             /* NULL for an unused entry */
+    uint8_t nameLen;
+    uint8_t method;             /* HTTP method of a route, 0 otherwise */
+}HttpLookup_Key_t;
+
+//*****************************************************************************
+//
+//! \brief Compares a key against a table name, ordering by length first and
+//!        then by bytes
+//!
+//! \param[in]  pKey          key, not necessarily NULL terminated
+//!
+//! \param[in]  keyLen        key length
+//!
+//! \param[in]  pName         table name
+//!
+//! \param[in]  nameLen       table name length
+//!
+//! \return 0 if equal, negative if the key sorts first, else positive
+//!
+//****************************************************************************
+int32_t HttpLookup_compare(const uint8_t *pKey, uint16_t keyLen,
+                           const char *pName, uint8_t nameLen);
+
+//*****************************************************************************
+//
+//! \brief Binary searches a table through its order array
+//!
+//! \param[in]  pTable        first entry, every entry starts with its
+//!                           HttpLookup_Key_t
+//!
+//! \param[in]  entrySize     size of an entry
+//!
+//! \param[in]  pOrder        entry indices sorted by HttpLookup_compare()
+//!                           and then by method
+//!
+//! \param[in]  orderNum      number of indices in pOrder
+//!
+//! \param[in]  pName         name, not necessarily NULL terminated
+//!
+//! \param[in]  nameLen       name length
+//!
+//! \param[in]  method        method, 0 for tables without one
+//!
+//! \return index of the entry or -1 if there is none
+//!
+//****************************************************************************
+int32_t HttpLookup_find(const void *pTable, uint16_t entrySize,
+                        const uint8_t *pOrder, uint8_t orderNum,
+                        const uint8_t *pName, uint16_t nameLen,
+                        uint8_t method);
+
+//*****************************************************************************
+//
+//! \brief Compares the name against every entry of a table, for tables
+//!        whose order array failed HttpLookup_checkOrder()
+//!
+//! \param[in]  pTable        first entry, every entry starts with its
+//!                           HttpLookup_Key_t
+//!
+//! \param[in]  entrySize     size of an entry
+//!
+//! \param[in]  tableNum      number of entries, unused ones included
+//!
+//! \param[in]  pName         name, not necessarily NULL terminated
+//!
+//! \param[in]  nameLen       name length
+//!
+//! \param[in]  method        method, 0 for tables without one
+//!
+//! \return index of the entry or -1 if there is none
+//!
+//****************************************************************************
+int32_t HttpLookup_scan(const void *pTable, uint16_t entrySize,
+                        uint8_t tableNum, const uint8_t *pName,
+                        uint16_t nameLen, uint8_t method);
+
+//*****************************************************************************
+//
+//! \brief Verifies that an order array lists every used entry of a table
+//!        once and that it is sorted, HttpLookup_find() depends on it
+//!
+//! \param[in]  pTable        first entry, every entry starts with its
+//!                           HttpLookup_Key_t
+//!
+//! \param[in]  entrySize     size of an entry
+//!
+//! \param[in]  tableNum      number of entries, unused ones included, at
+//!                           most HTTP_LOOKUP_MAX_ENTRIES
+//!
+//! \param[in]  pOrder        entry indices
+//!
+//! \param[in]  orderNum      number of indices in pOrder
+//!
+//! \return 0 on success, HTTP_LOOKUP_BAD_ORDER or HTTP_LOOKUP_NOT_SORTED
+//!
+//****************************************************************************
+int32_t HttpLookup_checkOrder(const void *pTable, uint16_t entrySize,
+                              uint8_t tableNum, const uint8_t *pOrder,
+                              uint8_t orderNum);
+
+#endif /* HTTP_LOOKUP_H_ */
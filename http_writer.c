@@ -0,0 +1,196 @@
+/*
+ * http_writer.c
+ *
+ *  Bounded payload writer. Decimal values are converted two digits at a
+ *  time from a table, which halves the divisions of a plain itoa and keeps
+ *  the varargs parsing of snprintf out of the request path.
+ */
+
+/* standard includes */
+#include <string.h>
+
+#include "http_writer.h"
+
+/* longest uint32_t, in decimal */
+#define HTTP_WRITER_MAX_DIGITS  (10)
+
+static const char gDigitPairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static const char gHexDigits[] = "0123456789abcdef";
+
+void HttpWriter_init(HttpWriter_t *pWriter, uint8_t *pBuf, uint16_t size)
+{
+    /* no room for the terminator, every append overflows */
+    pWriter->pBuf = (size > 0) ? pBuf : NULL;
+    pWriter->len = 0;
+    pWriter->size = (size > 0) ? (size - 1) : 0;
+    pWriter->overflow = (size == 0);
+}
+
+void HttpWriter_append(HttpWriter_t *pWriter, const void *pData, uint16_t len)
+{
+    if(pWriter->overflow || (len > (pWriter->size - pWriter->len)))
+    {
+        pWriter->overflow = 1;
+        return;
+    }
+
+    memcpy(pWriter->pBuf + pWriter->len, pData, len);
+    pWriter->len += len;
+}
+
+void HttpWriter_appendStr(HttpWriter_t *pWriter, const char *pStr)
+{
+    HttpWriter_append(pWriter, pStr, strlen(pStr));
+}
+
+void HttpWriter_appendChar(HttpWriter_t *pWriter, char c)
+{
+    if(pWriter->overflow || (pWriter->len >= pWriter->size))
+    {
+        pWriter->overflow = 1;
+        return;
+    }
+
+    pWriter->pBuf[pWriter->len++] = (uint8_t)c;
+}
+
+void HttpWriter_appendUint(HttpWriter_t *pWriter, uint32_t value,
+                           uint8_t minDigits)
+{
+    char digits[HTTP_WRITER_MAX_DIGITS];
+    char *pDigit = digits + HTTP_WRITER_MAX_DIGITS;
+    uint32_t pair;
+
+    /* filled from the end, two digits per division */
+    while(value >= 100)
+    {
+        pair = (value % 100) * 2;
+        value /= 100;
+        *--pDigit = gDigitPairs[pair + 1];
+        *--pDigit = gDigitPairs[pair];
+    }
+
+    if(value >= 10)
+    {
+        *--pDigit = gDigitPairs[(value * 2) + 1];
+        *--pDigit = gDigitPairs[value * 2];
+    }
+    else
+    {
+        *--pDigit = (char)('0' + value);
+    }
+
+    if(minDigits > HTTP_WRITER_MAX_DIGITS)
+    {
+        minDigits = HTTP_WRITER_MAX_DIGITS;
+    }
+    while((digits + HTTP_WRITER_MAX_DIGITS - pDigit) < minDigits)
+    {
+        *--pDigit = '0';
+    }
+
+    HttpWriter_append(pWriter, pDigit, digits + HTTP_WRITER_MAX_DIGITS - pDigit);
+}
+
+void HttpWriter_appendInt(HttpWriter_t *pWriter, int32_t value)
+{
+    if(value < 0)
+    {
+        HttpWriter_appendChar(pWriter, '-');
+        /* negated in unsigned, INT32_MIN has no positive counterpart */
+        HttpWriter_appendUint(pWriter, 0u - (uint32_t)value, 0);
+    }
+    else
+    {
+        HttpWriter_appendUint(pWriter, (uint32_t)value, 0);
+    }
+}
+
+void HttpWriter_appendHex(HttpWriter_t *pWriter, uint32_t value,
+                          uint8_t minDigits)
+{
+    char digits[8];
+    char *pDigit = digits + sizeof(digits);
+
+    do
+    {
+        *--pDigit = gHexDigits[value & 0xF];
+        value >>= 4;
+    } while(value != 0);
+
+    if(minDigits > sizeof(digits))
+    {
+        minDigits = sizeof(digits);
+    }
+    while((digits + sizeof(digits) - pDigit) < minDigits)
+    {
+        *--pDigit = '0';
+    }
+
+    HttpWriter_append(pWriter, pDigit, digits + sizeof(digits) - pDigit);
+}
+
+void HttpWriter_appendFixed(HttpWriter_t *pWriter, int32_t value,
+                            uint8_t decimals, uint8_t width)
+{
+    /* sign, digits and decimal point */
+    char digits[HTTP_WRITER_MAX_DIGITS + 2];
+    char *pDigit = digits + sizeof(digits);
+    uint32_t magnitude;
+    uint8_t count = 0;
+    uint8_t len;
+
+    if(decimals >= HTTP_WRITER_MAX_DIGITS)
+    {
+        decimals = HTTP_WRITER_MAX_DIGITS - 1;
+    }
+
+    /* negated in unsigned, INT32_MIN has no positive counterpart */
+    magnitude = (value < 0) ? (0u - (uint32_t)value) : (uint32_t)value;
+    do
+    {
+        if((decimals > 0) && (count == decimals))
+        {
+            *--pDigit = '.';
+        }
+        *--pDigit = (char)('0' + (magnitude % 10));
+        magnitude /= 10;
+        count++;
+    } while((magnitude != 0) || (count <= decimals));
+
+    if(value < 0)
+    {
+        *--pDigit = '-';
+    }
+
+    for(len = digits + sizeof(digits) - pDigit; len < width; len++)
+    {
+        HttpWriter_appendChar(pWriter, ' ');
+    }
+
+    HttpWriter_append(pWriter, pDigit, digits + sizeof(digits) - pDigit);
+}
+
+int32_t HttpWriter_finish(HttpWriter_t *pWriter)
+{
+    if(pWriter->pBuf == NULL)
+    {
+        return(-1);
+    }
+
+    /* the size kept a byte aside, the terminator always fits */
+    pWriter->pBuf[pWriter->len] = '\0';
+
+    return(pWriter->overflow ? -1 : (int32_t)pWriter->len);
+}
@@ -0,0 +1,153 @@
+/*
+ * http_writer.h
+ *
+ *  Append-only writer for HTTP response payloads. It tracks the length,
+ *  never writes past the buffer and formats integers without snprintf.
+ *  An append that does not fit marks the writer overflowed and is dropped,
+ *  HttpWriter_finish() then reports the failure.
+ */
+
+#ifndef HTTP_WRITER_H_
+#define HTTP_WRITER_H_
+
+#include <stdint.h>
+
+typedef struct
+{
+    uint8_t  *pBuf;
+    uint16_t len;
+    uint16_t size;          /* usable size, one byte is kept for the NULL */
+    uint8_t  overflow;
+}HttpWriter_t;
+
+//*****************************************************************************
+//
+//! \brief Starts a payload in a buffer
+//!
+//! \param[out] pWriter       writer to initialize
+//!
+//! \param[in]  pBuf          destination buffer
+//!
+//! \param[in]  size          size of the destination buffer
+//!
+//! \return none
+//!
+//****************************************************************************
+void HttpWriter_init(HttpWriter_t *pWriter, uint8_t *pBuf, uint16_t size);
+
+//*****************************************************************************
+//
+//! \brief Appends bytes
+//!
+//! \param[in]  pWriter       writer
+//!
+//! \param[in]  pData         bytes to append
+//!
+//! \param[in]  len           number of bytes
+//!
+//! \return none
+//!
+//****************************************************************************
+void HttpWriter_append(HttpWriter_t *pWriter, const void *pData, uint16_t len);
+
+//*****************************************************************************
+//
+//! \brief Appends a NULL terminated string
+//!
+//! \param[in]  pWriter       writer
+//!
+//! \param[in]  pStr          string to append
+//!
+//! \return none
+//!
+//****************************************************************************
+void HttpWriter_appendStr(HttpWriter_t *pWriter, const char *pStr);
+
+//*****************************************************************************
+//
+//! \brief Appends a single character
+//!
+//! \param[in]  pWriter       writer
+//!
+//! \param[in]  c             character to append
+//!
+//! \return none
+//!
+//****************************************************************************
+void HttpWriter_appendChar(HttpWriter_t *pWriter, char c);
+
+//*****************************************************************************
+//
+//! \brief Appends an unsigned value in decimal
+//!
+//! \param[in]  pWriter       writer
+//!
+//! \param[in]  value         value to append
+//!
+//! \param[in]  minDigits     zero padding, 0 or 1 for none
+//!
+//! \return none
+//!
+//****************************************************************************
+void HttpWriter_appendUint(HttpWriter_t *pWriter, uint32_t value,
+                           uint8_t minDigits);
+
+//*****************************************************************************
+//
+//! \brief Appends a signed value in decimal
+//!
+//! \param[in]  pWriter       writer
+//!
+//! \param[in]  value         value to append
+//!
+//! \return none
+//!
+//****************************************************************************
+void HttpWriter_appendInt(HttpWriter_t *pWriter, int32_t value);
+
+//*****************************************************************************
+//
+//! \brief Appends an unsigned value in lower case hexadecimal
+//!
+//! \param[in]  pWriter       writer
+//!
+//! \param[in]  value         value to append
+//!
+//! \param[in]  minDigits     zero padding, 0 or 1 for none
+//!
+//! \return none
+//!
+//****************************************************************************
+void HttpWriter_appendHex(HttpWriter_t *pWriter, uint32_t value,
+                          uint8_t minDigits);
+
+//*****************************************************************************
+//
+//! \brief Appends a signed fixed point value, right aligned with spaces
+//!
+//! \param[in]  pWriter       writer
+//!
+//! \param[in]  value         value in units of 10^-decimals
+//!
+//! \param[in]  decimals      digits after the decimal point
+//!
+//! \param[in]  width         space padding, a wider value is not cut
+//!
+//! \return none
+//!
+//****************************************************************************
+void HttpWriter_appendFixed(HttpWriter_t *pWriter, int32_t value,
+                            uint8_t decimals, uint8_t width);
+
+//*****************************************************************************
+//
+//! \brief NULL terminates the payload
+//!
+//! \param[in]  pWriter       writer
+//!
+//! \return payload length, or -1 if an append did not fit
+//!
+//****************************************************************************
+int32_t HttpWriter_finish(HttpWriter_t *pWriter);
+
+#endif /* HTTP_WRITER_H_ */
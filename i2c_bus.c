@@ -0,0 +1,357 @@
+/*
+ * i2c_bus.c
+ *
+ *  Shared I2C bus manager. One caller owns the bus at a time; the others
+ *  wait in a list sorted by device priority and the owner hands the bus to
+ *  the head of the list when its transfer completes. The controller runs
+ *  in callback mode, the owner waits for the callback with a timeout so a
+ *  slave holding the bus can not block the sensor task forever.
+ */
+
+/* standard includes */
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+/* Kernel includes */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* driverlib Header files */
+#include <ti/devices/cc32xx/inc/hw_types.h>
+#include <ti/devices/cc32xx/inc/hw_memmap.h>
+#include <ti/devices/cc32xx/driverlib/rom.h>
+#include <ti/devices/cc32xx/driverlib/rom_map.h>
+#include <ti/devices/cc32xx/driverlib/prcm.h>
+#include <ti/devices/cc32xx/driverlib/pin.h>
+#include <ti/devices/cc32xx/driverlib/gpio.h>
+#include <ti/devices/cc32xx/driverlib/utils.h>
+
+#include <uart_term.h>
+
+#include "i2c_bus.h"
+
+/* half an SCL period of the recovery clock, UtilsDelay() loops take three
+   cycles: 134 loops at 80 MHz is about 5 us, a 100 kHz clock */
+#define I2CBUS_RECOVER_HALF_CLOCK       (134)
+#define I2CBUS_RECOVER_CLOCKS           (9)
+
+typedef struct I2CBus_Request
+{
+    I2C_Transaction *pTxn;
+    sem_t signal;               /* bus handed over, then transfer done */
+    uint8_t priority;
+    volatile bool status;
+    struct I2CBus_Request *pNext;
+}I2CBus_Request_t;
+
+static I2C_Handle gI2CBusHandle;
+static uint_least8_t gI2CBusIndex;
+static I2C_Params gI2CBusParams;
+
+static pthread_mutex_t gI2CBusLock;
+static uint8_t gI2CBusBusy;
+/* callers waiting for the bus, by priority then arrival */
+static I2CBus_Request_t *gI2CBusWaiting;
+
+/* counters, written by the bus owner and read by others under the lock */
+static I2CBus_DeviceStats_t gI2CBusDevices[I2CBUS_MAX_DEVICES];
+static uint8_t gI2CBusDeviceNum;
+static uint32_t gI2CBusRecoveries;
+/* only the bus owner touches this */
+static uint8_t gI2CBusErrors;
+
+//*****************************************************************************
+//
+//! \brief Transfer callback, runs in interrupt context
+//!
+//! \param[in]  handle        I2C handle
+//!
+//! \param[in]  pTxn          completed transaction
+//!
+//! \param[in]  status        transfer status
+//!
+//! \return none
+//!
+//****************************************************************************
+static void I2CBus_callback(I2C_Handle handle, I2C_Transaction *pTxn,
+                            bool status)
+{
+    I2CBus_Request_t *pReq = (I2CBus_Request_t *)pTxn->arg;
+
+    pReq->status = status;
+    sem_post(&pReq->signal);
+}
+
+//*****************************************************************************
+//
+//! \brief Finds the counters of a device
+//!
+//! \param[in]  addr          7-bit slave address
+//!
+//! \return device counters, NULL if the device is not registered
+//!
+//****************************************************************************
+static I2CBus_DeviceStats_t * I2CBus_findDevice(uint8_t addr)
+{
+    uint8_t idx;
+
+    for(idx = 0; idx < gI2CBusDeviceNum; idx++)
+    {
+        if(gI2CBusDevices[idx].addr == addr)
+        {
+            return(&gI2CBusDevices[idx]);
+        }
+    }
+
+    return(NULL);
+}
+
+//*****************************************************************************
+//
+//! \brief Frees a slave stuck in the middle of a read, holding SDA low:
+//!        clocks SCL until it lets go of SDA, then reopens the controller,
+//!        which restores the pin mux
+//!
+//! \param  none
+//!
+//! \return none
+//!
+//****************************************************************************
+static void I2CBus_recover(void)
+{
+    uint8_t clock;
+
+    if(gI2CBusHandle != NULL)
+    {
+        I2C_close(gI2CBusHandle);
+        gI2CBusHandle = NULL;
+    }
+
+    MAP_PRCMPeripheralClkEnable(PRCM_GPIOA1, PRCM_RUN_MODE_CLK);
+    MAP_PinTypeGPIO(I2CBUS_SDA_PIN, PIN_MODE_0, false);
+    MAP_GPIODirModeSet(I2CBUS_GPIO_BASE, I2CBUS_SDA_BIT, GPIO_DIR_MODE_IN);
+    MAP_PinTypeGPIO(I2CBUS_SCL_PIN, PIN_MODE_0, true);
+    MAP_GPIODirModeSet(I2CBUS_GPIO_BASE, I2CBUS_SCL_BIT, GPIO_DIR_MODE_OUT);
+    MAP_GPIOPinWrite(I2CBUS_GPIO_BASE, I2CBUS_SCL_BIT, I2CBUS_SCL_BIT);
+
+    for(clock = 0; clock < I2CBUS_RECOVER_CLOCKS; clock++)
+    {
+        if(MAP_GPIOPinRead(I2CBUS_GPIO_BASE, I2CBUS_SDA_BIT))
+        {
+            break;
+        }
+        MAP_GPIOPinWrite(I2CBUS_GPIO_BASE, I2CBUS_SCL_BIT, 0);
+        MAP_UtilsDelay(I2CBUS_RECOVER_HALF_CLOCK);
+        MAP_GPIOPinWrite(I2CBUS_GPIO_BASE, I2CBUS_SCL_BIT, I2CBUS_SCL_BIT);
+        MAP_UtilsDelay(I2CBUS_RECOVER_HALF_CLOCK);
+    }
+
+    /* I2C_open() hands out the same handle for an index, the ones the
+       drivers keep stay valid */
+    gI2CBusHandle = I2C_open(gI2CBusIndex, &gI2CBusParams);
+    pthread_mutex_lock(&gI2CBusLock);
+    gI2CBusRecoveries++;
+    pthread_mutex_unlock(&gI2CBusLock);
+
+    UART_PRINT("[I2C bus] recovered after %d clocks%s\n\r", clock,
+               (gI2CBusHandle == NULL) ? ", reopen failed" : "");
+}
+
+I2C_Handle I2CBus_open(uint_least8_t index, I2C_BitRate bitRate)
+{
+    pthread_mutex_init(&gI2CBusLock, (pthread_mutexattr_t*)NULL);
+
+    I2C_Params_init(&gI2CBusParams);
+    gI2CBusParams.bitRate = bitRate;
+    gI2CBusParams.transferMode = I2C_MODE_CALLBACK;
+    gI2CBusParams.transferCallbackFxn = I2CBus_callback;
+    gI2CBusIndex = index;
+
+    gI2CBusHandle = I2C_open(index, &gI2CBusParams);
+
+    return(gI2CBusHandle);
+}
+
+int32_t I2CBus_addDevice(uint8_t addr, const char *name,
+                         I2CBus_Priority priority)
+{
+    I2CBus_DeviceStats_t *pDev;
+
+    pthread_mutex_lock(&gI2CBusLock);
+    pDev = I2CBus_findDevice(addr);
+    if((pDev == NULL) && (gI2CBusDeviceNum < I2CBUS_MAX_DEVICES))
+    {
+        pDev = &gI2CBusDevices[gI2CBusDeviceNum++];
+        memset(pDev, 0, sizeof(I2CBus_DeviceStats_t));
+        pDev->addr = addr;
+    }
+    if(pDev != NULL)
+    {
+        pDev->name = name;
+        pDev->priority = priority;
+    }
+    pthread_mutex_unlock(&gI2CBusLock);
+
+    return((pDev != NULL) ? 0 : -1);
+}
+
+bool I2CBus_transfer(I2C_Handle handle, I2C_Transaction *pTxn)
+{
+    I2CBus_Request_t req;
+    I2CBus_Request_t **ppPrev;
+    I2CBus_DeviceStats_t *pDev;
+    struct timespec ts;
+    TickType_t start;
+    uint32_t latencyMs;
+    uint8_t timedOut = 0;
+    uint8_t answeredBefore = 0;
+
+    start = xTaskGetTickCount();
+
+    req.pTxn = pTxn;
+    req.status = false;
+    req.pNext = NULL;
+    sem_init(&req.signal, 0, 0);
+
+    pthread_mutex_lock(&gI2CBusLock);
+    pDev = I2CBus_findDevice(pTxn->slaveAddress);
+    req.priority = (pDev != NULL) ? pDev->priority : I2CBus_Priority_Normal;
+    if(gI2CBusBusy)
+    {
+        /* behind every waiting caller of the same or a higher priority */
+        ppPrev = &gI2CBusWaiting;
+        while((*ppPrev != NULL) && ((*ppPrev)->priority <= req.priority))
+        {
+            ppPrev = &(*ppPrev)->pNext;
+        }
+        req.pNext = *ppPrev;
+        *ppPrev = &req;
+        pthread_mutex_unlock(&gI2CBusLock);
+
+        /* the previous owner hands the bus over */
+        sem_wait(&req.signal);
+    }
+    else
+    {
+        gI2CBusBusy = 1;
+        pthread_mutex_unlock(&gI2CBusLock);
+    }
+
+    /* every driver opens the bus through I2CBus_open(), the handle it
+       passes is ours */
+    (void)handle;
+
+    /* the last recovery could not reopen the controller */
+    if(gI2CBusHandle == NULL)
+    {
+        I2CBus_recover();
+    }
+
+    pTxn->arg = &req;
+    if((gI2CBusHandle != NULL) && I2C_transfer(gI2CBusHandle, pTxn))
+    {
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_nsec += I2CBUS_TIMEOUT_MS * 1000000L;
+        if(ts.tv_nsec >= 1000000000L)
+        {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+        }
+
+        if(sem_timedwait(&req.signal, &ts) != 0)
+        {
+            /* the cancelled transfer still calls back */
+            I2C_cancel(gI2CBusHandle);
+            sem_wait(&req.signal);
+            timedOut = !req.status;
+        }
+    }
+    else
+    {
+        req.status = false;
+    }
+
+    /* counters are read by I2CBus_getStats() from other tasks */
+    latencyMs = (xTaskGetTickCount() - start) * portTICK_PERIOD_MS;
+    pthread_mutex_lock(&gI2CBusLock);
+    if(pDev != NULL)
+    {
+        pDev->transfers++;
+        pDev->latencyTotalMs += latencyMs;
+        if(latencyMs > pDev->latencyMaxMs)
+        {
+            pDev->latencyMaxMs = latencyMs;
+        }
+        if(!req.status)
+        {
+            pDev->errors++;
+        }
+        if(timedOut)
+        {
+            pDev->timeouts++;
+        }
+        answeredBefore = (pDev->errors < pDev->transfers);
+    }
+    pthread_mutex_unlock(&gI2CBusLock);
+
+    /* a missing device NAKs and fails alone. a run of timeouts, or of
+       failures of devices that answered before, points at the bus */
+    if(req.status)
+    {
+        gI2CBusErrors = 0;
+    }
+    else if((timedOut || answeredBefore) &&
+            (++gI2CBusErrors >= I2CBUS_RECOVER_ERRORS))
+    {
+        I2CBus_recover();
+        gI2CBusErrors = 0;
+    }
+
+    /* hand the bus to the next caller */
+    pthread_mutex_lock(&gI2CBusLock);
+    if(gI2CBusWaiting != NULL)
+    {
+        I2CBus_Request_t *pNext = gI2CBusWaiting;
+
+        gI2CBusWaiting = pNext->pNext;
+        pthread_mutex_unlock(&gI2CBusLock);
+        sem_post(&pNext->signal);
+    }
+    else
+    {
+        gI2CBusBusy = 0;
+        pthread_mutex_unlock(&gI2CBusLock);
+    }
+
+    sem_destroy(&req.signal);
+
+    return(req.status);
+}
+
+int32_t I2CBus_getStats(uint8_t idx, I2CBus_DeviceStats_t *pStats)
+{
+    int32_t status = -1;
+
+    pthread_mutex_lock(&gI2CBusLock);
+    if(idx < gI2CBusDeviceNum)
+    {
+        memcpy(pStats, &gI2CBusDevices[idx], sizeof(I2CBus_DeviceStats_t));
+        status = 0;
+    }
+    pthread_mutex_unlock(&gI2CBusLock);
+
+    return(status);
+}
+
+uint32_t I2CBus_getRecoveries(void)
+{
+    uint32_t recoveries;
+
+    pthread_mutex_lock(&gI2CBusLock);
+    recoveries = gI2CBusRecoveries;
+    pthread_mutex_unlock(&gI2CBusLock);
+
+    return(recoveries);
+}
@@ -0,0 +1,127 @@
+/*
+ * i2c_bus.h
+ *
+ *  Shared I2C bus manager. The sensor drivers call I2CBus_transfer() in
+ *  place of I2C_transfer(): the bus runs in callback mode, callers waiting
+ *  for the bus are served by device priority, every device keeps latency
+ *  and error counters, and a bus that keeps failing is recovered by
+ *  clocking out the stuck slave and reopening the controller.
+ */
+
+#ifndef I2C_BUS_H_
+#define I2C_BUS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* TI-DRIVERS Header files */
+#include <ti/drivers/I2C.h>
+
+/* devices with counters, transactions to other addresses run at normal
+   priority and are not accounted */
+#define I2CBUS_MAX_DEVICES              (8)
+
+/* a transaction not completed by then is cancelled */
+#define I2CBUS_TIMEOUT_MS               (50)
+
+/* consecutive failures before the bus is recovered */
+#define I2CBUS_RECOVER_ERRORS           (3)
+
+/* LaunchPad I2C pins (CC3220S_LAUNCHXL.c), bit-banged during recovery:
+   PIN_01 is GPIO10 (SCL), PIN_02 is GPIO11 (SDA) */
+#define I2CBUS_SCL_PIN                  PIN_01
+#define I2CBUS_SDA_PIN                  PIN_02
+#define I2CBUS_GPIO_BASE                GPIOA1_BASE
+#define I2CBUS_SCL_BIT                  (0x04)
+#define I2CBUS_SDA_BIT                  (0x08)
+
+/* lower value is served first */
+typedef enum
+{
+    I2CBus_Priority_Control,    /* readings the control loop acts on */
+    I2CBus_Priority_Normal,
+    I2CBus_Priority_Ui,         /* readings only shown to the user */
+    I2CBus_Priority_Max
+}I2CBus_Priority;
+
+typedef struct
+{
+    uint8_t  addr;
+    uint8_t  priority;
+    const char *name;
+    uint32_t transfers;
+    uint32_t errors;
+    uint32_t timeouts;
+    uint32_t latencyTotalMs;    /* queueing and transfer time */
+    uint32_t latencyMaxMs;
+}I2CBus_DeviceStats_t;
+
+//*****************************************************************************
+//
+//! \brief Opens the I2C controller in callback mode
+//!
+//! \param[in]  index         Board_I2Cx index of the controller
+//!
+//! \param[in]  bitRate       bus speed
+//!
+//! \return handle to pass to the drivers, NULL on failure
+//!
+//****************************************************************************
+I2C_Handle I2CBus_open(uint_least8_t index, I2C_BitRate bitRate);
+
+//*****************************************************************************
+//
+//! \brief Registers a device, its priority and the name its counters are
+//!        reported under
+//!
+//! \param[in]  addr          7-bit slave address
+//!
+//! \param[in]  name          device name, kept by reference
+//!
+//! \param[in]  priority      priority of the device transactions
+//!
+//! \return 0 on success, -1 if the device table is full
+//!
+//****************************************************************************
+int32_t I2CBus_addDevice(uint8_t addr, const char *name,
+                         I2CBus_Priority priority);
+
+//*****************************************************************************
+//
+//! \brief Runs a transaction. Blocks the caller until it is its turn on the
+//!        bus and the transfer is done, same contract as I2C_transfer().
+//!
+//! \param[in]  handle        handle returned by I2CBus_open()
+//!
+//! \param[in]  pTxn          transaction, its arg field is used by the bus
+//!
+//! \return true on success, false on failure or timeout
+//!
+//****************************************************************************
+bool I2CBus_transfer(I2C_Handle handle, I2C_Transaction *pTxn);
+
+//*****************************************************************************
+//
+//! \brief Copies the counters of a registered device
+//!
+//! \param[in]  idx           device index, in registration order
+//!
+//! \param[out] pStats        counters
+//!
+//! \return 0 on success, -1 past the last device
+//!
+//****************************************************************************
+int32_t I2CBus_getStats(uint8_t idx, I2CBus_DeviceStats_t *pStats);
+
+//*****************************************************************************
+//
+//! \brief Returns how many times the bus was recovered
+//!
+//! \param  none
+//!
+//! \return recovery count
+//!
+//****************************************************************************
+uint32_t I2CBus_getRecoveries(void);
+
+#endif /* I2C_BUS_H_ */
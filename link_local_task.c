@@ -55,6 +55,13 @@
 #include "out_of_box.h"
 #include "ota_archive.h"
 #include "system_task.h"
+#include "sensor_snapshot.h"
+#include "sensor_task.h"
+#include "sensor_history.h"
+#include "record_log.h"
+#include "url_encoded.h"
+#include "web_manifest.h"
+#include "http_writer.h"
 
 /* driverlib Header files */
 #include <ti/devices/cc32xx/inc/hw_memmap.h>
@@ -63,14 +70,14 @@
 #include <ti/devices/cc32xx/driverlib/prcm.h>
 
 
-/* External sensor Drivers*/
-#include "ccs811.h"
-#include "bme280.h"
-
-#define NETAPP_MAX_RX_FRAGMENT_LEN     SL_NETAPP_REQUEST_MAX_DATA_LEN
-#define NETAPP_MAX_METADATA_LEN        (100)
-#define NETAPP_MAX_ARGV_TO_CALLBACK    SL_FS_MAX_FILE_NAME_LENGTH + 50
-#define NUMBER_OF_URI_SERVICES         (9)
+#define NUMBER_OF_URI_SERVICES         (13)
+#if NUMBER_OF_URI_SERVICES > HTTP_LOOKUP_MAX_ENTRIES
+#error "HttpLookup_checkOrder() tracks the routes in a 32 bit mask"
+#endif
+#define LINKLOCAL_OTA_WORKER_IDX       (LINKLOCAL_WORKER_NUM)
+/* one request in hand per general worker plus a short backlog (uploads
+   included), anything beyond that is answered with 503 */
+#define LINKLOCAL_REQUEST_SLOT_NUM     (LINKLOCAL_WORKER_NUM + 2)
 
 #define LED_TOGGLE_OTA_PROCESS_TIMEOUT (100)   /* In msecs */
 
@@ -83,9 +90,22 @@
 
 #define MAC_ADDR_STR_LEN               (18)
 #define IP_ADDR_STR_LEN                (16)
-#define SENSOR_VALUE_STR_LEN           (4)
-#define ENVIRO_VALUE_STR_LEN           (10)
-#define STATE_VALUE_STR_LEN            (10)
+/* longest characteristic name accepted by the url-encoded parser */
+#define HTTP_MAX_CHARACTERISTIC_LEN    (16)
+
+/* httpRequest[] entries whose characteristics name the readings */
+#define SENSOR_REQUEST_IDX             (4)
+#define ENVIRO_REQUEST_IDX             (6)
+#define STATE_REQUEST_IDX              (7)
+
+/* accelerometer samples per /accel response, "-128,-128,-128," each */
+#define ACCEL_BATCH_MAX                (64)
+/* history samples per /history response, "-1000,254,25400,8528" each */
+#define HISTORY_BATCH_MAX              (48)
+/* log records read from the SD card at a time by /log */
+#define LOG_BATCH_RECORDS              (8)
+
+#define WEB_CONTENT_ENCODING_GZIP      "gzip"
 
 
 /****************************************************************************
@@ -106,36 +126,40 @@ void NetAppRequestErrorResponse(SlNetAppResponse_t *pNetAppResponse);
 
 //*****************************************************************************
 //
-//! \brief This function fetches the device MAC address
+//! \brief This function answers a netapp request right away with an HTTP
+//!        status, used when no slot or worker is available
 //!
-//! \param[out]  buffer to occupy the MAC address in string format
+//! \param[out]  pNetAppResponse    netapp response structure
 //!
-//! \return 0 on success else negative
+//! \param[in]   httpStatus         HTTP status to answer with
+//!
+//! \return none
 //!
 //****************************************************************************
-int32_t getDeviceMacAddress(uint8_t *macAddress);
+void NetAppRequestRejectResponse(SlNetAppResponse_t *pNetAppResponse,
+                                 uint16_t httpStatus);
 
 //*****************************************************************************
 //
-//! Function to read accelarometer
-//!
-//! \param  none
+//! \brief Request slot pool - allocation, release and metadata copy
 //!
-//! \return SUCCESS or FAILURE
-//!
-//*****************************************************************************
-uint8_t accelarometerReading(void);
+//****************************************************************************
+http_RequestSlot_t *requestSlotAlloc(void);
+void requestSlotFree(SlNetAppRequest_t *netAppRequest);
+int32_t requestSlotCopyMetadata(http_RequestSlot_t *slot,
+                                uint8_t *pMetadata,
+                                uint16_t metadataLen);
 
 //*****************************************************************************
 //
-//! Function to read temperature
+//! \brief This function fetches the device MAC address
 //!
-//! \param  none
+//! \param[out]  buffer to occupy the MAC address in string format
 //!
-//! \return SUCCESS or FAILURE
+//! \return 0 on success else negative
 //!
-//*****************************************************************************
-uint8_t temperatureReading(void);
+//****************************************************************************
+int32_t getDeviceMacAddress(uint8_t *macAddress);
 
 //*****************************************************************************
 //
@@ -164,12 +188,15 @@ uint16_t setElementType(uint8_t isValue,
 //! \param[in] contentLen           content length in respond to  
 //! HTTP GET request
 //!
+//! \param[in] pCtx                 worker context holding the metadata buffer
+//!
 //! \return metadataLen
 //!
 //****************************************************************************
 uint16_t prepareGetMetadata(int32_t parsingStatus,
                             uint32_t contentLen,
-                            HttpContentTypeList contentTypeId);
+                            HttpContentTypeList contentTypeId,
+                            http_WorkerCtx_t *pCtx);
 
 //*****************************************************************************
 //
@@ -177,32 +204,125 @@ uint16_t prepareGetMetadata(int32_t parsingStatus,
 //!
 //! \param[in] parsingStatus        validity of HTTP POST/PUT request
 //!
+//! \param[in] pCtx                 worker context holding the metadata buffer
+//!
 //! \return metadataLen
 //!
 //****************************************************************************
-uint16_t preparePostMetadata(int32_t parsingStatus);
+uint16_t preparePostMetadata(int32_t parsingStatus,
+                             http_WorkerCtx_t *pCtx);
+
+//*****************************************************************************
+//
+//! \brief This function answers 304 Not Modified, with no body, when the
+//!        client copy carries the entity tag of the response being served
+//!
+//! \param[in] netAppRequest        netapp request structure
+//!
+//! \param[in] pCtx                 worker context holding the entity tag
+//!
+//! \return 0 if 304 was sent, negative if the response must be sent
+//!
+//****************************************************************************
+int32_t sendNotModified(SlNetAppRequest_t *netAppRequest,
+                        http_WorkerCtx_t *pCtx);
+
+//*****************************************************************************
+//
+//! \brief This function returns a tag that changes with the actuator states
+//!
+//! \param[in]  None
+//!
+//! \return state tag
+//!
+//****************************************************************************
+uint32_t getStateTag(void);
+
+//*****************************************************************************
+//
+//! \brief This function appends the name of a characteristic and the
+//!        equal sign, preceded by the pair separator if needed
+//!
+//! \param[in]  pWriter           payload writer
+//!
+//! \param[in]  requestIdx        request index to indicate the message
+//!
+//! \param[in]  charIdx           characteristic index in charValues[]
+//!
+//! \return None
+//!
+//****************************************************************************
+void appendCharacteristic(HttpWriter_t *pWriter,
+                          uint8_t requestIdx,
+                          uint8_t charIdx);
+
+//*****************************************************************************
+//
+//! \brief This function sends the response to an HTTP GET request, 404 with
+//!        the not found page if the payload could not be formatted
+//!
+//! \param[in] netAppRequest        netapp request structure
+//!
+//! \param[in] pCtx                 worker context holding the payload
+//!
+//! \param[in] payloadLen           url-encoded payload length, or negative
+//!
+//! \return 0 on success else negative
+//!
+//****************************************************************************
+int32_t sendGetResponse(SlNetAppRequest_t *netAppRequest,
+                        http_WorkerCtx_t *pCtx,
+                        int32_t payloadLen);
+
+//*****************************************************************************
+//
+//! \brief This function sets the entity tag of the response
+//!
+//! \param[in] pCtx                 worker context holding the entity tag
+//!
+//! \param[in] sequence             snapshot sequence the response is built of
+//!
+//! \param[in] pStateTag            actuator state tag, NULL if not reported
+//!
+//! \return None
+//!
+//****************************************************************************
+void setEntityTag(http_WorkerCtx_t *pCtx,
+                  uint32_t sequence,
+                  uint32_t *pStateTag);
+
+//*****************************************************************************
+//
+//! \brief This function draws the per boot entity tag nonce
+//!
+//! \return None
+//!
+//****************************************************************************
+void initEntityTagNonce(void);
 
 //*****************************************************************************
 //
 //! \brief This function fetches the device IP address
 //!
-//! \param[in]  none
+//! \param[out] pCtx    worker context, the result is left in its
+//!                     metadata buffer
 //!
 //! \return 0 on success else negative
 //!
 //****************************************************************************
-int32_t getDeviceIpAddress(void);
+int32_t getDeviceIpAddress(http_WorkerCtx_t *pCtx);
 
 //*****************************************************************************
 //
 //! \brief This function fetches the SSID the device is connected to
 //!
-//! \param[in]  none
+//! \param[out] pCtx    worker context, the result is left in its
+//!                     metadata buffer
 //!
 //! \return 0 on success else negative
 //!
 //****************************************************************************
-int32_t getDeviceSSID(void);
+int32_t getDeviceSSID(http_WorkerCtx_t *pCtx);
 
 //*****************************************************************************
 //
@@ -210,13 +330,16 @@ int32_t getDeviceSSID(void);
 //!
 //! \param[in] netAppRequest        netapp request structure
 //!
+//! \param[in] pCtx                 worker context holding the request buffers
+//!
 //! \param[in] flags                netapp flags for more data
 //!
 //! \return 0 on success else negative
 //!
 //****************************************************************************
 int32_t otaFlushNetappReq(SlNetAppRequest_t *netAppRequest,
-                          uint32_t *flags);
+                          uint32_t *flags,
+                          http_WorkerCtx_t *pCtx);
 
 //*****************************************************************************
 //
@@ -230,13 +353,16 @@ int32_t otaFlushNetappReq(SlNetAppRequest_t *netAppRequest,
 //!
 //! \param[in] netAppRequest      netapp request structure
 //!
+//! \param[in] pCtx               worker context holding the request buffers
+//!
 //! \return 0 on success else negative
 //!
 //****************************************************************************
 int32_t otaPutCallback(uint8_t requestIdx,
                        uint8_t *argcCallback,
                        uint8_t **argvCallback,
-                       SlNetAppRequest_t *netAppRequest);
+                       SlNetAppRequest_t *netAppRequest,
+                       http_WorkerCtx_t *pCtx);
 
 //*****************************************************************************
 //
@@ -250,13 +376,16 @@ int32_t otaPutCallback(uint8_t requestIdx,
 //!
 //! \param[in] netAppRequest      netapp request structure
 //!
+//! \param[in] pCtx               worker context holding the request buffers
+//!
 //! \return 0 on success else negative
 //!
 //****************************************************************************
 int32_t otaGetCallback(uint8_t requestIdx,
                        uint8_t *argcCallback,
                        uint8_t **argvCallback,
-                       SlNetAppRequest_t *netAppRequest);
+                       SlNetAppRequest_t *netAppRequest,
+                       http_WorkerCtx_t *pCtx);
 
 //*****************************************************************************
 //
@@ -270,13 +399,16 @@ int32_t otaGetCallback(uint8_t requestIdx,
 //!
 //! \param[in] netAppRequest      netapp request structure
 //!
+//! \param[in] pCtx               worker context holding the request buffers
+//!
 //! \return 0 on success else negative
 //!
 //****************************************************************************
 int32_t lightGetCallback(uint8_t requestIdx,
                          uint8_t *argcCallback,
                          uint8_t **argvCallback,
-                         SlNetAppRequest_t *netAppRequest);
+                         SlNetAppRequest_t *netAppRequest,
+                         http_WorkerCtx_t *pCtx);
 
 //*****************************************************************************
 //
@@ -290,13 +422,16 @@ int32_t lightGetCallback(uint8_t requestIdx,
 //!
 //! \param[in] netAppRequest      netapp request structure
 //!
+//! \param[in] pCtx               worker context holding the request buffers
+//!
 //! \return 0 on success else negative
 //!
 //****************************************************************************
 int32_t lightPostCallback(uint8_t requestIdx,
                           uint8_t *argcCallback,
                           uint8_t **argvCallback,
-                          SlNetAppRequest_t *netAppRequest);
+                          SlNetAppRequest_t *netAppRequest,
+                          http_WorkerCtx_t *pCtx);
 
 //*****************************************************************************
 //
@@ -310,13 +445,85 @@ int32_t lightPostCallback(uint8_t requestIdx,
 //!
 //! \param[in] netAppRequest      netapp request structure
 //!
+//! \param[in] pCtx               worker context holding the request buffers
+//!
 //! \return 0 on success else negative
 //!
 //****************************************************************************
 int32_t sensorGetCallback(uint8_t requestIdx,
                           uint8_t *argcCallback,
                           uint8_t **argvCallback,
-                          SlNetAppRequest_t *netAppRequest);
+                          SlNetAppRequest_t *netAppRequest,
+                          http_WorkerCtx_t *pCtx);
+
+//*****************************************************************************
+//
+//! \brief This is a environmental sensors service callback function for HTTP GET
+//!
+//! \param[in]  requestIdx        request index to indicate the message
+//!
+//! \param[in]  argcCallback      count of input params to the service callback
+//!
+//! \param[in]  argvCallback      set of input params to the service callback
+//!
+//! \param[in] netAppRequest      netapp request structure
+//!
+//! \param[in] pCtx               worker context holding the request buffers
+//!
+//! \return 0 on success else negative
+//!
+//****************************************************************************
+int32_t environGetCallback(uint8_t requestIdx,
+                           uint8_t *argcCallback,
+                           uint8_t **argvCallback,
+                           SlNetAppRequest_t *netAppRequest,
+                           http_WorkerCtx_t *pCtx);
+
+//*****************************************************************************
+//
+//! \brief This is a device state service callback function for HTTP GET
+//!
+//! \param[in]  requestIdx        request index to indicate the message
+//!
+//! \param[in]  argcCallback      count of input params to the service callback
+//!
+//! \param[in]  argvCallback      set of input params to the service callback
+//!
+//! \param[in] netAppRequest      netapp request structure
+//!
+//! \param[in] pCtx               worker context holding the request buffers
+//!
+//! \return 0 on success else negative
+//!
+//****************************************************************************
+int32_t stateGetCallback(uint8_t requestIdx,
+                         uint8_t *argcCallback,
+                         uint8_t **argvCallback,
+                         SlNetAppRequest_t *netAppRequest,
+                         http_WorkerCtx_t *pCtx);
+
+//*****************************************************************************
+//
+//! \brief This is a device state service callback function for HTTP POST
+//!
+//! \param[in]  requestIdx        request index to indicate the message
+//!
+//! \param[in]  argcCallback      count of input params to the service callback
+//!
+//! \param[in]  argvCallback      set of input params to the service callback
+//!
+//! \param[in] netAppRequest      netapp request structure
+//!
+//! \param[in] pCtx               worker context holding the request buffers
+//!
+//! \return 0 on success else negative
+//!
+//****************************************************************************
+int32_t statePostCallback(uint8_t requestIdx,
+                          uint8_t *argcCallback,
+                          uint8_t **argvCallback,
+                          SlNetAppRequest_t *netAppRequest,
+                          http_WorkerCtx_t *pCtx);
 
 //*****************************************************************************
 //
@@ -330,25 +537,184 @@ int32_t sensorGetCallback(uint8_t requestIdx,
 //!
 //! \param[in] netAppRequest      netapp request structure
 //!
+//! \param[in] pCtx               worker context holding the request buffers
+//!
 //! \return 0 on success else negative
 //!
 //****************************************************************************
 int32_t deviceGetCallback(uint8_t requestIdx,
                           uint8_t *argcCallback,
                           uint8_t **argvCallback,
-                          SlNetAppRequest_t *netAppRequest);
+                          SlNetAppRequest_t *netAppRequest,
+                          http_WorkerCtx_t *pCtx);
+
+//*****************************************************************************
+//
+//! \brief This is the snapshot service callback function for HTTP GET, it
+//!        returns every reading and actuator state in one response
+//!
+//! \param[in]  requestIdx        request index to indicate the message
+//!
+//! \param[in]  argcCallback      count of input params to the service callback
+//!
+//! \param[in]  argvCallback      set of input params to the service callback
+//!
+//! \param[in] netAppRequest      netapp request structure
+//!
+//! \param[in] pCtx               worker context holding the request buffers
+//!
+//! \return 0 on success else negative
+//!
+//****************************************************************************
+int32_t snapshotGetCallback(uint8_t requestIdx,
+                            uint8_t *argcCallback,
+                            uint8_t **argvCallback,
+                            SlNetAppRequest_t *netAppRequest,
+                            http_WorkerCtx_t *pCtx);
+
+//*****************************************************************************
+//
+//! \brief This is the accelerometer stream callback function for HTTP GET
+//!
+//! \param[in]  requestIdx        request index to indicate the message
+//!
+//! \param[in]  argcCallback      count of input params to the service callback
+//!
+//! \param[in]  argvCallback      set of input params to the service callback
+//!
+//! \param[in] netAppRequest      netapp request structure
+//!
+//! \param[in] pCtx               worker context holding the request buffers
+//!
+//! \return 0 on success else negative
+//!
+//****************************************************************************
+int32_t accelGetCallback(uint8_t requestIdx,
+                         uint8_t *argcCallback,
+                         uint8_t **argvCallback,
+                         SlNetAppRequest_t *netAppRequest,
+                         http_WorkerCtx_t *pCtx);
+
+//*****************************************************************************
+//
+//! \brief This is the reading history callback function for HTTP GET
+//!
+//! \param[in]  requestIdx        request index to indicate the message
+//!
+//! \param[in]  argcCallback      count of input params to the service callback
+//!
+//! \param[in]  argvCallback      set of input params to the service callback
+//!
+//! \param[in] netAppRequest      netapp request structure
+//!
+//! \param[in] pCtx               worker context holding the request buffers
+//!
+//! \return 0 on success else negative
+//!
+//****************************************************************************
+int32_t historyGetCallback(uint8_t requestIdx,
+                           uint8_t *argcCallback,
+                           uint8_t **argvCallback,
+                           SlNetAppRequest_t *netAppRequest,
+                           http_WorkerCtx_t *pCtx);
+
+//*****************************************************************************
+//
+//! \brief This is the data log export callback function for HTTP GET
+//!
+//! \param[in]  requestIdx        request index to indicate the message
+//!
+//! \param[in]  argcCallback      count of input params to the service callback
+//!
+//! \param[in]  argvCallback      set of input params to the service callback
+//!
+//! \param[in] netAppRequest      netapp request structure
+//!
+//! \param[in] pCtx               worker context holding the request buffers
+//!
+//! \return 0 on success, negative if records were sent as zeros
+//!
+//****************************************************************************
+int32_t logGetCallback(uint8_t requestIdx,
+                       uint8_t *argcCallback,
+                       uint8_t **argvCallback,
+                       SlNetAppRequest_t *netAppRequest,
+                       http_WorkerCtx_t *pCtx);
 
 //*****************************************************************************
 //
-//! \brief This function create mailbox message queue between linkLocal task
-//!                and driver task
+//! \brief This function verifies that the route and characteristic lookup
+//!        tables are sorted, the binary searches depend on it
 //!
 //! \param[in]  None
 //!
 //! \return 0 on success or -ve on error
 //!
 //****************************************************************************
-void initLinkLocalDB(void);
+int32_t initLinkLocalDB(void);
+
+//*****************************************************************************
+//
+//! \brief This function finds the service serving an URI and HTTP method
+//!
+//! \param[in]  pUri              URI, not necessarily NULL terminated
+//!
+//! \param[in]  uriLen            URI length
+//!
+//! \param[in]  requestType       HTTP method (GET, POST, PUT or DEL)
+//!
+//! \return index in httpRequest[] or -1 if the route is unknown
+//!
+//****************************************************************************
+int32_t lookupRoute(const uint8_t *pUri,
+                    uint16_t uriLen,
+                    uint8_t requestType);
+
+//*****************************************************************************
+//
+//! \brief This function finds a characteristic of a service by exact name
+//!
+//! \param[in]  requestIdx        request index to indicate the message
+//!
+//! \param[in]  pName             characteristic name
+//!
+//! \param[in]  nameLen           characteristic name length
+//!
+//! \return index in charValues[] or -1 if the characteristic is unknown
+//!
+//****************************************************************************
+int32_t lookupCharacteristic(uint8_t requestIdx,
+                             const uint8_t *pName,
+                             uint16_t nameLen);
+
+//*****************************************************************************
+//
+//! \brief This function finds a fingerprinted web asset by its URI
+//!
+//! \param[in]  pUri              URI, not necessarily NULL terminated
+//!
+//! \param[in]  uriLen            URI length
+//!
+//! \return index in gWebAssets[] or -1 if the asset is unknown
+//!
+//****************************************************************************
+int32_t lookupWebAsset(const uint8_t *pUri,
+                       uint16_t uriLen);
+
+//*****************************************************************************
+//
+//! \brief This function serves a fingerprinted web asset from the file
+//!        system, precompressed assets are sent with Content-Encoding gzip
+//!
+//! \param[in] netAppRequest        netapp request structure
+//!
+//! \param[in] pCtx                 worker context holding the request buffers
+//!
+//! \return 0 if the response was sent, negative if the URI is not an asset
+//!
+//****************************************************************************
+int32_t serveWebAsset(SlNetAppRequest_t *netAppRequest,
+                      http_WorkerCtx_t *pCtx);
 
 //*****************************************************************************
 //
@@ -463,10 +829,13 @@ int32_t httpCheckContentInDB(SlNetAppRequest_t *netAppRequest,
 //!
 //! \param[in] netAppRequest        netapp request structure
 //!
+//! \param[in] pCtx                 worker context holding the request buffers
+//!
 //! \return None
 //!
 //****************************************************************************
-void httpGetHandler(SlNetAppRequest_t *netAppRequest);
+void httpGetHandler(SlNetAppRequest_t *netAppRequest,
+http_WorkerCtx_t *pCtx);
 
 //*****************************************************************************
 //
@@ -474,10 +843,24 @@ void httpGetHandler(SlNetAppRequest_t *netAppRequest);
 //!
 //! \param[in] netAppRequest        netapp request structure
 //!
+//! \param[in] pCtx                 worker context holding the request buffers
+//!
+//! \return None
+//!
+//****************************************************************************
+void httpPostHandler(SlNetAppRequest_t *netAppRequest,
+http_WorkerCtx_t *pCtx);
+
+//*****************************************************************************
+//
+//! \brief This task serves LinkLocal requests from one of the request queues
+//!
+//! \param[in]  pvParameters      worker context (http_WorkerCtx_t)
+//!
 //! \return None
 //!
 //****************************************************************************
-void httpPostHandler(SlNetAppRequest_t *netAppRequest);
+void * linkLocalWorkerTask(void *pvParameters);
 
 /****************************************************************************
                       GLOBAL VARIABLES
@@ -485,30 +868,16 @@ void httpPostHandler(SlNetAppRequest_t *netAppRequest);
 
 const uint8_t pageNotFound[] = "<html>404 - Sorry page not found</html>";
 
-/* metadata and content buffer are allocated 
-   static as these are shared in all use cases*/
-/* however, it is possible to set those dynamically as well */
-uint8_t gMetadataBuffer[NETAPP_MAX_METADATA_LEN];
-uint8_t gPayloadBuffer[NETAPP_MAX_RX_FRAGMENT_LEN];
-uint8_t gOtaVersion[VERSION_STR_SIZE + 1];
-
-uint8_t gHttpPostBuffer[NETAPP_MAX_ARGV_TO_CALLBACK];
-uint8_t gHttpGetBuffer[NETAPP_MAX_ARGV_TO_CALLBACK];
-
-int8_t xVal, yVal, zVal;
-
-/* BME280 Data outputs*/
-
-BME280_RawData *bmeDatIn;
-BME280_RawData *bmeDatOut;
-int32_t tempIn;
-uint32_t presIn;
-uint32_t humidIn;
-int32_t tempOut;
-uint32_t presOut;
-uint32_t humidOut;
-
+/* metadata, content and argv buffers are owned by the request workers.
+   the last worker is the long-running lane (OTA PUT) so an upload never
+   blocks the short requests served by the others */
+http_WorkerCtx_t gWorkerCtx[LINKLOCAL_WORKER_NUM + 1];
+pthread_t gLinklocalWorkerThread[LINKLOCAL_WORKER_NUM + 1];
 
+/* requests waiting for, or served by, a worker live in these slots */
+http_RequestSlot_t gRequestPool[LINKLOCAL_REQUEST_SLOT_NUM];
+http_RequestPoolStats_t gRequestPoolStats;
+pthread_mutex_t gRequestPoolLockObj;
 
 extern Actuator_State Lights_State;
 extern Actuator_State Fan_State;
@@ -516,67 +885,164 @@ extern Actuator_State Peltier_State;
 extern ScheduleTime Lights_ON;
 extern ScheduleTime Lights_OFF;
 extern int32_t goalTemp;
-extern TickType_t dataFreq;
+extern int16_t dataFreq;
 extern SlDateTime_t lastDump;
 extern SlDateTime_t lastCheckin;
 
-
-
-
-
-/* CCS811 Data Outputs*/
-static ccs811_sensor_t* sensor;//
-
-uint16_t airQuality = 0; // in eco2 ppm
-
-/* oxygen sensor variables*/
-ADC_Handle oxygenSensor;
-uint16_t oxygenRAW;
-uint16_t oxygen;
-
-
-
-
-float temperatureVal;
-I2C_Handle i2cHandle;
-
 /* database to hold ota archive */
 OtaArchive_t gOtaArcive;
 
-/* message queue for http messages between server and client */
+/* message queues for http messages between server and client */
 mqd_t linkLocalMQueue;
-pthread_mutex_t *sensorLockObj = NULL;    /* Lock Object for sensor readings */
+mqd_t linkLocalOtaMQueue;
+
+/* characteristic indices of each service sorted by name length, then by
+   name bytes. keep them sorted when adding a characteristic, initLinkLocalDB
+   verifies the order at startup */
+const uint8_t gOtaGetCharOrder[] = {OtaIdx_Version};
+const uint8_t gOtaPutCharOrder[] = {0};
+const uint8_t gLightGetCharOrder[] =
+{
+    LedIdx_RedLed, LedIdx_GreenLed, LedIdx_OrangeLed
+};
+const uint8_t gLightPostCharOrder[] = {LedIdx_RedLed};
+const uint8_t gSensorCharOrder[] =
+{
+    SensorIdx_FarnTemp, SensorIdx_XAxis, SensorIdx_YAxis, SensorIdx_ZAxis
+};
+const uint8_t gDeviceCharOrder[] =
+{
+    DeviceIdx_Ssid, DeviceIdx_AppID, DeviceIdx_IpAddress, DeviceIdx_MacAddress
+};
+const uint8_t gEnviroCharOrder[] =
+{
+    EnviroIdx_InPres, EnviroIdx_InTemp, EnviroIdx_oxygen, EnviroIdx_InHumid,
+    EnviroIdx_OutPres, EnviroIdx_OutTemp, EnviroIdx_OutHumid,
+    EnviroIdx_airQuality
+};
+const uint8_t gStateCharOrder[] =
+{
+    StateIdx_fans, StateIdx_lights, StateIdx_cooling, StateIdx_dataFreq,
+    StateIdx_goalTemp, StateIdx_lastDump, StateIdx_lastCheckin
+};
+const uint8_t gStatePostCharOrder[] =
+{
+    StatePostIdx_o2Cal, StatePostIdx_bmeProfile
+};
+const uint8_t gAccelCharOrder[] = {AccelIdx_count, AccelIdx_since};
+const uint8_t gHistoryCharOrder[] =
+{
+    HistoryIdx_tier, HistoryIdx_count, HistoryIdx_since
+};
+const uint8_t gLogCharOrder[] = {LogIdx_to, LogIdx_from, LogIdx_format};
 
-http_RequestObj_t httpRequest[NUMBER_OF_URI_SERVICES] =
+/* charValues[] stay in enum order, the callbacks index them directly */
+const http_RequestObj_t httpRequest[NUMBER_OF_URI_SERVICES] =
 {
-    {0, SL_NETAPP_REQUEST_HTTP_GET, "/ota", {
-         {NULL}
-     }, NULL},
-    {1, SL_NETAPP_REQUEST_HTTP_PUT, "/ota", {
-         {NULL}
-     }, NULL},
-    {2, SL_NETAPP_REQUEST_HTTP_GET, "/light", {
-         {NULL}
-     }, NULL},
-    {3, SL_NETAPP_REQUEST_HTTP_POST, "/light", {
-         {NULL}
-     }, NULL},
-    {4, SL_NETAPP_REQUEST_HTTP_GET, "/sensor", {
-         {NULL}
-     }, NULL},
-    {5, SL_NETAPP_REQUEST_HTTP_GET, "/device", {
-         {NULL}
-     }, NULL},
-     {6, SL_NETAPP_REQUEST_HTTP_GET, "/enviro", {
-              {NULL}
-     }, NULL},
-     {7, SL_NETAPP_REQUEST_HTTP_GET, "/state", {
-              {NULL}
-     }, NULL},
-     {8, SL_NETAPP_REQUEST_HTTP_POST, "/state", {
-              {NULL}
-     }, NULL},
+    {{HTTP_STR("/ota"), SL_NETAPP_REQUEST_HTTP_GET}, 0,
+     gOtaGetCharOrder, sizeof(gOtaGetCharOrder), {
+         {{HTTP_STR("version")}}
+     }, otaGetCallback},
+    {{HTTP_STR("/ota"), SL_NETAPP_REQUEST_HTTP_PUT}, 1,
+     gOtaPutCharOrder, sizeof(gOtaPutCharOrder), {
+         {{HTTP_STR("filename")}}
+     }, otaPutCallback},
+    {{HTTP_STR("/light"), SL_NETAPP_REQUEST_HTTP_GET}, 2,
+     gLightGetCharOrder, sizeof(gLightGetCharOrder), {
+         {{HTTP_STR("redled")}, {"off", "on", "toggle"}},
+         {{HTTP_STR("orangeled")}, {"off", "on", "toggle"}},
+         {{HTTP_STR("greenled")}, {"off", "on", "toggle"}}
+     }, lightGetCallback},
+    {{HTTP_STR("/light"), SL_NETAPP_REQUEST_HTTP_POST}, 3,
+     gLightPostCharOrder, sizeof(gLightPostCharOrder), {
+         {{HTTP_STR("redled")}, {"off", "on", "toggle"}}
+     }, lightPostCallback},
+    {{HTTP_STR("/sensor"), SL_NETAPP_REQUEST_HTTP_GET}, 4,
+     gSensorCharOrder, sizeof(gSensorCharOrder), {
+         {{HTTP_STR("axisx")}},
+         {{HTTP_STR("axisy")}},
+         {{HTTP_STR("axisz")}},
+         {{HTTP_STR("temp")}}
+     }, sensorGetCallback},
+    {{HTTP_STR("/device"), SL_NETAPP_REQUEST_HTTP_GET}, 5,
+     gDeviceCharOrder, sizeof(gDeviceCharOrder), {
+         {{HTTP_STR("ssid")}},
+         {{HTTP_STR("ipaddress")}},
+         {{HTTP_STR("macaddress")}},
+         {{HTTP_STR("appname")}}
+     }, deviceGetCallback},
+    {{HTTP_STR("/enviro"), SL_NETAPP_REQUEST_HTTP_GET}, 6,
+     gEnviroCharOrder, sizeof(gEnviroCharOrder), {
+         {{HTTP_STR("inTemp")}},
+         {{HTTP_STR("outTemp")}},
+         {{HTTP_STR("inHumid")}},
+         {{HTTP_STR("outHumid")}},
+         {{HTTP_STR("inPres")}},
+         {{HTTP_STR("outPres")}},
+         {{HTTP_STR("oxygen")}},
+         {{HTTP_STR("airQuality")}}
+     }, environGetCallback},
+    {{HTTP_STR("/state"), SL_NETAPP_REQUEST_HTTP_GET}, 7,
+     gStateCharOrder, sizeof(gStateCharOrder), {
+         {{HTTP_STR("fans")}, {"off", "on", "toggle"}},
+         {{HTTP_STR("lights")}, {"off", "on", "toggle"}},
+         {{HTTP_STR("cooling")}, {"off", "on", "toggle"}},
+         {{HTTP_STR("goalTemp")}},
+         {{HTTP_STR("dataFreq")}},
+         {{HTTP_STR("lastDump")}},
+         {{HTTP_STR("lastCheckin")}}
+     }, stateGetCallback},
+    {{HTTP_STR("/state"), SL_NETAPP_REQUEST_HTTP_POST}, 8,
+     gStatePostCharOrder, sizeof(gStatePostCharOrder), {
+         /* values in BME280_Profile order */
+         {{HTTP_STR("bmeProfile")}, {"lowpower", "balanced", "highres"}},
+         /* values in SensorOxygenCal order */
+         {{HTTP_STR("o2Cal")}, {"zero", "air", "reset"}}
+     }, statePostCallback},
+    {{HTTP_STR("/api/snapshot"), SL_NETAPP_REQUEST_HTTP_GET}, 9,
+     NULL, 0, {
+         {{NULL}}
+     }, snapshotGetCallback},
+    {{HTTP_STR("/accel"), SL_NETAPP_REQUEST_HTTP_GET}, 10,
+     gAccelCharOrder, sizeof(gAccelCharOrder), {
+         {{HTTP_STR("since")}},
+         {{HTTP_STR("count")}}
+     }, accelGetCallback},
+    {{HTTP_STR("/history"), SL_NETAPP_REQUEST_HTTP_GET}, 11,
+     gHistoryCharOrder, sizeof(gHistoryCharOrder), {
+         /* values in SensorHistoryTier order */
+         {{HTTP_STR("tier")}, {"1s", "1m", "15m"}},
+         {{HTTP_STR("since")}},
+         {{HTTP_STR("count")}}
+     }, historyGetCallback},
+    {{HTTP_STR("/log"), SL_NETAPP_REQUEST_HTTP_GET}, 12,
+     gLogCharOrder, sizeof(gLogCharOrder), {
+         /* values in RecordLogFormat order */
+         {{HTTP_STR("format")}, {"csv", "json"}},
+         {{HTTP_STR("from")}},
+         {{HTTP_STR("to")}}
+     }, logGetCallback},
+};
+
+/* cleared by initLinkLocalDB() when a lookup order is wrong, the lookups
+   then scan the tables instead of missing entries */
+static uint8_t gLookupSorted = 1;
+
+/* drawn once per boot and put in front of every snapshot entity tag, the
+   snapshot sequence restarts at every boot and a tag cached before a reset
+   must not match the readings published after it */
+static uint32_t gEtagNonce;
 
+/* httpRequest[] indices sorted by URI length, URI bytes and then method */
+const uint8_t gRouteOrder[NUMBER_OF_URI_SERVICES] =
+{
+    12,             /* /log */
+    0, 1,           /* /ota GET, PUT */
+    10,             /* /accel */
+    2, 3, 7, 8,     /* /light GET, POST, /state GET, POST */
+    5, 6, 4,        /* /device, /enviro, /sensor */
+    11,             /* /history */
+    9               /* /api/snapshot */
 };
 
 http_headerFieldType_t g_HeaderFields [] =
@@ -619,33 +1085,34 @@ http_headerFieldType_t g_HeaderFields [] =
 
 http_contentTypeMapping_t g_ContentTypes [] =
 {
-    {HttpContentTypeList_TextHtml, TEXT_HTML, TEXT_HTML_MIME},
-    {HttpContentTypeList_TextCSS, TEXT_CSS, TEXT_CSS_MIME},
-    {HttpContentTypeList_TextXML, TEXT_XML, TEXT_XML_MIME},
-    {HttpContentTypeList_ApplicationJson, APPLICATION_JSON,
+    {HttpContentTypeList_TextHtml, HTTP_STR(TEXT_HTML), TEXT_HTML_MIME},
+    {HttpContentTypeList_TextCSS, HTTP_STR(TEXT_CSS), TEXT_CSS_MIME},
+    {HttpContentTypeList_TextXML, HTTP_STR(TEXT_XML), TEXT_XML_MIME},
+    {HttpContentTypeList_ApplicationJson, HTTP_STR(APPLICATION_JSON),
      APPLICATION_JSON_MIME},
-    {HttpContentTypeList_ImagePNG, IMAGE_PNG, IMAGE_PNG_MIME},
-    {HttpContentTypeList_ImageGIF, IMAGE_GIF, IMAGE_GIF_MIME},
-    {HttpContentTypeList_TextPlain, TEXT_PLAIN, TEXT_PLAIN_MIME},
-    {HttpContentTypeList_TextCSV, TEXT_CSV, TEXT_CSV_MIME},
-    {HttpContentTypeList_ApplicationJavascript, APPLICATION_JAVASCRIPT,
-     APPLICATION_JAVASCRIPT_MIME},
-    {HttpContentTypeList_ImageJPEG, IMAGE_JPEG, IMAGE_JPEG_MIME},
-    {HttpContentTypeList_ApplicationPDF, APPLICATION_PDF, 
+    {HttpContentTypeList_ImagePNG, HTTP_STR(IMAGE_PNG), IMAGE_PNG_MIME},
+    {HttpContentTypeList_ImageGIF, HTTP_STR(IMAGE_GIF), IMAGE_GIF_MIME},
+    {HttpContentTypeList_TextPlain, HTTP_STR(TEXT_PLAIN), TEXT_PLAIN_MIME},
+    {HttpContentTypeList_TextCSV, HTTP_STR(TEXT_CSV), TEXT_CSV_MIME},
+    {HttpContentTypeList_ApplicationJavascript,
+     HTTP_STR(APPLICATION_JAVASCRIPT), APPLICATION_JAVASCRIPT_MIME},
+    {HttpContentTypeList_ImageJPEG, HTTP_STR(IMAGE_JPEG), IMAGE_JPEG_MIME},
+    {HttpContentTypeList_ApplicationPDF, HTTP_STR(APPLICATION_PDF), 
      APPLICATION_PDF_MIME},
-    {HttpContentTypeList_ApplicationZIP, APPLICATION_ZIP, 
+    {HttpContentTypeList_ApplicationZIP, HTTP_STR(APPLICATION_ZIP), 
      APPLICATION_ZIP_MIME},
-    {HttpContentTypeList_ShokewaveFlash, SHOCKWAVE_FLASH, 
+    {HttpContentTypeList_ShokewaveFlash, HTTP_STR(SHOCKWAVE_FLASH), 
      SHOCKWAVE_FLASH_MIME},
-    {HttpContentTypeList_AudioXAAC, AUDIO_X_AAC, AUDIO_X_AAC_MIME},
-    {HttpContentTypeList_ImageXIcon, IMAGE_X_ICON, IMAGE_X_ICON_MIME},
-    {HttpContentTypeList_TextVcard, TEXT_VCARD, TEXT_VCARD_MIME},
-    {HttpContentTypeList_ApplicationOctecStream, APPLICATION_OCTEC_STREAM,
-     APPLICATION_OCTEC_STREAM_MIME},
-    {HttpContentTypeList_VideoAVI, VIDEO_AVI, VIDEO_AVI_MIME},
-    {HttpContentTypeList_VideoMPEG, VIDEO_MPEG, VIDEO_MPEG_MIME},
-    {HttpContentTypeList_VideoMP4, VIDEO_MP4, VIDEO_MP4_MIME},
-    {HttpContentTypeList_UrlEncoded, FORM_URLENCODED, URL_ENCODED_MIME}
+    {HttpContentTypeList_AudioXAAC, HTTP_STR(AUDIO_X_AAC), AUDIO_X_AAC_MIME},
+    {HttpContentTypeList_ImageXIcon, HTTP_STR(IMAGE_X_ICON), IMAGE_X_ICON_MIME},
+    {HttpContentTypeList_TextVcard, HTTP_STR(TEXT_VCARD), TEXT_VCARD_MIME},
+    {HttpContentTypeList_ApplicationOctecStream,
+     HTTP_STR(APPLICATION_OCTEC_STREAM), APPLICATION_OCTEC_STREAM_MIME},
+    {HttpContentTypeList_VideoAVI, HTTP_STR(VIDEO_AVI), VIDEO_AVI_MIME},
+    {HttpContentTypeList_VideoMPEG, HTTP_STR(VIDEO_MPEG), VIDEO_MPEG_MIME},
+    {HttpContentTypeList_VideoMP4, HTTP_STR(VIDEO_MP4), VIDEO_MP4_MIME},
+    {HttpContentTypeList_UrlEncoded, HTTP_STR(FORM_URLENCODED),
+     URL_ENCODED_MIME}
 };
 
 LinkLocal_CB LinkLocal_ControlBlock;
@@ -673,8 +1140,11 @@ extern int snprintf(char *_string,
 void SimpleLinkNetAppRequestEventHandler(SlNetAppRequest_t *pNetAppRequest,
                                          SlNetAppResponse_t *pNetAppResponse)
 {
+    http_RequestSlot_t *slot;
     SlNetAppRequest_t *netAppRequest;
     int32_t msgqRetVal;
+    int32_t metadataLen;
+    struct timespec ts;
 
     INFO_PRINT(
         "[Link local task] NetApp Request Received - AppId = %d, Type = %d,"
@@ -701,77 +1171,77 @@ void SimpleLinkNetAppRequestEventHandler(SlNetAppRequest_t *pNetAppRequest,
         return;
     }
 
-    netAppRequest = (SlNetAppRequest_t *) malloc (sizeof(SlNetAppRequest_t));
-    if(NULL == netAppRequest)
+    slot = requestSlotAlloc();
+    if(NULL == slot)
     {
-        NetAppRequestErrorResponse(pNetAppResponse);
+        NetAppRequestRejectResponse(pNetAppResponse,
+                                    SL_NETAPP_HTTP_RESPONSE_503_SERVICE_UNAVAILABLE);
 
         return;
     }
 
-    memset(netAppRequest,0,sizeof(SlNetAppRequest_t));
+    netAppRequest = &slot->request;
     netAppRequest->AppId = pNetAppRequest->AppId;
     netAppRequest->Type = pNetAppRequest->Type;
     netAppRequest->Handle = pNetAppRequest->Handle;
     netAppRequest->requestData.Flags = pNetAppRequest->requestData.Flags;
 
     /* Copy Metadata */
-    if(pNetAppRequest->requestData.MetadataLen > 0)
-    {
-        netAppRequest->requestData.pMetadata = (uint8_t *) malloc (
-            pNetAppRequest->requestData.MetadataLen);
-        if(NULL == netAppRequest->requestData.pMetadata)
-        {
-            NetAppRequestErrorResponse(pNetAppResponse);
-            free(netAppRequest);
-            return;
-        }
-        sl_Memcpy(netAppRequest->requestData.pMetadata,
-                  pNetAppRequest->requestData.pMetadata,
-                  pNetAppRequest->requestData.MetadataLen);
-        netAppRequest->requestData.MetadataLen =
-            pNetAppRequest->requestData.MetadataLen;
-    }
-    else
+    metadataLen = requestSlotCopyMetadata(slot,
+                                          pNetAppRequest->requestData.pMetadata,
+                                          pNetAppRequest->requestData.MetadataLen);
+    if(metadataLen < 0)
     {
-        netAppRequest->requestData.MetadataLen = 0;
+        requestSlotFree(netAppRequest);
+        gRequestPoolStats.oversize++;
+        NetAppRequestRejectResponse(pNetAppResponse,
+                                    SL_NETAPP_HTTP_RESPONSE_404_NOT_FOUND);
+
+        return;
     }
+    netAppRequest->requestData.pMetadata = slot->metadata;
+    netAppRequest->requestData.MetadataLen = (uint16_t)metadataLen;
 
-    /* Copy the payload */
-    if(pNetAppRequest->requestData.PayloadLen > 0)
+    /* Copy the payload, the NWP never hands over more than a fragment */
+    if((pNetAppRequest->requestData.PayloadLen > 0) &&
+       (pNetAppRequest->requestData.PayloadLen <= NETAPP_MAX_RX_FRAGMENT_LEN))
     {
-        netAppRequest->requestData.pPayload = (uint8_t *) malloc (
-            pNetAppRequest->requestData.PayloadLen);
-        if(NULL == netAppRequest->requestData.pPayload)
-        {
-            NetAppRequestErrorResponse(pNetAppResponse);
-
-            if(netAppRequest->requestData.pMetadata != NULL)
-            {
-                free(netAppRequest->requestData.pMetadata);
-            }
-            free(netAppRequest);
-            return;
-        }
-        sl_Memcpy (netAppRequest->requestData.pPayload,
+        sl_Memcpy (slot->payload,
                    pNetAppRequest->requestData.pPayload,
                    pNetAppRequest->requestData.PayloadLen);
+        slot->payload[pNetAppRequest->requestData.PayloadLen] = '\0';
+        netAppRequest->requestData.pPayload = slot->payload;
         netAppRequest->requestData.PayloadLen =
             pNetAppRequest->requestData.PayloadLen;
     }
     else
     {
+        netAppRequest->requestData.pPayload = NULL;
         netAppRequest->requestData.PayloadLen = 0;
     }
 
-    msgqRetVal = mq_send(linkLocalMQueue, (char *)&netAppRequest, 1, 0);
+    /* never block the NWP event context - if the workers are behind,
+       turn the client away right now */
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    /* uploads are long-running, keep them off the queue of the
+       short requests */
+    if(netAppRequest->Type == SL_NETAPP_REQUEST_HTTP_PUT)
+    {
+        msgqRetVal = mq_timedsend(linkLocalOtaMQueue, (char *)&netAppRequest,
+                                  sizeof(SlNetAppRequest_t*), 0, &ts);
+    }
+    else
+    {
+        msgqRetVal = mq_timedsend(linkLocalMQueue, (char *)&netAppRequest,
+                                  sizeof(SlNetAppRequest_t*), 0, &ts);
+    }
     if(msgqRetVal < 0)
     {
-        UART_PRINT("[Link local task] could not send element to msg queue\n\r");
-        while(1)
-        {
-            ;
-        }
+        requestSlotFree(netAppRequest);
+        gRequestPoolStats.queueFull++;
+        NetAppRequestRejectResponse(pNetAppResponse,
+                                    SL_NETAPP_HTTP_RESPONSE_503_SERVICE_UNAVAILABLE);
     }
 }
 
@@ -788,13 +1258,16 @@ void SimpleLinkNetAppRequestEventHandler(SlNetAppRequest_t *pNetAppRequest,
 //!
 //! \param[in] netAppRequest        netapp request structure
 //!
+//! \param[in] pCtx                 worker context holding the request buffers
+//!
 //! \return 0 on success else negative
 //!
 //****************************************************************************
 int32_t otaPutCallback(uint8_t requestIdx,
                        uint8_t *argcCallback,
                        uint8_t **argvCallback,
-                       SlNetAppRequest_t *netAppRequest)
+                       SlNetAppRequest_t *netAppRequest,
+                       http_WorkerCtx_t *pCtx)
 {
     uint8_t *argvArray;
     uint16_t metadataLen;
@@ -865,10 +1338,10 @@ int32_t otaPutCallback(uint8_t requestIdx,
     /* updating versions */
     OtaArchive_CheckVersion(&gOtaArcive, filename);
 
-    sl_Memcpy(gPayloadBuffer, netAppRequest->requestData.pPayload,
+    sl_Memcpy(pCtx->payloadBuffer, netAppRequest->requestData.pPayload,
               netAppRequest->requestData.PayloadLen);
     status =
-        (int32_t)OtaArchive_Process(&gOtaArcive, gPayloadBuffer,
+        (int32_t)OtaArchive_Process(&gOtaArcive, pCtx->payloadBuffer,
                                     netAppRequest->requestData.PayloadLen,
                                     &processedBytes);
     INFO_PRINT("[Link local task] Received OTA payload %d. Processed %d \n\r",
@@ -910,7 +1383,7 @@ int32_t otaPutCallback(uint8_t requestIdx,
         /* copy the unprocessed part to the start of the buffer */
         if(unprocessedBytes > 0)
         {
-            sl_Memcpy(&gPayloadBuffer[0], &gPayloadBuffer[processedBytes],
+            sl_Memcpy(&pCtx->payloadBuffer[0], &pCtx->payloadBuffer[processedBytes],
                       unprocessedBytes);
         }
 
@@ -919,7 +1392,7 @@ int32_t otaPutCallback(uint8_t requestIdx,
             chunkLen = NETAPP_MAX_RX_FRAGMENT_LEN - unprocessedBytes;
             status =
                 sl_NetAppRecv(netAppRequest->Handle, (uint16_t *)&chunkLen,
-                              &gPayloadBuffer[unprocessedBytes],
+                              &pCtx->payloadBuffer[unprocessedBytes],
                               (unsigned long *)&flags);
             INFO_PRINT(
                 "[Link local task] sl_NetAppRecv payload=%d, flags=%d \n\r",
@@ -996,7 +1469,7 @@ int32_t otaPutCallback(uint8_t requestIdx,
 
         otaChunkLen = chunkLen + unprocessedBytes;
         status =
-            (int32_t)OtaArchive_Process(&gOtaArcive, gPayloadBuffer,
+            (int32_t)OtaArchive_Process(&gOtaArcive, pCtx->payloadBuffer,
                                         otaChunkLen,
                                         &processedBytes);
 
@@ -1081,7 +1554,7 @@ exit_ota_put:
     if(status == 0)
     {
         /* flush the netapp data from client */
-        otaFlushNetappReq(netAppRequest, &flags);
+        otaFlushNetappReq(netAppRequest, &flags, pCtx);
     }
 
     /* sending metadata is not allowed in case of internal error */
@@ -1092,10 +1565,10 @@ exit_ota_put:
     }
     else
     {
-        metadataLen = preparePostMetadata(status);
+        metadataLen = preparePostMetadata(status, pCtx);
 
         INFO_PRINT("[Link local task] ota put, sending metadata \r\n");
-        sl_NetAppSend (netAppRequest->Handle, metadataLen, gMetadataBuffer,
+        sl_NetAppSend (netAppRequest->Handle, metadataLen, pCtx->metadataBuffer,
                        SL_NETAPP_REQUEST_RESPONSE_FLAGS_METADATA);
     }
 
@@ -1156,20 +1629,24 @@ exit_ota_put:
 //!
 //! \param[in] netAppRequest      netapp request structure
 //!
+//! \param[in] pCtx               worker context holding the request buffers
+//!
 //! \return 0 on success else negative
 //!
 //****************************************************************************
 int32_t otaGetCallback(uint8_t requestIdx,
                        uint8_t *argcCallback,
                        uint8_t **argvCallback,
-                       SlNetAppRequest_t *netAppRequest)
+                       SlNetAppRequest_t *netAppRequest,
+                       http_WorkerCtx_t *pCtx)
 {
-    uint8_t *argvArray, *pPayload;
-    uint16_t metadataLen, elementType;
-    int32_t status = 0;
+    uint8_t *argvArray;
+    uint16_t elementType;
+    uint8_t otaVersion[VERSION_STR_SIZE];
+    HttpWriter_t writer;
 
     argvArray = *argvCallback;
-    pPayload = gPayloadBuffer;
+    HttpWriter_init(&writer, pCtx->payloadBuffer, NETAPP_MAX_RX_FRAGMENT_LEN);
 
     while(*argcCallback > 0)
     {
@@ -1177,45 +1654,27 @@ int32_t otaGetCallback(uint8_t requestIdx,
         /* content length is irrelevant for GET */
         if(*((uint16_t *)argvArray) != elementType)          
         {
+            appendCharacteristic(&writer, requestIdx,
+                                 *(argvArray + ARGV_VALUE_OFFSET));
+
             switch(*(argvArray + ARGV_VALUE_OFFSET))
             {
             case OtaIdx_Version:
 
-                status = OtaArchive_GetCurrentVersion(gOtaVersion);
-                if(status < 0)
+                if(OtaArchive_GetCurrentVersion(otaVersion) < 0)
                 {
                     UART_PRINT(
                         "[Link local task] ota bundle version file does "
                         "not exist\r\n");
-                    strcpy((char *)gMetadataBuffer, "no version file exists");
-                    status = 0;
+                    HttpWriter_appendStr(&writer, "no version file exists");
                 }
                 else
                 {
-                    sl_Memcpy(gMetadataBuffer, gOtaVersion, VERSION_STR_SIZE);
-                    gMetadataBuffer[VERSION_STR_SIZE] = '\0';
+                    HttpWriter_append(&writer, otaVersion, VERSION_STR_SIZE);
                 }
 
                 break;
             }
-
-            sl_Memcpy (
-                pPayload,
-                httpRequest[requestIdx].charValues[*(argvArray +
-                                                     ARGV_VALUE_OFFSET)].
-                characteristic,
-                strlen((const char *)httpRequest[requestIdx].
-                charValues[*(argvArray+ARGV_VALUE_OFFSET)]
-                .characteristic));
-                pPayload += strlen(
-                (const char *)httpRequest[requestIdx].
-                charValues[*(argvArray +ARGV_VALUE_OFFSET)].
-                characteristic);
-            *pPayload++ = '=';
-            sl_Memcpy (pPayload, gMetadataBuffer,
-                       strlen((const char *)gMetadataBuffer));
-            pPayload += strlen((const char *)gMetadataBuffer);
-            *pPayload++ = '&';
         }
 
         (*argcCallback)--;
@@ -1224,27 +1683,7 @@ int32_t otaGetCallback(uint8_t requestIdx,
         argvArray++;                /* skip the length */
     }
 
-    /* NULL terminate the payload */
-    *(pPayload - 1) = '\0';
-
-    metadataLen =
-        prepareGetMetadata(status, strlen(
-                               (const char *)gPayloadBuffer),
-                           HttpContentTypeList_UrlEncoded);
-
-    sl_NetAppSend (netAppRequest->Handle, metadataLen, gMetadataBuffer,
-                   (SL_NETAPP_REQUEST_RESPONSE_FLAGS_CONTINUATION |
-                    SL_NETAPP_REQUEST_RESPONSE_FLAGS_METADATA));
-    INFO_PRINT("[Link local task] Metadata Sent, len = %d \n\r", metadataLen);
-    /* mark as last segment */
-    sl_NetAppSend(netAppRequest->Handle, 
-                  strlen ((const char *)gPayloadBuffer),
-                  gPayloadBuffer,
-                   0);                            
-    INFO_PRINT("[Link local task] Data Sent, len = %d\n\r",
-               strlen ((const char *)gPayloadBuffer));
-
-    return(status);
+    return(sendGetResponse(netAppRequest, pCtx, HttpWriter_finish(&writer)));
 }
 
 //*****************************************************************************
@@ -1259,20 +1698,24 @@ int32_t otaGetCallback(uint8_t requestIdx,
 //!
 //! \param[in] netAppRequest      netapp request structure
 //!
+//! \param[in] pCtx               worker context holding the request buffers
+//!
 //! \return 0 on success else negative
 //!
 //****************************************************************************
 int32_t lightGetCallback(uint8_t requestIdx,
                          uint8_t *argcCallback,
                          uint8_t **argvCallback,
-                         SlNetAppRequest_t *netAppRequest)
+                         SlNetAppRequest_t *netAppRequest,
+                         http_WorkerCtx_t *pCtx)
 {
-    uint8_t *argvArray, *pPayload;
+    uint8_t *argvArray;
     uint8_t ledIdx = Board_GPIO_LED0;
-    uint16_t ledState, metadataLen, elementType;
+    uint16_t ledState, elementType;
+    HttpWriter_t writer;
 
     argvArray = *argvCallback;
-    pPayload = gPayloadBuffer;
+    HttpWriter_init(&writer, pCtx->payloadBuffer, NETAPP_MAX_RX_FRAGMENT_LEN);
 
     while(*argcCallback > 0)
     {
@@ -1294,33 +1737,12 @@ int32_t lightGetCallback(uint8_t requestIdx,
             }
 
             ledState = GPIO_read(ledIdx);
-            sl_Memcpy (
-                pPayload,
-                httpRequest[requestIdx].charValues[*(argvArray +
-                                                     ARGV_VALUE_OFFSET)].
-                characteristic,
-                strlen((const char *)httpRequest[requestIdx].
-                charValues[*(argvArray+ARGV_VALUE_OFFSET)]
-                .characteristic));
-                pPayload += strlen(
-                (const char *)httpRequest[requestIdx].
-                charValues[*(argvArray + ARGV_VALUE_OFFSET)]
-                .characteristic);
-            *pPayload++ = '=';
-            sl_Memcpy (
-                pPayload,
-                httpRequest[requestIdx].
-                charValues[*(argvArray +ARGV_VALUE_OFFSET)].
-                value[ledState],strlen((const char *)httpRequest[requestIdx].
-                                       charValues[*(argvArray +
-                                                    ARGV_VALUE_OFFSET)].
-                value[ledState]));
-                
-            pPayload += strlen(
-                (const char *)httpRequest[requestIdx].
-                charValues[*(argvArray +ARGV_VALUE_OFFSET)].
-                value[ledState]);
-            *pPayload++ = '&';
+            appendCharacteristic(&writer, requestIdx,
+                                 *(argvArray + ARGV_VALUE_OFFSET));
+            HttpWriter_appendStr(&writer,
+                                 httpRequest[requestIdx].
+                                 charValues[*(argvArray + ARGV_VALUE_OFFSET)].
+                                 value[ledState]);
         }
 
         (*argcCallback)--;
@@ -1329,24 +1751,7 @@ int32_t lightGetCallback(uint8_t requestIdx,
         argvArray++;                  /* skip the length */
     }
 
-    /* NULL terminate the payload */
-    *(pPayload - 1) = '\0';
-
-    metadataLen = prepareGetMetadata(0,
-                                    strlen((const char *)gPayloadBuffer),
-                                    HttpContentTypeList_UrlEncoded);
-    sl_NetAppSend (netAppRequest->Handle, metadataLen, gMetadataBuffer,
-                   (SL_NETAPP_REQUEST_RESPONSE_FLAGS_CONTINUATION |
-                    SL_NETAPP_REQUEST_RESPONSE_FLAGS_METADATA));
-    INFO_PRINT("[Link local task] Metadata Sent, len = %d \n\r", metadataLen);
-           /* mark as last segment */
-    sl_NetAppSend ( netAppRequest->Handle,
-                    strlen ((const char *)gPayloadBuffer),
-                    gPayloadBuffer, 0);                 
-    INFO_PRINT("[Link local task] Data Sent, len = %d\n\r",
-               strlen ((const char *)gPayloadBuffer));
-
-    return(0);
+    return(sendGetResponse(netAppRequest, pCtx, HttpWriter_finish(&writer)));
 }
 
 //*****************************************************************************
@@ -1361,13 +1766,16 @@ int32_t lightGetCallback(uint8_t requestIdx,
 //!
 //! \param[in] netAppRequest      netapp request structure
 //!
+//! \param[in] pCtx               worker context holding the request buffers
+//!
 //! \return 0 on success else negative
 //!
 //****************************************************************************
 int32_t lightPostCallback(uint8_t requestIdx,
                           uint8_t *argcCallback,
                           uint8_t **argvCallback,
-                          SlNetAppRequest_t *netAppRequest)
+                          SlNetAppRequest_t *netAppRequest,
+                          http_WorkerCtx_t *pCtx)
 {
     uint8_t *argvArray;
     uint16_t metadataLen, elementType;
@@ -1425,14 +1833,147 @@ int32_t lightPostCallback(uint8_t requestIdx,
         argvArray++;        /* skip the length */
     }
 
-    metadataLen = preparePostMetadata(0);
+    metadataLen = preparePostMetadata(0, pCtx);
 
-    sl_NetAppSend (netAppRequest->Handle, metadataLen, gMetadataBuffer,
+    sl_NetAppSend (netAppRequest->Handle, metadataLen, pCtx->metadataBuffer,
                    SL_NETAPP_REQUEST_RESPONSE_FLAGS_METADATA);
 
     return(0);
 }
 
+//*****************************************************************************
+//
+//! \brief Returns the value reported for a /sensor characteristic
+//!
+//! \param[in]  pSnapshot         readings to report from
+//!
+//! \param[in]  idx               SensorIdx of the characteristic
+//!
+//! \return reported value
+//!
+//****************************************************************************
+int16_t getSensorValue(SensorSnapshot_t *pSnapshot, uint8_t idx)
+{
+    switch(idx)
+    {
+    case SensorIdx_XAxis:
+        return(pSnapshot->xVal);
+    case SensorIdx_YAxis:
+        return(pSnapshot->yVal);
+    case SensorIdx_ZAxis:
+        return(pSnapshot->zVal);
+    case SensorIdx_FarnTemp:
+        return((int16_t)pSnapshot->temperatureVal);
+    }
+
+    return(0);
+}
+
+//*****************************************************************************
+//
+//! \brief Returns the value reported for an /enviro characteristic
+//!
+//! \param[in]  pSnapshot         readings to report from
+//!
+//! \param[in]  idx               EnviroIdx of the characteristic
+//!
+//! \return reported value
+//!
+//****************************************************************************
+int32_t getEnviroValue(SensorSnapshot_t *pSnapshot, uint8_t idx)
+{
+    switch(idx)
+    {
+    case EnviroIdx_InTemp:
+        return(pSnapshot->tempIn/100);
+    case EnviroIdx_OutTemp:
+        return(pSnapshot->tempOut/100);
+    case EnviroIdx_InHumid:
+        return((int32_t)pSnapshot->humidIn);
+    case EnviroIdx_OutHumid:
+        return((int32_t)pSnapshot->humidOut);
+    case EnviroIdx_InPres:
+        return((int32_t)pSnapshot->presIn);
+    case EnviroIdx_OutPres:
+        return((int32_t)pSnapshot->presOut);
+    case EnviroIdx_oxygen:
+        return(pSnapshot->oxygen/1000);
+    case EnviroIdx_airQuality:
+        return(pSnapshot->airQuality);
+    }
+
+    return(0);
+}
+
+//*****************************************************************************
+//
+//! \brief Appends the value reported for a /state characteristic
+//!
+//! \param[in]  pWriter           payload writer
+//!
+//! \param[in]  idx               StateIdx of the characteristic
+//!
+//! \return None
+//!
+//****************************************************************************
+void appendStateValue(HttpWriter_t *pWriter, uint8_t idx)
+{
+    const http_charValuesPair_t *pChar =
+        &httpRequest[STATE_REQUEST_IDX].charValues[idx];
+
+    switch(idx)
+    {
+    case StateIdx_fans:
+        HttpWriter_appendStr(pWriter, pChar->value[Fan_State]);
+        break;
+    case StateIdx_lights:
+        HttpWriter_appendStr(pWriter, pChar->value[Lights_State]);
+        break;
+    case StateIdx_cooling:
+        HttpWriter_appendStr(pWriter, pChar->value[Peltier_State]);
+        break;
+    case StateIdx_goalTemp:
+        HttpWriter_appendInt(pWriter, goalTemp/100);
+        break;
+    case StateIdx_dataFreq:
+        HttpWriter_appendInt(pWriter, dataFreq);
+        break;
+    case StateIdx_lastDump:
+        HttpWriter_appendUint(pWriter, lastDump.tm_hour, 2);
+        HttpWriter_appendChar(pWriter, ':');
+        HttpWriter_appendUint(pWriter, lastDump.tm_min, 2);
+        break;
+    case StateIdx_lastCheckin:
+        HttpWriter_appendUint(pWriter, lastCheckin.tm_hour, 2);
+        HttpWriter_appendChar(pWriter, ':');
+        HttpWriter_appendUint(pWriter, lastCheckin.tm_min, 2);
+        break;
+    }
+}
+
+//*****************************************************************************
+//
+//! \brief Formats the value reported for a /state characteristic
+//!
+//! \param[in]  idx               StateIdx of the characteristic
+//!
+//! \param[out] pValue            destination string
+//!
+//! \param[in]  valueLen          size of the destination
+//!
+//! \return length of the formatted value, -1 if it does not fit
+//!
+//****************************************************************************
+int32_t formatStateValue(uint8_t idx, uint8_t *pValue, uint16_t valueLen)
+{
+    HttpWriter_t writer;
+
+    HttpWriter_init(&writer, pValue, valueLen);
+    appendStateValue(&writer, idx);
+
+    return(HttpWriter_finish(&writer));
+}
+
 //*****************************************************************************
 //
 //! \brief This is a sensors service callback function for HTTP GET
@@ -1445,79 +1986,51 @@ int32_t lightPostCallback(uint8_t requestIdx,
 //!
 //! \param[in] netAppRequest      netapp request structure
 //!
+//! \param[in] pCtx               worker context holding the request buffers
+//!
 //! \return 0 on success else negative
 //!
 //****************************************************************************
 int32_t sensorGetCallback(uint8_t requestIdx,
                           uint8_t *argcCallback,
                           uint8_t **argvCallback,
-                          SlNetAppRequest_t *netAppRequest)
+                          SlNetAppRequest_t *netAppRequest,
+                          http_WorkerCtx_t *pCtx)
 {
-    uint8_t *argvArray, *pPayload;
-    uint16_t metadataLen, elementType;
-    int16_t value = 0;
-    int32_t status;
+    uint8_t *argvArray;
+    uint16_t elementType;
+    SensorSnapshot_t snapshot;
+    HttpWriter_t writer;
 
     argvArray = *argvCallback;
-    pPayload = gPayloadBuffer;
 
-    /* Read accelerometer axis values */
-    status = accelarometerReading();
-    if(status != 0)
-    {
-        UART_PRINT(
-            "[Link local task] Failed to read data from accelerometer\n\r");
-    }
+    /* readings are sampled by the sensor task, never touch the bus here.
+       without its FIFO the accelerometer is only sampled when asked for,
+       the next poll gets a fresh value */
+    SensorTask_demand(SnapshotSensor_Accel);
+    SensorSnapshot_read(&snapshot);
 
-    /* Read temperature sensor values */
-    status = temperatureReading();
-    if(status != 0)
+    /* nothing sampled since the client copy, skip the formatting */
+    setEntityTag(pCtx, snapshot.sequence, NULL);
+    if(sendNotModified(netAppRequest, pCtx) == 0)
     {
-        UART_PRINT(
-            "[Link local task] Failed to"
-            " read data from temperature sensor\n\r");
+        return(0);
     }
 
+    HttpWriter_init(&writer, pCtx->payloadBuffer, NETAPP_MAX_RX_FRAGMENT_LEN);
+
     while(*argcCallback > 0)
     {
         elementType = setElementType(1, requestIdx, CONTENT_LEN_TYPE);
         /* content length is irrelevant for GET */
         if(*((uint16_t *)argvArray) != elementType)          
         {
-            switch(*(argvArray + ARGV_VALUE_OFFSET))
-            {
-            case SensorIdx_XAxis:
-                value = xVal;
-                break;
-            case SensorIdx_YAxis:
-                value = yVal;
-                break;
-            case SensorIdx_ZAxis:
-                value = zVal;
-                break;
-            case SensorIdx_FarnTemp:
-                value = (int16_t)temperatureVal;
-                break;
-            }
-
-            sl_Memcpy (
-                pPayload,
-                httpRequest[requestIdx].charValues[*(argvArray +
-                                                     ARGV_VALUE_OFFSET)].
-                characteristic,
-                strlen((const char *)httpRequest[requestIdx].
-                charValues[*(argvArray+ARGV_VALUE_OFFSET)].
-                characteristic));
-            pPayload += strlen(
-                (const char *)httpRequest[requestIdx].
-                charValues[*(argvArray +ARGV_VALUE_OFFSET)].
-                characteristic);
-            *pPayload++ = '=';
-
-            snprintf((char *)pPayload, SENSOR_VALUE_STR_LEN, "%d", value);
-            /* add the value length */
-            pPayload += strlen((const char *)pPayload);    
-            *pPayload++ = '&';
+            appendCharacteristic(&writer, requestIdx,
+                                 *(argvArray + ARGV_VALUE_OFFSET));
+            HttpWriter_appendInt(&writer,
+                                 getSensorValue(&snapshot,
+                                                *(argvArray +
+                                                  ARGV_VALUE_OFFSET)));
         }
 
         (*argcCallback)--;
@@ -1526,24 +2039,7 @@ int32_t sensorGetCallback(uint8_t requestIdx,
         argvArray++;                  /* skip the length */
     }
 
-    /* NULL terminate the payload */
-    *(pPayload - 1) = '\0';
-
-    metadataLen = prepareGetMetadata(0,
-                                    strlen((const char *)gPayloadBuffer),
-                                    HttpContentTypeList_UrlEncoded);
-
-    sl_NetAppSend (netAppRequest->Handle, metadataLen, gMetadataBuffer,
-                   (SL_NETAPP_REQUEST_RESPONSE_FLAGS_CONTINUATION |
-                    SL_NETAPP_REQUEST_RESPONSE_FLAGS_METADATA));
-    INFO_PRINT("[Link local task] Metadata Sent, len = %d \n\r", metadataLen);
- /* mark as last segment */
-    sl_NetAppSend (netAppRequest->Handle, strlen (
-                       (const char *)gPayloadBuffer), gPayloadBuffer, 0);
-    INFO_PRINT("[Link local task] Data Sent, len = %d\n\r",
-               strlen ((const char *)gPayloadBuffer));
-
-    return(0);
+    return(sendGetResponse(netAppRequest, pCtx, HttpWriter_finish(&writer)));
 }
 
 //*****************************************************************************
@@ -1558,250 +2054,820 @@ int32_t sensorGetCallback(uint8_t requestIdx,
 //!
 //! \param[in] netAppRequest      netapp request structure
 //!
+//! \param[in] pCtx               worker context holding the request buffers
+//!
 //! \return 0 on success else negative
 //!
 //****************************************************************************
 int32_t environGetCallback(uint8_t requestIdx,
-                          uint8_t *argcCallback,
-                          uint8_t **argvCallback,
-                          SlNetAppRequest_t *netAppRequest){
-    uint8_t *argvArray, *pPayload;
-      uint16_t metadataLen, elementType;
-      int32_t value = 0;
-      int32_t status;
-      UART_PRINT("bmefuckedup\n\r");
-      argvArray = *argvCallback;
-      pPayload = gPayloadBuffer;
-
-      if(sensorLockObj != NULL)
-      {
-          pthread_mutex_lock(sensorLockObj);
-      }
-
-
-      while(*argcCallback > 0)
-      {
-          elementType = setElementType(1, requestIdx, CONTENT_LEN_TYPE);
-          /* content length is irrelevant for GET */
-          if(*((uint16_t *)argvArray) != elementType)
-          {
-              switch(*(argvArray + ARGV_VALUE_OFFSET))
-              {
-              case EnviroIdx_InTemp:
-                  value = (int16_t)tempIn/100;
-                  break;
-              case EnviroIdx_OutTemp:
-                  value = (int16_t)tempOut;
-                  break;
-              case EnviroIdx_InHumid:
-                  value = (int16_t)humidIn;
-                  break;
-              case EnviroIdx_OutHumid:
-                  value = (int16_t)humidOut;
-                  break;
-              case EnviroIdx_InPres:
-                  value = (int32_t)presIn;
-                  UART_PRINT("pressure =%d Pa",value);
-                  break;
-              case EnviroIdx_OutPres:
-                  value = (int32_t)presOut;
-
-                  break;
-              case     EnviroIdx_oxygen:
-                  value = (int16_t)oxygen/1000;
-                  break;
-              case EnviroIdx_airQuality:
-                  value = (int16_t)airQuality;
-                  UART_PRINT("air quality =%d ppm of eco2",value);
-                  break;
-              }
-
-              sl_Memcpy (
-                  pPayload,
-                  httpRequest[requestIdx].charValues[*(argvArray +
-                                                       ARGV_VALUE_OFFSET)].
-                  characteristic,
-                  strlen((const char *)httpRequest[requestIdx].
-                  charValues[*(argvArray+ARGV_VALUE_OFFSET)].
-                  characteristic));
-              pPayload += strlen(
-                  (const char *)httpRequest[requestIdx].
-                  charValues[*(argvArray +ARGV_VALUE_OFFSET)].
-                  characteristic);
-              *pPayload++ = '=';
-
-              snprintf((char *)pPayload, ENVIRO_VALUE_STR_LEN, "%d", value);
-              /* add the value length */
-              pPayload += strlen((const char *)pPayload);
-              *pPayload++ = '&';
-          }
-
-          (*argcCallback)--;
-          argvArray += ARGV_LEN_OFFSET; /* skip the type */
-          argvArray += *argvArray;      /* add the length */
-          argvArray++;                  /* skip the length */
-      }
-
-      /* NULL terminate the payload */
-      *(pPayload - 1) = '\0';
-
-      metadataLen = prepareGetMetadata(0,
-                                      strlen((const char *)gPayloadBuffer),
-                                      HttpContentTypeList_UrlEncoded);
-
-      sl_NetAppSend (netAppRequest->Handle, metadataLen, gMetadataBuffer,
-                     (SL_NETAPP_REQUEST_RESPONSE_FLAGS_CONTINUATION |
-                      SL_NETAPP_REQUEST_RESPONSE_FLAGS_METADATA));
-      INFO_PRINT("[Link local task] Metadata Sent, len = %d \n\r", metadataLen);
-   /* mark as last segment */
-      sl_NetAppSend (netAppRequest->Handle, strlen (
-                         (const char *)gPayloadBuffer), gPayloadBuffer, 0);
-      INFO_PRINT("[Link local task] Data Sent, len = %d\n\r",
-                 strlen ((const char *)gPayloadBuffer));
-      if(sensorLockObj != NULL)
-      {
-          pthread_mutex_unlock(sensorLockObj);
-      }
-      return(0);
+                           uint8_t *argcCallback,
+                           uint8_t **argvCallback,
+                           SlNetAppRequest_t *netAppRequest,
+                           http_WorkerCtx_t *pCtx)
+{
+    uint8_t *argvArray;
+    uint16_t elementType;
+    SensorSnapshot_t snapshot;
+    HttpWriter_t writer;
+
+    argvArray = *argvCallback;
+
+    /* readings are sampled by the sensor task, never touch the bus here */
+    SensorSnapshot_read(&snapshot);
+
+    /* nothing sampled since the client copy, skip the formatting */
+    setEntityTag(pCtx, snapshot.sequence, NULL);
+    if(sendNotModified(netAppRequest, pCtx) == 0)
+    {
+        return(0);
+    }
+
+    HttpWriter_init(&writer, pCtx->payloadBuffer, NETAPP_MAX_RX_FRAGMENT_LEN);
+
+    while(*argcCallback > 0)
+    {
+        elementType = setElementType(1, requestIdx, CONTENT_LEN_TYPE);
+        /* content length is irrelevant for GET */
+        if(*((uint16_t *)argvArray) != elementType)
+        {
+            appendCharacteristic(&writer, requestIdx,
+                                 *(argvArray + ARGV_VALUE_OFFSET));
+            HttpWriter_appendInt(&writer,
+                                 getEnviroValue(&snapshot,
+                                                *(argvArray +
+                                                  ARGV_VALUE_OFFSET)));
+        }
 
+        (*argcCallback)--;
+        argvArray += ARGV_LEN_OFFSET; /* skip the type */
+        argvArray += *argvArray;      /* add the length */
+        argvArray++;                  /* skip the length */
+    }
 
+    return(sendGetResponse(netAppRequest, pCtx, HttpWriter_finish(&writer)));
 }
+
+//*****************************************************************************
+//
+//! \brief This is a device state service callback function for HTTP GET
+//!
+//! \param[in]  requestIdx        request index to indicate the message
+//!
+//! \param[in]  argcCallback      count of input params to the service callback
+//!
+//! \param[in]  argvCallback      set of input params to the service callback
+//!
+//! \param[in] netAppRequest      netapp request structure
+//!
+//! \param[in] pCtx               worker context holding the request buffers
+//!
+//! \return 0 on success else negative
+//!
+//****************************************************************************
 int32_t stateGetCallback(uint8_t requestIdx,
-                          uint8_t *argcCallback,
-                          uint8_t **argvCallback,
-                          SlNetAppRequest_t *netAppRequest){
-      uint8_t *argvArray, *pPayload;
-      uint16_t metadataLen, elementType;
-      int16_t value = 0;
-      int32_t status;
-      argvArray = *argvCallback;
-      pPayload = gPayloadBuffer;
-
-
-      while(*argcCallback > 0)
-       {
-           elementType = setElementType(1, requestIdx, CONTENT_LEN_TYPE);
-           /* content length is irrelevant for GET */
-           if(*((uint16_t *)argvArray) != elementType)
-           {
-               switch(*(argvArray + ARGV_VALUE_OFFSET))
-               {
-               case StateIdx_fans:
-
-                   break;
-               case StateIdx_lights:
-
-                   break;
-               case StateIdx_cooling:
-
-                   break;
-               case StateIdx_goalTemp:
-
-                   break;
-               case StateIdx_dataFreq:
-
-                   break;
-               case StateIdx_lastDump:
-
-                   break;
-               case StateIdx_lastCheckin:
-
-                   break;
-               }
-
-               sl_Memcpy (
-                   pPayload,
-                   httpRequest[requestIdx].charValues[*(argvArray +
-                                                        ARGV_VALUE_OFFSET)].
-                   characteristic,
-                   strlen((const char *)httpRequest[requestIdx].
-                   charValues[*(argvArray+ARGV_VALUE_OFFSET)].
-                   characteristic));
-               pPayload += strlen(
-                   (const char *)httpRequest[requestIdx].
-                   charValues[*(argvArray +ARGV_VALUE_OFFSET)].
-                   characteristic);
-               *pPayload++ = '=';
-
-               snprintf((char *)pPayload, STATE_VALUE_STR_LEN, "%d", value);
-               /* add the value length */
-               pPayload += strlen((const char *)pPayload);
-               *pPayload++ = '&';
-           }
-
-           (*argcCallback)--;
-           argvArray += ARGV_LEN_OFFSET; /* skip the type */
-           argvArray += *argvArray;      /* add the length */
-           argvArray++;                  /* skip the length */
-       }
-
-       /* NULL terminate the payload */
-       *(pPayload - 1) = '\0';
-
-       metadataLen = prepareGetMetadata(0,
-                                       strlen((const char *)gPayloadBuffer),
-                                       HttpContentTypeList_UrlEncoded);
-
-       sl_NetAppSend (netAppRequest->Handle, metadataLen, gMetadataBuffer,
-                      (SL_NETAPP_REQUEST_RESPONSE_FLAGS_CONTINUATION |
-                       SL_NETAPP_REQUEST_RESPONSE_FLAGS_METADATA));
-       INFO_PRINT("[Link local task] Metadata Sent, len = %d \n\r", metadataLen);
-    /* mark as last segment */
-       sl_NetAppSend (netAppRequest->Handle, strlen (
-                          (const char *)gPayloadBuffer), gPayloadBuffer, 0);
-       INFO_PRINT("[Link local task] Data Sent, len = %d\n\r",
-                  strlen ((const char *)gPayloadBuffer));
+                         uint8_t *argcCallback,
+                         uint8_t **argvCallback,
+                         SlNetAppRequest_t *netAppRequest,
+                         http_WorkerCtx_t *pCtx)
+{
+    uint8_t *argvArray;
+    uint16_t elementType;
+    HttpWriter_t writer;
 
-       return(0);
-}
+    argvArray = *argvCallback;
+    HttpWriter_init(&writer, pCtx->payloadBuffer, NETAPP_MAX_RX_FRAGMENT_LEN);
 
+    while(*argcCallback > 0)
+    {
+        elementType = setElementType(1, requestIdx, CONTENT_LEN_TYPE);
+        /* content length is irrelevant for GET */
+        if(*((uint16_t *)argvArray) != elementType)
+        {
+            appendCharacteristic(&writer, requestIdx,
+                                 *(argvArray + ARGV_VALUE_OFFSET));
+            appendStateValue(&writer, *(argvArray + ARGV_VALUE_OFFSET));
+        }
 
+        (*argcCallback)--;
+        argvArray += ARGV_LEN_OFFSET; /* skip the type */
+        argvArray += *argvArray;      /* add the length */
+        argvArray++;                  /* skip the length */
+    }
 
+    return(sendGetResponse(netAppRequest, pCtx, HttpWriter_finish(&writer)));
+}
 
 //*****************************************************************************
 //
-//! \brief This is a generic device service callback function for HTTP GET
+//! \brief This is a device state service callback function for HTTP POST
 //!
-//! \param[in]  requestIdx          request index to indicate the message
+//! \param[in]  requestIdx        request index to indicate the message
 //!
-//! \param[in]  argcCallback        count of input params to the service callback
+//! \param[in]  argcCallback      count of input params to the service callback
 //!
-//! \param[in]  argvCallback        set of input params to the service callback
+//! \param[in]  argvCallback      set of input params to the service callback
 //!
-//! \param[in] netAppRequest        netapp request structure
+//! \param[in] netAppRequest      netapp request structure
+//!
+//! \param[in] pCtx               worker context holding the request buffers
 //!
 //! \return 0 on success else negative
 //!
 //****************************************************************************
-int32_t deviceGetCallback(uint8_t requestIdx,
+int32_t statePostCallback(uint8_t requestIdx,
                           uint8_t *argcCallback,
                           uint8_t **argvCallback,
-                          SlNetAppRequest_t *netAppRequest)
+                          SlNetAppRequest_t *netAppRequest,
+                          http_WorkerCtx_t *pCtx)
 {
-    uint8_t *argvArray, *pPayload;
+    uint8_t *argvArray;
     uint16_t metadataLen, elementType;
-    int32_t status;
-    uint32_t deviceType;
+    uint8_t charIdx = StatePostIdx_MaxStatePost;
+    int32_t status = 0;
 
     argvArray = *argvCallback;
-    pPayload = gPayloadBuffer;
-    deviceType = getDeviceType();
 
     while(*argcCallback > 0)
     {
         elementType = setElementType(1, requestIdx, CONTENT_LEN_TYPE);
-        /* content length is irrelevant for GET */
-        if(*((uint16_t *)argvArray) != elementType)          
+        /* content length is irrelevant for POST */
+        if(*((uint16_t *)argvArray) != elementType)
         {
-            switch(*(argvArray + ARGV_VALUE_OFFSET))
+            /* means it is the value, not the parameter */
+            if(*(argvArray + 1) & 0x80)
             {
-            case DeviceIdx_Ssid:
-                status = getDeviceSSID();
-                if(status != 0)
+                switch(charIdx)
                 {
-                    UART_PRINT(
-                        "[Link local task] failed to get SSID.  IP_ACQ=%d, "
-                        "IP_LEASED=%d\n\r",
+                case StatePostIdx_bmeProfile:
+                    /* applied by the sensor task, it owns the bus */
+                    status = SensorTask_setBmeProfile(
+                        (BME280_Profile)*(argvArray + ARGV_VALUE_OFFSET));
+                    break;
+                case StatePostIdx_o2Cal:
+                    /* sampled by the sensor task at its next tick */
+                    status = SensorTask_calibrateOxygen(
+                        (SensorOxygenCal)*(argvArray + ARGV_VALUE_OFFSET));
+                    break;
+                }
+
+                if(status < 0)
+                {
+                    break;
+                }
+            }
+            else    /* means it is the parameter, not the value */
+            {
+                charIdx = *(argvArray + ARGV_VALUE_OFFSET);
+            }
+        }
+
+        (*argcCallback)--;
+        argvArray += ARGV_LEN_OFFSET;        /* skip the type */
+        argvArray += *argvArray;    /* add the length */
+        argvArray++;        /* skip the length */
+    }
+
+    metadataLen = preparePostMetadata(status, pCtx);
+
+    sl_NetAppSend (netAppRequest->Handle, metadataLen, pCtx->metadataBuffer,
+                   SL_NETAPP_REQUEST_RESPONSE_FLAGS_METADATA);
+
+    return(0);
+}
+
+//*****************************************************************************
+//
+//! \brief This function formats the readings and actuator states url-encoded
+//!
+//! \param[in]  pSnapshot         readings to format
+//!
+//! \param[in]  pPrev             readings already reported, only the fields
+//!                               that changed since are formatted. NULL
+//!                               formats every field
+//!
+//! \param[in,out] pStateCache    state values already reported, updated with
+//!                               the formatted ones. NULL formats every state
+//!
+//! \param[out] pPayload          destination buffer
+//!
+//! \param[in]  payloadLen        size of the destination buffer
+//!
+//! \return length of the formatted payload
+//!
+//****************************************************************************
+int32_t formatSnapshotFields(SensorSnapshot_t *pSnapshot,
+                             SensorSnapshot_t *pPrev,
+                             uint8_t (*pStateCache)[STATE_VALUE_STR_LEN],
+                             uint8_t *pPayload,
+                             uint16_t payloadLen)
+{
+    HttpWriter_t writer;
+    uint8_t stateValue[STATE_VALUE_STR_LEN];
+    int32_t value, stateLen;
+    uint8_t idx;
+
+    HttpWriter_init(&writer, pPayload, payloadLen);
+
+    HttpWriter_append(&writer, "seq=", 4);
+    HttpWriter_appendUint(&writer, pSnapshot->sequence, 0);
+    HttpWriter_append(&writer, "&ts=", 4);
+    HttpWriter_appendUint(&writer, pSnapshot->sampleTick, 0);
+    /* bit (1 << SnapshotSensor) per sensor without a recent good sample */
+    if((NULL == pPrev) || (pSnapshot->staleMask != pPrev->staleMask))
+    {
+        HttpWriter_append(&writer, "&stale=", 7);
+        HttpWriter_appendUint(&writer, pSnapshot->staleMask, 0);
+    }
+
+    for(idx = 0; idx < SensorIdx_MaxSensor; idx++)
+    {
+        value = getSensorValue(pSnapshot, idx);
+        if((NULL == pPrev) || (value != getSensorValue(pPrev, idx)))
+        {
+            appendCharacteristic(&writer, SENSOR_REQUEST_IDX, idx);
+            HttpWriter_appendInt(&writer, value);
+        }
+    }
+
+    for(idx = 0; idx < EnviroIdx_MaxEnviro; idx++)
+    {
+        value = getEnviroValue(pSnapshot, idx);
+        if((NULL == pPrev) || (value != getEnviroValue(pPrev, idx)))
+        {
+            appendCharacteristic(&writer, ENVIRO_REQUEST_IDX, idx);
+            HttpWriter_appendInt(&writer, value);
+        }
+    }
+
+    for(idx = 0; idx < StateIdx_MaxState; idx++)
+    {
+        stateLen = formatStateValue(idx, stateValue, STATE_VALUE_STR_LEN);
+        if(stateLen < 0)
+        {
+            continue;
+        }
+        if(pStateCache != NULL)
+        {
+            if(!strcmp((const char *)stateValue,
+                       (const char *)pStateCache[idx]))
+            {
+                continue;
+            }
+            strcpy((char *)pStateCache[idx], (const char *)stateValue);
+        }
+        appendCharacteristic(&writer, STATE_REQUEST_IDX, idx);
+        HttpWriter_append(&writer, stateValue, stateLen);
+    }
+
+    return(HttpWriter_finish(&writer));
+}
+
+//*****************************************************************************
+//
+//! \brief This is the snapshot service callback function for HTTP GET, it
+//!        returns every reading and actuator state in one response
+//!
+//! \param[in]  requestIdx        request index to indicate the message
+//!
+//! \param[in]  argcCallback      count of input params to the service callback
+//!
+//! \param[in]  argvCallback      set of input params to the service callback
+//!
+//! \param[in] netAppRequest      netapp request structure
+//!
+//! \param[in] pCtx               worker context holding the request buffers
+//!
+//! \return 0 on success else negative
+//!
+//****************************************************************************
+int32_t snapshotGetCallback(uint8_t requestIdx,
+                            uint8_t *argcCallback,
+                            uint8_t **argvCallback,
+                            SlNetAppRequest_t *netAppRequest,
+                            http_WorkerCtx_t *pCtx)
+{
+    SensorSnapshot_t snapshot;
+    uint32_t stateTag;
+
+    /* one copy of the readings, so every value below is from the same
+       sample. the dashboard polls the accelerometer through here */
+    SensorTask_demand(SnapshotSensor_Accel);
+    SensorSnapshot_read(&snapshot);
+
+    /* the states change without a new sample, they are part of the tag */
+    stateTag = getStateTag();
+    setEntityTag(pCtx, snapshot.sequence, &stateTag);
+    if(sendNotModified(netAppRequest, pCtx) == 0)
+    {
+        return(0);
+    }
+
+    /* whole snapshot in a single, last segment */
+    return(sendGetResponse(netAppRequest, pCtx,
+                           formatSnapshotFields(&snapshot, NULL, NULL,
+                                                pCtx->payloadBuffer,
+                                                NETAPP_MAX_RX_FRAGMENT_LEN)));
+}
+
+
+//*****************************************************************************
+//
+//! \brief This is the accelerometer stream callback function for HTTP GET.
+//!        It returns the samples from "since" on, up to "count" of them, so a
+//!        client polls with the seq+n of the previous response.
+//!
+//! \param[in]  requestIdx        request index to indicate the message
+//!
+//! \param[in]  argcCallback      count of input params to the service callback
+//!
+//! \param[in]  argvCallback      set of input params to the service callback
+//!
+//! \param[in] netAppRequest      netapp request structure
+//!
+//! \param[in] pCtx               worker context holding the request buffers
+//!
+//! \return 0 on success else negative
+//!
+//****************************************************************************
+int32_t accelGetCallback(uint8_t requestIdx,
+                         uint8_t *argcCallback,
+                         uint8_t **argvCallback,
+                         SlNetAppRequest_t *netAppRequest,
+                         http_WorkerCtx_t *pCtx)
+{
+    SensorAccelSample_t samples[ACCEL_BATCH_MAX];
+    uint8_t *argvArray;
+    uint16_t elementType;
+    uint8_t charIdx = AccelIdx_MaxAccel;
+    uint32_t seq = 0;
+    uint32_t value;
+    uint16_t maxCount = ACCEL_BATCH_MAX;
+    uint16_t count, idx;
+    HttpWriter_t writer;
+
+    argvArray = *argvCallback;
+
+    while(*argcCallback > 0)
+    {
+        elementType = setElementType(1, requestIdx, CONTENT_LEN_TYPE);
+        /* content length is irrelevant for GET */
+        if(*((uint16_t *)argvArray) != elementType)
+        {
+            /* means it is the value, not the parameter */
+            if(*(argvArray + 1) & 0x80)
+            {
+                value = strtoul((const char *)(argvArray + ARGV_VALUE_OFFSET),
+                                NULL, 10);
+                switch(charIdx)
+                {
+                case AccelIdx_since:
+                    seq = value;
+                    break;
+                case AccelIdx_count:
+                    if((value > 0) && (value <= ACCEL_BATCH_MAX))
+                    {
+                        maxCount = (uint16_t)value;
+                    }
+                    break;
+                }
+            }
+            else    /* means it is the parameter, not the value */
+            {
+                charIdx = *(argvArray + ARGV_VALUE_OFFSET);
+            }
+        }
+
+        (*argcCallback)--;
+        argvArray += ARGV_LEN_OFFSET; /* skip the type */
+        argvArray += *argvArray;      /* add the length */
+        argvArray++;                  /* skip the length */
+    }
+
+    /* the samples are streamed by the sensor task, never touch the bus */
+    count = SensorTask_readAccel(&seq, samples, maxCount);
+
+    HttpWriter_init(&writer, pCtx->payloadBuffer, NETAPP_MAX_RX_FRAGMENT_LEN);
+
+    HttpWriter_append(&writer, "seq=", 4);
+    HttpWriter_appendUint(&writer, seq, 0);
+    HttpWriter_append(&writer, "&n=", 3);
+    HttpWriter_appendUint(&writer, count, 0);
+    HttpWriter_append(&writer, "&rate=", 6);
+    HttpWriter_appendUint(&writer, SENSOR_ACCEL_RATE_HZ, 0);
+    HttpWriter_append(&writer, "&overruns=", 10);
+    HttpWriter_appendUint(&writer, SensorTask_getAccelOverruns(), 0);
+    HttpWriter_append(&writer, "&xyz=", 5);
+    for(idx = 0; idx < count; idx++)
+    {
+        if(idx > 0)
+        {
+            HttpWriter_appendChar(&writer, ',');
+        }
+        HttpWriter_appendInt(&writer, samples[idx].x);
+        HttpWriter_appendChar(&writer, ',');
+        HttpWriter_appendInt(&writer, samples[idx].y);
+        HttpWriter_appendChar(&writer, ',');
+        HttpWriter_appendInt(&writer, samples[idx].z);
+    }
+
+    return(sendGetResponse(netAppRequest, pCtx, HttpWriter_finish(&writer)));
+}
+
+//*****************************************************************************
+//
+//! \brief This is the reading history callback function for HTTP GET. It
+//!        returns up to "count" samples of a tier from "since" on, or the
+//!        latest ones without "since". A sample covers "step" seconds, the
+//!        first of the run is seq 0 and the current second is "uptime".
+//!        Missing readings are left empty.
+//!
+//! \param[in]  requestIdx        request index to indicate the message
+//!
+//! \param[in]  argcCallback      count of input params to the service callback
+//!
+//! \param[in]  argvCallback      set of input params to the service callback
+//!
+//! \param[in] netAppRequest      netapp request structure
+//!
+//! \param[in] pCtx               worker context holding the request buffers
+//!
+//! \return 0 on success else negative
+//!
+//****************************************************************************
+int32_t historyGetCallback(uint8_t requestIdx,
+                           uint8_t *argcCallback,
+                           uint8_t **argvCallback,
+                           SlNetAppRequest_t *netAppRequest,
+                           http_WorkerCtx_t *pCtx)
+{
+    /* names of the channels, in SensorHistoryChannel order */
+    static const char * const historyNames[SensorHistoryChannel_Max] =
+    {
+        "&inTemp=", "&inHumid=", "&oxygen=", "&airQuality="
+    };
+    SensorHistorySample_t samples[HISTORY_BATCH_MAX];
+    uint8_t *argvArray;
+    uint16_t elementType;
+    uint8_t charIdx = HistoryIdx_MaxHistory;
+    SensorHistoryTier tier = SensorHistoryTier_Second;
+    uint32_t seq = 0;
+    uint32_t head, value;
+    uint16_t maxCount = HISTORY_BATCH_MAX;
+    uint16_t count, idx;
+    uint8_t ch, latest = 1;
+    HttpWriter_t writer;
+
+    argvArray = *argvCallback;
+
+    while(*argcCallback > 0)
+    {
+        elementType = setElementType(1, requestIdx, CONTENT_LEN_TYPE);
+        /* content length is irrelevant for GET */
+        if(*((uint16_t *)argvArray) != elementType)
+        {
+            /* means it is the value, not the parameter */
+            if(*(argvArray + 1) & 0x80)
+            {
+                switch(charIdx)
+                {
+                case HistoryIdx_tier:
+                    tier = (SensorHistoryTier)*(argvArray + ARGV_VALUE_OFFSET);
+                    break;
+                case HistoryIdx_since:
+                    seq = strtoul((const char *)(argvArray +
+                                                 ARGV_VALUE_OFFSET), NULL, 10);
+                    latest = 0;
+                    break;
+                case HistoryIdx_count:
+                    value = strtoul((const char *)(argvArray +
+                                                   ARGV_VALUE_OFFSET), NULL, 10);
+                    if((value > 0) && (value <= HISTORY_BATCH_MAX))
+                    {
+                        maxCount = (uint16_t)value;
+                    }
+                    break;
+                }
+            }
+            else    /* means it is the parameter, not the value */
+            {
+                charIdx = *(argvArray + ARGV_VALUE_OFFSET);
+            }
+        }
+
+        (*argcCallback)--;
+        argvArray += ARGV_LEN_OFFSET; /* skip the type */
+        argvArray += *argvArray;      /* add the length */
+        argvArray++;                  /* skip the length */
+    }
+
+    if(tier >= SensorHistoryTier_Max)
+    {
+        tier = SensorHistoryTier_Second;
+    }
+
+    /* the history lives in RAM, filled by the sensor task */
+    head = SensorHistory_getHead(tier);
+    if(latest)
+    {
+        seq = (head > maxCount) ? (head - maxCount) : 0;
+    }
+    count = SensorHistory_read(tier, &seq, samples, maxCount);
+
+    HttpWriter_init(&writer, pCtx->payloadBuffer, NETAPP_MAX_RX_FRAGMENT_LEN);
+
+    HttpWriter_append(&writer, "seq=", 4);
+    HttpWriter_appendUint(&writer, seq, 0);
+    HttpWriter_append(&writer, "&n=", 3);
+    HttpWriter_appendUint(&writer, count, 0);
+    HttpWriter_append(&writer, "&step=", 6);
+    HttpWriter_appendUint(&writer, SensorHistory_getStep(tier), 0);
+    HttpWriter_append(&writer, "&uptime=", 8);
+    HttpWriter_appendUint(&writer,
+                          SensorHistory_getHead(SensorHistoryTier_Second), 0);
+    for(ch = 0; ch < SensorHistoryChannel_Max; ch++)
+    {
+        HttpWriter_appendStr(&writer, historyNames[ch]);
+        for(idx = 0; idx < count; idx++)
+        {
+            if(idx > 0)
+            {
+                HttpWriter_appendChar(&writer, ',');
+            }
+            if(samples[idx].code[ch] != SENSOR_HISTORY_MISSING)
+            {
+                HttpWriter_appendInt(&writer, SensorHistory_decode(
+                    (SensorHistoryChannel)ch, samples[idx].code[ch]));
+            }
+        }
+    }
+
+    return(sendGetResponse(netAppRequest, pCtx, HttpWriter_finish(&writer)));
+}
+
+//*****************************************************************************
+//
+//! \brief This is the data log export callback function for HTTP GET. It
+//!        streams the records with "from" <= time < "to", seconds since 1970
+//!        of the device clock, rendered as CSV or as a JSON array. The range
+//!        defaults to the current day and is cut to its last
+//!        RECORD_LOG_RANGE_MAX_DAYS days. The records of every day file are
+//!        found with its hour index, every record renders to the same
+//!        length, so the Content-Length is sent up front and the records are
+//!        read from the SD card a batch at a time. Records that can not be
+//!        read are sent as zero records, keeping the length.
+//!
+//! \param[in]  requestIdx        request index to indicate the message
+//!
+//! \param[in]  argcCallback      count of input params to the service callback
+//!
+//! \param[in]  argvCallback      set of input params to the service callback
+//!
+//! \param[in] netAppRequest      netapp request structure
+//!
+//! \param[in] pCtx               worker context holding the request buffers
+//!
+//! \return 0 on success, negative if records were sent as zeros
+//!
+//****************************************************************************
+int32_t logGetCallback(uint8_t requestIdx,
+                       uint8_t *argcCallback,
+                       uint8_t **argvCallback,
+                       SlNetAppRequest_t *netAppRequest,
+                       http_WorkerCtx_t *pCtx)
+{
+    RecordLog_Record_t records[LOG_BATCH_RECORDS];
+    /* records of each day in the range, found before the length is sent */
+    uint32_t rangeFirst[RECORD_LOG_RANGE_MAX_DAYS];
+    uint32_t rangeEnd[RECORD_LOG_RANGE_MAX_DAYS];
+    uint8_t *argvArray;
+    uint16_t elementType;
+    uint8_t charIdx = LogIdx_MaxLog;
+    RecordLogFormat format = RecordLogFormat_Csv;
+    uint32_t today = RecordLog_getDay();
+    uint32_t from = today * RECORD_LOG_SECONDS_PER_DAY;
+    uint32_t to = 0xFFFFFFFF;
+    uint32_t firstDay, days, day, total, exported;
+    uint32_t contentLen, sent, idx, batch;
+    uint16_t metadataLen, recordLen;
+    int32_t readCount, record;
+    int32_t status = 0;
+    uint8_t readFailed;
+    HttpWriter_t writer;
+
+    argvArray = *argvCallback;
+
+    while(*argcCallback > 0)
+    {
+        elementType = setElementType(1, requestIdx, CONTENT_LEN_TYPE);
+        /* content length is irrelevant for GET */
+        if(*((uint16_t *)argvArray) != elementType)
+        {
+            /* means it is the value, not the parameter */
+            if(*(argvArray + 1) & 0x80)
+            {
+                switch(charIdx)
+                {
+                case LogIdx_format:
+                    format = (RecordLogFormat)*(argvArray + ARGV_VALUE_OFFSET);
+                    break;
+                case LogIdx_from:
+                    from = strtoul((const char *)(argvArray +
+                                                  ARGV_VALUE_OFFSET), NULL, 10);
+                    break;
+                case LogIdx_to:
+                    to = strtoul((const char *)(argvArray +
+                                                ARGV_VALUE_OFFSET), NULL, 10);
+                    break;
+                }
+            }
+            else    /* means it is the parameter, not the value */
+            {
+                charIdx = *(argvArray + ARGV_VALUE_OFFSET);
+            }
+        }
+
+        (*argcCallback)--;
+        argvArray += ARGV_LEN_OFFSET; /* skip the type */
+        argvArray += *argvArray;      /* add the length */
+        argvArray++;                  /* skip the length */
+    }
+
+    if(format >= RecordLogFormat_Max)
+    {
+        format = RecordLogFormat_Csv;
+    }
+
+    /* no day file is later than the current day */
+    days = 0;
+    firstDay = RECORD_LOG_DAY(from);
+    if(from < to)
+    {
+        day = RECORD_LOG_DAY(to - 1);
+        if(day > today)
+        {
+            day = today;
+        }
+        if(day >= firstDay)
+        {
+            days = day - firstDay + 1;
+            if(days > RECORD_LOG_RANGE_MAX_DAYS)
+            {
+                firstDay = day - RECORD_LOG_RANGE_MAX_DAYS + 1;
+                days = RECORD_LOG_RANGE_MAX_DAYS;
+            }
+        }
+    }
+
+    /* records appended during the export are left for the next one */
+    total = 0;
+    for(day = 0; day < days; day++)
+    {
+        RecordLog_find(firstDay + day, from, to, &rangeFirst[day],
+                       &rangeEnd[day]);
+        total += rangeEnd[day] - rangeFirst[day];
+    }
+
+    contentLen = RecordLog_exportSize(format, total);
+    recordLen = RecordLog_exportRecordSize(format);
+
+    metadataLen = prepareGetMetadata(0, contentLen,
+                                     (format == RecordLogFormat_Json) ?
+                                     HttpContentTypeList_ApplicationJson :
+                                     HttpContentTypeList_TextCSV, pCtx);
+    sl_NetAppSend (netAppRequest->Handle, metadataLen, pCtx->metadataBuffer,
+                   (SL_NETAPP_REQUEST_RESPONSE_FLAGS_CONTINUATION |
+                    SL_NETAPP_REQUEST_RESPONSE_FLAGS_METADATA));
+
+    HttpWriter_init(&writer, pCtx->payloadBuffer, NETAPP_MAX_RX_FRAGMENT_LEN);
+    RecordLog_exportBegin(format, &writer);
+
+    sent = 0;
+    exported = 0;
+    for(day = 0; day < days; day++)
+    {
+        idx = rangeFirst[day];
+        readFailed = 0;
+        while(idx < rangeEnd[day])
+        {
+            batch = (writer.size - writer.len) / recordLen;
+            if(batch == 0)
+            {
+                sl_NetAppSend (netAppRequest->Handle, writer.len,
+                               pCtx->payloadBuffer,
+                               SL_NETAPP_REQUEST_RESPONSE_FLAGS_CONTINUATION);
+                sent += writer.len;
+                HttpWriter_init(&writer, pCtx->payloadBuffer,
+                                NETAPP_MAX_RX_FRAGMENT_LEN);
+                continue;
+            }
+            if(batch > LOG_BATCH_RECORDS)
+            {
+                batch = LOG_BATCH_RECORDS;
+            }
+            if(batch > (rangeEnd[day] - idx))
+            {
+                batch = rangeEnd[day] - idx;
+            }
+
+            readCount = 0;
+            if(!readFailed)
+            {
+                readCount = RecordLog_read(firstDay + day, idx, records,
+                                           (uint16_t)batch);
+                if(readCount <= 0)
+                {
+                    UART_PRINT("[Link local task] log read error, records "
+                               "%d to %d of day %d sent as zeros\n\r", idx,
+                               rangeEnd[day] - 1, firstDay + day);
+                    readFailed = 1;
+                    status = -1;
+                }
+            }
+            if(readFailed)
+            {
+                /* the length is already sent, the rest of the day goes out
+                   as zero records of the same width, their time is 0 */
+                memset(records, 0, batch * sizeof(RecordLog_Record_t));
+                readCount = batch;
+            }
+
+            for(record = 0; record < readCount; record++)
+            {
+                RecordLog_exportRecord(format, &records[record],
+                                       ((exported + record) == 0), &writer);
+            }
+            idx += readCount;
+            exported += readCount;
+        }
+    }
+
+    /* what is left to send, the records in the buffer and the end */
+    if((contentLen - sent) > writer.size)
+    {
+        sl_NetAppSend (netAppRequest->Handle, writer.len, pCtx->payloadBuffer,
+                       SL_NETAPP_REQUEST_RESPONSE_FLAGS_CONTINUATION);
+        sent += writer.len;
+        HttpWriter_init(&writer, pCtx->payloadBuffer,
+                        NETAPP_MAX_RX_FRAGMENT_LEN);
+    }
+    RecordLog_exportEnd(format, &writer);
+
+    /* mark as last segment */
+    sl_NetAppSend (netAppRequest->Handle, writer.len, pCtx->payloadBuffer, 0);
+    INFO_PRINT("[Link local task] log sent, %d records, len = %d\n\r",
+               total, sent + writer.len);
+
+    return(status);
+}
+
+//*****************************************************************************
+//
+//! \brief This is a generic device service callback function for HTTP GET
+//!
+//! \param[in]  requestIdx          request index to indicate the message
+//!
+//! \param[in]  argcCallback        count of input params to the service callback
+//!
+//! \param[in]  argvCallback        set of input params to the service callback
+//!
+//! \param[in] netAppRequest        netapp request structure
+//!
+//! \param[in] pCtx                 worker context holding the request buffers
+//!
+//! \return 0 on success else negative
+//!
+//****************************************************************************
+int32_t deviceGetCallback(uint8_t requestIdx,
+                          uint8_t *argcCallback,
+                          uint8_t **argvCallback,
+                          SlNetAppRequest_t *netAppRequest,
+                          http_WorkerCtx_t *pCtx)
+{
+    uint8_t *argvArray;
+    uint16_t elementType;
+    int32_t status;
+    uint32_t deviceType;
+    HttpWriter_t writer;
+
+    argvArray = *argvCallback;
+    deviceType = getDeviceType();
+    HttpWriter_init(&writer, pCtx->payloadBuffer, NETAPP_MAX_RX_FRAGMENT_LEN);
+
+    while(*argcCallback > 0)
+    {
+        elementType = setElementType(1, requestIdx, CONTENT_LEN_TYPE);
+        /* content length is irrelevant for GET */
+        if(*((uint16_t *)argvArray) != elementType)          
+        {
+            switch(*(argvArray + ARGV_VALUE_OFFSET))
+            {
+            case DeviceIdx_Ssid:
+                status = getDeviceSSID(pCtx);
+                if(status != 0)
+                {
+                    UART_PRINT(
+                        "[Link local task] failed to get SSID.  IP_ACQ=%d, "
+                        "IP_LEASED=%d\n\r",
                         GET_STATUS_BIT(OutOfBox_ControlBlock.status,
                                        AppStatusBits_IpAcquired),
                         GET_STATUS_BIT(OutOfBox_ControlBlock.status,
@@ -1810,14 +2876,14 @@ int32_t deviceGetCallback(uint8_t requestIdx,
                 }
                 break;
             case DeviceIdx_IpAddress:
-                status = getDeviceIpAddress();
+                status = getDeviceIpAddress(pCtx);
                 if(status != 0)
                 {
                     goto exit_device_get;
                 }
                 break;
             case DeviceIdx_MacAddress:
-                status = getDeviceMacAddress(gMetadataBuffer);
+                status = getDeviceMacAddress(pCtx->metadataBuffer);
                 if(status != 0)
                 {
                     goto exit_device_get;
@@ -1827,27 +2893,27 @@ int32_t deviceGetCallback(uint8_t requestIdx,
                 /* 3235 applies for both CC3230 and CC3235 */
                 if(deviceType == DEV_TYPE_CC323XFS)
                 {
-                    strcpy((char *)gMetadataBuffer, "out_of_box_3235_fs");
+                    strcpy((char *)pCtx->metadataBuffer, "out_of_box_3235_fs");
                 }
                 else if(deviceType == DEV_TYPE_CC323XRS)
                 {
-                    strcpy((char *)gMetadataBuffer, "out_of_box_3235_rs");
+                    strcpy((char *)pCtx->metadataBuffer, "out_of_box_3235_rs");
                 }
                 else if(deviceType == DEV_TYPE_CC323XR)
                 {
-                    strcpy((char *)gMetadataBuffer, "out_of_box_3235_r");
+                    strcpy((char *)pCtx->metadataBuffer, "out_of_box_3235_r");
                 }
                 else if(deviceType == DEV_TYPE_CC3220FS)
                 {
-                    strcpy((char *)gMetadataBuffer, "out_of_box_fs");
+                    strcpy((char *)pCtx->metadataBuffer, "out_of_box_fs");
                 }
                 else if(deviceType == DEV_TYPE_CC3220RS)
                 {
-                    strcpy((char *)gMetadataBuffer, "out_of_box_rs");
+                    strcpy((char *)pCtx->metadataBuffer, "out_of_box_rs");
                 }
                 else if(deviceType == DEV_TYPE_CC3220R)
                 {
-                    strcpy((char *)gMetadataBuffer, "out_of_box_r");
+                    strcpy((char *)pCtx->metadataBuffer, "out_of_box_r");
                 }
                 else
                 {
@@ -1864,23 +2930,9 @@ int32_t deviceGetCallback(uint8_t requestIdx,
                 break;
             }
 
-            sl_Memcpy (
-                pPayload,
-                httpRequest[requestIdx].charValues[*(argvArray +
-                                                     ARGV_VALUE_OFFSET)].
-                characteristic,
-                strlen((const char *)httpRequest[requestIdx].
-                charValues[*(argvArray+ARGV_VALUE_OFFSET)].
-                characteristic));
-            pPayload += strlen(
-                (const char *)httpRequest[requestIdx].
-                charValues[*(argvArray +ARGV_VALUE_OFFSET)].
-                characteristic);
-            *pPayload++ = '=';
-            sl_Memcpy (pPayload, gMetadataBuffer,
-                       strlen((const char *)gMetadataBuffer));
-            pPayload += strlen((const char *)gMetadataBuffer);
-            *pPayload++ = '&';
+            appendCharacteristic(&writer, requestIdx,
+                                 *(argvArray + ARGV_VALUE_OFFSET));
+            HttpWriter_appendStr(&writer, (const char *)pCtx->metadataBuffer);
         }
 
         (*argcCallback)--;
@@ -1889,33 +2941,10 @@ int32_t deviceGetCallback(uint8_t requestIdx,
         argvArray++;                       /* skip the length */
     }
 
-    /* NULL terminate the payload */
-    *(pPayload - 1) = '\0';
-
-    status = 0;
+    status = HttpWriter_finish(&writer);
 
 exit_device_get:
-    if(status != 0)
-    {
-        strcpy((char *)gPayloadBuffer, (const char *)pageNotFound);
-    }
-
-    metadataLen =
-        prepareGetMetadata(status,
-        strlen((const char *)gPayloadBuffer),
-        HttpContentTypeList_UrlEncoded);
-
-    sl_NetAppSend (netAppRequest->Handle, metadataLen, gMetadataBuffer,
-                   (SL_NETAPP_REQUEST_RESPONSE_FLAGS_CONTINUATION |
-                    SL_NETAPP_REQUEST_RESPONSE_FLAGS_METADATA));
-    INFO_PRINT("[Link local task] Metadata Sent, len = %d \n\r", metadataLen);
-    /* mark as last segment */    
-    sl_NetAppSend (netAppRequest->Handle, strlen (
-                       (const char *)gPayloadBuffer), gPayloadBuffer, 0);
-    INFO_PRINT("[Link local task] Data Sent, len = %d\n\r",
-               strlen ((const char *)gPayloadBuffer));
-
-    return(status);
+    return(sendGetResponse(netAppRequest, pCtx, status));
 }
 
 //*****************************************************************************
@@ -1948,215 +2977,195 @@ void NetAppRequestErrorResponse(SlNetAppResponse_t *pNetAppResponse)
 
 //*****************************************************************************
 //
-//! \brief This function fetches the device MAC address
+//! \brief This function answers a netapp request right away with an HTTP
+//!        status, without involving the workers
 //!
-//! \param[out]  buffer to occupy the MAC address in string format
+//! \param[out]  pNetAppResponse    netapp response structure
 //!
-//! \return 0 on success else negative
+//! \param[in]   httpStatus         HTTP status to answer with
+//!
+//! \return none
 //!
 //****************************************************************************
-int32_t getDeviceMacAddress(uint8_t *macAddress)
+void NetAppRequestRejectResponse(SlNetAppResponse_t *pNetAppResponse,
+                                 uint16_t httpStatus)
 {
-    uint8_t macAddressVal[6];
-    uint16_t macAddressLen;
-    int32_t status;
-
-    macAddress[0] = '\0';
-
-    /* Get the device's MAC address */
-    macAddressLen = 6;
-    status =
-        sl_NetCfgGet(SL_NETCFG_MAC_ADDRESS_GET,NULL,&macAddressLen,
-                     (uint8_t *)macAddressVal);
-    if(status < 0)
-    {
-        return(status);
-    }
+    INFO_PRINT("[Link local task] request rejected with status %d\n\r",
+               httpStatus);
 
-    snprintf((char *)macAddress, MAC_ADDR_STR_LEN,
-             "%02x:%02x:%02x:%02x:%02x:%02x",
-             macAddressVal[0],
-             macAddressVal[1],
-             macAddressVal[2],
-             macAddressVal[3],
-             macAddressVal[4],
-             macAddressVal[5]);
-
-    return(0);
+    pNetAppResponse->Status = httpStatus;
+    pNetAppResponse->ResponseData.pMetadata = NULL;
+    pNetAppResponse->ResponseData.MetadataLen = 0;
+    pNetAppResponse->ResponseData.pPayload = NULL;
+    pNetAppResponse->ResponseData.PayloadLen = 0;
+    pNetAppResponse->ResponseData.Flags = 0;
 }
 
 //*****************************************************************************
 //
-//! Function to read accelarometer
+//! \brief This function takes a free slot from the request pool
 //!
-//! \param  none
+//! \param[in]  None
 //!
-//! \return SUCCESS or FAILURE
+//! \return slot, or NULL when the pool is exhausted
 //!
-//*****************************************************************************
-uint8_t accelarometerReading(void)
+//****************************************************************************
+http_RequestSlot_t *requestSlotAlloc(void)
 {
-    int8_t xValRead, yValRead, zValRead;
-    int32_t status;
+    http_RequestSlot_t *slot = NULL;
+    uint8_t slotIdx;
 
-    if(sensorLockObj != NULL)
-    {
-        pthread_mutex_lock(sensorLockObj);
-    }
+    pthread_mutex_lock(&gRequestPoolLockObj);
 
-    /* Read accelarometer axis values */
-    status = BMA2xxReadNew(i2cHandle, &xValRead, &yValRead, &zValRead);
-    if(status != 0)
+    for(slotIdx = 0; slotIdx < LINKLOCAL_REQUEST_SLOT_NUM; slotIdx++)
     {
-        /* try to read again */
-        status = BMA2xxReadNew(i2cHandle, &xValRead, &yValRead, &zValRead);
-        if(status != 0)     /* leave previous values */
+        if(!gRequestPool[slotIdx].inUse)
         {
-            UART_PRINT(
-                "[Link local task] Failed to read data from accelarometer\n\r");
+            slot = &gRequestPool[slotIdx];
+            slot->inUse = 1;
+
+            gRequestPoolStats.inUse++;
+            if(gRequestPoolStats.inUse > gRequestPoolStats.highWater)
+            {
+                gRequestPoolStats.highWater = gRequestPoolStats.inUse;
+            }
+            break;
         }
     }
 
-    if(status == 0)
+    if(NULL == slot)
     {
-        xVal = xValRead;
-        yVal = yValRead;
-        zVal = zValRead;
+        gRequestPoolStats.exhausted++;
     }
 
-    if(sensorLockObj != NULL)
-    {
-        pthread_mutex_unlock(sensorLockObj);
-    }
+    pthread_mutex_unlock(&gRequestPoolLockObj);
 
-    return(status);
+    return(slot);
 }
 
 //*****************************************************************************
 //
-//! Function to read temperature
+//! \brief This function returns the slot of a served request to the pool
 //!
-//! \param  none
+//! \param[in]  netAppRequest      request taken from requestSlotAlloc()
 //!
-//! \return SUCCESS or FAILURE
+//! \return none
 //!
-//*****************************************************************************
-uint8_t temperatureReading(void)
+//****************************************************************************
+void requestSlotFree(SlNetAppRequest_t *netAppRequest)
 {
-    int32_t status;
-    float fTempRead;
-    if(sensorLockObj != NULL)
-    {
-        pthread_mutex_lock(sensorLockObj);
-    }
-    /* Read temperature axis values */
-    status = TMP006DrvGetTemp(i2cHandle, &fTempRead);
-    if(status != 0)
-    {
-        /* try to read again */
-        status = TMP006DrvGetTemp(i2cHandle, &fTempRead);
-        if(status != 0)     /* leave previous values */
-        {
-            UART_PRINT(
-                "[Link local task] Failed to read data from"
-                " temperature sensor\n\r");
-        }
-    }
+    http_RequestSlot_t *slot = (http_RequestSlot_t *)netAppRequest;
 
-    if(status == 0)
-    {
-        fTempRead = (fTempRead > 100) ? 100 : fTempRead;
-        temperatureVal = fTempRead;
-    }
-    if(sensorLockObj != NULL)
+    pthread_mutex_lock(&gRequestPoolLockObj);
+
+    if(slot->inUse)
     {
-        pthread_mutex_unlock(sensorLockObj);
+        slot->inUse = 0;
+        gRequestPoolStats.inUse--;
     }
-    return(status);
-}
 
+    pthread_mutex_unlock(&gRequestPoolLockObj);
+}
 
 //*****************************************************************************
 //
-//! Function to read BME280
+//! \brief This function copies the metadata TLVs the parser uses into a
+//!        request slot. Headers the server does not look at (user agent,
+//!        cookies, languages...) are dropped so they can not overflow it.
 //!
-//! \param  none
+//! \param[in]  slot               destination request slot
 //!
-//! \return SUCCESS(0) or FAILURE(-1)
+//! \param[in]  pMetadata          metadata handed over by the NWP
 //!
-//*****************************************************************************
-int8_t BME280Reading(void){
-    int32_t status;
-    int32_t tempOutRead;
-    uint32_t presOutRead;
-    uint32_t humidOutRead;
+//! \param[in]  metadataLen        metadata length
+//!
+//! \return copied length, or negative if the kept TLVs do not fit
+//!
+//****************************************************************************
+int32_t requestSlotCopyMetadata(http_RequestSlot_t *slot,
+                                uint8_t *pMetadata,
+                                uint16_t metadataLen)
+{
+    uint8_t *pTlv = pMetadata;
+    uint8_t *pEnd = pMetadata + metadataLen;
+    uint16_t copiedLen = 0;
+    uint16_t tlvLen;
+    uint8_t type;
 
-    if(sensorLockObj != NULL)
+    while((pTlv + 3) <= pEnd)
     {
-        pthread_mutex_lock(sensorLockObj);
-    }
+        type = *pTlv;
+        sl_Memcpy((uint8_t *)&tlvLen, pTlv + 1, 2);
+        if((pTlv + 3 + tlvLen) > pEnd)
+        {
+            break;
+        }
+
+        switch(type)
+        {
+        case SL_NETAPP_REQUEST_METADATA_TYPE_HTTP_REQUEST_URI:
+        case SL_NETAPP_REQUEST_METADATA_TYPE_HTTP_QUERY_STRING:
+        case SL_NETAPP_REQUEST_METADATA_TYPE_HTTP_CONTENT_LEN:
+        case SL_NETAPP_REQUEST_METADATA_TYPE_HTTP_ETAG:  /* If-None-Match */
+            if((copiedLen + 3 + tlvLen) > LINKLOCAL_SLOT_METADATA_LEN)
+            {
+                return(-1);
+            }
+            sl_Memcpy(&slot->metadata[copiedLen], pTlv, 3 + tlvLen);
+            copiedLen += 3 + tlvLen;
+            break;
 
-    bmeDatIn = BME280_read();
+        default:
+            break;
+        }
 
-    if(bmeDatIn ==NULL){
-        return -1;
+        pTlv += 3 + tlvLen;
     }
-    tempIn=BME280_compensated_Temperature(bmeDatIn);
-    humidIn=BME280_compensated_Humidity(bmeDatIn) / 1024;
-    presIn=((BME280_compensated_Pressure(bmeDatIn) / 256) );
-    if(sensorLockObj != NULL)
-    {
-        pthread_mutex_unlock(sensorLockObj);
-    }
-    return 0;
 
+    slot->metadata[copiedLen] = '\0';
+
+    return(copiedLen);
 }
 
 //*****************************************************************************
 //
-//! Function to read CCS811
+//! \brief This function fetches the device MAC address
 //!
-//! \param  none
+//! \param[out]  buffer to occupy the MAC address in string format
 //!
-//! \return SUCCESS or FAILURE
+//! \return 0 on success else negative
 //!
-//*****************************************************************************
-int8_t ccs811Reading(void){
-    if(sensorLockObj != NULL)
-    {
-        pthread_mutex_lock(sensorLockObj);
-    }
-    uint16_t status;
-    status = ccs811_set_environmental_data (sensor, ((float)(tempIn))/100, (((float)humidIn)/100));
-    status = ccs811_get_results (sensor, 0, &airQuality, 0, 0);
-
-    if(sensorLockObj != NULL)
-    {
-        pthread_mutex_unlock(sensorLockObj);
-    }
-    if (status ==1) return 0;
+//****************************************************************************
+int32_t getDeviceMacAddress(uint8_t *macAddress)
+{
+    uint8_t macAddressVal[6];
+    uint16_t macAddressLen;
+    int32_t status;
 
-    else return 1;
+    macAddress[0] = '\0';
 
-}
-int8_t oxySensorReading(void){
-    int8_t status;
-    if(sensorLockObj != NULL)
-    {
-        pthread_mutex_lock(sensorLockObj);
-    }
-    status = ADC_convert(oxygenSensor,& oxygenRAW);
-    if (status == ADC_STATUS_SUCCESS) {
-        oxygen = oxygenRAW * (3300*210)/(4095*20);      //(milivolt conversion 3300/4095)*(oxy concentration conversion(milli%) 21000/2000)
-    }
-    if(sensorLockObj != NULL)
+    /* Get the device's MAC address */
+    macAddressLen = 6;
+    status =
+        sl_NetCfgGet(SL_NETCFG_MAC_ADDRESS_GET,NULL,&macAddressLen,
+                     (uint8_t *)macAddressVal);
+    if(status < 0)
     {
-        pthread_mutex_unlock(sensorLockObj);
+        return(status);
     }
-    return status;
 
+    snprintf((char *)macAddress, MAC_ADDR_STR_LEN,
+             "%02x:%02x:%02x:%02x:%02x:%02x",
+             macAddressVal[0],
+             macAddressVal[1],
+             macAddressVal[2],
+             macAddressVal[3],
+             macAddressVal[4],
+             macAddressVal[5]);
 
+    return(0);
 }
+
 //*****************************************************************************
 //
 //! \brief this function composes an element type from metadata/payload
@@ -2192,20 +3201,23 @@ uint16_t setElementType(uint8_t isValue,
 //! \param[in] contentLen           content length in respond to 
 //!            HTTP GET request
 //!
+//! \param[in] pCtx                 worker context holding the metadata buffer
+//!
 //! \return metadataLen
 //!
 //****************************************************************************
 uint16_t prepareGetMetadata(int32_t parsingStatus,
                             uint32_t contentLen,
-                            HttpContentTypeList contentTypeId)
+                            HttpContentTypeList contentTypeId,
+                            http_WorkerCtx_t *pCtx)
 {
-    char *contentType;
+    const http_contentTypeMapping_t *pContentType;
     uint8_t *pMetadata;
-    uint16_t metadataLen;
+    uint16_t metadataLen, etagLen;
 
-    contentType = g_ContentTypes[contentTypeId].contentTypeText;
+    pContentType = &g_ContentTypes[contentTypeId];
 
-    pMetadata = gMetadataBuffer;
+    pMetadata = pCtx->metadataBuffer;
 
     /* http status */
     *pMetadata = (uint8_t) SL_NETAPP_REQUEST_METADATA_TYPE_STATUS;
@@ -2228,10 +3240,11 @@ uint16_t prepareGetMetadata(int32_t parsingStatus,
     /* Content type */
     *pMetadata = (uint8_t) SL_NETAPP_REQUEST_METADATA_TYPE_HTTP_CONTENT_TYPE;
     pMetadata++;
-    (*(uint16_t *)pMetadata) = (uint16_t) strlen ((const char *)contentType);
+    (*(uint16_t *)pMetadata) = (uint16_t) pContentType->contentTypeLen;
     pMetadata += 2;
-    sl_Memcpy (pMetadata, contentType, strlen((const char *)contentType));
-    pMetadata += strlen((const char *)contentType);
+    sl_Memcpy (pMetadata, pContentType->contentTypeText,
+               pContentType->contentTypeLen);
+    pMetadata += pContentType->contentTypeLen;
 
     /* Content len */
     *pMetadata = SL_NETAPP_REQUEST_METADATA_TYPE_HTTP_CONTENT_LEN;
@@ -2239,8 +3252,22 @@ uint16_t prepareGetMetadata(int32_t parsingStatus,
     *(uint16_t *)pMetadata = (uint16_t) 4;
     pMetadata += 2;
     *(uint32_t *)pMetadata = (uint32_t) contentLen;
+    pMetadata += 4;
 
-    metadataLen = 5 + 7 + strlen ((const char *)contentType) + 3;
+    metadataLen = 5 + 7 + pContentType->contentTypeLen + 3;
+
+    /* Etag, lets the client revalidate with If-None-Match */
+    if((parsingStatus >= 0) && (pCtx->etag[0] != '\0'))
+    {
+        etagLen = strlen((const char *)pCtx->etag);
+        *pMetadata = (uint8_t) SL_NETAPP_REQUEST_METADATA_TYPE_HTTP_ETAG;
+        pMetadata++;
+        *(uint16_t *)pMetadata = etagLen;
+        pMetadata += 2;
+        sl_Memcpy (pMetadata, pCtx->etag, etagLen);
+
+        metadataLen += 3 + etagLen;
+    }
 
     return(metadataLen);
 }
@@ -2251,15 +3278,18 @@ uint16_t prepareGetMetadata(int32_t parsingStatus,
 //!
 //! \param[in] parsingStatus        validity of HTTP POST/PUT request
 //!
+//! \param[in] pCtx                 worker context holding the metadata buffer
+//!
 //! \return metadataLen
 //!
 //****************************************************************************
-uint16_t preparePostMetadata(int32_t parsingStatus)
+uint16_t preparePostMetadata(int32_t parsingStatus,
+                             http_WorkerCtx_t *pCtx)
 {
     uint8_t *pMetadata;
     uint16_t metadataLen;
 
-    pMetadata = gMetadataBuffer;
+    pMetadata = pCtx->metadataBuffer;
 
     /* http status */
     *pMetadata = (uint8_t) SL_NETAPP_REQUEST_METADATA_TYPE_STATUS;
@@ -2285,23 +3315,274 @@ uint16_t preparePostMetadata(int32_t parsingStatus)
     return(metadataLen);
 }
 
+//*****************************************************************************
+//
+//! \brief This function appends the name of a characteristic and the
+//!        equal sign, preceded by the pair separator if needed
+//!
+//! \param[in]  pWriter           payload writer
+//!
+//! \param[in]  requestIdx        request index to indicate the message
+//!
+//! \param[in]  charIdx           characteristic index in charValues[]
+//!
+//! \return None
+//!
+//****************************************************************************
+void appendCharacteristic(HttpWriter_t *pWriter,
+                          uint8_t requestIdx,
+                          uint8_t charIdx)
+{
+    const http_charValuesPair_t *pChar =
+        &httpRequest[requestIdx].charValues[charIdx];
+
+    if(pWriter->len > 0)
+    {
+        HttpWriter_appendChar(pWriter, '&');
+    }
+    HttpWriter_append(pWriter, pChar->characteristic.pName,
+                      pChar->characteristic.nameLen);
+    HttpWriter_appendChar(pWriter, '=');
+}
+
+//*****************************************************************************
+//
+//! \brief This function sends the response to an HTTP GET request, 404 with
+//!        the not found page if the payload could not be formatted
+//!
+//! \param[in] netAppRequest        netapp request structure
+//!
+//! \param[in] pCtx                 worker context holding the payload
+//!
+//! \param[in] payloadLen           url-encoded payload length, or negative
+//!
+//! \return 0 on success else negative
+//!
+//****************************************************************************
+int32_t sendGetResponse(SlNetAppRequest_t *netAppRequest,
+                        http_WorkerCtx_t *pCtx,
+                        int32_t payloadLen)
+{
+    uint16_t metadataLen;
+    const uint8_t *pPayload = pCtx->payloadBuffer;
+    int32_t status = 0;
+
+    if(payloadLen < 0)
+    {
+        UART_PRINT("[Link local task] GET response does not fit\n\r");
+        pPayload = pageNotFound;
+        payloadLen = sizeof(pageNotFound) - 1;
+        status = -1;
+    }
+
+    metadataLen = prepareGetMetadata(status, payloadLen,
+                                     HttpContentTypeList_UrlEncoded, pCtx);
+
+    sl_NetAppSend (netAppRequest->Handle, metadataLen, pCtx->metadataBuffer,
+                   (SL_NETAPP_REQUEST_RESPONSE_FLAGS_CONTINUATION |
+                    SL_NETAPP_REQUEST_RESPONSE_FLAGS_METADATA));
+    INFO_PRINT("[Link local task] Metadata Sent, len = %d \n\r", metadataLen);
+
+    /* mark as last segment */
+    sl_NetAppSend (netAppRequest->Handle, payloadLen, (uint8_t *)pPayload, 0);
+    INFO_PRINT("[Link local task] Data Sent, len = %d\n\r", payloadLen);
+
+    return(status);
+}
+
+//*****************************************************************************
+//
+//! \brief This function draws the per boot entity tag nonce
+//!
+//! \return None
+//!
+//****************************************************************************
+void initEntityTagNonce(void)
+{
+    struct timespec ts;
+    uint16_t len = sizeof(gEtagNonce);
+    int32_t status;
+
+    status = sl_NetUtilGet(SL_NETUTIL_TRUE_RANDOM, 0,
+                           (uint8_t *)&gEtagNonce, &len);
+    if((status < 0) || (len != sizeof(gEtagNonce)))
+    {
+        /* the clock still tells most boots apart */
+        clock_gettime(CLOCK_REALTIME, &ts);
+        gEtagNonce = (uint32_t)ts.tv_sec ^ ((uint32_t)ts.tv_nsec << 12);
+        UART_PRINT("[Link local task] no random number for the entity "
+                   "tags, using the clock\n\r");
+    }
+}
+
+//*****************************************************************************
+//
+//! \brief This function sets the entity tag of the response
+//!
+//! \param[in] pCtx                 worker context holding the entity tag
+//!
+//! \param[in] sequence             snapshot sequence the response is built of
+//!
+//! \param[in] pStateTag            actuator state tag, NULL if not reported
+//!
+//! \return None
+//!
+//****************************************************************************
+void setEntityTag(http_WorkerCtx_t *pCtx,
+                  uint32_t sequence,
+                  uint32_t *pStateTag)
+{
+    HttpWriter_t writer;
+
+    HttpWriter_init(&writer, pCtx->etag, LINKLOCAL_ETAG_LEN);
+    HttpWriter_appendChar(&writer, '"');
+    HttpWriter_appendHex(&writer, gEtagNonce, 8);
+    HttpWriter_appendChar(&writer, '-');
+    HttpWriter_appendUint(&writer, sequence, 0);
+    if(pStateTag != NULL)
+    {
+        HttpWriter_appendChar(&writer, '.');
+        HttpWriter_appendHex(&writer, *pStateTag, 0);
+    }
+    HttpWriter_appendChar(&writer, '"');
+
+    /* the longest tag fits, an empty one disables revalidation anyway */
+    if(HttpWriter_finish(&writer) < 0)
+    {
+        pCtx->etag[0] = '\0';
+    }
+}
+
+//*****************************************************************************
+//
+//! \brief This function answers 304 Not Modified, with no body, when the
+//!        client copy carries the entity tag of the response being served
+//!
+//! \param[in] netAppRequest        netapp request structure
+//!
+//! \param[in] pCtx                 worker context holding the entity tag
+//!
+//! \return 0 if 304 was sent, negative if the response must be sent
+//!
+//****************************************************************************
+int32_t sendNotModified(SlNetAppRequest_t *netAppRequest,
+                        http_WorkerCtx_t *pCtx)
+{
+    uint8_t *pTlv, *pEnd, *pValue;
+    uint8_t *pMetadata;
+    uint16_t len, etagLen, offset;
+    uint8_t match = 0;
+
+    etagLen = strlen((const char *)pCtx->etag);
+    if(etagLen == 0)
+    {
+        return(-1);
+    }
+
+    /* the request slot only keeps the TLVs the server looks at */
+    pTlv = netAppRequest->requestData.pMetadata;
+    pEnd = pTlv + netAppRequest->requestData.MetadataLen;
+    while(((pTlv + 3) <= pEnd) && !match)
+    {
+        sl_Memcpy((uint8_t *)&len, pTlv + 1, 2);
+        pValue = pTlv + 3;
+        if((pValue + len) > pEnd)
+        {
+            break;
+        }
+
+        if(*pTlv == SL_NETAPP_REQUEST_METADATA_TYPE_HTTP_ETAG)
+        {
+            /* a list of tags, weak ones included, or any tag */
+            if((len == 1) && (*pValue == '*'))
+            {
+                match = 1;
+            }
+            for(offset = 0; (offset + etagLen) <= len; offset++)
+            {
+                if(!memcmp(pValue + offset, pCtx->etag, etagLen))
+                {
+                    match = 1;
+                    break;
+                }
+            }
+        }
+
+        pTlv = pValue + len;
+    }
+
+    if(!match)
+    {
+        return(-1);
+    }
+
+    pMetadata = pCtx->metadataBuffer;
+
+    /* http status */
+    *pMetadata = (uint8_t) SL_NETAPP_REQUEST_METADATA_TYPE_STATUS;
+    pMetadata++;
+    *(uint16_t *)pMetadata = (uint16_t) 2;
+    pMetadata += 2;
+    *(uint16_t *)pMetadata = (uint16_t) SL_NETAPP_HTTP_RESPONSE_304_NOT_MODIFIED;
+    pMetadata += 2;
+
+    /* Etag */
+    *pMetadata = (uint8_t) SL_NETAPP_REQUEST_METADATA_TYPE_HTTP_ETAG;
+    pMetadata++;
+    *(uint16_t *)pMetadata = etagLen;
+    pMetadata += 2;
+    sl_Memcpy (pMetadata, pCtx->etag, etagLen);
+
+    sl_NetAppSend (netAppRequest->Handle, 5 + 3 + etagLen,
+                   pCtx->metadataBuffer,
+                   SL_NETAPP_REQUEST_RESPONSE_FLAGS_METADATA);
+    INFO_PRINT("[Link local task] Not modified, etag %s\n\r", pCtx->etag);
+
+    return(0);
+}
+
+//*****************************************************************************
+//
+//! \brief This function returns a tag that changes with the actuator states
+//!
+//! \param[in]  None
+//!
+//! \return state tag
+//!
+//****************************************************************************
+uint32_t getStateTag(void)
+{
+    uint32_t tag;
+
+    /* cheap mix of the raw values, no formatting */
+    tag = (uint32_t)Fan_State | ((uint32_t)Lights_State << 2) |
+          ((uint32_t)Peltier_State << 4);
+    tag = (tag * 31) + (uint32_t)goalTemp;
+    tag = (tag * 31) + (uint32_t)dataFreq;
+    tag = (tag * 31) + (lastDump.tm_hour << 8) + lastDump.tm_min;
+    tag = (tag * 31) + (lastCheckin.tm_hour << 8) + lastCheckin.tm_min;
+
+    return(tag);
+}
+
 //*****************************************************************************
 //
 //! \brief This function fetches the device IP address
 //!
-//! \param[in]  none
+//! \param[out] pCtx    worker context, the result is left in its
+//!                     metadata buffer
 //!
 //! \return 0 on success else negative
 //!
 //****************************************************************************
-int32_t getDeviceIpAddress(void)
+int32_t getDeviceIpAddress(http_WorkerCtx_t *pCtx)
 {
     uint16_t ConfigOpt;
     uint16_t ipLen;
     SlNetCfgIpV4Args_t ipV4 = {0};
     int32_t status;
 
-    gMetadataBuffer[0] = '\0';
+    pCtx->metadataBuffer[0] = '\0';
 
     /* Get the device's IP address */
     ipLen = sizeof(SlNetCfgIpV4Args_t);
@@ -2314,7 +3595,7 @@ int32_t getDeviceIpAddress(void)
         return(status);
     }
 
-    snprintf((char *)gMetadataBuffer, IP_ADDR_STR_LEN, "%d.%d.%d.%d",
+    snprintf((char *)pCtx->metadataBuffer, IP_ADDR_STR_LEN, "%d.%d.%d.%d",
              (int)SL_IPV4_BYTE(ipV4.Ip,3),
              (int)SL_IPV4_BYTE(ipV4.Ip,2),
              (int)SL_IPV4_BYTE(ipV4.Ip,1),
@@ -2327,176 +3608,288 @@ int32_t getDeviceIpAddress(void)
 //
 //! \brief This function fetches the SSID the device is connected to
 //!
-//! \param[in]  none
+//! \param[out] pCtx    worker context, the result is left in its
+//!                     metadata buffer
 //!
 //! \return 0 on success else negative
 //!
 //****************************************************************************
-int32_t getDeviceSSID(void)
+int32_t getDeviceSSID(http_WorkerCtx_t *pCtx)
 {
-    uint16_t len = 32;
+    uint16_t len = SL_WLAN_SSID_MAX_LENGTH + 1;
     uint16_t config_opt = SL_WLAN_AP_OPT_SSID;
     /* simplelink as station connected to AP */
     if(GET_STATUS_BIT(OutOfBox_ControlBlock.status,
                       AppStatusBits_IpAcquired) &&
        GET_STATUS_BIT(OutOfBox_ControlBlock.status, AppStatusBits_Connection))
     {
-        sl_Memcpy ((uint8_t *)gMetadataBuffer,
+        sl_Memcpy ((uint8_t *)pCtx->metadataBuffer,
                    (const uint8_t *)OutOfBox_ControlBlock.connectionSSID,
                    OutOfBox_ControlBlock.ssidLen);
-        gMetadataBuffer[OutOfBox_ControlBlock.ssidLen] = '\0';
+        pCtx->metadataBuffer[OutOfBox_ControlBlock.ssidLen] = '\0';
     }
     /* simplelink as AP with connected client */
     else if(GET_STATUS_BIT(OutOfBox_ControlBlock.status,
                            AppStatusBits_IpAcquired) &&
             GET_STATUS_BIT(OutOfBox_ControlBlock.status, AppStatusBits_IpLeased))                                                                                
     {
-        sl_WlanGet(SL_WLAN_CFG_AP_ID, &config_opt, &len,
-                   (uint8_t *)OutOfBox_ControlBlock.connectionSSID);
-        OutOfBox_ControlBlock.ssidLen = len - 1;
-        sl_Memcpy ((uint8_t *)gMetadataBuffer,
-                   (const uint8_t *)OutOfBox_ControlBlock.connectionSSID,
-                   OutOfBox_ControlBlock.ssidLen);
-        gMetadataBuffer[OutOfBox_ControlBlock.ssidLen] = '\0';
+        /* read into the worker buffer, the control block is shared by
+           every worker */
+        if((sl_WlanGet(SL_WLAN_CFG_AP_ID, &config_opt, &len,
+                       (uint8_t *)pCtx->metadataBuffer) < 0) || (len == 0))
+        {
+            return(-1);
+        }
+        pCtx->metadataBuffer[len - 1] = '\0';
     }
     else
     {
-        return(-1);
+        return(-1);
+    }
+
+    return(0);
+}
+
+//*****************************************************************************
+//
+//! \brief This function flushes the netapp data from the client
+//!
+//! \param[in] netAppRequest        netapp request structure
+//!
+//! \param[in] pCtx                 worker context holding the request buffers
+//!
+//! \param[in] flags                netapp flags for more data
+//!
+//! \return 0 on success else negative
+//!
+//****************************************************************************
+int32_t otaFlushNetappReq(SlNetAppRequest_t *netAppRequest,
+                          uint32_t *flags,
+                          http_WorkerCtx_t *pCtx)
+{
+    int32_t status;
+    int32_t chunkLen;
+
+    status = 0;
+
+    while((*flags & SL_NETAPP_REQUEST_RESPONSE_FLAGS_CONTINUATION) ==
+          SL_NETAPP_REQUEST_RESPONSE_FLAGS_CONTINUATION)
+    {
+        chunkLen = NETAPP_MAX_RX_FRAGMENT_LEN;
+        status =
+            sl_NetAppRecv(netAppRequest->Handle, (uint16_t *)&chunkLen,
+                          pCtx->payloadBuffer,
+                          (_u32 *)flags);
+        INFO_PRINT("[Link local task] flushing NetApp packet, len=%d \n\r",
+                   chunkLen);
+        if(status < 0)
+        {
+            return(status);
+        }
+
+        if(*flags == 0)
+        {
+            break;
+        }
+    }
+
+    return(status);
+}
+
+//*****************************************************************************
+//
+//! \brief This function verifies that the route and characteristic lookup
+//!        orders list every entry once and are sorted by length, bytes and
+//!        method, the binary searches depend on it. On failure the lookups
+//!        fall back to scanning the tables.
+//!
+//! \param[in]  None
+//!
+//! \return 0 on success or -ve on error
+//!
+//****************************************************************************
+int32_t initLinkLocalDB(void)
+{
+    const http_RequestObj_t *pRoute;
+    uint8_t loopIdx;
+    int32_t status = 0;
+
+    /* every route at the index its entry names */
+    for(loopIdx = 0; loopIdx < NUMBER_OF_URI_SERVICES; loopIdx++)
+    {
+        if(httpRequest[loopIdx].requestIdx != loopIdx)
+        {
+            UART_PRINT("[Link local task] route %s has index %d, not %d\n\r",
+                       httpRequest[loopIdx].service.pName,
+                       httpRequest[loopIdx].requestIdx, loopIdx);
+            status = -1;
+        }
+    }
+
+    switch(HttpLookup_checkOrder(httpRequest, sizeof(httpRequest[0]),
+                                 NUMBER_OF_URI_SERVICES, gRouteOrder,
+                                 NUMBER_OF_URI_SERVICES))
+    {
+    case 0:
+        break;
+
+    case HTTP_LOOKUP_NOT_SORTED:
+        UART_PRINT("[Link local task] route table not sorted\n\r");
+        status = -1;
+        break;
+
+    default:
+        UART_PRINT("[Link local task] route order misses or repeats a "
+                   "route\n\r");
+        status = -1;
+        break;
+    }
+
+    for(loopIdx = 0; loopIdx < NUMBER_OF_URI_SERVICES; loopIdx++)
+    {
+        pRoute = &httpRequest[loopIdx];
+
+        switch(HttpLookup_checkOrder(pRoute->charValues,
+                                     sizeof(pRoute->charValues[0]),
+                                     sizeof(pRoute->charValues) /
+                                     sizeof(pRoute->charValues[0]),
+                                     pRoute->charOrder, pRoute->charNum))
+        {
+        case 0:
+            break;
+
+        case HTTP_LOOKUP_NOT_SORTED:
+            UART_PRINT("[Link local task] characteristics of %s not "
+                       "sorted\n\r", pRoute->service.pName);
+            status = -1;
+            break;
+
+        default:
+            UART_PRINT("[Link local task] characteristic order of %s misses "
+                       "or repeats a characteristic\n\r",
+                       pRoute->service.pName);
+            status = -1;
+            break;
+        }
+    }
+
+    gLookupSorted = (status == 0);
+
+    return(status);
+}
+
+//*****************************************************************************
+//
+//! \brief This function finds the service serving an URI and HTTP method
+//!
+//! \param[in]  pUri              URI, not necessarily NULL terminated
+//!
+//! \param[in]  uriLen            URI length
+//!
+//! \param[in]  requestType       HTTP method (GET, POST, PUT or DEL)
+//!
+//! \return index in httpRequest[] or -1 if the route is unknown
+//!
+//****************************************************************************
+int32_t lookupRoute(const uint8_t *pUri,
+                    uint16_t uriLen,
+                    uint8_t requestType)
+{
+    /* an order failed the boot check, scan the table */
+    if(!gLookupSorted)
+    {
+        return(HttpLookup_scan(httpRequest, sizeof(httpRequest[0]),
+                               NUMBER_OF_URI_SERVICES, pUri, uriLen,
+                               requestType));
     }
 
-    return(0);
+    return(HttpLookup_find(httpRequest, sizeof(httpRequest[0]), gRouteOrder,
+                           NUMBER_OF_URI_SERVICES, pUri, uriLen,
+                           requestType));
 }
 
 //*****************************************************************************
 //
-//! \brief This function flushes the netapp data from the client
+//! \brief This function finds a characteristic of a service by exact name
 //!
-//! \param[in] netAppRequest        netapp request structure
+//! \param[in]  requestIdx        request index to indicate the message
 //!
-//! \param[in] flags                netapp flags for more data
+//! \param[in]  pName             characteristic name
 //!
-//! \return 0 on success else negative
+//! \param[in]  nameLen           characteristic name length
+//!
+//! \return index in charValues[] or -1 if the characteristic is unknown
 //!
 //****************************************************************************
-int32_t otaFlushNetappReq(SlNetAppRequest_t *netAppRequest,
-                          uint32_t *flags)
+int32_t lookupCharacteristic(uint8_t requestIdx,
+                             const uint8_t *pName,
+                             uint16_t nameLen)
 {
-    int32_t status;
-    int32_t chunkLen;
-
-    status = 0;
+    const http_RequestObj_t *pRoute = &httpRequest[requestIdx];
 
-    while((*flags & SL_NETAPP_REQUEST_RESPONSE_FLAGS_CONTINUATION) ==
-          SL_NETAPP_REQUEST_RESPONSE_FLAGS_CONTINUATION)
+    /* an order failed the boot check, scan the table */
+    if(!gLookupSorted)
     {
-        chunkLen = NETAPP_MAX_RX_FRAGMENT_LEN;
-        status =
-            sl_NetAppRecv(netAppRequest->Handle, (uint16_t *)&chunkLen,
-                          gPayloadBuffer,
-                          (_u32 *)flags);
-        INFO_PRINT("[Link local task] flushing NetApp packet, len=%d \n\r",
-                   chunkLen);
-        if(status < 0)
-        {
-            return(status);
-        }
-
-        if(*flags == 0)
-        {
-            break;
-        }
+        return(HttpLookup_scan(pRoute->charValues,
+                               sizeof(pRoute->charValues[0]),
+                               sizeof(pRoute->charValues) /
+                               sizeof(pRoute->charValues[0]), pName, nameLen,
+                               0));
     }
 
-    return(status);
+    return(HttpLookup_find(pRoute->charValues, sizeof(pRoute->charValues[0]),
+                           pRoute->charOrder, pRoute->charNum, pName, nameLen,
+                           0));
 }
 
 //*****************************************************************************
 //
-//! \brief This function create mailbox message queue between linkLocal task
-//!                and driver task
+//! \brief This function finds a fingerprinted web asset by its URI
 //!
-//! \param[in]  None
+//! \param[in]  pUri              URI, not necessarily NULL terminated
 //!
-//! \return 0 on success or -ve on error
+//! \param[in]  uriLen            URI length
+//!
+//! \return index in gWebAssets[] or -1 if the asset is unknown
 //!
 //****************************************************************************
-void initLinkLocalDB(void)
+int32_t lookupWebAsset(const uint8_t *pUri,
+                       uint16_t uriLen)
 {
-    httpRequest[0].charValues[0].characteristic = "version";
-    httpRequest[0].serviceCallback = otaGetCallback;
-
-    httpRequest[1].charValues[0].characteristic = "filename";
-    httpRequest[1].serviceCallback = otaPutCallback;
-
-    httpRequest[2].charValues[0].characteristic = "redled";
-    httpRequest[2].charValues[0].value[0] = "off";
-    httpRequest[2].charValues[0].value[1] = "on";
-    httpRequest[2].charValues[0].value[2] = "toggle";
-    httpRequest[2].charValues[1].characteristic = "orangeled";
-    httpRequest[2].charValues[1].value[0] = "off";
-    httpRequest[2].charValues[1].value[1] = "on";
-    httpRequest[2].charValues[1].value[2] = "toggle";
-    httpRequest[2].charValues[2].characteristic = "greenled";
-    httpRequest[2].charValues[2].value[0] = "off";
-    httpRequest[2].charValues[2].value[1] = "on";
-    httpRequest[2].charValues[2].value[2] = "toggle";
-    httpRequest[2].serviceCallback = lightGetCallback;
-
-    httpRequest[3].charValues[0].characteristic = "redled";
-    httpRequest[3].charValues[0].value[0] = "off";
-    httpRequest[3].charValues[0].value[1] = "on";
-    httpRequest[3].charValues[0].value[2] = "toggle";
-    httpRequest[3].serviceCallback = lightPostCallback;
-
-    httpRequest[4].charValues[0].characteristic = "axisx";
-    httpRequest[4].charValues[1].characteristic = "axisy";
-    httpRequest[4].charValues[2].characteristic = "axisz";
-    httpRequest[4].charValues[3].characteristic = "temp";
-    httpRequest[4].serviceCallback = sensorGetCallback;
-
-    httpRequest[5].charValues[0].characteristic = "ssid";
-    httpRequest[5].charValues[1].characteristic = "ipaddress";
-    httpRequest[5].charValues[2].characteristic = "macaddress";
-    httpRequest[5].charValues[3].characteristic = "appname";
-    httpRequest[5].serviceCallback = deviceGetCallback;
-
-    httpRequest[6].charValues[0].characteristic = "inTemp";
-    httpRequest[6].charValues[1].characteristic = "outTemp";
-    httpRequest[6].charValues[2].characteristic = "inHumid";
-    httpRequest[6].charValues[3].characteristic = "outHumid";
-    httpRequest[6].charValues[4].characteristic = "inPres";
-    httpRequest[6].charValues[5].characteristic = "outPres";
-    httpRequest[6].charValues[6].characteristic = "oxygen";
-    httpRequest[6].charValues[7].characteristic = "airQuality";
-    httpRequest[6].serviceCallback = environGetCallback;
-
-    httpRequest[7].charValues[0].characteristic = "fans";
-    httpRequest[7].charValues[0].value[0] = "off";
-    httpRequest[7].charValues[0].value[1] = "on";
-    httpRequest[7].charValues[0].value[2] = "toggle";
-    httpRequest[7].charValues[1].characteristic = "lights";
-    httpRequest[7].charValues[1].value[0] = "off";
-    httpRequest[7].charValues[1].value[1] = "on";
-    httpRequest[7].charValues[1].value[2] = "toggle";
-    httpRequest[7].charValues[2].characteristic = "cooling";
-    httpRequest[7].charValues[2].value[0] = "off";
-    httpRequest[7].charValues[2].value[1] = "on";
-    httpRequest[7].charValues[2].value[2] = "toggle";
-    httpRequest[7].charValues[3].characteristic = "goalTemp";
-    httpRequest[7].charValues[4].characteristic = "dataFreq";
-    httpRequest[7].charValues[5].characteristic = "lastDump";
-    httpRequest[7].charValues[6].characteristic = "lastCheckin";
-
-    httpRequest[7].serviceCallback = stateGetCallback;
-
+    int32_t low = 0;
+    int32_t high = WEB_ASSET_NUM - 1;
+    int32_t mid, order;
 
+    /* the generator sorts the manifest like the route table */
+    while(low <= high)
+    {
+        mid = (low + high) >> 1;
 
+        order = HttpLookup_compare(pUri, uriLen, gWebAssets[mid].uri,
+                                   gWebAssets[mid].uriLen);
+        if(order == 0)
+        {
+            return(mid);
+        }
+        else if(order < 0)
+        {
+            high = mid - 1;
+        }
+        else
+        {
+            low = mid + 1;
+        }
+    }
 
+    return(-1);
 }
 
 //*****************************************************************************
 //
-//! \brief This function scan netapp request and parse the payload
+//! \brief This function scan netapp request and parse the payload. The
+//!        phrase is walked once and left untouched, pairs are written to
+//!        argv as TLVs, characteristics and enumerated values by index and
+//!        free values as decoded NULL terminated strings
 //!
 //! \param[in]  requestIdx        request index to indicate the message
 //!
@@ -2517,16 +3910,21 @@ int32_t parseUrlEncoded(uint8_t requestIdx,
                         uint8_t *argcCallback,
                         uint8_t **argvCallback)
 {
-    uint8_t *token;
-    uint8_t characteristic, value, isValueExpected, loopIdx;
-    int32_t status = -1;
-    uint8_t *argvArray;
-    uint8_t remainingLen, actualLen;
+    const uint8_t *pCurr, *pEnd;
+    UrlEncoded_Pair_t pair;
+    uint8_t *pDecoded;
+    uint16_t decodedMax;
+    uint8_t name[HTTP_MAX_CHARACTERISTIC_LEN];
+    uint8_t characteristic, value, loopIdx;
+    int32_t lookupIdx, decodedLen;
+    uint8_t *argvArray, *argvEnd;
     uint16_t elementType;
+    const http_charValuesPair_t *pChar;
 
     argvArray = *argvCallback;
+    argvEnd = *argvCallback + NETAPP_MAX_ARGV_TO_CALLBACK;
     /* it means parameters already exist - fast forward to the end of argv */
-    if(*argcCallback > 0)         
+    if(*argcCallback > 0)
     {
         loopIdx = *argcCallback;
         while(loopIdx > 0)
@@ -2539,174 +3937,126 @@ int32_t parseUrlEncoded(uint8_t requestIdx,
         }
     }
 
-    /* check if values are expected per characteristic   */
-    /* it is a 2 steps procedure:                        */
-    /*     1) check that '=' sign exists                 */
-    /*     2) check that the value is not NULL           */
-    /* if not, return                                    */
-    isValueExpected = 0;
-    token = (uint8_t *)strchr((char *)pPhrase, '=');
-    if(token != NULL)
-    {    /* it means no value supplied */
-        if((*(token + 1) == '&') || (*(token + 1) == '\0'))        
+    pCurr = pPhrase;
+    pEnd = pPhrase + phraseLen;
+
+    /* an embedded NULL ends the phrase as well */
+    while(UrlEncoded_next(&pCurr, pEnd, &pair))
+    {
+        if(0 == pair.nameLen)
+        {
+            if(pair.pValue != NULL)
+            {
+                return(-1);
+            }
+            continue;           /* empty pair, e.g. "a&&b" */
+        }
+
+        /* it means no value supplied */
+        if((pair.pValue != NULL) && (0 == pair.valueLen))
         {
             return(-1);
         }
-        else
+
+        decodedLen = UrlEncoded_decode(pair.pName, pair.nameLen, name,
+                                       sizeof(name));
+        lookupIdx = -1;
+        if(decodedLen > 0)
         {
-            isValueExpected = 1;
+            lookupIdx = lookupCharacteristic(requestIdx, name,
+                                             (uint16_t)decodedLen);
         }
-    }
+        /* it means the characteristics is not valid/known */
+        if(lookupIdx < 0)
+        {
+            return(-1);
+        }
+        characteristic = (uint8_t)lookupIdx;
+        pChar = &httpRequest[requestIdx].charValues[characteristic];
 
-    /* Parse payload list */
-    token = (uint8_t *)strtok((char *)pPhrase, "=&");
+        if((argvEnd - argvArray) < (ARGV_VALUE_OFFSET + 1))
+        {
+            return(-1);
+        }
 
-    if(NULL == token)         /* it means there is no url encoded data */
-    {
-        return(0);
-    }
+        /* found a characteristic. save its index number */
+        (*argcCallback)++;
+        elementType = setElementType(0, requestIdx, characteristic);
+        sl_Memcpy ((uint8_t*)argvArray, (uint8_t*)&elementType,
+                   ARGV_LEN_OFFSET);
+        argvArray += ARGV_LEN_OFFSET;
+        *argvArray++ = 1;        /* length field */
+        *argvArray++ = characteristic;
 
-    while(token && ((pPhrase + phraseLen) > token))
-    {
-        status = -1;
-        characteristic = 0;
-
-        /* run over all possible characteristics, if exist */
-        while(httpRequest[requestIdx].charValues[characteristic].characteristic
-              != NULL)
-        {
-            if(!strncmp((const char *)token,
-                        (const char *)httpRequest[requestIdx].charValues[
-                            characteristic].
-                        characteristic,
-                        strlen((const char *)httpRequest[requestIdx].charValues
-                               [
-                                   characteristic].characteristic)))
-            {
-                status = 0;
+        INFO_PRINT ("[Link local task] characteristic is: %s\n\r",
+                    pChar->characteristic.pName);
 
-                /* found a characteristic. save its index number */
-                (*argcCallback)++;
-                elementType = setElementType(0, requestIdx, characteristic);
-                sl_Memcpy ((uint8_t*)argvArray, (uint8_t*)&elementType,
-                           ARGV_LEN_OFFSET);
-                argvArray += ARGV_LEN_OFFSET;
-                *argvArray++ = 1;        /* length field */
-                *argvArray++ = characteristic;
-                /* remaining length is for cases where the last value is of 
-                string type */
-               remainingLen =(uint8_t)
-                        (phraseLen -(uint8_t)(token -pPhrase) - 
-                        strlen((const char *)token) - 1);
-
-                UART_PRINT (
-                    "[Link local task] characteristic is: %s\n\r",
-                    (int8_t *)httpRequest[requestIdx].
-                    charValues[characteristic].
-                    characteristic);
-                break;
-            }
-            else
-            {
-                characteristic++;
-            }
+        if(NULL == pair.pValue)
+        {
+            continue;
         }
-        /* it means the characteristics is not valid/known */
-        if(-1 == status)         
+
+        if((argvEnd - argvArray) < (ARGV_VALUE_OFFSET + 2))
         {
-            return(status);
+            return(-1);
         }
 
-        token = (uint8_t *)strtok(NULL, "=&");
+        /* decode straight into argv, the length field limits a value to
+           254 characters plus its NULL terminator */
+        pDecoded = argvArray + ARGV_VALUE_OFFSET;
+        decodedMax = (uint16_t)(argvEnd - pDecoded - 1);
+        if(decodedMax > 254)
+        {
+            decodedMax = 254;
+        }
+        decodedLen = UrlEncoded_decode(pair.pValue, pair.valueLen, pDecoded,
+                                       decodedMax);
+        if(decodedLen < 0)
+        {
+            return(-1);
+        }
+        pDecoded[decodedLen] = '\0';
 
-        if(isValueExpected)
+        /* it means any value is OK - keep the string */
+        if(NULL == pChar->value[0])
         {
-            status = -1;
             value = 0;
-
-            if(token != NULL)
+            *(argvArray + ARGV_LEN_OFFSET) = (uint8_t)(decodedLen + 1);
+        }
+        else
+        {
+            /* run over all possible values, if exist */
+            for(value = 0; (value < 5) && (pChar->value[value] != NULL);
+                value++)
             {
-                /* it means any value is OK */
-                if(NULL ==
-                   httpRequest[requestIdx].
-                   charValues[characteristic].value[value])
-                {
-                    status = 0;
-
-                    /* found a string value. copy its content */
-                    (*argcCallback)++;
-                    elementType = setElementType(1, requestIdx, value);
-                    sl_Memcpy ((uint8_t*)argvArray, (uint8_t*)&elementType,
-                               ARGV_LEN_OFFSET);
-                    argvArray += ARGV_LEN_OFFSET;
-                    if(strlen((const char *)token) > remainingLen)
-                    {
-                        actualLen = remainingLen;
-                    }
-                    else
-                    {
-                        actualLen = strlen((const char *)token);
-                    }
-
-                    *argvArray++ = (actualLen + 1);
-                    sl_Memcpy(argvArray, token, actualLen);
-                    argvArray += actualLen;
-                    *argvArray++ = '\0';
-
-                    UART_PRINT ("[Link local task] value is: %s\n\r",
-                                (int8_t *)(argvArray - actualLen - 1));
-                }
-                else
+                if(!strcmp((const char *)pDecoded, pChar->value[value]))
                 {
-                    /* run over all possible values, if exist */
-                    while(httpRequest[requestIdx].charValues[characteristic].
-                          value[value] != NULL)
-                    {
-                        if(!strncmp((const char *)token,
-                                    (const char *)httpRequest[requestIdx].
-                                    charValues[
-                                        characteristic].value[value],
-                                    strlen((const char *)httpRequest[requestIdx
-                                           ].charValues[
-                                               characteristic].value[value])))
-                        {
-                            status = 0;
-
-                            /* found a value. save its index number */
-                            (*argcCallback)++;
-                            elementType = setElementType(1, requestIdx, value);
-                            sl_Memcpy ((uint8_t*)argvArray,
-                                       (uint8_t*)&elementType,
-                                       ARGV_LEN_OFFSET);
-                            argvArray += ARGV_LEN_OFFSET;
-                            *argvArray++ = 1;            /* length field */
-                            *argvArray++ = value;
-
-                            UART_PRINT (
-                                "[Link local task] value is: %s\n\r",
-                                (int8_t *)httpRequest[requestIdx].
-                                charValues[
-                                    characteristic].value[value]);
-
-                            break;
-                        }
-                        else
-                        {
-                            value++;
-                        }
-                    }
-                    /* it means the value is not valid/known */
-                    if(-1 == status)         
-                    {
-                        return(status);
-                    }
+                    break;
                 }
             }
-            token = (uint8_t *)strtok(NULL, (const char *)"=&");
+            /* it means the value is not valid/known */
+            if((value == 5) || (NULL == pChar->value[value]))
+            {
+                return(-1);
+            }
+
+            /* found a value. save its index number */
+            *(argvArray + ARGV_LEN_OFFSET) = 1;
+            *pDecoded = value;
+            decodedLen = 0;
         }
+
+        (*argcCallback)++;
+        elementType = setElementType(1, requestIdx, value);
+        sl_Memcpy ((uint8_t*)argvArray, (uint8_t*)&elementType,
+                   ARGV_LEN_OFFSET);
+        INFO_PRINT ("[Link local task] value is: %s\n\r",
+                    (NULL == pChar->value[0]) ? (char *)pDecoded :
+                    pChar->value[value]);
+        argvArray = pDecoded + decodedLen + 1;
     }
 
-    return(status);
+    return(0);
 }
 
 //*****************************************************************************
@@ -2773,6 +4123,7 @@ int32_t parseHttpRequestMetadata(uint8_t requestType,
     uint16_t len;
     uint32_t value;
     uint8_t *typeText;
+    int32_t routeIdx;
     uint8_t nullTerminator;
     uint8_t *argvArray;
     uint16_t elementType;
@@ -2851,22 +4202,12 @@ int32_t parseHttpRequestMetadata(uint8_t requestType,
             zero out the character counter argument */
             *argcCallback = 0;        
 
-            for(loopIdx = 0; loopIdx < NUMBER_OF_URI_SERVICES; loopIdx++)
+            routeIdx = lookupRoute(pTlv, len, requestType);
+            if(routeIdx >= 0)
             {
-                if((strncmp((const char *)pTlv,
-                            (const char *)httpRequest[loopIdx].service,
-                           strlen((const char *)httpRequest[loopIdx].service)))
-                   == 0)
-                {
-                    if(requestType == httpRequest[loopIdx].httpMethod)
-                    {
-                        status = 0;
-                        *requestIdx = httpRequest[loopIdx].requestIdx;
-                        INFO_PRINT ("%s\n\r", httpRequest[loopIdx].service);
-
-                        break;
-                    }
-                }
+                status = 0;
+                *requestIdx = httpRequest[routeIdx].requestIdx;
+                INFO_PRINT ("%s\n\r", httpRequest[routeIdx].service.pName);
             }
 
             if(status != 0)
@@ -2994,20 +4335,152 @@ int32_t httpCheckContentInDB(SlNetAppRequest_t *netAppRequest,
                                     argcCallback,
                                     argvCallback);
     }
-    UART_PRINT("status is %d\r\n", status);
+
+    INFO_PRINT("[Link local task] parsing status is %d\r\n", status);
     return(status);
 }
 
+//*****************************************************************************
+//
+//! \brief This function serves a fingerprinted web asset from the file
+//!        system, precompressed assets are sent with Content-Encoding gzip
+//!
+//! \param[in] netAppRequest        netapp request structure
+//!
+//! \param[in] pCtx                 worker context holding the request buffers
+//!
+//! \return 0 if the response was sent, negative if the URI is not an asset
+//!
+//****************************************************************************
+int32_t serveWebAsset(SlNetAppRequest_t *netAppRequest,
+                      http_WorkerCtx_t *pCtx)
+{
+    const http_WebAsset_t *pAsset = NULL;
+    uint8_t *pTlv, *pEnd, *pMetadata;
+    uint16_t len, metadataLen;
+    uint32_t offset;
+    int32_t assetIdx, fileHandle, chunkLen;
+    uint32_t flags;
+
+    pTlv = netAppRequest->requestData.pMetadata;
+    pEnd = pTlv + netAppRequest->requestData.MetadataLen;
+    while(((pTlv + 3) <= pEnd) && (pAsset == NULL))
+    {
+        sl_Memcpy((uint8_t *)&len, pTlv + 1, 2);
+        if((pTlv + 3 + len) > pEnd)
+        {
+            break;
+        }
+
+        if(*pTlv == SL_NETAPP_REQUEST_METADATA_TYPE_HTTP_REQUEST_URI)
+        {
+            assetIdx = lookupWebAsset(pTlv + 3, len);
+            if(assetIdx < 0)
+            {
+                return(-1);
+            }
+            pAsset = &gWebAssets[assetIdx];
+        }
+
+        pTlv += 3 + len;
+    }
+
+    if(pAsset == NULL)
+    {
+        return(-1);
+    }
+
+    /* the name carries the content hash, the tag never goes stale */
+    strncpy((char *)pCtx->etag, pAsset->etag, LINKLOCAL_ETAG_LEN - 1);
+    pCtx->etag[LINKLOCAL_ETAG_LEN - 1] = '\0';
+    if(sendNotModified(netAppRequest, pCtx) == 0)
+    {
+        return(0);
+    }
+
+    /* not flashed, answer 404 */
+    fileHandle = sl_FsOpen((unsigned char *)pAsset->uri, SL_FS_READ, NULL);
+    if(fileHandle < 0)
+    {
+        UART_PRINT("[Link local task] web asset %s not found, error=%d\n\r",
+                   pAsset->uri, fileHandle);
+        return(-1);
+    }
+
+    metadataLen = prepareGetMetadata(0, pAsset->size, pAsset->contentType,
+                                     pCtx);
+    if(pAsset->isGzip)
+    {
+        pMetadata = pCtx->metadataBuffer + metadataLen;
+        *pMetadata =
+            (uint8_t) SL_NETAPP_REQUEST_METADATA_TYPE_HTTP_CONTENT_ENCODING;
+        pMetadata++;
+        *(uint16_t *)pMetadata =
+            (uint16_t) (sizeof(WEB_CONTENT_ENCODING_GZIP) - 1);
+        pMetadata += 2;
+        sl_Memcpy (pMetadata, WEB_CONTENT_ENCODING_GZIP,
+                   sizeof(WEB_CONTENT_ENCODING_GZIP) - 1);
+
+        metadataLen += 3 + sizeof(WEB_CONTENT_ENCODING_GZIP) - 1;
+    }
+
+    sl_NetAppSend (netAppRequest->Handle, metadataLen, pCtx->metadataBuffer,
+                   (SL_NETAPP_REQUEST_RESPONSE_FLAGS_CONTINUATION |
+                    SL_NETAPP_REQUEST_RESPONSE_FLAGS_METADATA));
+
+    offset = 0;
+    chunkLen = 0;
+    while(offset < pAsset->size)
+    {
+        chunkLen = pAsset->size - offset;
+        if(chunkLen > NETAPP_MAX_RX_FRAGMENT_LEN)
+        {
+            chunkLen = NETAPP_MAX_RX_FRAGMENT_LEN;
+        }
+
+        chunkLen = sl_FsRead(fileHandle, offset, pCtx->payloadBuffer,
+                             chunkLen);
+        if(chunkLen <= 0)
+        {
+            UART_PRINT("[Link local task] web asset %s read error=%d\n\r",
+                       pAsset->uri, chunkLen);
+            break;
+        }
+
+        offset += chunkLen;
+        /* the last segment closes the response */
+        flags = (offset < pAsset->size) ?
+                SL_NETAPP_REQUEST_RESPONSE_FLAGS_CONTINUATION : 0;
+        sl_NetAppSend (netAppRequest->Handle, chunkLen, pCtx->payloadBuffer,
+                       flags);
+    }
+
+    /* a short file still has to end the response */
+    if(offset < pAsset->size)
+    {
+        sl_NetAppSend (netAppRequest->Handle, 0, pCtx->payloadBuffer, 0);
+    }
+
+    sl_FsClose(fileHandle, NULL, NULL, 0);
+    INFO_PRINT("[Link local task] web asset %s sent, len = %d\n\r",
+               pAsset->uri, offset);
+
+    return(0);
+}
+
 //*****************************************************************************
 //
 //! \brief This function parse and execute HTTP GET requests
 //!
 //! \param[in] netAppRequest        netapp request structure
 //!
+//! \param[in] pCtx                 worker context holding the request buffers
+//!
 //! \return None
 //!
 //****************************************************************************
-void httpGetHandler(SlNetAppRequest_t *netAppRequest)
+void httpGetHandler(SlNetAppRequest_t *netAppRequest,
+http_WorkerCtx_t *pCtx)
 {
     uint16_t metadataLen;
     int32_t status;
@@ -3017,19 +4490,32 @@ void httpGetHandler(SlNetAppRequest_t *netAppRequest)
     uint8_t     *argvArray;
     uint8_t     **argvCallback = &argvArray;
 
-    argvArray = gHttpGetBuffer;
+    argvArray = pCtx->argvBuffer;
+    /* only callbacks serving versioned data set an entity tag */
+    pCtx->etag[0] = '\0';
 
     status = httpCheckContentInDB(netAppRequest, &requestIdx, &argcCallback,
                                   argvCallback);
 
+    if((status == 0) && (httpRequest[requestIdx].serviceCallback == NULL))
+    {
+        status = -1;
+    }
+
+    /* not a service, may be a fingerprinted asset outside /www */
+    if((status < 0) && (serveWebAsset(netAppRequest, pCtx) == 0))
+    {
+        return;
+    }
+
     if(status < 0)
     {
         metadataLen =
             prepareGetMetadata(status, strlen (
                                    (const char *)pageNotFound),
-                               HttpContentTypeList_TextHtml);
+                               HttpContentTypeList_TextHtml, pCtx);
 
-        sl_NetAppSend (netAppRequest->Handle, metadataLen, gMetadataBuffer,
+        sl_NetAppSend (netAppRequest->Handle, metadataLen, pCtx->metadataBuffer,
                        (SL_NETAPP_REQUEST_RESPONSE_FLAGS_CONTINUATION |
                         SL_NETAPP_REQUEST_RESPONSE_FLAGS_METADATA));
         INFO_PRINT("[Link local task] Metadata Sent, len = %d \n\r",
@@ -3046,7 +4532,7 @@ void httpGetHandler(SlNetAppRequest_t *netAppRequest)
     {
         httpRequest[requestIdx].serviceCallback(requestIdx, &argcCallback,
                                                 argvCallback,
-                                                netAppRequest);
+                                                netAppRequest, pCtx);
     }
 }
 
@@ -3056,10 +4542,13 @@ void httpGetHandler(SlNetAppRequest_t *netAppRequest)
 //!
 //! \param[in] netAppRequest        netapp request structure
 //!
+//! \param[in] pCtx                 worker context holding the request buffers
+//!
 //! \return None
 //!
 //****************************************************************************
-void httpPostHandler(SlNetAppRequest_t *netAppRequest)
+void httpPostHandler(SlNetAppRequest_t *netAppRequest,
+http_WorkerCtx_t *pCtx)
 {
     uint16_t metadataLen;
     int32_t status;
@@ -3069,23 +4558,28 @@ void httpPostHandler(SlNetAppRequest_t *netAppRequest)
     uint8_t     *argvArray;
     uint8_t     **argvCallback = &argvArray;
 
-    argvArray = gHttpPostBuffer;
+    argvArray = pCtx->argvBuffer;
 
     status = httpCheckContentInDB(netAppRequest,&requestIdx,&argcCallback,
                                   argvCallback);
 
+    if((status == 0) && (httpRequest[requestIdx].serviceCallback == NULL))
+    {
+        status = -1;
+    }
+
     if(status < 0)
     {
-        metadataLen = preparePostMetadata(status);
+        metadataLen = preparePostMetadata(status, pCtx);
 
-        sl_NetAppSend (netAppRequest->Handle, metadataLen, gMetadataBuffer,
+        sl_NetAppSend (netAppRequest->Handle, metadataLen, pCtx->metadataBuffer,
                        SL_NETAPP_REQUEST_RESPONSE_FLAGS_METADATA);
     }
     else
     {
         httpRequest[requestIdx].serviceCallback(requestIdx, &argcCallback,
                                                 argvCallback,
-                                                netAppRequest);
+                                                netAppRequest, pCtx);
     }
 }
 
@@ -3161,74 +4655,111 @@ void * linkLocalTask(void *pvParameters)
 
 
     mq_attr attr;
-    int32_t msgqRetVal;
-    I2C_Params i2cParams;
+    pthread_attr_t pAttrs;
+    struct sched_param priParam;
+    int32_t retVal;
+    uint8_t workerIdx;
 
 
-    /* initializes I2C */
-    I2C_Params_init(&i2cParams);
-    i2cParams.bitRate = I2C_400kHz;
-    i2cHandle = I2C_open(Board_I2C0, &i2cParams);
-    if(i2cHandle == NULL)
+    /* initializes mailboxes for http messages */
+    attr.mq_maxmsg = LINKLOCAL_REQUEST_SLOT_NUM;         /* queue size */
+    attr.mq_msgsize = sizeof(SlNetAppRequest_t*);        /* Size of message */
+    linkLocalMQueue = mq_open("linklocal msg q", O_CREAT, 0, &attr);
+    if(linkLocalMQueue == NULL)
     {
-        UART_PRINT("[Link local task] Error Initializing I2C\n\r");
-    }
-    BME280_init(i2cHandle, BOSCH_SENSORTEC_BME280_I2CSLAVE_DEFAULT);
-    if (!BME280_open()) {
-        UART_PRINT( "ERROR opening BME280_open()\r\n" );
-    } else {
-        UART_PRINT( "BME280 opened; polling every 500ms\r\n" );
+        UART_PRINT("[Link local task] could not create msg queue\n\r");
+        while(1)
+        {
+            ;
+        }
     }
 
-    sensor = ccs811_init_sensor(i2cHandle, CCS811_I2C_ADDRESS_1);
-    if(!sensor){
-        UART_PRINT( "ERROR initializing CCS811\r\n" );
+    attr.mq_maxmsg = 2;          /* one upload at a time, plus a retry */
+    linkLocalOtaMQueue = mq_open("linklocal ota msg q", O_CREAT, 0, &attr);
+    if(linkLocalOtaMQueue == NULL)
+    {
+        UART_PRINT("[Link local task] could not create ota msg queue\n\r");
+        while(1)
+        {
+            ;
+        }
     }
-    ccs811_set_mode (sensor, ccs811_mode_10s);
 
-    ADC_Params params;
-    ADC_Params_init(&params);
-    oxygenSensor = ADC_open(Board_ADC0, &params);
-    if (oxygenSensor == NULL) {
-        UART_PRINT( "Error opening ADC" );
-     // Error initializing ADC channel 0
+    pthread_mutex_init(&gRequestPoolLockObj, (pthread_mutexattr_t*)NULL);
 
+    if(initLinkLocalDB() < 0)
+    {
+        UART_PRINT("[Link local task] lookup tables are not sorted, "
+                   "falling back to scanning them\n\r");
     }
-    //UART_PRINT("kill me %d      %d\r\n",ADC_convert(oxygenSensor,&oxygenRAW),oxygenRAW);
-
-
 
+    /* waits for valid local connection - via provisioning task  */
 
-    /* Setup mutex operations for sensors reading */
-    sensorLockObj = malloc(sizeof(pthread_mutex_t));
-    pthread_mutex_init(sensorLockObj, (pthread_mutexattr_t*)NULL);
+    sem_wait(&Provisioning_ControlBlock.provisioningDoneSignal);
 
+    initEntityTagNonce();
 
-    /* initializes mailbox for http messages */
-    attr.mq_maxmsg = 10;         /* queue size */
-    attr.mq_msgsize = sizeof(SlNetAppRequest_t*);        /* Size of message */
-    linkLocalMQueue = mq_open("linklocal msg q", O_CREAT, 0, &attr);
-    if(linkLocalMQueue == NULL)
+    /* this task serves as worker 0, spawn the other general workers and
+       the long-running lane */
+    for(workerIdx = 0; workerIdx <= LINKLOCAL_WORKER_NUM; workerIdx++)
     {
-        UART_PRINT("[Link local task] could not create msg queue\n\r");
-        while(1)
+        gWorkerCtx[workerIdx].workerIdx = workerIdx;
+        if(workerIdx == 0)
         {
-            ;
+            continue;
+        }
+
+        pthread_attr_init(&pAttrs);
+        priParam.sched_priority = 1;
+        retVal = pthread_attr_setschedparam(&pAttrs, &priParam);
+        retVal |= pthread_attr_setstacksize(&pAttrs, LINKLOCAL_STACK_SIZE);
+        retVal |= pthread_create(&gLinklocalWorkerThread[workerIdx], &pAttrs,
+                                 linkLocalWorkerTask, &gWorkerCtx[workerIdx]);
+        if(retVal)
+        {
+            UART_PRINT("[Link local task] Unable to create worker %d\n\r",
+                       workerIdx);
+            while(1)
+            {
+                ;
+            }
         }
     }
 
-    initLinkLocalDB();
+    return(linkLocalWorkerTask(&gWorkerCtx[0]));
+}
 
-    /* waits for valid local connection - via provisioning task  */
+//*****************************************************************************
+//
+//! \brief This task serves LinkLocal requests from one of the request queues
+//!        using the buffers of its own worker context
+//!
+//! \param[in]  pvParameters      worker context (http_WorkerCtx_t)
+//!
+//! \return None
+//!
+//****************************************************************************
+void * linkLocalWorkerTask(void *pvParameters)
+{
+    http_WorkerCtx_t *pCtx = (http_WorkerCtx_t *)pvParameters;
+    mqd_t requestQueue;
+    int32_t msgqRetVal;
 
-    sem_wait(&Provisioning_ControlBlock.provisioningDoneSignal);
+    if(pCtx->workerIdx == LINKLOCAL_OTA_WORKER_IDX)
+    {
+        requestQueue = linkLocalOtaMQueue;
+    }
+    else
+    {
+        requestQueue = linkLocalMQueue;
+    }
 
     while(1)
     {
         SlNetAppRequest_t *netAppRequest;
 
         msgqRetVal =
-            mq_receive(linkLocalMQueue, (char *)&netAppRequest,
+            mq_receive(requestQueue, (char *)&netAppRequest,
                        sizeof(SlNetAppRequest_t*), NULL);
         if(msgqRetVal < 0)
         {
@@ -3242,8 +4773,8 @@ void * linkLocalTask(void *pvParameters)
         }
 
         INFO_PRINT(
-            "[Link local task] NetApp Request Received - handle from main "
-            "context AppId = %d, Type = %d, Handle = %d\n\r",
+            "[Link local task] NetApp Request Received - worker %d "
+            "AppId = %d, Type = %d, Handle = %d\n\r", pCtx->workerIdx,
             netAppRequest->AppId, netAppRequest->Type, netAppRequest->Handle);
 
         INFO_PRINT("[Link local task] Metadata len = %d\n\r",
@@ -3261,7 +4792,7 @@ void * linkLocalTask(void *pvParameters)
                 UART_PRINT("[Link local task] HTTP DELETE Request\n\r");
             }
 
-            httpGetHandler(netAppRequest);
+            httpGetHandler(netAppRequest, pCtx);
         }
         else if((netAppRequest->Type == SL_NETAPP_REQUEST_HTTP_POST) ||
                 (netAppRequest->Type == SL_NETAPP_REQUEST_HTTP_PUT))
@@ -3280,23 +4811,9 @@ void * linkLocalTask(void *pvParameters)
                 netAppRequest->requestData.PayloadLen,
                 netAppRequest->requestData.Flags);
 
-            httpPostHandler(netAppRequest);
-        }
-
-        if(netAppRequest->requestData.MetadataLen > 0)
-        {
-            free (netAppRequest->requestData.pMetadata);
+            httpPostHandler(netAppRequest, pCtx);
         }
-        if(netAppRequest->requestData.PayloadLen > 0)
-        {
-            free (netAppRequest->requestData.pPayload);
-        }
-
-        free (netAppRequest);
-        ccs811Reading();
-        oxySensorReading();
-        UART_PRINT( "eco2 = %d ppm and oxy concentration: %d.%.3d%%    \r\n", airQuality, (oxygen/1000),(oxygen%1000) );
-
 
+        requestSlotFree(netAppRequest);
     }
 }
@@ -40,6 +40,9 @@
 #include <mqueue.h>
 #include <semaphore.h>
 
+#include "sensor_snapshot.h"
+#include "http_lookup.h"
+
 #define OOB_IS_NETAPP_MORE_DATA(flags)              ((flags & \
                                                       SL_NETAPP_REQUEST_RESPONSE_FLAGS_CONTINUATION) \
                                                      == \
@@ -148,11 +151,25 @@ typedef enum
 
 #define CONTENT_LEN_TYPE    0xFF
 
+#define NETAPP_MAX_RX_FRAGMENT_LEN     SL_NETAPP_REQUEST_MAX_DATA_LEN
+#define NETAPP_MAX_METADATA_LEN        (100)
+#define NETAPP_MAX_ARGV_TO_CALLBACK    SL_FS_MAX_FILE_NAME_LENGTH + 50
+/* room for the URI and a query string carrying a file name */
+#define LINKLOCAL_SLOT_METADATA_LEN    (NETAPP_MAX_METADATA_LEN + \
+                                        SL_FS_MAX_FILE_NAME_LENGTH)
+
+/* longest formatted /state value, e.g. "toggle" or "hh:mm" */
+#define STATE_VALUE_STR_LEN            (10)
+
 /* offsets of TLV structure of parameters parsed in NetApp request */
 #define ARGV_TYPE_OFFSET     0
 #define ARGV_LEN_OFFSET      2
 #define ARGV_VALUE_OFFSET    3
 
+/* expands a string literal to its pointer and its length, so the tables
+   below carry precomputed lengths */
+#define HTTP_STR(str)        (str), (sizeof(str) - 1)
+
 typedef struct    _http_headerFieldType_t_
 {
     SlNetAppMetadataHTTPTypes_e headerType;
@@ -163,27 +180,81 @@ typedef struct    _http_contentTypeMapping_t_
 {
     HttpContentTypeList contentType;
     char *contentTypeText;
+    uint8_t contentTypeLen;
     char *mimeExt;
 }http_contentTypeMapping_t;
 
 typedef struct    _http_charValuesPair_t_
 {
-    char    *characteristic;
+    HttpLookup_Key_t characteristic;    /* first, HttpLookup_find() reads it */
     char    *value[5];
 }http_charValuesPair_t;
 
+/* quoted entity tag, boot nonce, snapshot sequence and state tag, e.g.
+   "9e3779b9-4294967295.ffffffff" */
+#define LINKLOCAL_ETAG_LEN             (32)
+
+/* per worker buffers - every request worker owns one, so requests can be
+   served concurrently */
+typedef struct    _http_WorkerCtx_t_
+{
+    uint8_t workerIdx;
+    /* entity tag of the response being served, empty if it has none */
+    uint8_t etag[LINKLOCAL_ETAG_LEN];
+    uint8_t metadataBuffer[NETAPP_MAX_METADATA_LEN];
+    uint8_t payloadBuffer[NETAPP_MAX_RX_FRAGMENT_LEN];
+    uint8_t argvBuffer[NETAPP_MAX_ARGV_TO_CALLBACK];
+}http_WorkerCtx_t;
+
+/* statically allocated copy of a netapp request. the slot pool replaces
+   the per request mallocs in the netapp event handler */
+typedef struct    _http_RequestSlot_t_
+{
+    SlNetAppRequest_t request;      /* must be first, workers get its address */
+    uint8_t inUse;
+    /* only the TLVs the parser needs are kept, plus a NULL terminator */
+    uint8_t metadata[LINKLOCAL_SLOT_METADATA_LEN + 1];
+    uint8_t payload[NETAPP_MAX_RX_FRAGMENT_LEN + 1];
+}http_RequestSlot_t;
+
+/* request slot pool usage, kept for debugging the backpressure */
+typedef struct    _http_RequestPoolStats_t_
+{
+    uint16_t inUse;
+    uint16_t highWater;
+    uint32_t exhausted;         /* rejected, no free slot */
+    uint32_t queueFull;         /* rejected, worker queue full */
+    uint32_t oversize;          /* rejected, metadata larger than a slot */
+}http_RequestPoolStats_t;
+
 typedef struct    _http_RequestObj_t_
 {
+    /* URI and HTTP method, first, HttpLookup_find() reads it */
+    HttpLookup_Key_t service;
     uint8_t requestIdx;
-    uint8_t httpMethod;
-    char                      *service;
+    /* charValues indices sorted by length then bytes, for binary search */
+    const uint8_t             *charOrder;
+    uint8_t charNum;
     http_charValuesPair_t charValues[10];
     int32_t (*serviceCallback)(uint8_t,
                                uint8_t *,
                                uint8_t **,
-                               SlNetAppRequest_t *);
+                               SlNetAppRequest_t *,
+                               http_WorkerCtx_t *);
 }http_RequestObj_t;
 
+/* fingerprinted web asset, generated into web_manifest.h by
+   WebFiles/build_assets.py. the file is stored under its uri */
+typedef struct    _http_WebAsset_t_
+{
+    char                      *uri;
+    uint8_t uriLen;
+    HttpContentTypeList contentType;
+    uint8_t isGzip;             /* stored gzip precompressed */
+    uint32_t size;              /* stored size */
+    char                      *etag;
+}http_WebAsset_t;
+
 typedef enum
 {
     LedIdx_RedLed,
@@ -235,6 +306,41 @@ typedef enum
 
 }StateIdx;
 
+/* settings accepted by POST /state */
+typedef enum
+{
+    StatePostIdx_bmeProfile,
+    StatePostIdx_o2Cal,
+    StatePostIdx_MaxStatePost,
+
+}StatePostIdx;
+
+typedef enum
+{
+    AccelIdx_since,
+    AccelIdx_count,
+    AccelIdx_MaxAccel,
+
+}AccelIdx;
+
+typedef enum
+{
+    HistoryIdx_tier,
+    HistoryIdx_since,
+    HistoryIdx_count,
+    HistoryIdx_MaxHistory,
+
+}HistoryIdx;
+
+typedef enum
+{
+    LogIdx_format,
+    LogIdx_from,
+    LogIdx_to,
+    LogIdx_MaxLog,
+
+}LogIdx;
+
 
 typedef enum
 {
@@ -278,6 +384,33 @@ extern LinkLocal_CB LinkLocal_ControlBlock;
 //****************************************************************************
 uint32_t getDeviceType();
 
+//*****************************************************************************
+//
+//! \brief This function formats the readings and actuator states url-encoded,
+//!        as served by /api/snapshot
+//!
+//! \param[in]  pSnapshot         readings to format
+//!
+//! \param[in]  pPrev             readings already reported, only the fields
+//!                               that changed since are formatted. NULL
+//!                               formats every field
+//!
+//! \param[in,out] pStateCache    state values already reported, updated with
+//!                               the formatted ones. NULL formats every state
+//!
+//! \param[out] pPayload          destination buffer
+//!
+//! \param[in]  payloadLen        size of the destination buffer
+//!
+//! \return length of the formatted payload
+//!
+//****************************************************************************
+int32_t formatSnapshotFields(SensorSnapshot_t *pSnapshot,
+                             SensorSnapshot_t *pPrev,
+                             uint8_t (*pStateCache)[STATE_VALUE_STR_LEN],
+                             uint8_t *pPayload,
+                             uint16_t payloadLen);
+
 //*****************************************************************************
 //
 //! \brief This task handles LinkLocal transactions with the client
@@ -0,0 +1,461 @@
+/*
+ * live_task.c
+ *
+ *  Server-Sent Events stream of the sensor snapshot. A single pass over each
+ *  new snapshot formats the changed fields once and the same event is sent
+ *  to every connected dashboard. A dashboard that could not take an event
+ *  is resynchronized with every field on the next pass.
+ */
+
+//*****************************************************************************
+//
+//! \addtogroup out_of_box
+//! @{
+//
+//*****************************************************************************
+
+/* standard includes */
+#include <stdlib.h>
+#include <string.h>
+
+/* POSIX Header files */
+#include <unistd.h>
+
+/* TI-DRIVERS Header files */
+#include <Board.h>
+#include <uart_term.h>
+
+/* Example/Board Header files */
+#include "live_task.h"
+#include "link_local_task.h"
+#include "provisioning_task.h"
+#include "out_of_box.h"
+#include "sensor_snapshot.h"
+#include "sensor_task.h"
+
+#define LIVE_POLL_TIMEOUT            (100)       /* in mSec */
+#define LIVE_NB_TIMEOUT              (10)        /* in mSec */
+#define LIVE_SEND_TRIALS             (10)
+#define LIVE_HEARTBEAT_TIMEOUT       (15000)     /* in mSec */
+#define LIVE_RESTART_TIMEOUT         (1000)      /* in mSec */
+#define LIVE_EVENT_LEN               (512)
+
+typedef struct
+{
+    int16_t sock;               /* -1 when the slot is free */
+    uint8_t needsFull;          /* missed an event, send every field */
+}LiveClient_t;
+
+/****************************************************************************
+                      GLOBAL VARIABLES
+****************************************************************************/
+const char gLiveHeader[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/event-stream\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Connection: keep-alive\r\n"
+    "Access-Control-Allow-Origin: *\r\n\r\n"
+    "retry: 5000\n\n";
+const char gLiveBusy[] =
+    "HTTP/1.1 503 Service Unavailable\r\n"
+    "Access-Control-Allow-Origin: *\r\n"
+    "Content-Length: 0\r\n\r\n";
+const char gLiveHeartbeat[] = ": ping\n\n";
+
+LiveClient_t gLiveClients[LIVE_MAX_CLIENTS];
+uint8_t gLiveEvent[LIVE_EVENT_LEN];
+uint8_t gLiveRecvBuf[64];
+
+/* last snapshot and state values streamed to the clients in sync */
+SensorSnapshot_t gLiveLastSnapshot;
+uint8_t gLiveStateCache[StateIdx_MaxState][STATE_VALUE_STR_LEN];
+
+//****************************************************************************
+//                      LOCAL FUNCTIONS
+//****************************************************************************
+
+//*****************************************************************************
+//
+//! \brief This function sends a buffer to a non-blocking client socket
+//!
+//! \param[in]  sock              client socket
+//!
+//! \param[in]  pBuf              data to send
+//!
+//! \param[in]  len               data length
+//!
+//! \return 0 on success, 1 if nothing could be sent, negative if the
+//!         connection is broken
+//!
+//****************************************************************************
+static int32_t liveSend(int16_t sock,
+                        const uint8_t *pBuf,
+                        uint16_t len)
+{
+    uint16_t sent = 0;
+    uint8_t trials = 0;
+    int32_t status;
+
+    while(sent < len)
+    {
+        status = sl_Send(sock, pBuf + sent, len - sent, 0);
+        if(status == SL_ERROR_BSD_EAGAIN)
+        {
+            if(++trials > LIVE_SEND_TRIALS)
+            {
+                /* an event cut in half cannot be recovered */
+                return((sent == 0) ? 1 : -1);
+            }
+            usleep(LIVE_NB_TIMEOUT * 1000);
+        }
+        else if(status < 0)
+        {
+            return(status);
+        }
+        else
+        {
+            sent += status;
+            trials = 0;
+        }
+    }
+
+    return(0);
+}
+
+//*****************************************************************************
+//
+//! \brief This function closes a client and frees its slot
+//!
+//! \param[in]  pClient           client to close
+//!
+//! \return None
+//!
+//****************************************************************************
+static void liveClose(LiveClient_t *pClient)
+{
+    sl_Close(pClient->sock);
+    pClient->sock = -1;
+    INFO_PRINT("[live task] client closed \n\r");
+}
+
+//*****************************************************************************
+//
+//! \brief This function sends an event to a client, closing it on error
+//!
+//! \param[in]  pClient           destination client
+//!
+//! \param[in]  pBuf              event to send
+//!
+//! \param[in]  len               event length
+//!
+//! \return 0 on success else failure
+//!
+//****************************************************************************
+static int32_t liveSendEvent(LiveClient_t *pClient,
+                             const uint8_t *pBuf,
+                             uint16_t len)
+{
+    int32_t status;
+
+    status = liveSend(pClient->sock, pBuf, len);
+    if(status < 0)
+    {
+        liveClose(pClient);
+    }
+    else if(status > 0)
+    {
+        /* client is lagging, resend every field once it drains */
+        pClient->needsFull = 1;
+    }
+
+    return(status);
+}
+
+//*****************************************************************************
+//
+//! \brief This function formats a snapshot as an event
+//!
+//! \param[in]  pSnapshot         readings to stream
+//!
+//! \param[in]  pPrev             readings already streamed, NULL for all
+//!
+//! \param[in,out] pStateCache    state values already streamed, NULL for all
+//!
+//! \return event length
+//!
+//****************************************************************************
+static uint16_t liveBuildEvent(SensorSnapshot_t *pSnapshot,
+                               SensorSnapshot_t *pPrev,
+                               uint8_t (*pStateCache)[STATE_VALUE_STR_LEN])
+{
+    int32_t fieldsLen;
+    uint16_t len;
+
+    memcpy(gLiveEvent, "data: ", 6);
+    len = 6;
+    fieldsLen = formatSnapshotFields(pSnapshot, pPrev, pStateCache,
+                                     gLiveEvent + len, LIVE_EVENT_LEN - len - 2);
+    /* an empty event is still a valid keepalive */
+    if(fieldsLen > 0)
+    {
+        len += fieldsLen;
+    }
+    gLiveEvent[len++] = '\n';
+    gLiveEvent[len++] = '\n';
+
+    return(len);
+}
+
+//*****************************************************************************
+//
+//! \brief This function takes a new connection, answering the stream header
+//!        or busy if all the client slots are taken
+//!
+//! \param[in]  sock              accepted socket
+//!
+//! \return None
+//!
+//****************************************************************************
+static void liveAddClient(int16_t sock)
+{
+    int32_t nonBlocking = 1;
+    uint8_t idx;
+
+    sl_SetSockOpt(sock, SL_SOL_SOCKET, SL_SO_NONBLOCKING, &nonBlocking,
+                  sizeof(nonBlocking));
+
+    for(idx = 0; idx < LIVE_MAX_CLIENTS; idx++)
+    {
+        if(gLiveClients[idx].sock < 0)
+        {
+            break;
+        }
+    }
+
+    if(idx == LIVE_MAX_CLIENTS)
+    {
+        /* the dashboard falls back to polling */
+        liveSend(sock, (const uint8_t *)gLiveBusy, sizeof(gLiveBusy) - 1);
+        sl_Close(sock);
+        UART_PRINT("[live task] no free client slot \n\r");
+        return;
+    }
+
+    if(liveSend(sock, (const uint8_t *)gLiveHeader,
+                sizeof(gLiveHeader) - 1) != 0)
+    {
+        sl_Close(sock);
+        return;
+    }
+
+    gLiveClients[idx].sock = sock;
+    gLiveClients[idx].needsFull = 1;
+    INFO_PRINT("[live task] client %d connected \n\r", idx);
+}
+
+//****************************************************************************
+//                            MAIN FUNCTION
+//****************************************************************************
+
+//*****************************************************************************
+//
+//! \brief This task streams snapshot changes to the connected dashboards
+//!
+//! \param[in]  None
+//!
+//! \return None
+//!
+//****************************************************************************
+void * liveTask(void *pvParameter)
+{
+    int16_t sock;
+    int16_t newsock;
+    int16_t addrSize;
+    int32_t status;
+    int32_t nonBlocking;
+    uint32_t sequence, lastSequence;
+    uint32_t idleTime;
+    uint16_t eventLen;
+    uint8_t idx;
+
+    SensorSnapshot_t snapshot;
+    SlSockAddrIn_t sAddr;
+    SlSockAddrIn_t sLocalAddr;
+
+    for(idx = 0; idx < LIVE_MAX_CLIENTS; idx++)
+    {
+        gLiveClients[idx].sock = -1;
+    }
+
+    /* waits for valid local connection - via provisioning task  */
+    sem_wait(&Provisioning_ControlBlock.provisioningConnDoneToLiveServerSignal);
+
+live_task_restart:
+    /* filling the TCP server socket address */
+    sLocalAddr.sin_family = SL_AF_INET;
+    sLocalAddr.sin_port = sl_Htons((uint16_t)LIVE_SERVER_PORT);
+    sLocalAddr.sin_addr.s_addr = SL_INADDR_ANY;
+
+    addrSize = sizeof(SlSockAddrIn_t);
+
+    sock = sl_Socket(sLocalAddr.sin_family, SL_SOCK_STREAM, 0);
+    if(sock < 0)
+    {
+        UART_PRINT("[live task] Error openning socket, %d \n\r", sock);
+        usleep(LIVE_RESTART_TIMEOUT * 1000);
+        goto live_task_restart;
+    }
+
+    status = sl_Bind(sock, (SlSockAddr_t *)&sLocalAddr, addrSize);
+    if(status < 0)
+    {
+        UART_PRINT("[live task] Error binding socket, error %d \n\r", status);
+        sl_Close(sock);
+        usleep(LIVE_RESTART_TIMEOUT * 1000);
+        goto live_task_restart;
+    }
+
+    status = sl_Listen(sock, 0);
+    if(status < 0)
+    {
+        UART_PRINT("[live task] Error listening on socket, error %d \n\r",
+                   status);
+        sl_Close(sock);
+        usleep(LIVE_RESTART_TIMEOUT * 1000);
+        goto live_task_restart;
+    }
+
+    nonBlocking = 1;
+    status = sl_SetSockOpt(sock, SL_SOL_SOCKET, SL_SO_NONBLOCKING, &nonBlocking,
+                           sizeof(nonBlocking));
+    if(status < 0)
+    {
+        UART_PRINT("[live task] Error setting socket as non-blocking, "
+                   "error %d \n\r", status);
+        sl_Close(sock);
+        usleep(LIVE_RESTART_TIMEOUT * 1000);
+        goto live_task_restart;
+    }
+
+    lastSequence = 0;
+    idleTime = 0;
+
+    while(1)
+    {
+        /* take new dashboards */
+        newsock = sl_Accept(sock, (SlSockAddr_t *)&sAddr,
+                            (SlSocklen_t *)&addrSize);
+        if(newsock >= 0)
+        {
+            liveAddClient(newsock);
+        }
+        else if((newsock == SL_RET_CODE_DEV_LOCKED) ||
+                (newsock == SL_API_ABORTED))
+        {
+            /* the network processor went away, start over */
+            for(idx = 0; idx < LIVE_MAX_CLIENTS; idx++)
+            {
+                if(gLiveClients[idx].sock >= 0)
+                {
+                    liveClose(&gLiveClients[idx]);
+                }
+            }
+            sl_Close(sock);
+            usleep(LIVE_RESTART_TIMEOUT * 1000);
+            goto live_task_restart;
+        }
+
+        /* drain whatever the clients send, and drop the ones that left */
+        for(idx = 0; idx < LIVE_MAX_CLIENTS; idx++)
+        {
+            if(gLiveClients[idx].sock < 0)
+            {
+                continue;
+            }
+            status = sl_Recv(gLiveClients[idx].sock, gLiveRecvBuf,
+                             sizeof(gLiveRecvBuf), 0);
+            if((status == 0) ||
+               ((status < 0) && (status != SL_ERROR_BSD_EAGAIN)))
+            {
+                liveClose(&gLiveClients[idx]);
+            }
+        }
+
+        /* a connected dashboard keeps the accelerometer sampled */
+        for(idx = 0; idx < LIVE_MAX_CLIENTS; idx++)
+        {
+            if(gLiveClients[idx].sock >= 0)
+            {
+                SensorTask_demand(SnapshotSensor_Accel);
+                break;
+            }
+        }
+
+        /* one formatting pass per new snapshot, whatever the client count */
+        sequence = SensorSnapshot_read(&snapshot);
+        if((sequence != 0) && (sequence != lastSequence))
+        {
+            eventLen = liveBuildEvent(&snapshot,
+                                      (lastSequence != 0) ?
+                                      &gLiveLastSnapshot : NULL,
+                                      gLiveStateCache);
+            for(idx = 0; idx < LIVE_MAX_CLIENTS; idx++)
+            {
+                if((gLiveClients[idx].sock >= 0) &&
+                   ((lastSequence == 0) || !gLiveClients[idx].needsFull))
+                {
+                    if(liveSendEvent(&gLiveClients[idx], gLiveEvent,
+                                     eventLen) == 0)
+                    {
+                        gLiveClients[idx].needsFull = 0;
+                    }
+                }
+            }
+
+            memcpy(&gLiveLastSnapshot, &snapshot, sizeof(SensorSnapshot_t));
+            lastSequence = sequence;
+            idleTime = 0;
+        }
+
+        /* new or lagging clients get every field of the last snapshot */
+        if(lastSequence != 0)
+        {
+            eventLen = 0;
+            for(idx = 0; idx < LIVE_MAX_CLIENTS; idx++)
+            {
+                if((gLiveClients[idx].sock >= 0) &&
+                   gLiveClients[idx].needsFull)
+                {
+                    if(eventLen == 0)
+                    {
+                        eventLen = liveBuildEvent(&gLiveLastSnapshot, NULL,
+                                                  NULL);
+                    }
+                    if(liveSendEvent(&gLiveClients[idx], gLiveEvent,
+                                     eventLen) == 0)
+                    {
+                        gLiveClients[idx].needsFull = 0;
+                    }
+                }
+            }
+        }
+
+        /* comment line keeps proxies open and detects dead clients */
+        idleTime += LIVE_POLL_TIMEOUT;
+        if(idleTime >= LIVE_HEARTBEAT_TIMEOUT)
+        {
+            for(idx = 0; idx < LIVE_MAX_CLIENTS; idx++)
+            {
+                if(gLiveClients[idx].sock >= 0)
+                {
+                    liveSendEvent(&gLiveClients[idx],
+                                  (const uint8_t *)gLiveHeartbeat,
+                                  sizeof(gLiveHeartbeat) - 1);
+                }
+            }
+            idleTime = 0;
+        }
+
+        usleep(LIVE_POLL_TIMEOUT * 1000);
+    }
+}
@@ -0,0 +1,27 @@
+/*
+ * live_task.h
+ *
+ *  Server-Sent Events stream of the sensor snapshot. Browsers keep one
+ *  connection open and receive only the fields that changed whenever the
+ *  sampler publishes a new snapshot.
+ */
+
+#ifndef LIVE_TASK_H_
+#define LIVE_TASK_H_
+
+#define LIVE_SERVER_PORT            (5433)
+/* concurrent dashboards, every one holds a NWP socket */
+#define LIVE_MAX_CLIENTS            (3)
+
+//*****************************************************************************
+//
+//! \brief This task streams snapshot changes to the connected dashboards
+//!
+//! \param[in]  None
+//!
+//! \return None
+//!
+//****************************************************************************
+void * liveTask(void *pvParameter);
+
+#endif /* LIVE_TASK_H_ */
@@ -56,7 +56,10 @@
 #include "provisioning_task.h"
 #include "link_local_task.h"
 #include "ota_task.h"
+#include "live_task.h"
 #include "system_task.h"
+#include "sensor_task.h"
+#include "record_log.h"
 
 /* TI-DRIVERS Header files */
 #include <ti/drivers/net/wifi/simplelink.h>
@@ -148,8 +151,10 @@ pthread_t gProvisioningThread = (pthread_t)NULL;
 pthread_t gLinklocalThread = (pthread_t)NULL;
 pthread_t gControlThread = (pthread_t)NULL;
 pthread_t gOtaThread = (pthread_t)NULL;
+pthread_t gLiveThread = (pthread_t)NULL;
 pthread_t gSpawnThread = (pthread_t)NULL;
 pthread_t gSystemThread = (pthread_t)NULL;
+pthread_t gSensorThread = (pthread_t)NULL;
 /* message queue for control messages */
 mqd_t controlMQueue;
 
@@ -1131,6 +1136,12 @@ void * controlTask(void *pvParameters)
 //****************************************************************************
 void mcuReboot(void)
 {
+    /* the last sector of the data log is only in RAM */
+    if(RecordLog_flush() < 0)
+    {
+        UART_PRINT("[Common] data log not saved before the reset\r\n");
+    }
+
     /* stop network processor activities before reseting the MCU */
     sl_Stop(SL_STOP_TIMEOUT);
 
@@ -1187,6 +1198,9 @@ void * mainThread(void *arg)
     sem_init(&Provisioning_ControlBlock.provisioningConnDoneToOtaServerSignal,
              0,
              0);
+    sem_init(&Provisioning_ControlBlock.provisioningConnDoneToLiveServerSignal,
+             0,
+             0);
     sem_init(&LinkLocal_ControlBlock.otaReportServerStartSignal, 0, 0);
     sem_init(&LinkLocal_ControlBlock.otaReportServerStopSignal, 0, 0);
 
@@ -1342,6 +1356,62 @@ void * mainThread(void *arg)
             ;
         }
     }
+
+    pthread_attr_init(&pAttrs);
+    priParam.sched_priority = 1;
+    RetVal = pthread_attr_setschedparam(&pAttrs, &priParam);
+    RetVal |= pthread_attr_setstacksize(&pAttrs, TASK_STACK_SIZE);
+
+    if(RetVal)
+    {
+        /* Handle Error */
+        UART_PRINT("Unable to configure liveTask thread parameters \n");
+        while(1)
+        {
+            ;
+        }
+    }
+
+    RetVal = pthread_create(&gLiveThread, &pAttrs, liveTask, NULL);
+
+    if(RetVal)
+    {
+        /* Handle Error */
+        UART_PRINT("Unable to create liveTask thread \n");
+        while(1)
+        {
+            ;
+        }
+    }
+    /* the sensor task runs the same priority as the system task, so its
+       schedule is not delayed by the http workers */
+    pthread_attr_init(&pAttrs);
+    priParam.sched_priority = 2;
+    RetVal = pthread_attr_setschedparam(&pAttrs, &priParam);
+    RetVal |= pthread_attr_setstacksize(&pAttrs, SENSOR_STACK_SIZE);
+
+    if(RetVal)
+    {
+        /* Handle Error */
+        UART_PRINT("Unable to configure sensorTask thread parameters \n");
+        while(1)
+        {
+            ;
+        }
+    }
+
+    RetVal = pthread_create(&gSensorThread, &pAttrs, sensorTask, NULL);
+
+    if(RetVal)
+    {
+        /* Handle Error */
+        UART_PRINT("Unable to create sensorTask thread \n");
+        while(1)
+        {
+            ;
+        }
+    }
+
     pthread_attr_init(&pAttrs);
     priParam.sched_priority = 2;
     RetVal = pthread_attr_setschedparam(&pAttrs, &priParam);
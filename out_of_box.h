@@ -58,8 +58,11 @@
 #define SPAWN_TASK_PRIORITY             (9)
 #define TASK_STACK_SIZE         (2048)
 #define LINKLOCAL_STACK_SIZE    (3072)
+/* general link local request workers, one more serves long uploads */
+#define LINKLOCAL_WORKER_NUM    (2)
 #define CONTROL_STACK_SIZE      (2048)
 #define SYSTEM_STACK_SIZE       (3072)
+#define SENSOR_STACK_SIZE       (2048)
 
 #define SL_STOP_TIMEOUT         (200)
 #define OCP_REGISTER_INDEX              (0)
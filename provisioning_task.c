@@ -1073,6 +1073,9 @@ static int32_t ReportSuccess(void)
     /* signal to report server task */
     sem_post(&Provisioning_ControlBlock.provisioningConnDoneToOtaServerSignal);
 
+    /* signal to live stream server task */
+    sem_post(&Provisioning_ControlBlock.provisioningConnDoneToLiveServerSignal);
+
     return(0);
 }
 
@@ -1553,6 +1556,11 @@ void * provisioningTask(void *pvParameters)
             sem_post(
                 &Provisioning_ControlBlock.
                 provisioningConnDoneToOtaServerSignal);
+
+            /* signal to live stream server task */
+            sem_post(
+                &Provisioning_ControlBlock.
+                provisioningConnDoneToLiveServerSignal);
         }
         /* it means a connection to AP failed, trigger provisioning */
         else if(retVal < 0)
@@ -1571,6 +1579,10 @@ void * provisioningTask(void *pvParameters)
         /* signal to report server task */
         sem_post(
             &Provisioning_ControlBlock.provisioningConnDoneToOtaServerSignal);
+
+        /* signal to live stream server task */
+        sem_post(
+            &Provisioning_ControlBlock.provisioningConnDoneToLiveServerSignal);
     }
 
     do
@@ -76,6 +76,7 @@ typedef struct Provisioning_ControlBlock_t
     sem_t connectionAsyncEvent;
     sem_t provisioningDoneSignal;
     sem_t provisioningConnDoneToOtaServerSignal;
+    sem_t provisioningConnDoneToLiveServerSignal;
 }Provisioning_CB;
 
 /****************************************************************************
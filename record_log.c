@@ -0,0 +1,1342 @@
+/*
+ * record_log.c
+ *
+ *  Binary data log on the SD card. A day file is a header followed by
+ *  fixed size records; it is grown by zeroed blocks, so the records written
+ *  so far are followed by empty ones and the end of the log is found by a
+ *  binary search when it is opened. A record torn by a reset fails its CRC
+ *  and is written over.
+ *
+ *  The system task appends, the HTTP workers read; the file of the current
+ *  day is kept open and every access holds the log lock. The sector holding
+ *  the end of the log is kept in RAM: appends fill it in place and it is
+ *  written back as one aligned 512 byte write, reads of the records in it
+ *  are served from RAM. The stdio buffer is off, every fwrite() goes
+ *  straight to FatFs. An earlier day being exported stays open for reading
+ *  until another day is read.
+ */
+
+/* standard includes */
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+/* Kernel includes */
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <uart_term.h>
+
+#include "record_log.h"
+
+/* longest rendered record or column list, a JSON record is ~280 bytes */
+#define RECORD_LOG_RENDER_LEN           (320)
+
+#define RECORD_LOG_CRC_LEN              (offsetof(RecordLog_Record_t, crc))
+#define RECORD_LOG_OFFSET(idx)          (sizeof(RecordLog_Header_t) + \
+                                         ((idx) * sizeof(RecordLog_Record_t)))
+
+#define RECORD_LOG_SECONDS_PER_HOUR     (60UL * 60)
+
+/* file offset of the sector holding a file offset */
+#define RECORD_LOG_SECTOR_OF(offset)    ((offset) & \
+                                         ~(uint32_t)(RECORD_LOG_SECTOR_LEN - 1))
+
+typedef enum
+{
+    RecordLogField_Time,
+    RecordLogField_Uptime,
+    RecordLogField_InTemp,
+    RecordLogField_InPres,
+    RecordLogField_InHumid,
+    RecordLogField_OutTemp,
+    RecordLogField_OutPres,
+    RecordLogField_OutHumid,
+    RecordLogField_IrTemp,
+    RecordLogField_Oxygen,
+    RecordLogField_AirQuality,
+    RecordLogField_Lights,
+    RecordLogField_Fans,
+    RecordLogField_Cooling,
+    RecordLogField_Connected,
+    RecordLogField_Stale,
+    RecordLogField_Max
+}RecordLogField;
+
+/* the widths hold every value of the record field, so every record
+   renders to the same length */
+typedef struct
+{
+    const char *name;
+    uint8_t width;
+    uint8_t decimals;
+}RecordLogColumn_t;
+
+static const RecordLogColumn_t gRecordLogColumns[RecordLogField_Max] =
+{
+    [RecordLogField_Time]       = {"time", 19, 0},  /* yyyy-mm-dd hh:mm:ss */
+    [RecordLogField_Uptime]     = {"uptime", 10, 0},
+    [RecordLogField_InTemp]     = {"inTemp", 7, 2},
+    [RecordLogField_InPres]     = {"inPres", 10, 0},
+    [RecordLogField_InHumid]    = {"inHumid", 3, 0},
+    [RecordLogField_OutTemp]    = {"outTemp", 7, 2},
+    [RecordLogField_OutPres]    = {"outPres", 10, 0},
+    [RecordLogField_OutHumid]   = {"outHumid", 3, 0},
+    [RecordLogField_IrTemp]     = {"irTemp", 7, 2},
+    [RecordLogField_Oxygen]     = {"oxygen", 6, 3},  /* % */
+    [RecordLogField_AirQuality] = {"airQuality", 5, 0},
+    [RecordLogField_Lights]     = {"lights", 1, 0},
+    [RecordLogField_Fans]       = {"fans", 1, 0},
+    [RecordLogField_Cooling]    = {"cooling", 1, 0},
+    [RecordLogField_Connected]  = {"connected", 1, 0},
+    [RecordLogField_Stale]      = {"stale", 3, 0},
+};
+
+/* CRC-16/CCITT, a nibble at a time */
+static const uint16_t gRecordLogCrcTable[16] =
+{
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+/* an open day file */
+typedef struct
+{
+    FILE *pFile;
+    uint32_t day;                           /* RECORD_LOG_DAY() */
+    volatile uint32_t count;                /* records written */
+    uint32_t capacity;                      /* records the file holds */
+    uint32_t lastTime;                      /* of the last record, or 0 */
+    uint32_t hourFirst[RECORD_LOG_INDEX_LEN];
+}RecordLogDay_t;
+
+static pthread_mutex_t gRecordLogLock;
+static uint8_t gRecordLogLockInit;
+static volatile uint8_t gRecordLogOpen;
+/* the day appended to, and an earlier day being read */
+static RecordLogDay_t gRecordLogDay;
+static RecordLogDay_t gRecordLogReader;
+static uint8_t gRecordLogIndexDirty;
+/* the sector holding the end of the log, its file offset, and when it got
+   its oldest record not on the card yet */
+static uint8_t gRecordLogSector[RECORD_LOG_SECTOR_LEN];
+static uint32_t gRecordLogSectorOffset;
+static uint8_t gRecordLogDirty;
+static TickType_t gRecordLogDirtySince;
+static RecordLog_Stats_t gRecordLogStats;
+/* rendered lengths per format, 0 until measured */
+static uint16_t gRecordLogRecordLen[RecordLogFormat_Max];
+
+//*****************************************************************************
+//
+//! \brief Computes the CRC of the fields of a record
+//!
+//! \param[in]  pRecord       record to check
+//!
+//! \return CRC-16/CCITT
+//!
+//****************************************************************************
+static uint16_t recordLogCrc(const RecordLog_Record_t *pRecord)
+{
+    const uint8_t *pData = (const uint8_t *)pRecord;
+    uint16_t crc = 0xFFFF;
+    uint8_t idx;
+
+    for(idx = 0; idx < RECORD_LOG_CRC_LEN; idx++)
+    {
+        crc = (crc << 4) ^ gRecordLogCrcTable[(crc >> 12) ^ (pData[idx] >> 4)];
+        crc = (crc << 4) ^ gRecordLogCrcTable[(crc >> 12) ^ (pData[idx] & 0xF)];
+    }
+
+    return(crc);
+}
+
+//*****************************************************************************
+//
+//! \brief Converts a day count to a civil date
+//!
+//! \param[in]  days          days since 1970
+//!
+//! \param[out] pYear         full year
+//!
+//! \param[out] pMonth        1 to 12
+//!
+//! \param[out] pDay          1 to 31
+//!
+//! \return none
+//!
+//****************************************************************************
+static void recordLogCivil(uint32_t days, uint32_t *pYear, uint32_t *pMonth,
+                           uint32_t *pDay)
+{
+    uint32_t era, dayOfEra, yearOfEra, dayOfYear, mp;
+
+    /* eras of 400 years from 0000-03-01 */
+    days += 719468;
+    era = days / 146097;
+    dayOfEra = days - (era * 146097);
+    yearOfEra = (dayOfEra - (dayOfEra / 1460) + (dayOfEra / 36524) -
+                 (dayOfEra / 146096)) / 365;
+    dayOfYear = dayOfEra - ((365 * yearOfEra) + (yearOfEra / 4) -
+                            (yearOfEra / 100));
+    mp = ((5 * dayOfYear) + 2) / 153;
+    *pDay = dayOfYear - (((153 * mp) + 2) / 5) + 1;
+    *pMonth = (mp < 10) ? (mp + 3) : (mp - 9);
+    *pYear = yearOfEra + (era * 400) + ((*pMonth <= 2) ? 1 : 0);
+}
+
+//*****************************************************************************
+//
+//! \brief Builds the 8.3 name of a file of a day, dYYMMDD.ext
+//!
+//! \param[out] pName         RECORD_LOG_NAME_LEN bytes
+//!
+//! \param[in]  day           RECORD_LOG_DAY() of the file
+//!
+//! \param[in]  pExt          "bin", "idx" or "old"
+//!
+//! \return none
+//!
+//****************************************************************************
+static void recordLogName(char *pName, uint32_t day, const char *pExt)
+{
+    uint32_t year, month, dayOfMonth;
+
+    recordLogCivil(day, &year, &month, &dayOfMonth);
+    snprintf(pName, RECORD_LOG_NAME_LEN, RECORD_LOG_DRIVE "d%02u%02u%02u.%s",
+             (unsigned int)(year % 100), (unsigned int)month,
+             (unsigned int)dayOfMonth, pExt);
+}
+
+//*****************************************************************************
+//
+//! \brief Tells whether a slot of a file holds a record. The caller holds
+//!        the log lock.
+//!
+//! \param[in]  pFile         day file, read past the sector buffer
+//!
+//! \param[in]  idx           slot to check
+//!
+//! \return 1 if the slot holds a record, 0 if it is empty or torn
+//!
+//****************************************************************************
+static uint8_t recordLogValid(FILE *pFile, uint32_t idx)
+{
+    RecordLog_Record_t record;
+
+    if((fseek(pFile, RECORD_LOG_OFFSET(idx), SEEK_SET) != 0) ||
+       (fread(&record, 1, sizeof(record), pFile) != sizeof(record)))
+    {
+        return(0);
+    }
+
+    return((record.time != 0) && (record.crc == recordLogCrc(&record)));
+}
+
+//*****************************************************************************
+//
+//! \brief Finds the size and the end of the records of a day file. The
+//!        caller holds the log lock.
+//!
+//! \param[in,out] pDay       day file, its capacity and count are set
+//!
+//! \return none
+//!
+//****************************************************************************
+static void recordLogMeasure(RecordLogDay_t *pDay)
+{
+    uint32_t low, high, mid;
+    long size;
+
+    fseek(pDay->pFile, 0, SEEK_END);
+    size = ftell(pDay->pFile);
+    pDay->capacity = (size > (long)sizeof(RecordLog_Header_t)) ?
+                     ((size - sizeof(RecordLog_Header_t)) /
+                      sizeof(RecordLog_Record_t)) : 0;
+
+    /* the slots below low hold records, the ones from high on are empty */
+    low = 0;
+    high = pDay->capacity;
+    while(low < high)
+    {
+        mid = low + ((high - low) / 2);
+        if(recordLogValid(pDay->pFile, mid))
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    pDay->count = low;
+}
+
+//*****************************************************************************
+//
+//! \brief Copies a record of a day file, the end of the current day comes
+//!        from the sector buffer. The caller holds the log lock.
+//!
+//! \param[in]  pDay          day file
+//!
+//! \param[in]  idx           record index, below the record count
+//!
+//! \param[out] pRecord       destination of the record
+//!
+//! \return 0 on success, -1 on failure
+//!
+//****************************************************************************
+static int32_t recordLogFetch(const RecordLogDay_t *pDay, uint32_t idx,
+                              RecordLog_Record_t *pRecord)
+{
+    if((pDay == &gRecordLogDay) &&
+       (RECORD_LOG_OFFSET(idx) >= gRecordLogSectorOffset))
+    {
+        memcpy(pRecord, &gRecordLogSector[RECORD_LOG_OFFSET(idx) -
+                                          gRecordLogSectorOffset],
+               sizeof(RecordLog_Record_t));
+        return(0);
+    }
+
+    if((fseek(pDay->pFile, RECORD_LOG_OFFSET(idx), SEEK_SET) != 0) ||
+       (fread(pRecord, 1, sizeof(RecordLog_Record_t), pDay->pFile) !=
+        sizeof(RecordLog_Record_t)))
+    {
+        return(-1);
+    }
+
+    return(0);
+}
+
+//*****************************************************************************
+//
+//! \brief Binary search for the first record at or after a time. The caller
+//!        holds the log lock.
+//!
+//! \param[in]  pDay          day file
+//!
+//! \param[in]  low           first record to search
+//!
+//! \param[in]  high          end of the records to search
+//!
+//! \param[in]  time          seconds since 1970
+//!
+//! \return index of the record, high if there is none
+//!
+//****************************************************************************
+static uint32_t recordLogLowerBound(const RecordLogDay_t *pDay, uint32_t low,
+                                    uint32_t high, uint32_t time)
+{
+    RecordLog_Record_t record;
+    uint32_t mid;
+
+    while(low < high)
+    {
+        mid = low + ((high - low) / 2);
+        if((recordLogFetch(pDay, mid, &record) == 0) && (record.time < time))
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return(low);
+}
+
+//*****************************************************************************
+//
+//! \brief Returns the first record after an hour of a day file, the first
+//!        of the next hour with records. The caller holds the log lock.
+//!
+//! \param[in]  pDay          day file
+//!
+//! \param[in]  hour          0 to 23
+//!
+//! \return index of the record, the record count if there is none
+//!
+//****************************************************************************
+static uint32_t recordLogNextHour(const RecordLogDay_t *pDay, uint32_t hour)
+{
+    for(hour++; hour < RECORD_LOG_INDEX_LEN; hour++)
+    {
+        if(pDay->hourFirst[hour] != RECORD_LOG_INDEX_NONE)
+        {
+            return(pDay->hourFirst[hour]);
+        }
+    }
+
+    return(pDay->count);
+}
+
+//*****************************************************************************
+//
+//! \brief Finds the first record of a day file at or after a time, with the
+//!        hour index and a binary search within the hour. The caller holds
+//!        the log lock.
+//!
+//! \param[in]  pDay          day file
+//!
+//! \param[in]  time          seconds since 1970
+//!
+//! \return index of the record, the record count if there is none
+//!
+//****************************************************************************
+static uint32_t recordLogSeek(const RecordLogDay_t *pDay, uint32_t time)
+{
+    uint32_t start = pDay->day * RECORD_LOG_SECONDS_PER_DAY;
+    uint32_t hour;
+
+    if(time <= start)
+    {
+        return(0);
+    }
+    if((time - start) >= RECORD_LOG_SECONDS_PER_DAY)
+    {
+        return(pDay->count);
+    }
+
+    hour = (time - start) / RECORD_LOG_SECONDS_PER_HOUR;
+    if(pDay->hourFirst[hour] == RECORD_LOG_INDEX_NONE)
+    {
+        return(recordLogNextHour(pDay, hour));
+    }
+
+    return(recordLogLowerBound(pDay, pDay->hourFirst[hour],
+                               recordLogNextHour(pDay, hour), time));
+}
+
+//*****************************************************************************
+//
+//! \brief Loads the hour index of a day file, or rebuilds it from the
+//!        records when it is missing or behind them. The caller holds the
+//!        log lock.
+//!
+//! \param[in,out] pDay       day file, its hourFirst is set
+//!
+//! \return 0 if the index was loaded, 1 if it was rebuilt
+//!
+//****************************************************************************
+static uint8_t recordLogLoadIndex(RecordLogDay_t *pDay)
+{
+    RecordLog_Index_t index;
+    RecordLog_Record_t record;
+    char name[RECORD_LOG_NAME_LEN];
+    FILE *pFile;
+    uint32_t start = pDay->day * RECORD_LOG_SECONDS_PER_DAY;
+    uint32_t hour, idx;
+    uint8_t valid = 0;
+
+    recordLogName(name, pDay->day, "idx");
+    pFile = fopen(name, "rb");
+    if(pFile != NULL)
+    {
+        valid = ((fread(&index, 1, sizeof(index), pFile) == sizeof(index)) &&
+                 (index.magic == RECORD_LOG_INDEX_MAGIC));
+        fclose(pFile);
+    }
+
+    for(hour = 0; valid && (hour < RECORD_LOG_INDEX_LEN); hour++)
+    {
+        if((index.hourFirst[hour] != RECORD_LOG_INDEX_NONE) &&
+           (index.hourFirst[hour] >= pDay->count))
+        {
+            valid = 0;
+        }
+    }
+
+    /* the index is written after the records, a reset in between leaves
+       the hour of the last record out */
+    if(valid && (pDay->count > 0) &&
+       (recordLogFetch(pDay, pDay->count - 1, &record) == 0) &&
+       (record.time >= start) &&
+       ((record.time - start) < RECORD_LOG_SECONDS_PER_DAY) &&
+       (index.hourFirst[(record.time - start) / RECORD_LOG_SECONDS_PER_HOUR] ==
+        RECORD_LOG_INDEX_NONE))
+    {
+        valid = 0;
+    }
+
+    if(valid)
+    {
+        memcpy(pDay->hourFirst, index.hourFirst, sizeof(pDay->hourFirst));
+        return(0);
+    }
+
+    idx = 0;
+    for(hour = 0; hour < RECORD_LOG_INDEX_LEN; hour++)
+    {
+        idx = recordLogLowerBound(pDay, idx, pDay->count,
+                                  start + (hour * RECORD_LOG_SECONDS_PER_HOUR));
+        pDay->hourFirst[hour] =
+            ((idx < pDay->count) &&
+             (recordLogFetch(pDay, idx, &record) == 0) &&
+             (record.time < (start + ((hour + 1) *
+                                      RECORD_LOG_SECONDS_PER_HOUR)))) ?
+            idx : RECORD_LOG_INDEX_NONE;
+    }
+
+    return(1);
+}
+
+//*****************************************************************************
+//
+//! \brief Writes data to the current day file and counts the write. The
+//!        caller holds the log lock.
+//!
+//! \param[in]  offset        file offset to write at
+//!
+//! \param[in]  pData         data to write
+//!
+//! \param[in]  len           bytes to write
+//!
+//! \return bytes written
+//!
+//****************************************************************************
+static uint32_t recordLogWrite(uint32_t offset, const uint8_t *pData,
+                               uint32_t len)
+{
+    uint32_t written;
+
+    if(fseek(gRecordLogDay.pFile, offset, SEEK_SET) != 0)
+    {
+        return(0);
+    }
+    written = fwrite(pData, 1, len, gRecordLogDay.pFile);
+
+    gRecordLogStats.writes++;
+    gRecordLogStats.bytesWritten += written;
+
+    return(written);
+}
+
+//*****************************************************************************
+//
+//! \brief Writes the hour index of the current day. The caller holds the
+//!        log lock.
+//!
+//! \param  none
+//!
+//! \return 0 on success, -1 on failure
+//!
+//****************************************************************************
+static int32_t recordLogWriteIndex(void)
+{
+    RecordLog_Index_t index;
+    char name[RECORD_LOG_NAME_LEN];
+    FILE *pFile;
+    uint32_t written;
+
+    index.magic = RECORD_LOG_INDEX_MAGIC;
+    memcpy(index.hourFirst, gRecordLogDay.hourFirst, sizeof(index.hourFirst));
+
+    recordLogName(name, gRecordLogDay.day, "idx");
+    pFile = fopen(name, "wb");
+    if(pFile == NULL)
+    {
+        return(-1);
+    }
+    written = fwrite(&index, 1, sizeof(index), pFile);
+    if(fclose(pFile) != 0)
+    {
+        written = 0;
+    }
+
+    gRecordLogStats.writes++;
+    gRecordLogStats.bytesWritten += written;
+
+    return((written == sizeof(index)) ? 0 : -1);
+}
+
+//*****************************************************************************
+//
+//! \brief Loads the sector at a file offset into the sector buffer, the
+//!        part past the end of the file reads as zero. The caller holds the
+//!        log lock and the buffer is clean.
+//!
+//! \param[in]  offset        file offset of the sector
+//!
+//! \return none
+//!
+//****************************************************************************
+static void recordLogLoadSector(uint32_t offset)
+{
+    memset(gRecordLogSector, 0, sizeof(gRecordLogSector));
+    gRecordLogSectorOffset = offset;
+
+    if(fseek(gRecordLogDay.pFile, offset, SEEK_SET) == 0)
+    {
+        fread(gRecordLogSector, 1, sizeof(gRecordLogSector),
+              gRecordLogDay.pFile);
+    }
+}
+
+//*****************************************************************************
+//
+//! \brief Writes the sector buffer back if it holds unsaved records, then
+//!        the hour index if it changed. The caller holds the log lock.
+//!
+//! \param  none
+//!
+//! \return 0 on success, -1 if the records were not written, the buffer
+//!         stays dirty then. A failed index write is counted and retried
+//!         with the next flush, the index is rebuilt when it is behind.
+//!
+//****************************************************************************
+static int32_t recordLogFlush(void)
+{
+    TickType_t start;
+    uint32_t elapsedMs;
+
+    if(gRecordLogDirty)
+    {
+        start = xTaskGetTickCount();
+        if((recordLogWrite(gRecordLogSectorOffset, gRecordLogSector,
+                           sizeof(gRecordLogSector)) !=
+            sizeof(gRecordLogSector)) ||
+           (fflush(gRecordLogDay.pFile) != 0))
+        {
+            gRecordLogStats.flushErrors++;
+            return(-1);
+        }
+        elapsedMs = (xTaskGetTickCount() - start) * portTICK_PERIOD_MS;
+
+        gRecordLogDirty = 0;
+        gRecordLogStats.flushes++;
+        gRecordLogStats.flushTotalMs += elapsedMs;
+        if(elapsedMs > gRecordLogStats.flushMaxMs)
+        {
+            gRecordLogStats.flushMaxMs = elapsedMs;
+        }
+    }
+
+    if(gRecordLogIndexDirty)
+    {
+        if(recordLogWriteIndex() == 0)
+        {
+            gRecordLogIndexDirty = 0;
+        }
+        else
+        {
+            gRecordLogStats.flushErrors++;
+        }
+    }
+
+    return(0);
+}
+
+//*****************************************************************************
+//
+//! \brief Grows the current day file by RECORD_LOG_GROW_RECORDS zeroed
+//!        records. The caller holds the log lock. The sector buffer is
+//!        written back and used as the zeroed block, then loaded again.
+//!
+//! \param  none
+//!
+//! \return 0 on success, -1 on failure
+//!
+//****************************************************************************
+static int32_t recordLogGrow(void)
+{
+    uint32_t offset, end, chunk, written;
+
+    if(recordLogFlush() < 0)
+    {
+        return(-1);
+    }
+
+    memset(gRecordLogSector, 0, sizeof(gRecordLogSector));
+
+    /* a short first chunk, the rest are whole sectors */
+    offset = RECORD_LOG_OFFSET(gRecordLogDay.capacity);
+    end = RECORD_LOG_OFFSET(gRecordLogDay.capacity + RECORD_LOG_GROW_RECORDS);
+    while(offset < end)
+    {
+        chunk = RECORD_LOG_SECTOR_LEN - (offset % RECORD_LOG_SECTOR_LEN);
+        if(chunk > (end - offset))
+        {
+            chunk = end - offset;
+        }
+        written = recordLogWrite(offset, gRecordLogSector, chunk);
+        offset += written;
+        if(written != chunk)
+        {
+            break;
+        }
+    }
+    fflush(gRecordLogDay.pFile);
+
+    /* the records written before the card filled up are usable */
+    written = (offset - RECORD_LOG_OFFSET(gRecordLogDay.capacity)) /
+              sizeof(RecordLog_Record_t);
+    gRecordLogDay.capacity += written;
+
+    recordLogLoadSector(gRecordLogSectorOffset);
+
+    return((written > 0) ? 0 : -1);
+}
+
+//*****************************************************************************
+//
+//! \brief Creates the file of the current day, the caller holds the log
+//!        lock
+//!
+//! \param[in]  pName         file name
+//!
+//! \param[in]  now           creation time, seconds since 1970
+//!
+//! \return 0 on success, -1 on failure
+//!
+//****************************************************************************
+static int32_t recordLogCreate(const char *pName, uint32_t now)
+{
+    RecordLog_Header_t header;
+
+    gRecordLogDay.pFile = fopen(pName, "w+b");
+    if(gRecordLogDay.pFile == NULL)
+    {
+        return(-1);
+    }
+    setvbuf(gRecordLogDay.pFile, NULL, _IONBF, 0);
+
+    memset(&header, 0, sizeof(header));
+    header.magic = RECORD_LOG_MAGIC;
+    header.version = RECORD_LOG_VERSION;
+    header.recordSize = sizeof(RecordLog_Record_t);
+    header.created = now;
+    if(fwrite(&header, 1, sizeof(header), gRecordLogDay.pFile) !=
+       sizeof(header))
+    {
+        fclose(gRecordLogDay.pFile);
+        gRecordLogDay.pFile = NULL;
+        return(-1);
+    }
+
+    gRecordLogDay.capacity = 0;
+
+    return(recordLogGrow());
+}
+
+//*****************************************************************************
+//
+//! \brief Tells whether a file starts with the header of this log version
+//!
+//! \param[in]  pFile         file to check
+//!
+//! \return 1 if the header is known, 0 otherwise
+//!
+//****************************************************************************
+static uint8_t recordLogHeaderValid(FILE *pFile)
+{
+    RecordLog_Header_t header;
+
+    return((fseek(pFile, 0, SEEK_SET) == 0) &&
+           (fread(&header, 1, sizeof(header), pFile) == sizeof(header)) &&
+           (header.magic == RECORD_LOG_MAGIC) &&
+           (header.version == RECORD_LOG_VERSION) &&
+           (header.recordSize == sizeof(RecordLog_Record_t)));
+}
+
+//*****************************************************************************
+//
+//! \brief Closes the current day file and opens the one of a day, or
+//!        creates it. The caller holds the log lock.
+//!
+//! \param[in]  day           RECORD_LOG_DAY() of the file
+//!
+//! \param[in]  now           current time, seconds since 1970
+//!
+//! \return 0 on success, -1 if the file can not be opened
+//!
+//****************************************************************************
+static int32_t recordLogOpenDay(uint32_t day, uint32_t now)
+{
+    char name[RECORD_LOG_NAME_LEN];
+    char oldName[RECORD_LOG_NAME_LEN];
+    RecordLog_Record_t last;
+
+    /* the previous day, or reopened after a failure and the card may have
+       been swapped */
+    gRecordLogOpen = 0;
+    if(gRecordLogDay.pFile != NULL)
+    {
+        if(recordLogFlush() < 0)
+        {
+            UART_PRINT("[Record log] unsaved records of the last sector "
+                       "lost\r\n");
+        }
+        fclose(gRecordLogDay.pFile);
+        gRecordLogDay.pFile = NULL;
+    }
+    gRecordLogDirty = 0;
+    gRecordLogIndexDirty = 0;
+
+    /* the clock may have gone back to the day being read */
+    if(gRecordLogReader.pFile != NULL)
+    {
+        fclose(gRecordLogReader.pFile);
+        gRecordLogReader.pFile = NULL;
+    }
+
+    gRecordLogDay.day = day;
+    recordLogName(name, day, "bin");
+
+    gRecordLogDay.pFile = fopen(name, "r+b");
+    if(gRecordLogDay.pFile != NULL)
+    {
+        setvbuf(gRecordLogDay.pFile, NULL, _IONBF, 0);
+        if(!recordLogHeaderValid(gRecordLogDay.pFile))
+        {
+            recordLogName(oldName, day, "old");
+            UART_PRINT("[Record log] unknown log format, kept as %s\r\n",
+                       oldName);
+            fclose(gRecordLogDay.pFile);
+            gRecordLogDay.pFile = NULL;
+            remove(oldName);
+            rename(name, oldName);
+        }
+    }
+
+    if(gRecordLogDay.pFile == NULL)
+    {
+        if(recordLogCreate(name, now) < 0)
+        {
+            UART_PRINT("[Record log] could not create %s\r\n", name);
+            return(-1);
+        }
+    }
+
+    recordLogMeasure(&gRecordLogDay);
+    recordLogLoadSector(RECORD_LOG_SECTOR_OF(
+                            RECORD_LOG_OFFSET(gRecordLogDay.count)));
+    gRecordLogDay.lastTime = 0;
+    if((gRecordLogDay.count > 0) &&
+       (recordLogFetch(&gRecordLogDay, gRecordLogDay.count - 1, &last) == 0))
+    {
+        gRecordLogDay.lastTime = last.time;
+    }
+    gRecordLogIndexDirty = recordLogLoadIndex(&gRecordLogDay);
+    gRecordLogOpen = 1;
+
+    UART_PRINT("[Record log] %s, %d records of %d\r\n", name,
+               gRecordLogDay.count, gRecordLogDay.capacity);
+
+    return(0);
+}
+
+//*****************************************************************************
+//
+//! \brief Returns the open file of a day, the current one or the reader,
+//!        which is opened for the day if needed. The caller holds the log
+//!        lock.
+//!
+//! \param[in]  day           RECORD_LOG_DAY() of the file
+//!
+//! \return day file, NULL if there is none
+//!
+//****************************************************************************
+static RecordLogDay_t * recordLogSelect(uint32_t day)
+{
+    char name[RECORD_LOG_NAME_LEN];
+
+    if(gRecordLogOpen && (day == gRecordLogDay.day))
+    {
+        return(&gRecordLogDay);
+    }
+    if((gRecordLogReader.pFile != NULL) && (day == gRecordLogReader.day))
+    {
+        return(&gRecordLogReader);
+    }
+
+    if(gRecordLogReader.pFile != NULL)
+    {
+        fclose(gRecordLogReader.pFile);
+        gRecordLogReader.pFile = NULL;
+    }
+
+    recordLogName(name, day, "bin");
+    gRecordLogReader.pFile = fopen(name, "rb");
+    if(gRecordLogReader.pFile == NULL)
+    {
+        return(NULL);
+    }
+    if(!recordLogHeaderValid(gRecordLogReader.pFile))
+    {
+        fclose(gRecordLogReader.pFile);
+        gRecordLogReader.pFile = NULL;
+        return(NULL);
+    }
+
+    /* an earlier day does not change, measured once */
+    gRecordLogReader.day = day;
+    recordLogMeasure(&gRecordLogReader);
+    recordLogLoadIndex(&gRecordLogReader);
+
+    return(&gRecordLogReader);
+}
+
+//*****************************************************************************
+//
+//! \brief Renders the time of a record as yyyy-mm-dd hh:mm:ss
+//!
+//! \param[in]  time          seconds since 1970
+//!
+//! \param[in]  pWriter       writer to render to
+//!
+//! \return none
+//!
+//****************************************************************************
+static void recordLogRenderTime(uint32_t time, HttpWriter_t *pWriter)
+{
+    uint32_t secs, year, month, day;
+
+    secs = time % RECORD_LOG_SECONDS_PER_DAY;
+    recordLogCivil(time / RECORD_LOG_SECONDS_PER_DAY, &year, &month, &day);
+
+    HttpWriter_appendUint(pWriter, year, 4);
+    HttpWriter_appendChar(pWriter, '-');
+    HttpWriter_appendUint(pWriter, month, 2);
+    HttpWriter_appendChar(pWriter, '-');
+    HttpWriter_appendUint(pWriter, day, 2);
+    HttpWriter_appendChar(pWriter, ' ');
+    HttpWriter_appendUint(pWriter, secs / 3600, 2);
+    HttpWriter_appendChar(pWriter, ':');
+    HttpWriter_appendUint(pWriter, (secs / 60) % 60, 2);
+    HttpWriter_appendChar(pWriter, ':');
+    HttpWriter_appendUint(pWriter, secs % 60, 2);
+}
+
+//*****************************************************************************
+//
+//! \brief Returns a numeric field of a record
+//!
+//! \param[in]  pRecord       record to read
+//!
+//! \param[in]  field         field to return, not the time
+//!
+//! \return field value, the unsigned ones capped to INT32_MAX
+//!
+//****************************************************************************
+static int32_t recordLogValue(const RecordLog_Record_t *pRecord,
+                              uint8_t field)
+{
+    switch(field)
+    {
+    case RecordLogField_Uptime:
+        return((pRecord->uptime > INT32_MAX) ? INT32_MAX : pRecord->uptime);
+    case RecordLogField_InTemp:
+        return(pRecord->tempIn);
+    case RecordLogField_InPres:
+        return((pRecord->presIn > INT32_MAX) ? INT32_MAX : pRecord->presIn);
+    case RecordLogField_InHumid:
+        return(pRecord->humidIn);
+    case RecordLogField_OutTemp:
+        return(pRecord->tempOut);
+    case RecordLogField_OutPres:
+        return((pRecord->presOut > INT32_MAX) ? INT32_MAX : pRecord->presOut);
+    case RecordLogField_OutHumid:
+        return(pRecord->humidOut);
+    case RecordLogField_IrTemp:
+        return(pRecord->irTemp);
+    case RecordLogField_Oxygen:
+        return(pRecord->oxygen);
+    case RecordLogField_AirQuality:
+        return(pRecord->airQuality);
+    case RecordLogField_Lights:
+        return((pRecord->state & RECORD_LOG_STATE_LIGHTS) ? 1 : 0);
+    case RecordLogField_Fans:
+        return((pRecord->state & RECORD_LOG_STATE_FANS) ? 1 : 0);
+    case RecordLogField_Cooling:
+        return((pRecord->state & RECORD_LOG_STATE_COOLING) ? 1 : 0);
+    case RecordLogField_Connected:
+        return((pRecord->state & RECORD_LOG_STATE_CONNECTED) ? 1 : 0);
+    default:
+        return(pRecord->staleMask);
+    }
+}
+
+int32_t RecordLog_open(uint32_t now)
+{
+    int32_t status;
+
+    /* only the system task opens the log */
+    if(!gRecordLogLockInit)
+    {
+        pthread_mutex_init(&gRecordLogLock, (pthread_mutexattr_t*)NULL);
+        gRecordLogLockInit = 1;
+    }
+
+    pthread_mutex_lock(&gRecordLogLock);
+    status = recordLogOpenDay(RECORD_LOG_DAY(now), now);
+    pthread_mutex_unlock(&gRecordLogLock);
+
+    return(status);
+}
+
+int32_t RecordLog_append(RecordLog_Record_t *pRecord)
+{
+    uint32_t offset, hour;
+    int32_t status = -1;
+
+    if(!gRecordLogOpen)
+    {
+        return(-1);
+    }
+
+    pRecord->crc = recordLogCrc(pRecord);
+
+    pthread_mutex_lock(&gRecordLogLock);
+    /* the first record of a day starts its file */
+    if(gRecordLogOpen && (RECORD_LOG_DAY(pRecord->time) != gRecordLogDay.day))
+    {
+        recordLogOpenDay(RECORD_LOG_DAY(pRecord->time), pRecord->time);
+    }
+
+    offset = RECORD_LOG_OFFSET(gRecordLogDay.count);
+    /* the lookups of a day need its records sorted by time */
+    if(gRecordLogOpen && (pRecord->time < gRecordLogDay.lastTime))
+    {
+        gRecordLogStats.outOfOrder++;
+        status = RECORD_LOG_OUT_OF_ORDER;
+    }
+    else if(gRecordLogOpen &&
+            ((gRecordLogDay.count < gRecordLogDay.capacity) ||
+             (recordLogGrow() == 0)))
+    {
+        /* the previous sector is full, its write back may have failed */
+        if((offset < (gRecordLogSectorOffset + RECORD_LOG_SECTOR_LEN)) ||
+           (recordLogFlush() == 0))
+        {
+            if(offset >= (gRecordLogSectorOffset + RECORD_LOG_SECTOR_LEN))
+            {
+                /* past the end of the log, nothing to load */
+                memset(gRecordLogSector, 0, sizeof(gRecordLogSector));
+                gRecordLogSectorOffset = RECORD_LOG_SECTOR_OF(offset);
+            }
+
+            memcpy(&gRecordLogSector[offset - gRecordLogSectorOffset],
+                   pRecord, sizeof(RecordLog_Record_t));
+            if(!gRecordLogDirty)
+            {
+                gRecordLogDirty = 1;
+                gRecordLogDirtySince = xTaskGetTickCount();
+            }
+
+            hour = (pRecord->time % RECORD_LOG_SECONDS_PER_DAY) /
+                   RECORD_LOG_SECONDS_PER_HOUR;
+            if(gRecordLogDay.hourFirst[hour] == RECORD_LOG_INDEX_NONE)
+            {
+                gRecordLogDay.hourFirst[hour] = gRecordLogDay.count;
+                gRecordLogIndexDirty = 1;
+            }
+
+            gRecordLogDay.count++;
+            gRecordLogDay.lastTime = pRecord->time;
+            gRecordLogStats.appends++;
+            status = 0;
+
+            /* a failure is retried by the next append or poll */
+            if((offset + sizeof(RecordLog_Record_t)) ==
+               (gRecordLogSectorOffset + RECORD_LOG_SECTOR_LEN))
+            {
+                recordLogFlush();
+            }
+        }
+    }
+    pthread_mutex_unlock(&gRecordLogLock);
+
+    return(status);
+}
+
+int32_t RecordLog_flush(void)
+{
+    int32_t status;
+
+    if(!gRecordLogOpen)
+    {
+        return(0);
+    }
+
+    pthread_mutex_lock(&gRecordLogLock);
+    status = gRecordLogOpen ? recordLogFlush() : 0;
+    pthread_mutex_unlock(&gRecordLogLock);
+
+    return(status);
+}
+
+void RecordLog_poll(void)
+{
+    if(!gRecordLogOpen || !gRecordLogDirty)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&gRecordLogLock);
+    if(gRecordLogOpen && gRecordLogDirty &&
+       ((xTaskGetTickCount() - gRecordLogDirtySince) >=
+        pdMS_TO_TICKS(RECORD_LOG_FLUSH_AGE_MS)))
+    {
+        recordLogFlush();
+    }
+    pthread_mutex_unlock(&gRecordLogLock);
+}
+
+void RecordLog_getStats(RecordLog_Stats_t *pStats)
+{
+    memcpy(pStats, &gRecordLogStats, sizeof(RecordLog_Stats_t));
+}
+
+uint32_t RecordLog_getCount(void)
+{
+    return(gRecordLogOpen ? gRecordLogDay.count : 0);
+}
+
+uint32_t RecordLog_getDay(void)
+{
+    return(gRecordLogOpen ? gRecordLogDay.day : 0);
+}
+
+int32_t RecordLog_find(uint32_t day, uint32_t from, uint32_t to,
+                       uint32_t *pFirst, uint32_t *pEnd)
+{
+    RecordLogDay_t *pDay;
+    int32_t status = -1;
+
+    *pFirst = 0;
+    *pEnd = 0;
+
+    /* the lock exists once the log was opened */
+    if(!gRecordLogLockInit)
+    {
+        return(-1);
+    }
+
+    pthread_mutex_lock(&gRecordLogLock);
+    pDay = recordLogSelect(day);
+    if(pDay != NULL)
+    {
+        *pFirst = recordLogSeek(pDay, from);
+        *pEnd = recordLogSeek(pDay, to);
+        if(*pEnd < *pFirst)
+        {
+            *pEnd = *pFirst;
+        }
+        status = 0;
+    }
+    pthread_mutex_unlock(&gRecordLogLock);
+
+    return(status);
+}
+
+int32_t RecordLog_read(uint32_t day, uint32_t first,
+                       RecordLog_Record_t *pRecords, uint16_t maxCount)
+{
+    RecordLogDay_t *pDay;
+    uint32_t buffered, fromFile;
+    int32_t count = -1;
+
+    if(!gRecordLogLockInit)
+    {
+        return(-1);
+    }
+
+    pthread_mutex_lock(&gRecordLogLock);
+    pDay = recordLogSelect(day);
+    if(pDay == NULL)
+    {
+        count = -1;
+    }
+    else if(first >= pDay->count)
+    {
+        count = 0;
+    }
+    else
+    {
+        if((pDay->count - first) < maxCount)
+        {
+            maxCount = (uint16_t)(pDay->count - first);
+        }
+
+        /* the records from the buffered sector on are read from RAM */
+        buffered = pDay->count;
+        if(pDay == &gRecordLogDay)
+        {
+            buffered = (gRecordLogSectorOffset > sizeof(RecordLog_Header_t)) ?
+                       ((gRecordLogSectorOffset -
+                         sizeof(RecordLog_Header_t)) /
+                        sizeof(RecordLog_Record_t)) : 0;
+        }
+        fromFile = (first < buffered) ? (buffered - first) : 0;
+        if(fromFile > maxCount)
+        {
+            fromFile = maxCount;
+        }
+
+        count = 0;
+        if(fromFile > 0)
+        {
+            if((fseek(pDay->pFile, RECORD_LOG_OFFSET(first), SEEK_SET) != 0) ||
+               (fread(pRecords, sizeof(RecordLog_Record_t), fromFile,
+                      pDay->pFile) != fromFile))
+            {
+                count = -1;
+            }
+        }
+        if(count == 0)
+        {
+            if(fromFile < maxCount)
+            {
+                memcpy(&pRecords[fromFile], &gRecordLogSector[
+                           RECORD_LOG_OFFSET(first + fromFile) -
+                           gRecordLogSectorOffset],
+                       (maxCount - fromFile) * sizeof(RecordLog_Record_t));
+            }
+            count = maxCount;
+        }
+    }
+    pthread_mutex_unlock(&gRecordLogLock);
+
+    return(count);
+}
+
+uint32_t RecordLog_makeTime(uint32_t year, uint32_t month, uint32_t day,
+                            uint32_t hour, uint32_t minute, uint32_t second)
+{
+    uint32_t era, yearOfEra, dayOfYear, dayOfEra, days;
+
+    /* day count of a civil date, eras of 400 years from 0000-03-01 */
+    year -= (month <= 2) ? 1 : 0;
+    era = year / 400;
+    yearOfEra = year - (era * 400);
+    dayOfYear = (((153 * ((month > 2) ? (month - 3) : (month + 9))) + 2) / 5) +
+                day - 1;
+    dayOfEra = (yearOfEra * 365) + (yearOfEra / 4) - (yearOfEra / 100) +
+               dayOfYear;
+    days = (era * 146097) + dayOfEra - 719468;
+
+    return((days * RECORD_LOG_SECONDS_PER_DAY) + (hour * 3600) +
+           (minute * 60) + second);
+}
+
+uint16_t RecordLog_exportRecordSize(RecordLogFormat format)
+{
+    RecordLog_Record_t record;
+    HttpWriter_t writer;
+    uint8_t scratch[RECORD_LOG_RENDER_LEN];
+
+    if(format >= RecordLogFormat_Max)
+    {
+        return(0);
+    }
+
+    /* the fixed widths make any record a good sample */
+    if(gRecordLogRecordLen[format] == 0)
+    {
+        memset(&record, 0, sizeof(record));
+        HttpWriter_init(&writer, scratch, sizeof(scratch));
+        RecordLog_exportRecord(format, &record, 0, &writer);
+        gRecordLogRecordLen[format] = writer.len;
+    }
+
+    return(gRecordLogRecordLen[format]);
+}
+
+uint32_t RecordLog_exportSize(RecordLogFormat format, uint32_t count)
+{
+    HttpWriter_t writer;
+    uint8_t scratch[RECORD_LOG_RENDER_LEN];
+
+    HttpWriter_init(&writer, scratch, sizeof(scratch));
+    RecordLog_exportBegin(format, &writer);
+    RecordLog_exportEnd(format, &writer);
+
+    return(writer.len + (count * RecordLog_exportRecordSize(format)));
+}
+
+void RecordLog_exportBegin(RecordLogFormat format, HttpWriter_t *pWriter)
+{
+    uint8_t field;
+
+    if(format == RecordLogFormat_Json)
+    {
+        HttpWriter_append(pWriter, "[\n", 2);
+        return;
+    }
+
+    for(field = 0; field < RecordLogField_Max; field++)
+    {
+        if(field > 0)
+        {
+            HttpWriter_appendChar(pWriter, ',');
+        }
+        HttpWriter_appendStr(pWriter, gRecordLogColumns[field].name);
+    }
+    HttpWriter_append(pWriter, "\r\n", 2);
+}
+
+void RecordLog_exportRecord(RecordLogFormat format,
+                            const RecordLog_Record_t *pRecord,
+                            uint8_t first, HttpWriter_t *pWriter)
+{
+    const RecordLogColumn_t *pColumn;
+    uint8_t field;
+
+    if(format == RecordLogFormat_Json)
+    {
+        /* same length for the first record, it has no comma */
+        HttpWriter_append(pWriter, first ? " {" : ",{", 2);
+    }
+
+    for(field = 0; field < RecordLogField_Max; field++)
+    {
+        pColumn = &gRecordLogColumns[field];
+        if(field > 0)
+        {
+            HttpWriter_appendChar(pWriter, ',');
+        }
+        if(format == RecordLogFormat_Json)
+        {
+            HttpWriter_appendChar(pWriter, '"');
+            HttpWriter_appendStr(pWriter, pColumn->name);
+            HttpWriter_append(pWriter, "\":", 2);
+        }
+
+        if(field == RecordLogField_Time)
+        {
+            if(format == RecordLogFormat_Json)
+            {
+                HttpWriter_appendChar(pWriter, '"');
+            }
+            recordLogRenderTime(pRecord->time, pWriter);
+            if(format == RecordLogFormat_Json)
+            {
+                HttpWriter_appendChar(pWriter, '"');
+            }
+        }
+        else
+        {
+            HttpWriter_appendFixed(pWriter, recordLogValue(pRecord, field),
+                                   pColumn->decimals, pColumn->width);
+        }
+    }
+
+    if(format == RecordLogFormat_Json)
+    {
+        HttpWriter_append(pWriter, "}\n", 2);
+    }
+    else
+    {
+        HttpWriter_append(pWriter, "\r\n", 2);
+    }
+}
+
+void RecordLog_exportEnd(RecordLogFormat format, HttpWriter_t *pWriter)
+{
+    if(format == RecordLogFormat_Json)
+    {
+        HttpWriter_append(pWriter, "]\n", 2);
+    }
+}
@@ -0,0 +1,344 @@
+/*
+ * record_log.h
+ *
+ *  Binary data log on the SD card. Every logged sample is a fixed size
+ *  record appended to a preallocated file behind a versioned header, no
+ *  text is formatted on the device. There is a file per day of the device
+ *  clock, dYYMMDD.bin, with an index of the first record of every hour
+ *  next to it, dYYMMDD.idx, so a time range is found with a few reads.
+ *  The exporter renders the records as CSV or JSON only when they are
+ *  downloaded; every record renders to the same length, so the size of an
+ *  export is known before it is sent.
+ *
+ *  Appends go to a RAM copy of the last sector of the file, which is
+ *  written back whole when it is full, when its oldest unsaved record gets
+ *  RECORD_LOG_FLUSH_AGE_MS old or before a reboot.
+ */
+
+#ifndef RECORD_LOG_H_
+#define RECORD_LOG_H_
+
+#include <stdint.h>
+
+#include "http_writer.h"
+
+/* day files are named dYYMMDD.bin and dYYMMDD.idx, an unreadable one is
+   kept as dYYMMDD.old and a new one started */
+#define RECORD_LOG_DRIVE                "fat:0:"
+#define RECORD_LOG_NAME_LEN             (24)
+
+#define RECORD_LOG_SECONDS_PER_DAY      (24UL * 60 * 60)
+/* day of a record time, the day files are numbered by */
+#define RECORD_LOG_DAY(time)            ((time) / RECORD_LOG_SECONDS_PER_DAY)
+
+/* most day files one export reads */
+#define RECORD_LOG_RANGE_MAX_DAYS       (31)
+
+#define RECORD_LOG_MAGIC                (0x474F4C44)    /* "DLOG" */
+#define RECORD_LOG_INDEX_MAGIC          (0x58444944)    /* "DIDX" */
+#define RECORD_LOG_VERSION              (1)
+
+/* day index entries, one per hour, and the entry of an hour with no record */
+#define RECORD_LOG_INDEX_LEN            (24)
+#define RECORD_LOG_INDEX_NONE           (0xFFFFFFFF)
+
+/* the file grows by this many zeroed records when it is full, 64 KB */
+#define RECORD_LOG_GROW_RECORDS         (2048)
+
+/* SD sector, the unit the log is written back in */
+#define RECORD_LOG_SECTOR_LEN           (512)
+/* longest an appended record stays in RAM only, lost on a power cut */
+#define RECORD_LOG_FLUSH_AGE_MS         (5 * 60 * 1000)
+
+/* returned by RecordLog_append() for a record older than the last one of
+   its day, the clock went back */
+#define RECORD_LOG_OUT_OF_ORDER         (-2)
+
+/* RecordLog_Record_t state bits */
+#define RECORD_LOG_STATE_LIGHTS         (0x01)
+#define RECORD_LOG_STATE_FANS           (0x02)
+#define RECORD_LOG_STATE_COOLING        (0x04)
+#define RECORD_LOG_STATE_CONNECTED      (0x08)   /* a station is connected */
+
+typedef enum
+{
+    RecordLogFormat_Csv,
+    RecordLogFormat_Json,
+    RecordLogFormat_Max
+}RecordLogFormat;
+
+/* file header, the size of a record so the records stay sector aligned */
+typedef struct
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;
+    uint32_t created;           /* seconds since 1970 */
+    uint8_t  reserved[20];
+}RecordLog_Header_t;
+
+/* the .idx file of a day, written back after the records it points to.
+   RecordLog_append() keeps the records of a day sorted by time */
+typedef struct
+{
+    uint32_t magic;
+    uint32_t hourFirst[RECORD_LOG_INDEX_LEN];   /* record index */
+}RecordLog_Index_t;
+
+/* 32 bytes, 16 records per SD sector. a record with a zero time or a bad
+   CRC ends the log */
+typedef struct
+{
+    uint32_t time;              /* seconds since 1970, device clock */
+    uint32_t uptime;            /* seconds since boot */
+    uint32_t presIn;            /* Pa */
+    uint32_t presOut;
+    int16_t  tempIn;            /* 0.01 C */
+    int16_t  tempOut;
+    int16_t  irTemp;            /* TMP006, 0.01 C */
+    uint16_t oxygen;            /* milli-percent */
+    uint16_t airQuality;        /* eCO2 in ppm */
+    uint8_t  humidIn;           /* % */
+    uint8_t  humidOut;
+    uint8_t  state;             /* RECORD_LOG_STATE_ bits */
+    uint8_t  staleMask;         /* bit (1 << SnapshotSensor) */
+    uint16_t crc;               /* CRC-16/CCITT of the fields above */
+}RecordLog_Record_t;
+
+typedef struct
+{
+    uint32_t appends;
+    uint32_t writes;            /* fwrite() calls, growing the file included */
+    uint32_t bytesWritten;
+    uint32_t flushes;           /* sectors written back */
+    uint32_t flushErrors;
+    uint32_t flushTotalMs;
+    uint32_t flushMaxMs;
+    uint32_t outOfOrder;        /* records dropped, older than their day */
+}RecordLog_Stats_t;
+
+//*****************************************************************************
+//
+//! \brief Opens the file of the current day, or creates it, and finds the
+//!        end of the records. Called once the SD card is mounted, and again
+//!        to reopen the log after a failed append.
+//!
+//! \param[in]  now           current time, seconds since 1970, picks the
+//!                           day file and is stamped in the header of a new
+//!                           one
+//!
+//! \return 0 on success, -1 if the log can not be opened
+//!
+//****************************************************************************
+int32_t RecordLog_open(uint32_t now);
+
+//*****************************************************************************
+//
+//! \brief Appends a record, growing the file when it is full. The record
+//!        is buffered, a full sector is written back at once. The first
+//!        record of another day closes the day file and opens the next. A
+//!        record older than the last one of its day is dropped, the range
+//!        lookups rely on the records of a day being sorted by time. The
+//!        clock goes back after a reset, until it is set again.
+//!
+//! \param[in,out] pRecord    record to append, its crc is filled in
+//!
+//! \return 0 on success, RECORD_LOG_OUT_OF_ORDER if the record was
+//!         dropped, -1 on failure
+//!
+//****************************************************************************
+int32_t RecordLog_append(RecordLog_Record_t *pRecord);
+
+//*****************************************************************************
+//
+//! \brief Writes the buffered sector back to the card. Called before a
+//!        reboot, the records appended since the last write back are lost
+//!        otherwise.
+//!
+//! \param  none
+//!
+//! \return 0 on success or when nothing is buffered, -1 on failure
+//!
+//****************************************************************************
+int32_t RecordLog_flush(void);
+
+//*****************************************************************************
+//
+//! \brief Writes the buffered sector back once its oldest unsaved record is
+//!        RECORD_LOG_FLUSH_AGE_MS old. The system task calls this every
+//!        second.
+//!
+//! \param  none
+//!
+//! \return none
+//!
+//****************************************************************************
+void RecordLog_poll(void);
+
+//*****************************************************************************
+//
+//! \brief Copies the write counters of the log
+//!
+//! \param[out] pStats        counters
+//!
+//! \return none
+//!
+//****************************************************************************
+void RecordLog_getStats(RecordLog_Stats_t *pStats);
+
+//*****************************************************************************
+//
+//! \brief Returns the number of records in the file of the current day
+//!
+//! \param  none
+//!
+//! \return record count, 0 if the log is not open
+//!
+//****************************************************************************
+uint32_t RecordLog_getCount(void);
+
+//*****************************************************************************
+//
+//! \brief Returns the current day, the one records are appended to
+//!
+//! \param  none
+//!
+//! \return RECORD_LOG_DAY() of the open file, 0 if the log is not open
+//!
+//****************************************************************************
+uint32_t RecordLog_getDay(void);
+
+//*****************************************************************************
+//
+//! \brief Finds the records of a day file in a time range, with the hour
+//!        index and a binary search within the hour
+//!
+//! \param[in]  day           RECORD_LOG_DAY() of the file
+//!
+//! \param[in]  from          first time wanted, seconds since 1970
+//!
+//! \param[in]  to            end of the range, not included
+//!
+//! \param[out] pFirst        index of the first record in the range
+//!
+//! \param[out] pEnd          index after the last record in the range
+//!
+//! \return 0 on success, -1 if there is no file for the day
+//!
+//****************************************************************************
+int32_t RecordLog_find(uint32_t day, uint32_t from, uint32_t to,
+                       uint32_t *pFirst, uint32_t *pEnd);
+
+//*****************************************************************************
+//
+//! \brief Copies records out of a day file
+//!
+//! \param[in]  day           RECORD_LOG_DAY() of the file
+//!
+//! \param[in]  first         index of the first record
+//!
+//! \param[out] pRecords      destination of the records
+//!
+//! \param[in]  maxCount      number of records pRecords holds
+//!
+//! \return number of records copied, -1 on failure
+//!
+//****************************************************************************
+int32_t RecordLog_read(uint32_t day, uint32_t first,
+                       RecordLog_Record_t *pRecords, uint16_t maxCount);
+
+//*****************************************************************************
+//
+//! \brief Converts a date of the device clock to seconds since 1970
+//!
+//! \param[in]  year          full year, 1970 to 2105
+//!
+//! \param[in]  month         1 to 12
+//!
+//! \param[in]  day           1 to 31
+//!
+//! \param[in]  hour          0 to 23
+//!
+//! \param[in]  minute        0 to 59
+//!
+//! \param[in]  second        0 to 59
+//!
+//! \return seconds since 1970
+//!
+//****************************************************************************
+uint32_t RecordLog_makeTime(uint32_t year, uint32_t month, uint32_t day,
+                            uint32_t hour, uint32_t minute, uint32_t second);
+
+//*****************************************************************************
+//
+//! \brief Returns the length of an export
+//!
+//! \param[in]  format        export format
+//!
+//! \param[in]  count         records exported
+//!
+//! \return bytes written by RecordLog_exportBegin(), count times
+//!         RecordLog_exportRecord() and RecordLog_exportEnd()
+//!
+//****************************************************************************
+uint32_t RecordLog_exportSize(RecordLogFormat format, uint32_t count);
+
+//*****************************************************************************
+//
+//! \brief Returns the length of one exported record, every record renders
+//!        to this length
+//!
+//! \param[in]  format        export format
+//!
+//! \return bytes per record
+//!
+//****************************************************************************
+uint16_t RecordLog_exportRecordSize(RecordLogFormat format);
+
+//*****************************************************************************
+//
+//! \brief Renders the start of an export, the CSV column names or the
+//!        opening of the JSON array
+//!
+//! \param[in]  format        export format
+//!
+//! \param[in]  pWriter       writer to render to
+//!
+//! \return none
+//!
+//****************************************************************************
+void RecordLog_exportBegin(RecordLogFormat format, HttpWriter_t *pWriter);
+
+//*****************************************************************************
+//
+//! \brief Renders a record
+//!
+//! \param[in]  format        export format
+//!
+//! \param[in]  pRecord       record to render
+//!
+//! \param[in]  first         the first record of the export
+//!
+//! \param[in]  pWriter       writer to render to
+//!
+//! \return none
+//!
+//****************************************************************************
+void RecordLog_exportRecord(RecordLogFormat format,
+                            const RecordLog_Record_t *pRecord,
+                            uint8_t first, HttpWriter_t *pWriter);
+
+//*****************************************************************************
+//
+//! \brief Renders the end of an export
+//!
+//! \param[in]  format        export format
+//!
+//! \param[in]  pWriter       writer to render to
+//!
+//! \return none
+//!
+//****************************************************************************
+void RecordLog_exportEnd(RecordLogFormat format, HttpWriter_t *pWriter);
+
+#endif /* RECORD_LOG_H_ */
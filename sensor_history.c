@@ -0,0 +1,476 @@
+/*
+ * sensor_history.c
+ *
+ *  Single writer / many reader history of the readings. The 1 s tier is a
+ *  ring of one minute blocks: a block starts with the absolute codes of
+ *  its first second and holds 4-bit differences for the others, a step
+ *  larger than a difference can hold is spread over the next seconds. The
+ *  1 min and 15 min tiers are rings of codes, every sample the average of
+ *  the finer one, accumulated as the samples come in.
+ *
+ *  The writer fills a sample before it moves the head, the rings keep a
+ *  spare slot (a spare block for the 1 s tier) and a reader checks the
+ *  head again after its copy, like the accelerometer ring.
+ */
+
+/* standard includes */
+#include <string.h>
+
+#include "sensor_history.h"
+
+/* keep the compiler (and the core) from moving the ring writes across the
+   head update */
+#if defined (__GNUC__)
+#define HISTORY_BARRIER()       __asm volatile ("dmb" ::: "memory")
+#else
+#define HISTORY_BARRIER()       __asm(" dmb")
+#endif
+
+#define HISTORY_BLOCK_LEN       (60)
+/* the hour, the block being written and a spare one */
+#define HISTORY_BLOCKS          ((SENSOR_HISTORY_SECOND_LEN / \
+                                  HISTORY_BLOCK_LEN) + 2)
+#define HISTORY_QUARTER_MINUTES (15)
+
+/* difference nibble of a missing reading, the others are -7..7 */
+#define HISTORY_DELTA_MISSING   (0x8)
+#define HISTORY_DELTA_MAX       (7)
+#define HISTORY_CODE_MAX        (SENSOR_HISTORY_MISSING - 1)
+
+typedef struct
+{
+    uint8_t key[SensorHistoryChannel_Max];
+    uint8_t keyMissing;         /* bit per channel */
+    /* seconds 1 to 59, two channels per byte, the even one in the low
+       nibble */
+    uint8_t delta[HISTORY_BLOCK_LEN - 1][SensorHistoryChannel_Max / 2];
+}HistoryBlock_t;
+
+/* reading = offset + code * scale */
+typedef struct
+{
+    SnapshotSensor sensor;
+    int32_t offset;
+    int32_t scale;
+}HistoryChannel_t;
+
+static const HistoryChannel_t gHistoryChannels[SensorHistoryChannel_Max] =
+{
+    [SensorHistoryChannel_TempIn]     = {SnapshotSensor_Bme280In, -1000, 25},
+    [SensorHistoryChannel_HumidIn]    = {SnapshotSensor_Bme280In, 0, 1},
+    [SensorHistoryChannel_Oxygen]     = {SnapshotSensor_Oxygen, 0, 100},
+    [SensorHistoryChannel_AirQuality] = {SnapshotSensor_Ccs811, 400, 32},
+};
+
+static const uint32_t gHistoryStep[SensorHistoryTier_Max] =
+{
+    [SensorHistoryTier_Second]  = 1,
+    [SensorHistoryTier_Minute]  = 60,
+    [SensorHistoryTier_Quarter] = 60 * HISTORY_QUARTER_MINUTES,
+};
+
+static HistoryBlock_t gHistorySeconds[HISTORY_BLOCKS];
+static SensorHistorySample_t gHistoryMinutes[SENSOR_HISTORY_MINUTE_LEN + 1];
+static SensorHistorySample_t gHistoryQuarters[SENSOR_HISTORY_QUARTER_LEN + 1];
+/* samples per tier since the start. 2^32 seconds is longer than the box
+   runs, the numbers do not wrap */
+static volatile uint32_t gHistoryHead[SensorHistoryTier_Max];
+
+/* writer state: codes the 1 s tier decodes to, and the sums of the
+   averages being accumulated */
+static uint8_t gHistoryPredict[SensorHistoryChannel_Max];
+static uint16_t gHistoryMinuteSum[SensorHistoryChannel_Max];
+static uint8_t gHistoryMinuteNum[SensorHistoryChannel_Max];
+static uint16_t gHistoryQuarterSum[SensorHistoryChannel_Max];
+static uint8_t gHistoryQuarterNum[SensorHistoryChannel_Max];
+
+//*****************************************************************************
+//
+//! \brief Converts a reading to its code
+//!
+//! \param[in]  channel       channel of the reading
+//!
+//! \param[in]  value         reading in the unit of the sensor snapshot
+//!
+//! \return code, rounded and clamped to the channel range
+//!
+//****************************************************************************
+static uint8_t sensorHistoryEncode(uint8_t channel, int32_t value)
+{
+    const HistoryChannel_t *pChannel = &gHistoryChannels[channel];
+
+    value = (value - pChannel->offset + (pChannel->scale / 2)) /
+            pChannel->scale;
+    if(value < 0)
+    {
+        return(0);
+    }
+
+    return((value > HISTORY_CODE_MAX) ? HISTORY_CODE_MAX : (uint8_t)value);
+}
+
+//*****************************************************************************
+//
+//! \brief Averages the codes accumulated for a coarser tier, then clears
+//!        the sums
+//!
+//! \param[in,out] pSum       code sums, per channel
+//!
+//! \param[in,out] pNum       codes summed, per channel
+//!
+//! \param[out] pSample       averages, missing where nothing was summed
+//!
+//! \return none
+//!
+//****************************************************************************
+static void sensorHistoryAverage(uint16_t *pSum, uint8_t *pNum,
+                                 SensorHistorySample_t *pSample)
+{
+    uint8_t ch;
+
+    for(ch = 0; ch < SensorHistoryChannel_Max; ch++)
+    {
+        pSample->code[ch] = (pNum[ch] == 0) ? SENSOR_HISTORY_MISSING :
+                            (uint8_t)((pSum[ch] + (pNum[ch] / 2)) / pNum[ch]);
+        pSum[ch] = 0;
+        pNum[ch] = 0;
+    }
+}
+
+//*****************************************************************************
+//
+//! \brief Adds the valid codes of a sample to the sums of a coarser tier
+//!
+//! \param[in]  pSample       sample to add
+//!
+//! \param[in,out] pSum       code sums, per channel
+//!
+//! \param[in,out] pNum       codes summed, per channel
+//!
+//! \return none
+//!
+//****************************************************************************
+static void sensorHistoryAccumulate(const SensorHistorySample_t *pSample,
+                                    uint16_t *pSum, uint8_t *pNum)
+{
+    uint8_t ch;
+
+    for(ch = 0; ch < SensorHistoryChannel_Max; ch++)
+    {
+        if(pSample->code[ch] != SENSOR_HISTORY_MISSING)
+        {
+            pSum[ch] += pSample->code[ch];
+            pNum[ch]++;
+        }
+    }
+}
+
+//*****************************************************************************
+//
+//! \brief Appends a sample to the ring of the 1 min or the 15 min tier
+//!
+//! \param[in]  tier          tier to append to
+//!
+//! \param[in]  pSample       sample to append
+//!
+//! \return none
+//!
+//****************************************************************************
+static void sensorHistoryPush(uint8_t tier, const SensorHistorySample_t *pSample)
+{
+    uint32_t head = gHistoryHead[tier];
+
+    if(tier == SensorHistoryTier_Minute)
+    {
+        gHistoryMinutes[head % (SENSOR_HISTORY_MINUTE_LEN + 1)] = *pSample;
+    }
+    else
+    {
+        gHistoryQuarters[head % (SENSOR_HISTORY_QUARTER_LEN + 1)] = *pSample;
+    }
+    HISTORY_BARRIER();
+    gHistoryHead[tier] = head + 1;
+}
+
+//*****************************************************************************
+//
+//! \brief Returns the number of the oldest sample of a tier that is safe
+//!        to copy
+//!
+//! \param[in]  tier          tier to check
+//!
+//! \param[in]  head          head of the tier
+//!
+//! \return sample number
+//!
+//****************************************************************************
+static uint32_t sensorHistoryOldest(uint8_t tier, uint32_t head)
+{
+    uint32_t block;
+
+    switch(tier)
+    {
+    case SensorHistoryTier_Second:
+        /* the spare block may be rewritten while a reader decodes it */
+        block = head / HISTORY_BLOCK_LEN;
+        return((block > (HISTORY_BLOCKS - 2)) ?
+               ((block - (HISTORY_BLOCKS - 2)) * HISTORY_BLOCK_LEN) : 0);
+    case SensorHistoryTier_Minute:
+        return((head > SENSOR_HISTORY_MINUTE_LEN) ?
+               (head - SENSOR_HISTORY_MINUTE_LEN) : 0);
+    default:
+        return((head > SENSOR_HISTORY_QUARTER_LEN) ?
+               (head - SENSOR_HISTORY_QUARTER_LEN) : 0);
+    }
+}
+
+//*****************************************************************************
+//
+//! \brief Decodes a range of the 1 s tier, from the start of the block of
+//!        its first sample
+//!
+//! \param[in]  seq           first sample to decode
+//!
+//! \param[in]  count         samples to decode
+//!
+//! \param[out] pSamples      decoded samples
+//!
+//! \return none
+//!
+//****************************************************************************
+static void sensorHistoryDecodeSeconds(uint32_t seq, uint16_t count,
+                                       SensorHistorySample_t *pSamples)
+{
+    const HistoryBlock_t *pBlock = NULL;
+    uint8_t value[SensorHistoryChannel_Max];
+    uint32_t sec, pos;
+    uint8_t ch, nibble, missing;
+
+    for(sec = seq - (seq % HISTORY_BLOCK_LEN); sec < (seq + count); sec++)
+    {
+        pos = sec % HISTORY_BLOCK_LEN;
+        if(pos == 0)
+        {
+            pBlock = &gHistorySeconds[(sec / HISTORY_BLOCK_LEN) %
+                                      HISTORY_BLOCKS];
+            memcpy(value, pBlock->key, sizeof(value));
+            missing = pBlock->keyMissing;
+        }
+        else
+        {
+            missing = 0;
+            for(ch = 0; ch < SensorHistoryChannel_Max; ch++)
+            {
+                nibble = (pBlock->delta[pos - 1][ch >> 1] >> ((ch & 1) * 4)) &
+                         0xF;
+                if(nibble == HISTORY_DELTA_MISSING)
+                {
+                    missing |= (1 << ch);
+                }
+                else
+                {
+                    /* sign extended */
+                    value[ch] += (int8_t)((nibble ^ 0x8) - 0x8);
+                }
+            }
+        }
+
+        if(sec >= seq)
+        {
+            for(ch = 0; ch < SensorHistoryChannel_Max; ch++)
+            {
+                pSamples[sec - seq].code[ch] = (missing & (1 << ch)) ?
+                                               SENSOR_HISTORY_MISSING :
+                                               value[ch];
+            }
+        }
+    }
+}
+
+void SensorHistory_add(const SensorSnapshot_t *pReadings)
+{
+    SensorHistorySample_t sample;
+    HistoryBlock_t *pBlock;
+    uint32_t head, pos;
+    int32_t value, delta;
+    uint8_t ch, sensor, nibble;
+
+    for(ch = 0; ch < SensorHistoryChannel_Max; ch++)
+    {
+        sensor = gHistoryChannels[ch].sensor;
+        if((pReadings->staleMask & (1 << sensor)) ||
+           (pReadings->sensorTick[sensor] == 0))
+        {
+            sample.code[ch] = SENSOR_HISTORY_MISSING;
+            continue;
+        }
+
+        switch(ch)
+        {
+        case SensorHistoryChannel_TempIn:
+            value = pReadings->tempIn;
+            break;
+        case SensorHistoryChannel_HumidIn:
+            value = (int32_t)pReadings->humidIn;
+            break;
+        case SensorHistoryChannel_Oxygen:
+            value = pReadings->oxygen;
+            break;
+        default:
+            value = pReadings->airQuality;
+            break;
+        }
+        sample.code[ch] = sensorHistoryEncode(ch, value);
+    }
+
+    head = gHistoryHead[SensorHistoryTier_Second];
+    pos = head % HISTORY_BLOCK_LEN;
+    pBlock = &gHistorySeconds[(head / HISTORY_BLOCK_LEN) % HISTORY_BLOCKS];
+    if(pos == 0)
+    {
+        /* a missing key keeps the last code, the differences go on from it */
+        pBlock->keyMissing = 0;
+        for(ch = 0; ch < SensorHistoryChannel_Max; ch++)
+        {
+            if(sample.code[ch] == SENSOR_HISTORY_MISSING)
+            {
+                pBlock->keyMissing |= (1 << ch);
+            }
+            else
+            {
+                gHistoryPredict[ch] = sample.code[ch];
+            }
+            pBlock->key[ch] = gHistoryPredict[ch];
+        }
+    }
+    else
+    {
+        memset(pBlock->delta[pos - 1], 0, sizeof(pBlock->delta[0]));
+        for(ch = 0; ch < SensorHistoryChannel_Max; ch++)
+        {
+            if(sample.code[ch] == SENSOR_HISTORY_MISSING)
+            {
+                nibble = HISTORY_DELTA_MISSING;
+            }
+            else
+            {
+                delta = (int32_t)sample.code[ch] - gHistoryPredict[ch];
+                if(delta > HISTORY_DELTA_MAX)
+                {
+                    delta = HISTORY_DELTA_MAX;
+                }
+                else if(delta < -HISTORY_DELTA_MAX)
+                {
+                    delta = -HISTORY_DELTA_MAX;
+                }
+                /* the reader decodes the same code */
+                gHistoryPredict[ch] += delta;
+                nibble = (uint8_t)delta & 0xF;
+            }
+            pBlock->delta[pos - 1][ch >> 1] |= nibble << ((ch & 1) * 4);
+        }
+    }
+    HISTORY_BARRIER();
+    gHistoryHead[SensorHistoryTier_Second] = head + 1;
+
+    /* the averages take the exact codes, not the differences */
+    sensorHistoryAccumulate(&sample, gHistoryMinuteSum, gHistoryMinuteNum);
+    if(pos != (HISTORY_BLOCK_LEN - 1))
+    {
+        return;
+    }
+
+    sensorHistoryAverage(gHistoryMinuteSum, gHistoryMinuteNum, &sample);
+    sensorHistoryPush(SensorHistoryTier_Minute, &sample);
+
+    sensorHistoryAccumulate(&sample, gHistoryQuarterSum, gHistoryQuarterNum);
+    if((gHistoryHead[SensorHistoryTier_Minute] % HISTORY_QUARTER_MINUTES) != 0)
+    {
+        return;
+    }
+
+    sensorHistoryAverage(gHistoryQuarterSum, gHistoryQuarterNum, &sample);
+    sensorHistoryPush(SensorHistoryTier_Quarter, &sample);
+}
+
+uint32_t SensorHistory_getHead(SensorHistoryTier tier)
+{
+    return((tier < SensorHistoryTier_Max) ? gHistoryHead[tier] : 0);
+}
+
+uint32_t SensorHistory_getStep(SensorHistoryTier tier)
+{
+    return((tier < SensorHistoryTier_Max) ? gHistoryStep[tier] : 0);
+}
+
+uint16_t SensorHistory_read(SensorHistoryTier tier, uint32_t *pSeq,
+                            SensorHistorySample_t *pSamples,
+                            uint16_t maxCount)
+{
+    uint32_t head, oldest, seq;
+    uint16_t count, idx, skip;
+
+    if(tier >= SensorHistoryTier_Max)
+    {
+        return(0);
+    }
+
+    head = gHistoryHead[tier];
+    HISTORY_BARRIER();
+
+    oldest = sensorHistoryOldest(tier, head);
+    seq = (*pSeq < oldest) ? oldest : *pSeq;
+    if(seq >= head)
+    {
+        *pSeq = head;
+        return(0);
+    }
+
+    count = ((head - seq) < maxCount) ? (uint16_t)(head - seq) : maxCount;
+    switch(tier)
+    {
+    case SensorHistoryTier_Second:
+        sensorHistoryDecodeSeconds(seq, count, pSamples);
+        break;
+    case SensorHistoryTier_Minute:
+        for(idx = 0; idx < count; idx++)
+        {
+            pSamples[idx] =
+                gHistoryMinutes[(seq + idx) % (SENSOR_HISTORY_MINUTE_LEN + 1)];
+        }
+        break;
+    default:
+        for(idx = 0; idx < count; idx++)
+        {
+            pSamples[idx] =
+                gHistoryQuarters[(seq + idx) % (SENSOR_HISTORY_QUARTER_LEN + 1)];
+        }
+        break;
+    }
+
+    /* drop what the sensor task overwrote meanwhile */
+    HISTORY_BARRIER();
+    oldest = sensorHistoryOldest(tier, gHistoryHead[tier]);
+    skip = 0;
+    if(oldest > seq)
+    {
+        skip = ((oldest - seq) < count) ? (uint16_t)(oldest - seq) : count;
+        memmove(pSamples, pSamples + skip,
+                (count - skip) * sizeof(SensorHistorySample_t));
+    }
+
+    *pSeq = seq + skip;
+
+    return(count - skip);
+}
+
+int32_t SensorHistory_decode(SensorHistoryChannel channel, uint8_t code)
+{
+    if(channel >= SensorHistoryChannel_Max)
+    {
+        return(0);
+    }
+
+    return(gHistoryChannels[channel].offset +
+           ((int32_t)code * gHistoryChannels[channel].scale));
+}
@@ -0,0 +1,127 @@
+/*
+ * sensor_history.h
+ *
+ *  In-RAM history of the main readings at three resolutions: the last hour
+ *  at 1 s, the last day at 1 min and the last week at 15 min. The sensor
+ *  task adds a sample every second and the coarser tiers are averages
+ *  rolled up as the samples come in, so a chart of any range is served
+ *  from RAM without reading the SD card.
+ *
+ *  A reading is stored as a one byte code, the 1 s tier as 4-bit
+ *  differences from the previous second. Sample n of a tier covers the
+ *  seconds [n * step, (n + 1) * step) since the sensor task started.
+ */
+
+#ifndef SENSOR_HISTORY_H_
+#define SENSOR_HISTORY_H_
+
+#include <stdint.h>
+
+#include "sensor_snapshot.h"
+
+/* samples kept per tier */
+#define SENSOR_HISTORY_SECOND_LEN       (60 * 60)
+#define SENSOR_HISTORY_MINUTE_LEN       (24 * 60)
+#define SENSOR_HISTORY_QUARTER_LEN      (7 * 24 * 4)
+
+/* code of a reading the sensor did not deliver, or of an average with no
+   reading in it */
+#define SENSOR_HISTORY_MISSING          (0xFF)
+
+typedef enum
+{
+    SensorHistoryTier_Second,
+    SensorHistoryTier_Minute,
+    SensorHistoryTier_Quarter,      /* 15 min */
+    SensorHistoryTier_Max
+}SensorHistoryTier;
+
+/* codes per channel: inside temperature in 0.25 C from -10 C, inside
+   humidity in %, oxygen in 0.1%, eCO2 in 32 ppm from 400 ppm */
+typedef enum
+{
+    SensorHistoryChannel_TempIn,
+    SensorHistoryChannel_HumidIn,
+    SensorHistoryChannel_Oxygen,
+    SensorHistoryChannel_AirQuality,
+    SensorHistoryChannel_Max
+}SensorHistoryChannel;
+
+typedef struct
+{
+    uint8_t code[SensorHistoryChannel_Max];
+}SensorHistorySample_t;
+
+//*****************************************************************************
+//
+//! \brief Adds the 1 s sample and rolls it up into the coarser tiers. Only
+//!        the sensor task calls this, once per second.
+//!
+//! \param[in]  pReadings     readings of this second, the stale ones are
+//!                           stored as missing
+//!
+//! \return none
+//!
+//****************************************************************************
+void SensorHistory_add(const SensorSnapshot_t *pReadings);
+
+//*****************************************************************************
+//
+//! \brief Returns the number of samples a tier got since the start, the
+//!        number of the next sample
+//!
+//! \param[in]  tier          tier to check
+//!
+//! \return sample count, 0 if the tier is unknown
+//!
+//****************************************************************************
+uint32_t SensorHistory_getHead(SensorHistoryTier tier);
+
+//*****************************************************************************
+//
+//! \brief Returns the time a sample of a tier covers
+//!
+//! \param[in]  tier          tier to check
+//!
+//! \return step in seconds, 0 if the tier is unknown
+//!
+//****************************************************************************
+uint32_t SensorHistory_getStep(SensorHistoryTier tier);
+
+//*****************************************************************************
+//
+//! \brief Copies the samples of a tier, oldest first. Never blocks, a
+//!        sample overwritten during the copy is left out.
+//!
+//! \param[in]  tier          tier to read
+//!
+//! \param[in,out] pSeq       in: number of the first sample wanted. out:
+//!                           number of the first sample copied, later than
+//!                           asked for if the tier no longer holds it
+//!
+//! \param[out] pSamples      destination of the samples
+//!
+//! \param[in]  maxCount      number of samples pSamples holds
+//!
+//! \return number of samples copied, 0 when none is newer than *pSeq
+//!
+//****************************************************************************
+uint16_t SensorHistory_read(SensorHistoryTier tier, uint32_t *pSeq,
+                            SensorHistorySample_t *pSamples,
+                            uint16_t maxCount);
+
+//*****************************************************************************
+//
+//! \brief Converts a code back to a reading
+//!
+//! \param[in]  channel       channel of the code
+//!
+//! \param[in]  code          stored code, not SENSOR_HISTORY_MISSING
+//!
+//! \return reading in the unit of the sensor snapshot, to the code
+//!         resolution
+//!
+//****************************************************************************
+int32_t SensorHistory_decode(SensorHistoryChannel channel, uint8_t code);
+
+#endif /* SENSOR_HISTORY_H_ */
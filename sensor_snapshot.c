@@ -0,0 +1,63 @@
+/*
+ * sensor_snapshot.c
+ *
+ *  Single writer / many reader snapshot of the sensor readings, protected
+ *  by a sequence lock. The writer makes the counter odd while it copies and
+ *  even again when the copy is complete; a reader retries whenever it saw
+ *  an odd counter or the counter changed under its copy.
+ */
+
+/* standard includes */
+#include <string.h>
+
+/* Kernel includes */
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "sensor_snapshot.h"
+
+/* keep the compiler (and the core) from moving the snapshot copy across
+   the sequence counter updates */
+#if defined (__GNUC__)
+#define SNAPSHOT_BARRIER()      __asm volatile ("dmb" ::: "memory")
+#else
+#define SNAPSHOT_BARRIER()      __asm(" dmb")
+#endif
+
+static volatile uint32_t gSnapshotLock = 0;
+static SensorSnapshot_t gSnapshot;
+
+void SensorSnapshot_publish(SensorSnapshot_t *pSnapshot)
+{
+    pSnapshot->sampleTick = (uint32_t)xTaskGetTickCount();
+    pSnapshot->sequence = (gSnapshotLock >> 1) + 1;
+
+    gSnapshotLock++;            /* odd - update in progress */
+    SNAPSHOT_BARRIER();
+    memcpy(&gSnapshot, pSnapshot, sizeof(SensorSnapshot_t));
+    SNAPSHOT_BARRIER();
+    gSnapshotLock++;            /* even - snapshot consistent */
+}
+
+uint32_t SensorSnapshot_read(SensorSnapshot_t *pSnapshot)
+{
+    uint32_t start;
+
+    while(1)
+    {
+        start = gSnapshotLock;
+        if(start & 1)
+        {
+            /* the sampler was preempted mid-update, let it finish */
+            vTaskDelay(1);
+            continue;
+        }
+        SNAPSHOT_BARRIER();
+        memcpy(pSnapshot, &gSnapshot, sizeof(SensorSnapshot_t));
+        SNAPSHOT_BARRIER();
+        if(gSnapshotLock == start)
+        {
+            return(pSnapshot->sequence);
+        }
+    }
+}
@@ -0,0 +1,82 @@
+/*
+ * sensor_snapshot.h
+ *
+ *  Versioned copy of the latest sensor readings. The sampler publishes a
+ *  complete set of readings once per cycle and every HTTP callback copies
+ *  it out without touching the I2C bus or the sensor lock.
+ */
+
+#ifndef SENSOR_SNAPSHOT_H_
+#define SENSOR_SNAPSHOT_H_
+
+#include <stdint.h>
+
+/* sensors feeding the snapshot, each one is sampled on its own schedule */
+typedef enum
+{
+    SnapshotSensor_Bme280In,
+    SnapshotSensor_Bme280Out,
+    SnapshotSensor_Oxygen,
+    SnapshotSensor_Ccs811,
+    SnapshotSensor_Tmp006,
+    SnapshotSensor_Accel,
+    SnapshotSensor_Max
+}SnapshotSensor;
+
+typedef struct
+{
+    /* accelerometer (BMA2xx) */
+    int8_t   xVal;
+    int8_t   yVal;
+    int8_t   zVal;
+    /* IR temperature sensor (TMP006) */
+    float    temperatureVal;
+    /* inside/outside BME280, temperature in 0.01 C, pressure in Pa,
+       humidity in % */
+    int32_t  tempIn;
+    uint32_t presIn;
+    uint32_t humidIn;
+    int32_t  tempOut;
+    uint32_t presOut;
+    uint32_t humidOut;
+    /* oxygen in milli-percent, eCO2 in ppm */
+    uint16_t oxygen;
+    uint16_t airQuality;
+    /* bit (1 << SnapshotSensor) set when the sensor has no recent good
+       sample, its fields hold the last good values */
+    uint8_t  staleMask;
+    /* tick count of the last good sample of every sensor, 0 if never */
+    uint32_t sensorTick[SnapshotSensor_Max];
+    /* tick count of the sample and publish counter (never 0 once
+       published) */
+    uint32_t sampleTick;
+    uint32_t sequence;
+}SensorSnapshot_t;
+
+//*****************************************************************************
+//
+//! \brief Publishes a new set of readings. Only the sampler calls this.
+//!
+//! \param[in]  pSnapshot     readings to publish, sampleTick and sequence
+//!                           are filled in by this function
+//!
+//! \return none
+//!
+//****************************************************************************
+void SensorSnapshot_publish(SensorSnapshot_t *pSnapshot);
+
+//*****************************************************************************
+//
+//! \brief Copies the latest published readings. Safe from any task and
+//!        takes no lock. If the sampler was preempted in the middle of an
+//!        update the reader sleeps a tick, so a lower priority sampler can
+//!        finish, and copies again.
+//!
+//! \param[out] pSnapshot     destination of the copy
+//!
+//! \return sequence number of the copied readings (0 if nothing published)
+//!
+//****************************************************************************
+uint32_t SensorSnapshot_read(SensorSnapshot_t *pSnapshot);
+
+#endif /* SENSOR_SNAPSHOT_H_ */
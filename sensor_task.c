@@ -0,0 +1,1213 @@
+/*
+ * sensor_task.c
+ *
+ *  Sensor acquisition task. A schedule table gives every sensor its own
+ *  cadence; the task wakes every SENSOR_TASK_TICK_MS, samples the sensors
+ *  that are due or were asked for, and publishes the readings through the
+ *  sensor snapshot. No other task touches the sensor bus.
+ *
+ *  A round starts the conversion of every due sensor that needs one, does
+ *  the fast reads while they run and then collects the conversions, so a
+ *  round takes as long as the slowest conversion rather than their sum.
+ */
+
+/* standard includes */
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Kernel includes */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* TI-DRIVERS Header files */
+#include <Board.h>
+#include <uart_term.h>
+#include <ti/drivers/I2C.h>
+#include <ti/drivers/ADC.h>
+#include <ti/drivers/net/wifi/simplelink.h>
+
+#include "sensor_task.h"
+#include "sensor_history.h"
+#include "i2c_bus.h"
+
+/* External sensor Drivers*/
+#include "ccs811.h"
+#include "bme280.h"
+#include "bma2xxdrv.h"
+#include "tmp006drv.h"
+
+/* returned by a read function when the conversion is not complete yet */
+#define SENSOR_NOT_READY                (1)
+
+/* returned by sensorLoadFile() when the stored record has another size */
+#define SENSOR_FILE_BAD_LENGTH          (-1)
+
+/* keep the compiler (and the core) from moving the ring writes across the
+   head update */
+#if defined (__GNUC__)
+#define SENSOR_BARRIER()        __asm volatile ("dmb" ::: "memory")
+#else
+#define SENSOR_BARRIER()        __asm(" dmb")
+#endif
+
+typedef struct
+{
+    char *name;
+    /* starts a conversion and returns its duration in ms, or a negative
+       value on failure. NULL for sensors that read at once or convert
+       continuously */
+    int32_t (*pStart)(void);
+    /* 0 on a new reading, SENSOR_NOT_READY, or negative on failure */
+    int8_t (*pRead)(void);
+    uint32_t defaultPeriodMs;
+    /* time between two new readings of a sensor converting on its own,
+       slower than it is polled. 0 if every poll can bring one */
+    uint32_t dataIntervalMs;
+}SensorSchedule_t;
+
+static int32_t BME280InStart(void);
+static int8_t BME280InReading(void);
+static int32_t BME280OutStart(void);
+static int8_t BME280OutReading(void);
+static int8_t oxySensorReading(void);
+static int8_t ccs811Reading(void);
+static int8_t temperatureReading(void);
+static int8_t accelarometerReading(void);
+
+/* the CCS811 compensation uses the latest inside BME280 reading, at most
+   one BME280 period old. both BME280 share a cadence, so their conversions
+   run in the same pass */
+static const SensorSchedule_t gSensorSchedule[SnapshotSensor_Max] =
+{
+    [SnapshotSensor_Bme280In]  = {"inside BME280", BME280InStart,
+                                  BME280InReading, SENSOR_BME280_PERIOD_MS,
+                                  0},
+    [SnapshotSensor_Bme280Out] = {"outside BME280", BME280OutStart,
+                                  BME280OutReading, SENSOR_BME280_PERIOD_MS,
+                                  0},
+    [SnapshotSensor_Oxygen] = {"oxygen sensor", NULL, oxySensorReading,
+                               SENSOR_OXYGEN_PERIOD_MS, 0},
+    [SnapshotSensor_Ccs811] = {"CCS811", NULL, ccs811Reading,
+                               SENSOR_CCS811_PERIOD_MS,
+                               SENSOR_CCS811_DATA_MS},
+    [SnapshotSensor_Tmp006] = {"temperature sensor", NULL, temperatureReading,
+                               SENSOR_TMP006_PERIOD_MS, 0},
+    [SnapshotSensor_Accel]  = {"accelerometer", NULL, accelarometerReading,
+                               SENSOR_ACCEL_PERIOD_MS, 0},
+};
+
+static volatile uint32_t gSensorPeriodMs[SnapshotSensor_Max];
+/* one byte per sensor, so setting and clearing need no lock */
+static volatile uint8_t gSensorDemand[SnapshotSensor_Max];
+static TickType_t gSensorDue[SnapshotSensor_Max];
+/* consecutive failures and, once the breaker is open, the next attempt */
+typedef struct
+{
+    uint8_t failures;
+    TickType_t retryTick;
+}SensorHealth_t;
+static SensorHealth_t gSensorHealth[SnapshotSensor_Max];
+/* BME280 profile to apply, BME280_Profile_Max when none is pending */
+static volatile uint8_t gBmeProfileRequest = BME280_Profile_Max;
+
+/* readings being collected and the last published ones */
+static SensorSnapshot_t gSensorReadings;
+static SensorSnapshot_t gSensorPublished;
+static TickType_t gSensorLastPublish;
+static TickType_t gHistoryDue;
+
+static I2C_Handle i2cHandle;
+static BME280_Object gBme280In;
+static BME280_Object gBme280Out;
+static ccs811_sensor_t* sensor;
+/* compensation last written to the CCS811, the sensor forgets it on reset */
+static bool gCcsEnvValid;
+static int32_t gCcsEnvTemp;
+static uint32_t gCcsEnvHumid;
+/* conditioning start, then last baseline save */
+static TickType_t gCcsBaselineTick;
+static bool gCcsBaselineRestored;
+static ADC_Handle oxygenSensor;
+/* filtered readings at the calibration points, in 1/16 LSB, and the
+   resulting scale in milli-percent per 1/16 LSB, Q16 */
+static struct
+{
+    uint32_t zero;
+    uint32_t air;
+}gOxygenCal = {0, SENSOR_OXYGEN_NOMINAL_SPAN};
+static uint32_t gOxygenGain;
+/* calibration point to take, SensorOxygenCal_Max when none is pending */
+static volatile uint8_t gOxygenCalRequest = SensorOxygenCal_Max;
+
+/* streamed accelerometer samples. single writer, the sensor task; the
+   readers check the head again after their copy */
+static SensorAccelSample_t gAccelRing[SENSOR_ACCEL_RING_LEN];
+static volatile uint32_t gAccelHead;
+static volatile uint32_t gAccelOverruns;
+static bool gAccelFifo;
+static signed char gAccelFrames[BMA2XX_FIFO_MAX_FRAMES * BMA2XX_FIFO_FRAME_LEN];
+
+int32_t SensorTask_setPeriod(SnapshotSensor sensor, uint32_t periodMs)
+{
+    if(sensor >= SnapshotSensor_Max)
+    {
+        return(-1);
+    }
+
+    gSensorPeriodMs[sensor] = periodMs;
+    /* the new cadence starts now */
+    gSensorDemand[sensor] = 1;
+
+    return(0);
+}
+
+void SensorTask_demand(SnapshotSensor sensor)
+{
+    if(sensor < SnapshotSensor_Max)
+    {
+        gSensorDemand[sensor] = 1;
+    }
+}
+
+int32_t SensorTask_setBmeProfile(BME280_Profile profile)
+{
+    if(profile >= BME280_Profile_Max)
+    {
+        return(-1);
+    }
+
+    gBmeProfileRequest = profile;
+
+    return(0);
+}
+
+int32_t SensorTask_calibrateOxygen(SensorOxygenCal point)
+{
+    if(point >= SensorOxygenCal_Max)
+    {
+        return(-1);
+    }
+
+    gOxygenCalRequest = point;
+
+    return(0);
+}
+
+uint16_t SensorTask_readAccel(uint32_t *pSeq, SensorAccelSample_t *pSamples,
+                              uint16_t maxCount)
+{
+    uint32_t head, oldest, seq;
+    uint16_t count, idx, skip;
+
+    head = gAccelHead;
+    SENSOR_BARRIER();
+
+    /* a drain overwrites up to a FIFO worth of samples before it moves the
+       head, those are not safe to copy. the sequence numbers wrap, compare
+       their differences */
+    oldest = head - (SENSOR_ACCEL_RING_LEN - BMA2XX_FIFO_MAX_FRAMES);
+    seq = ((int32_t)(*pSeq - oldest) < 0) ? oldest : *pSeq;
+    if((int32_t)(head - seq) <= 0)
+    {
+        *pSeq = head;
+        return(0);
+    }
+
+    count = ((head - seq) < maxCount) ? (uint16_t)(head - seq) : maxCount;
+    for(idx = 0; idx < count; idx++)
+    {
+        pSamples[idx] = gAccelRing[(seq + idx) & (SENSOR_ACCEL_RING_LEN - 1)];
+    }
+
+    /* drop what the sensor task overwrote meanwhile */
+    SENSOR_BARRIER();
+    head = gAccelHead;
+    oldest = head - (SENSOR_ACCEL_RING_LEN - BMA2XX_FIFO_MAX_FRAMES);
+    skip = 0;
+    if((int32_t)(oldest - seq) > 0)
+    {
+        skip = ((oldest - seq) < count) ? (uint16_t)(oldest - seq) : count;
+        memmove(pSamples, pSamples + skip,
+                (count - skip) * sizeof(SensorAccelSample_t));
+    }
+
+    *pSeq = seq + skip;
+
+    return(count - skip);
+}
+
+uint32_t SensorTask_getAccelOverruns(void)
+{
+    return(gAccelOverruns);
+}
+
+//*****************************************************************************
+//
+//! Function to drain the accelarometer FIFO into the sample ring. The last
+//! frame is the reading published in the snapshot.
+//!
+//! \param  none
+//!
+//! \return SUCCESS, SENSOR_NOT_READY or FAILURE
+//!
+//*****************************************************************************
+static int8_t accelarometerDrain(void)
+{
+    SensorAccelSample_t *pFrame;
+    uint32_t head;
+    unsigned char overrun;
+    int32_t frames, idx;
+
+    frames = BMA2xxFifoRead(i2cHandle, gAccelFrames, BMA2XX_FIFO_MAX_FRAMES,
+                            &overrun);
+    if(frames < 0)
+    {
+        return(-1);
+    }
+    if(overrun)
+    {
+        gAccelOverruns++;
+    }
+    if(frames == 0)
+    {
+        return(SENSOR_NOT_READY);
+    }
+
+    pFrame = (SensorAccelSample_t *)gAccelFrames;
+    head = gAccelHead;
+    for(idx = 0; idx < frames; idx++)
+    {
+        gAccelRing[(head + idx) & (SENSOR_ACCEL_RING_LEN - 1)] = pFrame[idx];
+    }
+    SENSOR_BARRIER();
+    gAccelHead = head + frames;
+
+    pFrame += frames - 1;
+    gSensorReadings.xVal = pFrame->x / 6;
+    gSensorReadings.yVal = pFrame->y / 6;
+    gSensorReadings.zVal = pFrame->z / 6;
+
+    return(0);
+}
+
+//*****************************************************************************
+//
+//! Function to read accelarometer
+//!
+//! \param  none
+//!
+//! \return SUCCESS, SENSOR_NOT_READY or FAILURE
+//!
+//*****************************************************************************
+static int8_t accelarometerReading(void)
+{
+    int8_t xValRead, yValRead, zValRead;
+    int32_t status;
+
+    if(gAccelFifo)
+    {
+        return(accelarometerDrain());
+    }
+
+    /* Read accelarometer axis values */
+    status = BMA2xxReadNew(i2cHandle, &xValRead, &yValRead, &zValRead);
+    if(status != 0)
+    {
+        /* try to read again */
+        status = BMA2xxReadNew(i2cHandle, &xValRead, &yValRead, &zValRead);
+    }
+
+    if(status == 0)
+    {
+        gSensorReadings.xVal = xValRead;
+        gSensorReadings.yVal = yValRead;
+        gSensorReadings.zVal = zValRead;
+    }
+
+    return(status);
+}
+
+//*****************************************************************************
+//
+//! Function to read temperature. The TMP006 converts continuously, only a
+//! completed conversion is read.
+//!
+//! \param  none
+//!
+//! \return SUCCESS, SENSOR_NOT_READY or FAILURE
+//!
+//*****************************************************************************
+static int8_t temperatureReading(void)
+{
+    int32_t status;
+    float fTempRead;
+
+    /* Read temperature axis values */
+    status = TMP006DrvCollect(i2cHandle, &fTempRead);
+    if(status < 0)
+    {
+        /* try to read again */
+        status = TMP006DrvCollect(i2cHandle, &fTempRead);
+    }
+    if(status == TMP006_NOT_READY)
+    {
+        return(SENSOR_NOT_READY);
+    }
+
+    if(status == 0)
+    {
+        fTempRead = (fTempRead > 100) ? 100 : fTempRead;
+        gSensorReadings.temperatureVal = fTempRead;
+    }
+
+    return(status);
+}
+
+//*****************************************************************************
+//
+//! Function to collect a BME280 conversion
+//!
+//! \param  handle        BME280 to collect
+//! \param  pTemp         temperature in 0.01 C
+//! \param  pPres         pressure in Pa
+//! \param  pHumid        humidity in %
+//!
+//! \return SUCCESS(0), SENSOR_NOT_READY or FAILURE
+//!
+//*****************************************************************************
+static int8_t BME280Collect(BME280_Handle handle, int32_t *pTemp,
+                            uint32_t *pPres, uint32_t *pHumid)
+{
+    BME280_RawData *bmeDatIn;
+    BME280_Compensated bmeComp;
+
+    bmeDatIn = BME280_collect(handle);
+    if(bmeDatIn == NULL)
+    {
+        return(handle->txnError ? -1 : SENSOR_NOT_READY);
+    }
+
+    BME280_compensate(BME280_getCalibration(handle), bmeDatIn, &bmeComp, 1);
+    *pTemp = bmeComp.temperature;
+    *pHumid = bmeComp.humidity / 1024;
+    *pPres = bmeComp.pressure / 256;
+
+    return(0);
+}
+
+//*****************************************************************************
+//
+//! Functions to start a BME280 conversion. Nothing to start when a normal
+//! mode profile is applied, the conversion time is then 0.
+//!
+//! \param  none
+//!
+//! \return conversion time in ms, or -1 if the chip did not answer
+//!
+//*****************************************************************************
+static int32_t BME280Start(BME280_Handle handle)
+{
+    uint16_t convMs;
+
+    convMs = BME280_startMeasurement(handle);
+
+    return(handle->txnError ? -1 : (int32_t)convMs);
+}
+
+static int32_t BME280InStart(void)
+{
+    return(BME280Start(&gBme280In));
+}
+
+static int32_t BME280OutStart(void)
+{
+    return(BME280Start(&gBme280Out));
+}
+
+//*****************************************************************************
+//
+//! Functions to collect the BME280 conversions
+//!
+//! \param  none
+//!
+//! \return SUCCESS(0), SENSOR_NOT_READY or FAILURE
+//!
+//*****************************************************************************
+static int8_t BME280InReading(void)
+{
+    return(BME280Collect(&gBme280In, &gSensorReadings.tempIn,
+                         &gSensorReadings.presIn, &gSensorReadings.humidIn));
+}
+
+static int8_t BME280OutReading(void)
+{
+    return(BME280Collect(&gBme280Out, &gSensorReadings.tempOut,
+                         &gSensorReadings.presOut, &gSensorReadings.humidOut));
+}
+
+//*****************************************************************************
+//
+//! Functions to load and save a small record in the serial flash
+//!
+//! \param  pName         file name
+//! \param  pData         record to load or save
+//! \param  len           record size
+//!
+//! \return 0 on success, SENSOR_FILE_BAD_LENGTH if the stored record is
+//!         short, a SimpleLink error code otherwise
+//!
+//*****************************************************************************
+static int32_t sensorLoadFile(const char *pName, void *pData, uint32_t len)
+{
+    int32_t fileHandle;
+    int32_t status;
+
+    fileHandle = sl_FsOpen((uint8_t *)pName, SL_FS_READ, NULL);
+    if(fileHandle < 0)
+    {
+        return(fileHandle);
+    }
+
+    status = sl_FsRead(fileHandle, 0, (uint8_t *)pData, len);
+    if(status == (int32_t)len)
+    {
+        status = 0;
+    }
+    else if(status >= 0)
+    {
+        status = SENSOR_FILE_BAD_LENGTH;
+    }
+    sl_FsClose(fileHandle, NULL, NULL, 0);
+
+    return(status);
+}
+
+static int32_t sensorSaveFile(const char *pName, const void *pData,
+                              uint32_t len)
+{
+    int32_t fileHandle;
+    int32_t status;
+    uint32_t token = 0;
+
+    /* failsafe, a reset in the middle of the write keeps the old copy */
+    fileHandle = sl_FsOpen((uint8_t *)pName,
+                           SL_FS_CREATE | SL_FS_OVERWRITE |
+                           SL_FS_CREATE_FAILSAFE | SL_FS_CREATE_NOSIGNATURE |
+                           SL_FS_CREATE_MAX_SIZE(len),
+                           (_u32 *)&token);
+    if(fileHandle < 0)
+    {
+        return(fileHandle);
+    }
+
+    status = sl_FsWrite(fileHandle, 0, (uint8_t *)pData, len);
+    sl_FsClose(fileHandle, NULL, NULL, 0);
+
+    return((status == (int32_t)len) ? 0 : -1);
+}
+
+//*****************************************************************************
+//
+//! Function to keep the CCS811 baseline across resets. The saved baseline
+//! is written back once the sensor is conditioned, as the datasheet asks,
+//! and the current one is saved once a day.
+//!
+//! \param  none
+//!
+//! \return none
+//!
+//*****************************************************************************
+static void ccs811Baseline(void)
+{
+    TickType_t now = xTaskGetTickCount();
+    uint32_t elapsedMs = (now - gCcsBaselineTick) * portTICK_PERIOD_MS;
+    uint16_t baseline;
+    int32_t status;
+
+    if(!gCcsBaselineRestored)
+    {
+        if(elapsedMs < SENSOR_CCS811_CONDITION_MS)
+        {
+            return;
+        }
+
+        status = sensorLoadFile(SENSOR_CCS811_BASELINE_FILE, &baseline,
+                                sizeof(baseline));
+        if(status == 0)
+        {
+            if(ccs811_set_baseline(sensor, baseline))
+            {
+                UART_PRINT("[Sensor task] CCS811 baseline 0x%x restored\n\r",
+                           baseline);
+            }
+        }
+        else if((status == SL_RET_CODE_DEV_NOT_STARTED) ||
+                (status == SL_RET_CODE_DEV_LOCKED) ||
+                (status == SL_API_ABORTED))
+        {
+            /* the network processor is not up yet, next sample */
+            return;
+        }
+        else if(status != SL_ERROR_FS_FILE_NOT_EXISTS)
+        {
+            /* a bad copy is not retried, the next save overwrites it */
+            UART_PRINT("[Sensor task] CCS811 baseline not restored, "
+                       "error %d\n\r", status);
+        }
+
+        gCcsBaselineRestored = true;
+        gCcsBaselineTick = now;
+        return;
+    }
+
+    if(elapsedMs < SENSOR_CCS811_BASELINE_SAVE_MS)
+    {
+        return;
+    }
+
+    baseline = ccs811_get_baseline(sensor);
+    if((baseline != 0) &&
+       (sensorSaveFile(SENSOR_CCS811_BASELINE_FILE, &baseline,
+                       sizeof(baseline)) == 0))
+    {
+        gCcsBaselineTick = now;
+    }
+}
+
+//*****************************************************************************
+//
+//! Function to read CCS811. Only the status is read until a sample is
+//! ready, and the compensation is only rewritten when it moved.
+//!
+//! \param  none
+//!
+//! \return SUCCESS, SENSOR_NOT_READY or FAILURE
+//!
+//*****************************************************************************
+static int8_t ccs811Reading(void)
+{
+    uint16_t airQuality;
+    int32_t tempIn;
+    uint32_t humidIn;
+
+    if(sensor == NULL)
+    {
+        return(-1);
+    }
+
+    if(!ccs811_data_ready(sensor))
+    {
+        return((sensor->error_code == CCS811_DRV_NO_NEW_DATA) ?
+               SENSOR_NOT_READY : -1);
+    }
+
+    if(!ccs811_get_results(sensor, 0, &airQuality, 0, 0))
+    {
+        return(-1);
+    }
+
+    gSensorReadings.airQuality = airQuality;
+
+    /* applies from the next sample on */
+    tempIn = gSensorReadings.tempIn;
+    humidIn = gSensorReadings.humidIn;
+    if((gSensorReadings.sensorTick[SnapshotSensor_Bme280In] != 0) &&
+       (!gCcsEnvValid ||
+        (abs(tempIn - gCcsEnvTemp) >= SENSOR_CCS811_ENV_TEMP_DELTA) ||
+        (abs((int32_t)(humidIn - gCcsEnvHumid)) >=
+         SENSOR_CCS811_ENV_HUMID_DELTA)))
+    {
+        if(ccs811_set_environmental_data(sensor, ((float)tempIn) / 100,
+                                         (float)humidIn))
+        {
+            gCcsEnvValid = true;
+            gCcsEnvTemp = tempIn;
+            gCcsEnvHumid = humidIn;
+        }
+    }
+
+    ccs811Baseline();
+
+    return(0);
+}
+
+//*****************************************************************************
+//
+//! Function to derive the oxygen scale from the calibration points
+//!
+//! \param  none
+//!
+//! \return none
+//!
+//*****************************************************************************
+static void oxygenApplyCal(void)
+{
+    uint32_t span;
+
+    /* a span point at or below the zero point is not usable */
+    if(gOxygenCal.air <= gOxygenCal.zero)
+    {
+        gOxygenCal.zero = 0;
+        gOxygenCal.air = SENSOR_OXYGEN_NOMINAL_SPAN;
+    }
+
+    span = gOxygenCal.air - gOxygenCal.zero;
+    gOxygenGain = (((uint32_t)SENSOR_OXYGEN_AIR_MPCT << 16) + (span / 2)) /
+                  span;
+}
+
+//*****************************************************************************
+//
+//! Function to sample the oxygen sensor ADC. A block of conversions is
+//! sorted and the middle half summed, which drops the spikes a median
+//! would and averages the rest.
+//!
+//! \param  pReading      filtered reading in 1/16 LSB
+//!
+//! \return SUCCESS or FAILURE
+//!
+//*****************************************************************************
+static int8_t oxygenSample(uint32_t *pReading)
+{
+    uint16_t samples[SENSOR_OXYGEN_SAMPLES];
+    uint16_t sample;
+    uint32_t sum;
+    uint8_t idx, pos;
+
+    if(oxygenSensor == NULL)
+    {
+        return(-1);
+    }
+
+    /* insertion sort as they come in, the block is small */
+    for(idx = 0; idx < SENSOR_OXYGEN_SAMPLES; idx++)
+    {
+        if(ADC_convert(oxygenSensor, &sample) != ADC_STATUS_SUCCESS)
+        {
+            return(-1);
+        }
+
+        for(pos = idx; (pos > 0) && (samples[pos - 1] > sample); pos--)
+        {
+            samples[pos] = samples[pos - 1];
+        }
+        samples[pos] = sample;
+    }
+
+    sum = 0;
+    for(idx = SENSOR_OXYGEN_TRIM;
+        idx < (SENSOR_OXYGEN_SAMPLES - SENSOR_OXYGEN_TRIM); idx++)
+    {
+        sum += samples[idx];
+    }
+
+    /* 16 samples are summed, the sum is in 1/16 LSB as is */
+    *pReading = sum * 16 / (SENSOR_OXYGEN_SAMPLES - (2 * SENSOR_OXYGEN_TRIM));
+
+    return(0);
+}
+
+//*****************************************************************************
+//
+//! Function to read the oxygen sensor
+//!
+//! \param  none
+//!
+//! \return SUCCESS or FAILURE
+//!
+//*****************************************************************************
+static int8_t oxySensorReading(void)
+{
+    uint32_t reading, oxygen;
+
+    if(oxygenSample(&reading) != 0)
+    {
+        return(-1);
+    }
+
+    oxygen = 0;
+    if(reading > gOxygenCal.zero)
+    {
+        oxygen = (uint32_t)(((uint64_t)(reading - gOxygenCal.zero) *
+                             gOxygenGain) >> 16);
+    }
+    gSensorReadings.oxygen = (oxygen > UINT16_MAX) ? UINT16_MAX : oxygen;
+
+    return(0);
+}
+
+//*****************************************************************************
+//
+//! Function to take an oxygen calibration point and save the calibration
+//!
+//! \param  point         calibration point the sensor is exposed to
+//!
+//! \return none
+//!
+//*****************************************************************************
+static void oxygenCalibrate(SensorOxygenCal point)
+{
+    uint32_t reading;
+
+    if(point == SensorOxygenCal_Reset)
+    {
+        gOxygenCal.zero = 0;
+        gOxygenCal.air = SENSOR_OXYGEN_NOMINAL_SPAN;
+    }
+    else if(oxygenSample(&reading) != 0)
+    {
+        UART_PRINT("[Sensor task] Failed to sample oxygen calibration\n\r");
+        return;
+    }
+    else if(point == SensorOxygenCal_Zero)
+    {
+        gOxygenCal.zero = reading;
+    }
+    else
+    {
+        gOxygenCal.air = reading;
+    }
+
+    oxygenApplyCal();
+    if(sensorSaveFile(SENSOR_OXYGEN_CAL_FILE, &gOxygenCal,
+                      sizeof(gOxygenCal)) != 0)
+    {
+        UART_PRINT("[Sensor task] Failed to save oxygen calibration\n\r");
+    }
+
+    UART_PRINT("[Sensor task] oxygen zero %d, air %d (1/16 LSB)\n\r",
+               gOxygenCal.zero, gOxygenCal.air);
+    gSensorDemand[SnapshotSensor_Oxygen] = 1;
+}
+
+//*****************************************************************************
+//
+//! \brief Tells whether a sensor may be sampled: its breaker is closed, or
+//!        its backoff is over and it gets one more attempt
+//!
+//! \param[in]  idx           sensor to check
+//!
+//! \param[in]  now           tick count of this round
+//!
+//! \return true if the sensor may be sampled
+//!
+//****************************************************************************
+static bool sensorAvailable(uint8_t idx, TickType_t now)
+{
+    return((gSensorHealth[idx].failures < SENSOR_BREAKER_FAILURES) ||
+           ((int32_t)(now - gSensorHealth[idx].retryTick) >= 0));
+}
+
+//*****************************************************************************
+//
+//! \brief Counts a sensor attempt. A good sample closes the breaker, a
+//!        failure past SENSOR_BREAKER_FAILURES opens it for a backoff that
+//!        doubles on every further failure.
+//!
+//! \param[in]  idx           sensor attempted
+//!
+//! \param[in]  ok            true on a good sample, false on a failure
+//!
+//! \return none
+//!
+//****************************************************************************
+static void sensorHealthUpdate(uint8_t idx, bool ok)
+{
+    SensorHealth_t *pHealth = &gSensorHealth[idx];
+    uint32_t backoffMs;
+    uint8_t shift;
+
+    if(ok)
+    {
+        if(pHealth->failures >= SENSOR_BREAKER_FAILURES)
+        {
+            UART_PRINT("[Sensor task] %s recovered\n\r",
+                       gSensorSchedule[idx].name);
+        }
+        pHealth->failures = 0;
+        return;
+    }
+
+    if(pHealth->failures < UINT8_MAX)
+    {
+        pHealth->failures++;
+    }
+    if(pHealth->failures < SENSOR_BREAKER_FAILURES)
+    {
+        return;
+    }
+
+    shift = pHealth->failures - SENSOR_BREAKER_FAILURES;
+    backoffMs = SENSOR_BACKOFF_MAX_MS;
+    if((shift < 16) &&
+       ((SENSOR_BACKOFF_MIN_MS << shift) < SENSOR_BACKOFF_MAX_MS))
+    {
+        backoffMs = SENSOR_BACKOFF_MIN_MS << shift;
+    }
+    pHealth->retryTick = xTaskGetTickCount() + pdMS_TO_TICKS(backoffMs);
+
+    if(pHealth->failures == SENSOR_BREAKER_FAILURES)
+    {
+        UART_PRINT("[Sensor task] %s failing, retrying every %d ms at most\n\r",
+                   gSensorSchedule[idx].name, backoffMs);
+    }
+}
+
+//*****************************************************************************
+//
+//! \brief Flags the sensors with no recent good sample: breaker open, or
+//!        scheduled and not sampled for SENSOR_STALE_PERIODS periods, or
+//!        data intervals when the sensor converts slower than it is polled
+//!
+//! \param[in]  now           tick count of this round
+//!
+//! \return none
+//!
+//****************************************************************************
+static void sensorUpdateStale(TickType_t now)
+{
+    uint32_t periodMs;
+    uint8_t idx, mask = 0;
+
+    for(idx = 0; idx < SnapshotSensor_Max; idx++)
+    {
+        periodMs = gSensorPeriodMs[idx];
+        if((periodMs != 0) &&
+           (periodMs < gSensorSchedule[idx].dataIntervalMs))
+        {
+            periodMs = gSensorSchedule[idx].dataIntervalMs;
+        }
+        if(gSensorHealth[idx].failures >= SENSOR_BREAKER_FAILURES)
+        {
+            mask |= (1 << idx);
+        }
+        else if((periodMs != 0) &&
+                ((gSensorReadings.sensorTick[idx] == 0) ||
+                 ((now - gSensorReadings.sensorTick[idx]) >
+                  pdMS_TO_TICKS(SENSOR_STALE_PERIODS * periodMs))))
+        {
+            mask |= (1 << idx);
+        }
+    }
+
+    gSensorReadings.staleMask = mask;
+}
+
+//*****************************************************************************
+//
+//! \brief Publishes the readings if they changed, or if the last publish
+//!        is older than SENSOR_PUBLISH_MAX_MS
+//!
+//! \param[in]  now           tick count of this round of samples
+//!
+//! \return none
+//!
+//****************************************************************************
+static void sensorPublish(TickType_t now)
+{
+    /* both copies are zero filled, the padding compares equal */
+    if(!memcmp(&gSensorReadings, &gSensorPublished,
+               offsetof(SensorSnapshot_t, sensorTick)) &&
+       ((now - gSensorLastPublish) < pdMS_TO_TICKS(SENSOR_PUBLISH_MAX_MS)))
+    {
+        return;
+    }
+
+    memcpy(&gSensorPublished, &gSensorReadings, sizeof(SensorSnapshot_t));
+    SensorSnapshot_publish(&gSensorPublished);
+    gSensorLastPublish = now;
+}
+
+//*****************************************************************************
+//
+//! \brief Reads a sensor, stamps its sample tick and counts the attempt
+//!        in its health. A conversion not done yet counts neither way.
+//!
+//! \param[in]  idx           sensor to read
+//!
+//! \return the status of the read function
+//!
+//****************************************************************************
+static int8_t sensorCollect(uint8_t idx)
+{
+    TickType_t now;
+    int8_t status;
+
+    status = gSensorSchedule[idx].pRead();
+    if(status == 0)
+    {
+        now = xTaskGetTickCount();
+        /* 0 means never sampled */
+        gSensorReadings.sensorTick[idx] = (now != 0) ? now : 1;
+        sensorHealthUpdate(idx, true);
+    }
+    else if(status < 0)
+    {
+        /* quiet once the breaker is open, it logged the failure */
+        if(gSensorHealth[idx].failures < SENSOR_BREAKER_FAILURES)
+        {
+            UART_PRINT("[Sensor task] Failed to read %s\n\r",
+                       gSensorSchedule[idx].name);
+        }
+        sensorHealthUpdate(idx, false);
+    }
+
+    return(status);
+}
+
+void * sensorTask(void *pvParameters)
+{
+    ADC_Params adcParams;
+    TickType_t lastWake, now, elapsed, wait;
+    uint32_t periodMs, waitMs;
+    int32_t convMs;
+    uint8_t idx, due, pending, retries, profile, calPoint;
+    bool bmeOutOpen;
+
+    memset(&gSensorReadings, 0, sizeof(SensorSnapshot_t));
+    memset(&gSensorPublished, 0, sizeof(SensorSnapshot_t));
+
+    /* initializes I2C, the control loop readings go first */
+    i2cHandle = I2CBus_open(Board_I2C0, I2C_400kHz);
+    if(i2cHandle == NULL)
+    {
+        UART_PRINT("[Sensor task] Error Initializing I2C\n\r");
+    }
+    I2CBus_addDevice(SENSOR_BME280_IN_ADDR, "inside BME280",
+                     I2CBus_Priority_Control);
+    I2CBus_addDevice(SENSOR_BME280_OUT_ADDR, "outside BME280",
+                     I2CBus_Priority_Normal);
+    I2CBus_addDevice(CCS811_I2C_ADDRESS_1, "CCS811", I2CBus_Priority_Normal);
+    I2CBus_addDevice(TMP006_I2C_ADDR_CC3220X, "TMP006", I2CBus_Priority_Ui);
+    I2CBus_addDevice(BMA2XX_DEV_ADDR, "BMA2xx", I2CBus_Priority_Ui);
+
+    BME280_init(&gBme280In, i2cHandle, SENSOR_BME280_IN_ADDR);
+    if(!BME280_open(&gBme280In))
+    {
+        UART_PRINT("[Sensor task] ERROR opening inside BME280\r\n");
+    }
+
+    BME280_init(&gBme280Out, i2cHandle, SENSOR_BME280_OUT_ADDR);
+    bmeOutOpen = BME280_open(&gBme280Out);
+    if(!bmeOutOpen)
+    {
+        UART_PRINT("[Sensor task] outside BME280 not found\r\n");
+    }
+
+    sensor = ccs811_init_sensor(i2cHandle, CCS811_I2C_ADDRESS_1);
+    if(sensor == NULL)
+    {
+        UART_PRINT("[Sensor task] ERROR initializing CCS811\r\n");
+    }
+    else
+    {
+        ccs811_set_mode(sensor, ccs811_mode_10s);
+        /* nINT follows the data ready status the sensor task polls */
+        ccs811_enable_interrupt(sensor, true);
+        gCcsBaselineTick = xTaskGetTickCount();
+    }
+
+    /* without the FIFO the accelerometer is only sampled on demand */
+    gAccelFifo = (BMA2xxOpen(i2cHandle) == 0) &&
+                 (BMA2xxFifoConfig(i2cHandle, SENSOR_ACCEL_BANDWIDTH,
+                                   SENSOR_ACCEL_WATERMARK) == 0);
+    if(!gAccelFifo)
+    {
+        UART_PRINT("[Sensor task] accelerometer FIFO not available\r\n");
+    }
+
+    ADC_Params_init(&adcParams);
+    oxygenSensor = ADC_open(Board_ADC0, &adcParams);
+    if(oxygenSensor == NULL)
+    {
+        UART_PRINT("[Sensor task] Error opening ADC\r\n");
+    }
+
+    /* the nominal scale until the sensor is calibrated */
+    if(sensorLoadFile(SENSOR_OXYGEN_CAL_FILE, &gOxygenCal,
+                      sizeof(gOxygenCal)) != 0)
+    {
+        gOxygenCal.zero = 0;
+        gOxygenCal.air = SENSOR_OXYGEN_NOMINAL_SPAN;
+    }
+    oxygenApplyCal();
+
+    /* every scheduled sensor is sampled on the first tick */
+    lastWake = xTaskGetTickCount();
+    for(idx = 0; idx < SnapshotSensor_Max; idx++)
+    {
+        if(gSensorPeriodMs[idx] == 0)
+        {
+            gSensorPeriodMs[idx] = gSensorSchedule[idx].defaultPeriodMs;
+        }
+        gSensorDue[idx] = lastWake;
+    }
+    gSensorLastPublish = lastWake;
+    gHistoryDue = lastWake + pdMS_TO_TICKS(SENSOR_HISTORY_PERIOD_MS);
+
+    /* the outside sensor is optional, do not poll a missing one */
+    if(!bmeOutOpen)
+    {
+        gSensorPeriodMs[SnapshotSensor_Bme280Out] = 0;
+    }
+    if(!gAccelFifo)
+    {
+        gSensorPeriodMs[SnapshotSensor_Accel] = 0;
+    }
+
+    while(1)
+    {
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(SENSOR_TASK_TICK_MS));
+        now = xTaskGetTickCount();
+        due = 0;
+        pending = 0;
+        waitMs = 0;
+
+        profile = gBmeProfileRequest;
+        if(profile != BME280_Profile_Max)
+        {
+            gBmeProfileRequest = BME280_Profile_Max;
+            if(BME280_setProfile(&gBme280In, (BME280_Profile)profile))
+            {
+                UART_PRINT("[Sensor task] BME280 profile %d applied\n\r",
+                           profile);
+                /* the filtered output restarts, sample it again */
+                gSensorDemand[SnapshotSensor_Bme280In] = 1;
+            }
+            else
+            {
+                UART_PRINT("[Sensor task] Failed to apply BME280 profile %d\n\r",
+                           profile);
+            }
+
+            if(bmeOutOpen &&
+               BME280_setProfile(&gBme280Out, (BME280_Profile)profile))
+            {
+                gSensorDemand[SnapshotSensor_Bme280Out] = 1;
+            }
+        }
+
+        calPoint = gOxygenCalRequest;
+        if(calPoint != SensorOxygenCal_Max)
+        {
+            gOxygenCalRequest = SensorOxygenCal_Max;
+            oxygenCalibrate((SensorOxygenCal)calPoint);
+        }
+
+        /* start every conversion first */
+        for(idx = 0; idx < SnapshotSensor_Max; idx++)
+        {
+            periodMs = gSensorPeriodMs[idx];
+            if(!gSensorDemand[idx] &&
+               ((periodMs == 0) || ((int32_t)(now - gSensorDue[idx]) < 0)))
+            {
+                continue;
+            }
+
+            /* a failing sensor waits for its backoff, a demand stays
+               pending until then */
+            if(!sensorAvailable(idx, now))
+            {
+                continue;
+            }
+
+            gSensorDemand[idx] = 0;
+            if(periodMs != 0)
+            {
+                gSensorDue[idx] = now + pdMS_TO_TICKS(periodMs);
+            }
+
+            if(gSensorSchedule[idx].pStart == NULL)
+            {
+                due |= (1 << idx);
+                continue;
+            }
+
+            convMs = gSensorSchedule[idx].pStart();
+            if(convMs < 0)
+            {
+                if(gSensorHealth[idx].failures < SENSOR_BREAKER_FAILURES)
+                {
+                    UART_PRINT("[Sensor task] Failed to start %s\n\r",
+                               gSensorSchedule[idx].name);
+                }
+                sensorHealthUpdate(idx, false);
+                continue;
+            }
+
+            pending |= (1 << idx);
+            if((uint32_t)convMs > waitMs)
+            {
+                waitMs = convMs;
+            }
+        }
+
+        /* the fast reads overlap the conversions */
+        for(idx = 0; idx < SnapshotSensor_Max; idx++)
+        {
+            if(due & (1 << idx))
+            {
+                sensorCollect(idx);
+            }
+        }
+
+        if(pending)
+        {
+            elapsed = xTaskGetTickCount() - now;
+            wait = pdMS_TO_TICKS(waitMs);
+            if(elapsed < wait)
+            {
+                vTaskDelay(wait - elapsed);
+            }
+        }
+
+        retries = SENSOR_COLLECT_RETRIES;
+        while(pending)
+        {
+            for(idx = 0; idx < SnapshotSensor_Max; idx++)
+            {
+                if(!(pending & (1 << idx)))
+                {
+                    continue;
+                }
+
+                switch(sensorCollect(idx))
+                {
+                case 0:
+                    pending &= ~(1 << idx);
+                    break;
+                case SENSOR_NOT_READY:
+                    if(retries == 0)
+                    {
+                        UART_PRINT("[Sensor task] %s conversion timed out\n\r",
+                                   gSensorSchedule[idx].name);
+                        sensorHealthUpdate(idx, false);
+                        pending &= ~(1 << idx);
+                    }
+                    break;
+                default:
+                    pending &= ~(1 << idx);
+                    break;
+                }
+            }
+
+            if(pending)
+            {
+                retries--;
+                vTaskDelay(pdMS_TO_TICKS(SENSOR_COLLECT_POLL_MS));
+            }
+        }
+
+        /* a sensor going stale changes the snapshot too */
+        sensorUpdateStale(now);
+        sensorPublish(now);
+
+        /* a late round catches up, sample n stays second n of the run */
+        while((int32_t)(now - gHistoryDue) >= 0)
+        {
+            SensorHistory_add(&gSensorReadings);
+            gHistoryDue += pdMS_TO_TICKS(SENSOR_HISTORY_PERIOD_MS);
+        }
+    }
+}
@@ -0,0 +1,200 @@
+/*
+ * sensor_task.h
+ *
+ *  Sensor acquisition task. It is the only user of the sensor bus: every
+ *  sensor is sampled on its own cadence from a schedule table and the
+ *  readings are published through the sensor snapshot, so the bus load
+ *  does not depend on the number of HTTP clients.
+ */
+
+#ifndef SENSOR_TASK_H_
+#define SENSOR_TASK_H_
+
+#include <stdint.h>
+
+#include "sensor_snapshot.h"
+#include "bme280.h"
+#include "bma2xxdrv.h"
+
+/* scheduler resolution, also the worst case latency of an on demand read */
+#define SENSOR_TASK_TICK_MS             (100)
+
+/* inside and outside BME280, SDO strapped differently */
+#define SENSOR_BME280_IN_ADDR           BOSCH_SENSORTEC_BME280_I2CSLAVE_DEFAULT
+#define SENSOR_BME280_OUT_ADDR          BOSCH_SENSORTEC_BME280_I2CSLAVE_ALT
+
+/* default cadences, 0 samples only on demand */
+#define SENSOR_BME280_PERIOD_MS         (1000)
+#define SENSOR_OXYGEN_PERIOD_MS         (2000)
+#define SENSOR_CCS811_PERIOD_MS         (1000)      /* status poll */
+#define SENSOR_TMP006_PERIOD_MS         (1000)
+#define SENSOR_ACCEL_PERIOD_MS          (SENSOR_TASK_TICK_MS)
+
+/* the CCS811 samples every 10 s (ccs811_mode_10s), its status is polled
+   and the results are only read when a sample is ready. the compensation
+   is rewritten when the inside readings move this much */
+#define SENSOR_CCS811_DATA_MS           (10000)     /* sample interval */
+#define SENSOR_CCS811_ENV_TEMP_DELTA    (50)        /* 0.01 C */
+#define SENSOR_CCS811_ENV_HUMID_DELTA   (2)         /* % */
+
+/* the saved baseline is restored after the 20 min conditioning of the
+   sensor, and the current one is saved daily */
+#define SENSOR_CCS811_CONDITION_MS      (20 * 60 * 1000)
+#define SENSOR_CCS811_BASELINE_SAVE_MS  (24 * 60 * 60 * 1000)
+#define SENSOR_CCS811_BASELINE_FILE     "ccs811_baseline.bin"
+
+/* an oxygen reading is a block of conversions, sorted, the top and bottom
+   quarters dropped and the middle half summed: 16 samples sum to a reading
+   in 1/16 LSB */
+#define SENSOR_OXYGEN_SAMPLES           (32)
+#define SENSOR_OXYGEN_TRIM              (SENSOR_OXYGEN_SAMPLES / 4)
+
+/* two-point calibration, the zero point at 0% and the span point in air.
+   the uncalibrated scale is the sensor nominal one, 3300 mV over 4095 LSB
+   and 21% over 2000 mV */
+#define SENSOR_OXYGEN_AIR_MPCT          (20950)     /* milli-percent */
+#define SENSOR_OXYGEN_NOMINAL_SPAN      ((SENSOR_OXYGEN_AIR_MPCT * 16ULL * \
+                                          4095 * 20) / (3300 * 210))
+#define SENSOR_OXYGEN_CAL_FILE          "oxygen_cal.bin"
+
+/* the accelerometer streams through its FIFO at twice the filter
+   bandwidth. the FIFO holds 32 frames, 256 ms at this rate, the sensor
+   task drains it every tick into a ring of the last 2 s */
+#define SENSOR_ACCEL_BANDWIDTH          BMA2XX_BW_62_5HZ
+#define SENSOR_ACCEL_RATE_HZ            (125)
+#define SENSOR_ACCEL_WATERMARK          (16)
+#define SENSOR_ACCEL_RING_LEN           (256)       /* power of 2 */
+
+/* a conversion that is not done after its datasheet time is polled this
+   often, this many times, before the round gives up on it */
+#define SENSOR_COLLECT_POLL_MS          (2)
+#define SENSOR_COLLECT_RETRIES          (5)
+
+/* a sensor failing this many rounds in a row is left alone for a backoff
+   that doubles on every further failure, so a dead device costs one
+   bounded attempt per backoff instead of a timeout every round */
+#define SENSOR_BREAKER_FAILURES         (3)
+#define SENSOR_BACKOFF_MIN_MS           (1000)
+#define SENSOR_BACKOFF_MAX_MS           (60000)
+
+/* a scheduled sensor without a good sample for this many periods, or data
+   intervals if it converts slower than it is polled, is flagged stale in
+   the snapshot */
+#define SENSOR_STALE_PERIODS            (3)
+
+/* the readings go to the history every second, its 1 s tier */
+#define SENSOR_HISTORY_PERIOD_MS        (1000)
+
+/* an unchanged snapshot is still published this often, so its sample
+   ticks stay current */
+#define SENSOR_PUBLISH_MAX_MS           (5000)
+
+typedef enum
+{
+    SensorOxygenCal_Zero,       /* the sensor sees no oxygen */
+    SensorOxygenCal_Air,        /* the sensor sees fresh air */
+    SensorOxygenCal_Reset,      /* back to the nominal scale */
+    SensorOxygenCal_Max
+}SensorOxygenCal;
+
+/* raw accelerometer reading, 15.6 mg per LSB at +-2g */
+typedef struct
+{
+    int8_t x;
+    int8_t y;
+    int8_t z;
+}SensorAccelSample_t;
+
+//*****************************************************************************
+//
+//! \brief Changes the cadence of a sensor
+//!
+//! \param[in]  sensor        sensor to reschedule
+//!
+//! \param[in]  periodMs      sampling period, 0 for on demand only
+//!
+//! \return 0 on success, -1 if the sensor is unknown
+//!
+//****************************************************************************
+int32_t SensorTask_setPeriod(SnapshotSensor sensor, uint32_t periodMs);
+
+//*****************************************************************************
+//
+//! \brief Asks for a sample of a sensor at the next scheduler tick. Never
+//!        blocks, the caller keeps using the last published snapshot.
+//!
+//! \param[in]  sensor        sensor to sample
+//!
+//! \return none
+//!
+//****************************************************************************
+void SensorTask_demand(SnapshotSensor sensor);
+
+//*****************************************************************************
+//
+//! \brief Asks for a BME280 profile, for both BME280. The sensor task
+//!        owns the bus and applies it at its next tick.
+//!
+//! \param[in]  profile       profile to apply
+//!
+//! \return 0 on success, -1 if the profile is unknown
+//!
+//****************************************************************************
+int32_t SensorTask_setBmeProfile(BME280_Profile profile);
+
+//*****************************************************************************
+//
+//! \brief Asks for an oxygen calibration point. The sensor task takes a
+//!        reading at its next tick, updates the calibration and saves it.
+//!
+//! \param[in]  point         calibration point the sensor is exposed to
+//!
+//! \return 0 on success, -1 if the point is unknown
+//!
+//****************************************************************************
+int32_t SensorTask_calibrateOxygen(SensorOxygenCal point);
+
+//*****************************************************************************
+//
+//! \brief Copies the streamed accelerometer samples, oldest first. Never
+//!        blocks, a sample overwritten during the copy is left out.
+//!
+//! \param[in,out] pSeq       in: number of the first sample wanted, samples
+//!                           are numbered from 0 since boot. out: number
+//!                           of the first sample copied, later than asked
+//!                           for if the ring no longer holds it
+//!
+//! \param[out] pSamples      destination of the samples
+//!
+//! \param[in]  maxCount      number of samples pSamples holds
+//!
+//! \return number of samples copied, 0 when none is newer than *pSeq
+//!
+//****************************************************************************
+uint16_t SensorTask_readAccel(uint32_t *pSeq, SensorAccelSample_t *pSamples,
+                              uint16_t maxCount);
+
+//*****************************************************************************
+//
+//! \brief Returns how many times the accelerometer FIFO filled up before
+//!        the sensor task drained it, dropping its oldest samples
+//!
+//! \param  none
+//!
+//! \return count of FIFO overruns
+//!
+//****************************************************************************
+uint32_t SensorTask_getAccelOverruns(void);
+
+//*****************************************************************************
+//
+//! \brief This task opens the sensors and samples them on schedule
+//!
+//! \param[in]  None
+//!
+//! \return None
+//!
+//****************************************************************************
+void * sensorTask(void *pvParameters);
+
+#endif /* SENSOR_TASK_H_ */
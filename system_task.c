@@ -42,6 +42,8 @@
 #include "out_of_box.h"
 #include "ota_archive.h"
 #include "system_task.h"
+#include "sensor_snapshot.h"
+#include "record_log.h"
 
 /* driverlib Header files */
 #include <ti/devices/cc32xx/inc/hw_memmap.h>
@@ -53,6 +55,7 @@
 /* External sensor Drivers*/
 #include "ccs811.h"
 #include "bme280.h"
+#include "i2c_bus.h"
 
 #ifndef CPY_BUFF_SIZE
 #define CPY_BUFF_SIZE       2048
@@ -97,13 +100,9 @@ SlDateTime_t lastCheckin;
 extern SlDateTime_t dateTime;
 
 
-/*external environmental Variables for Control System*/
-extern int32_t tempIn;
-extern uint16_t airQuality;
-extern uint32_t presIn;
-extern uint32_t humidIn;
-extern uint16_t oxygen;
-extern float temperatureVal;
+/*environmental readings for the Control System, copied from the sensor
+  snapshot once per cycle */
+static SensorSnapshot_t readings;
 
 
 
@@ -125,7 +124,6 @@ SDFatFS_Handle sdfatfsHandle;
 
 FILE_INFO FileList[File_End] ={
      { systemFilename,systemHeader, systemLineBuffer},
-     { dataFilename, dataHeader, dataLineBuffer},
      {warningFilename,warningHeader,warningLineBuffer},
 };
 
@@ -219,6 +217,13 @@ void * System_Task(void *pvParameters){
 
     UART_PRINT("made it to loop\r\n");
     sl_DeviceGet(SL_DEVICE_GENERAL,&configOpt,&configLen,(_u8 *)(&dateTime));
+
+    /* the data log stays open, records are appended as they come */
+    status = RecordLog_open(RecordLog_makeTime(dateTime.tm_year,dateTime.tm_mon,dateTime.tm_day,
+                                               dateTime.tm_hour,dateTime.tm_min,dateTime.tm_sec));
+    if(status){
+        UART_PRINT("failed to open the data log\r\n");
+    }
      while(1){
 
          vTaskDelayUntil(&systemStartTime,systemTick);
@@ -228,33 +233,10 @@ void * System_Task(void *pvParameters){
 
 
 
-         /* Read BME, CCS811 and 02 sensor values */
-         status = BME280Reading();
-
-         if(status != 0)
-         {
-             UART_PRINT(
-                 "[Link local task] Failed to read data from BME280\n\r");
-         }
-
-
-         status = oxySensorReading();
-         if(status != 0){
-             UART_PRINT(
-                 "[Link local task] Failed to read oxygenSensor\n\r");
-         }
-         status = ccs811Reading();
-         if(status != 0)
-         {
-             UART_PRINT(
-                 "[Link local task] Failed to read or calibrate CCS811\n\r");
-         }
-         status = temperatureReading();
-         if(status != 0)
-         {
-             UART_PRINT(
-                 "[Link local task] Failed to"
-                 " read data from temperature sensor\n\r");
+         /* the sensor task samples on its own schedule, take the latest.
+            nothing to control on until its first readings are out */
+         if(SensorSnapshot_read(&readings) == 0){
+             continue;
          }
 
 
@@ -276,31 +258,39 @@ void * System_Task(void *pvParameters){
              //create error
          }
 
-         if(tempIn>=((goalTemp+tempMargin))){
+         /* a dead inside sensor leaves its last reading behind, do not cool
+            on a temperature nobody measures any more */
+         if(readings.staleMask & (1 << SnapshotSensor_Bme280In)){
+             if(Peltier_State == Device_On){
+                    UART_PRINT("inside temperature stale, turning cooling OFF \r\n");
+                    Peltier_State = Device_Off;
+             }
+         }
+         else if(readings.tempIn>=((goalTemp+tempMargin))){
              if(Peltier_State == Device_Off){
-                    UART_PRINT("turning Cooling ON Goal Temp: %d actual temp: %d \r\n",goalTemp,tempIn);
+                    UART_PRINT("turning Cooling ON Goal Temp: %d actual temp: %d \r\n",goalTemp,readings.tempIn);
                     Peltier_State = Device_On;
              }
              else{
-                    UART_PRINT("Cooling ON Goal Temp: %d actual temp: %d \r\n",goalTemp,tempIn);
+                    UART_PRINT("Cooling ON Goal Temp: %d actual temp: %d \r\n",goalTemp,readings.tempIn);
              }
 
          }
 
-         else if(tempIn<=((goalTemp-tempMargin))){
+         else if(readings.tempIn<=((goalTemp-tempMargin))){
 
              if(Peltier_State ==Device_On){
-                   UART_PRINT("turning cooling OFF Goal Temp: %d actual temp: %d \r\n",goalTemp,tempIn);
+                   UART_PRINT("turning cooling OFF Goal Temp: %d actual temp: %d \r\n",goalTemp,readings.tempIn);
                    Peltier_State = Device_Off;
              }
              else{
-                   UART_PRINT("cooling OFF Goal Temp: %d actual temp: %d \r\n",goalTemp,tempIn);
+                   UART_PRINT("cooling OFF Goal Temp: %d actual temp: %d \r\n",goalTemp,readings.tempIn);
              }
 
          }
          else{
              UART_PRINT("At Temp. cooling %s Goal Temp: %d actual temp: %d temp Margin: %d\r\n",
-                         ((Peltier_State==1) ? "ON" : "OFF"  ),goalTemp,tempIn, tempMargin);
+                         ((Peltier_State==1) ? "ON" : "OFF"  ),goalTemp,readings.tempIn, tempMargin);
          }
 
 
@@ -341,7 +331,7 @@ void * System_Task(void *pvParameters){
 
 
          UART_PRINT("Year %d,Hour %d,Min %d,Sec %d leds: %d Peltier: %d  Temp: %d\r\n",dateTime.tm_year,
-                             dateTime.tm_hour,dateTime.tm_min,dateTime.tm_sec, Lights_State, Peltier_State,tempIn);
+                             dateTime.tm_hour,dateTime.tm_min,dateTime.tm_sec, Lights_State, Peltier_State,readings.tempIn);
          if(secondCount>=60*dataFreq){
              status = updateData();
              if(status){
@@ -350,6 +340,8 @@ void * System_Task(void *pvParameters){
              }
              else secondCount = 0;
          }
+         /* writes back a sector of records that has waited too long */
+         RecordLog_poll();
 
          secondCount++;
      }
@@ -528,6 +520,10 @@ int32_t updateData(){
     _i16 Status;
     _u8 NumConnectedStations;
     _u16 ValueLen = sizeof(_u8);
+    RecordLog_Record_t record;
+    RecordLog_Stats_t logStats;
+    I2CBus_DeviceStats_t busStats;
+    uint8_t busIdx;
 
     Status = sl_NetCfgGet(SL_NETCFG_AP_STATIONS_NUM_CONNECTED, NULL, &ValueLen,
     &NumConnectedStations);
@@ -536,27 +532,54 @@ int32_t updateData(){
     NumConnectedStations = 0;
     }
 
-    sdCard[File_Data] = fopen(FileList[File_Data].filename, "a");
-    if (!sdCard[File_Data]) {
-        Status = initializeFiles(File_Data);
-        if(Status !=-1){
+    /* binary record, rendered to CSV/JSON only when it is downloaded */
+    memset(&record, 0, sizeof(record));
+    record.time = RecordLog_makeTime(dateTime.tm_year,dateTime.tm_mon,dateTime.tm_day,
+                                     dateTime.tm_hour,dateTime.tm_min,dateTime.tm_sec);
+    record.uptime = xTaskGetTickCount() / pdMS_TO_TICKS(1000);
+    record.presIn = readings.presIn;
+    record.presOut = readings.presOut;
+    record.tempIn = (int16_t)readings.tempIn;
+    record.tempOut = (int16_t)readings.tempOut;
+    record.irTemp = (int16_t)(readings.temperatureVal * 100.0f);
+    record.oxygen = readings.oxygen;
+    record.airQuality = readings.airQuality;
+    record.humidIn = (uint8_t)readings.humidIn;
+    record.humidOut = (uint8_t)readings.humidOut;
+    record.state = ((Lights_State == Device_On) ? RECORD_LOG_STATE_LIGHTS : 0) |
+                   ((Fan_State == Device_On) ? RECORD_LOG_STATE_FANS : 0) |
+                   ((Peltier_State == Device_On) ? RECORD_LOG_STATE_COOLING : 0) |
+                   (NumConnectedStations ? RECORD_LOG_STATE_CONNECTED : 0);
+    record.staleMask = readings.staleMask;
+
+    /* the card may have been missing or swapped, reopen the log once. a
+       record older than its day is dropped, the clock is not set yet */
+    Status = RecordLog_append(&record);
+    if(Status == RECORD_LOG_OUT_OF_ORDER){
+        UART_PRINT("record dropped, the clock is behind the data log\r\n");
+    }
+    else if(Status){
+        if(RecordLog_open(record.time) || RecordLog_append(&record)){
             return -1;
         }
     }
-    else{
 
+    RecordLog_getStats(&logStats);
+    UART_PRINT("logged record %d, %d SD writes of %d bytes avg, %d flushes of %d ms avg, %d ms max, %d failed, %d dropped\r\n",
+               RecordLog_getCount(), logStats.writes,
+               logStats.writes ? (logStats.bytesWritten / logStats.writes) : 0,
+               logStats.flushes,
+               logStats.flushes ? (logStats.flushTotalMs / logStats.flushes) : 0,
+               logStats.flushMaxMs, logStats.flushErrors, logStats.outOfOrder);
+
+    /* bus health, the counters only grow since boot */
+    for(busIdx = 0; I2CBus_getStats(busIdx, &busStats) == 0; busIdx++){
+        UART_PRINT("[I2C bus] %s: %d transfers, %d errors, %d timeouts, latency avg %d max %d ms\r\n",
+                   busStats.name, busStats.transfers, busStats.errors, busStats.timeouts,
+                   busStats.transfers ? (busStats.latencyTotalMs / busStats.transfers) : 0,
+                   busStats.latencyMaxMs);
     }
-
-    sprintf(FileList[File_Data].lineBuf,
-            "%.2u:%.2u,%.2u/%.2u/%.4u,%.2u.%.1u,%.6u,%.2u,%4.1f,%.6u,%.6u,%3.3s,%3.3s,%3.3s,%3.3s\r\n",
-            dateTime.tm_hour,dateTime.tm_min,dateTime.tm_mon,dateTime.tm_day,dateTime.tm_year,
-            (tempIn/100),((tempIn%100)/10),presIn,humidIn,temperatureVal,oxygen,airQuality,
-            StatePrint(Lights_State),StatePrint(Fan_State),StatePrint(Peltier_State),StatePrint(NumConnectedStations));
-    fwrite(FileList[File_Data].lineBuf, 1, strlen(FileList[File_Data].lineBuf), sdCard[File_Data]);
-    fflush(sdCard[File_Data]);
-
-    fclose(sdCard[File_Data]);
-    UART_PRINT(FileList[File_Data].lineBuf);
+    UART_PRINT("[I2C bus] %d recoveries\r\n", I2CBus_getRecoveries());
     return 0;
 }
 
@@ -23,7 +23,6 @@ typedef enum{
 
 typedef enum{
     File_System=0,
-    File_Data,
     File_Warnings,
     File_End,
 }Current_File;
@@ -31,21 +30,16 @@ typedef enum{
 //possibly make these const instead of defines.
 
 #define systemFilename "fat:"STR(DRIVE_NUM)":system.txt"
-#define dataFilename "fat:"STR(DRIVE_NUM)":dataLog.csv"
 #define warningFilename "fat:"STR(DRIVE_NUM)":warnings.csv"
 
 #define systemHeader      "check in time(hh:mm),check in date(mm/dd/yyyy),goal temp(C),"\
                           "log Freq (min),light on time(hh:mm), light off time(hh:mm)\r\n"
 
-#define dataHeader        "Time(HH:MM),Date(dd/mm/yyyy),inside Temp(C),inside press(Pa),"\
-                          "inside humid(%),outside Temp(C), O2(ppm),eCO2(ppm),lights,fans,cooler,connection\r\n"
-
 #define warningHeader     "Errors and warnings will be listed below, including date and time of occurrence\r\n"\
                           "Time,Date(dd/mm/yyyy),inside Temp(C),inside press(Pa),inside humid(%),outside Temp(C),"\
                           "O2(ppm),eCO2(ppm),lights,fans,cooler,connection, error\r\n"
 
 
-#define dataLineBuffer    "00:00,00/00/0000,00.0,000000,00.0,00.0,000000,000000,off,off,off,off\r\n"
 #define systemLineBuffer  "00:00,00/00/0000,23.0,001,20:00,08:00"
 #define warningLineBuffer "00:00,00/00/0000,00.0,000000,00.0,00.0,000000,000000,off,off,off,off," \
                           "Example Error message: this is NOT an error, just an example of the structure of errors"
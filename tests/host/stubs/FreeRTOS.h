@@ -0,0 +1,17 @@
+/*
+ * FreeRTOS.h
+ *
+ *  Host stand-in for the kernel header, only the types the drivers under
+ *  test use.
+ */
+
+#ifndef FREERTOS_H_
+#define FREERTOS_H_
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+
+#define pdMS_TO_TICKS(ms)       ((TickType_t)(ms))
+
+#endif /* FREERTOS_H_ */
@@ -0,0 +1,14 @@
+/*
+ * task.h
+ *
+ *  Host stand-in for the task API, the test provides vTaskDelay().
+ */
+
+#ifndef TASK_H_
+#define TASK_H_
+
+#include "FreeRTOS.h"
+
+void vTaskDelay(const TickType_t xTicksToDelay);
+
+#endif /* TASK_H_ */
@@ -0,0 +1,10 @@
+/*
+ * Display.h
+ *
+ *  Host stand-in, included by drivers that do not use it.
+ */
+
+#ifndef ti_display_Display__include
+#define ti_display_Display__include
+
+#endif /* ti_display_Display__include */
@@ -0,0 +1,33 @@
+/*
+ * I2C.h
+ *
+ *  Host stand-in for the TI-Drivers I2C header, transactions are served by
+ *  the I2CBus_transfer() of the test.
+ */
+
+#ifndef ti_drivers_I2C__include
+#define ti_drivers_I2C__include
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct I2C_Config_ *I2C_Handle;
+
+typedef enum
+{
+    I2C_100kHz,
+    I2C_400kHz
+}I2C_BitRate;
+
+typedef struct
+{
+    void    *writeBuf;
+    size_t  writeCount;
+    void    *readBuf;
+    size_t  readCount;
+    uint_least8_t slaveAddress;
+    void    *arg;
+}I2C_Transaction;
+
+#endif /* ti_drivers_I2C__include */
@@ -0,0 +1,14 @@
+/*
+ * uart_term.h
+ *
+ *  Host stand-in for the UART terminal, messages go to stdout.
+ */
+
+#ifndef UART_TERM_H_
+#define UART_TERM_H_
+
+#include <stdio.h>
+
+#define UART_PRINT              printf
+
+#endif /* UART_TERM_H_ */
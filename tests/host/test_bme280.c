@@ -0,0 +1,326 @@
+/*
+ * test_bme280.c
+ *
+ *  Host test and benchmark of the BME280 driver. The integer compensation
+ *  is checked against the datasheet calculation example and swept against
+ *  the floating point reference formulas of the datasheet, and
+ *  BME280_open() runs against a simulated chip whose calibration reads can
+ *  be made to fail.
+ */
+
+#ifndef __TI_COMPILER_VERSION__
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "bme280.h"
+#include "i2c_bus.h"
+
+#define BENCH_SAMPLES   (1024)
+#define BENCH_ROUNDS    (2000)
+
+/* datasheet calculation example, the humidity trimming is taken from a
+   production part */
+static const BME280_Calibration gCal =
+{
+    .dig_T1 = 27504, .dig_T2 = 26435, .dig_T3 = -1000,
+    .dig_P1 = 36477, .dig_P2 = -10685, .dig_P3 = 3024, .dig_P4 = 2855,
+    .dig_P5 = 140, .dig_P6 = -7, .dig_P7 = 15500, .dig_P8 = -14600,
+    .dig_P9 = 6000,
+    .dig_H1 = 75, .dig_H2 = 362, .dig_H3 = 0, .dig_H4 = 313, .dig_H5 = 50,
+    .dig_H6 = 30,
+};
+
+static int gFailures;
+
+#define CHECK(cond)     do { if(!(cond)) { gFailures++; \
+                             printf("FAIL %s:%d %s\n", __FILE__, __LINE__, \
+                                    #cond); } } while(0)
+
+/* simulated chip */
+static uint8_t gRegs[256];
+static uint8_t gFailReg;        /* reads of this register fail, 0 for none */
+static struct I2C_Config_ *gBus;
+
+void vTaskDelay(const TickType_t xTicksToDelay)
+{
+    (void)xTicksToDelay;
+}
+
+bool I2CBus_transfer(I2C_Handle handle, I2C_Transaction *pTxn)
+{
+    const uint8_t *pWrite = pTxn->writeBuf;
+    uint8_t reg = pWrite[0];
+
+    (void)handle;
+    if(pTxn->writeCount == 2)
+    {
+        gRegs[reg] = pWrite[1];
+        if((reg == BME280_REG_RESET) && (pWrite[1] == BME280_RESET_ASSERT))
+        {
+            gRegs[BME280_REG_CTRL_MEAS] = 0;
+            gRegs[BME280_REG_CTRL_HUM] = 0;
+            gRegs[BME280_REG_CONFIG] = 0;
+        }
+        return(true);
+    }
+    if((gFailReg != 0) && (reg == gFailReg))
+    {
+        return(false);
+    }
+    memcpy(pTxn->readBuf, &gRegs[reg], pTxn->readCount);
+
+    return(true);
+}
+
+static void put16(uint8_t *pBuf, uint16_t value)
+{
+    pBuf[0] = value & 0xFF;
+    pBuf[1] = value >> 8;
+}
+
+/* calibration registers of gCal, as BME280_parseCalibration() reads them */
+static void loadChip(const BME280_Calibration *pCal)
+{
+    uint8_t *pC0 = &gRegs[BME280_REG_CALIB00];
+    uint8_t *pC26 = &gRegs[BME280_REG_CALIB26];
+
+    memset(gRegs, 0, sizeof(gRegs));
+    gRegs[BME280_REG_ID] = 0x60;
+
+    put16(pC0 + 0, pCal->dig_T1);
+    put16(pC0 + 2, pCal->dig_T2);
+    put16(pC0 + 4, pCal->dig_T3);
+    put16(pC0 + 6, pCal->dig_P1);
+    put16(pC0 + 8, pCal->dig_P2);
+    put16(pC0 + 10, pCal->dig_P3);
+    put16(pC0 + 12, pCal->dig_P4);
+    put16(pC0 + 14, pCal->dig_P5);
+    put16(pC0 + 16, pCal->dig_P6);
+    put16(pC0 + 18, pCal->dig_P7);
+    put16(pC0 + 20, pCal->dig_P8);
+    put16(pC0 + 22, pCal->dig_P9);
+    pC0[25] = pCal->dig_H1;
+    put16(pC26 + 0, pCal->dig_H2);
+    pC26[2] = pCal->dig_H3;
+    pC26[3] = (uint8_t)(pCal->dig_H4 >> 4);
+    pC26[4] = (pCal->dig_H4 & 0x0F) | ((pCal->dig_H5 & 0x0F) << 4);
+    pC26[5] = (uint8_t)(pCal->dig_H5 >> 4);
+    pC26[6] = (uint8_t)pCal->dig_H6;
+}
+
+/* floating point compensation, datasheet section 8.1 */
+static double refTFine(const BME280_Calibration *pCal, int32_t adcT)
+{
+    double var1, var2;
+
+    var1 = (adcT / 16384.0 - pCal->dig_T1 / 1024.0) * pCal->dig_T2;
+    var2 = (adcT / 131072.0 - pCal->dig_T1 / 8192.0) *
+           (adcT / 131072.0 - pCal->dig_T1 / 8192.0) * pCal->dig_T3;
+
+    return(var1 + var2);
+}
+
+static double refPressure(const BME280_Calibration *pCal, double tFine,
+                          int32_t adcP)
+{
+    double var1, var2, p;
+
+    var1 = tFine / 2.0 - 64000.0;
+    var2 = var1 * var1 * pCal->dig_P6 / 32768.0;
+    var2 = var2 + var1 * pCal->dig_P5 * 2.0;
+    var2 = var2 / 4.0 + pCal->dig_P4 * 65536.0;
+    var1 = (pCal->dig_P3 * var1 * var1 / 524288.0 + pCal->dig_P2 * var1) /
+           524288.0;
+    var1 = (1.0 + var1 / 32768.0) * pCal->dig_P1;
+    if(var1 == 0.0)
+    {
+        return(0.0);
+    }
+    p = 1048576.0 - adcP;
+    p = (p - var2 / 4096.0) * 6250.0 / var1;
+    var1 = pCal->dig_P9 * p * p / 2147483648.0;
+    var2 = p * pCal->dig_P8 / 32768.0;
+
+    return(p + (var1 + var2 + pCal->dig_P7) / 16.0);
+}
+
+static double refHumidity(const BME280_Calibration *pCal, double tFine,
+                          int32_t adcH)
+{
+    double h;
+
+    h = tFine - 76800.0;
+    h = (adcH - (pCal->dig_H4 * 64.0 + pCal->dig_H5 / 16384.0 * h)) *
+        (pCal->dig_H2 / 65536.0 * (1.0 + pCal->dig_H6 / 67108864.0 * h *
+         (1.0 + pCal->dig_H3 / 67108864.0 * h)));
+    h = h * (1.0 - pCal->dig_H1 * h / 524288.0);
+
+    return((h > 100.0) ? 100.0 : ((h < 0.0) ? 0.0 : h));
+}
+
+static void testVector(void)
+{
+    BME280_RawData raw = {.temperature_raw = 519888,
+                          .pressure_raw = 415148};
+    BME280_Compensated out;
+
+    /* 25.08 degC and 100653.27 Pa, the example rounds t_fine differently
+       so the pressure is only checked to a few hundredths */
+    BME280_compensate(&gCal, &raw, &out, 1);
+    CHECK(out.temperature == 2508);
+    CHECK(fabs(out.pressure / 256.0 - 100653.27) < 0.05);
+}
+
+static void testParse(void)
+{
+    BME280_Calibration cal = gCal;
+    BME280_Calibration parsed;
+
+    /* dig_H4 and dig_H5 are 12 bit two's complement, sharing 0xE5 */
+    cal.dig_H4 = -5;
+    cal.dig_H5 = -300;
+    cal.dig_H6 = -7;
+    loadChip(&cal);
+    BME280_parseCalibration(&gRegs[BME280_REG_CALIB00],
+                            &gRegs[BME280_REG_CALIB26], &parsed);
+    CHECK(!memcmp(&parsed, &cal, sizeof(cal)));
+}
+
+/* -40..85 degC, 300..1100 hPa and the whole humidity range */
+static void testSweep(void)
+{
+    BME280_RawData raw;
+    BME280_Compensated out;
+    double tFine, ref, errT = 0, errP = 0, errH = 0;
+    uint32_t samples = 0;
+    int32_t adcT, adcP, adcH;
+
+    for(adcT = 380000; adcT <= 640000; adcT += 2600)
+    {
+        for(adcP = 200000; adcP <= 700000; adcP += 10000)
+        {
+            for(adcH = 20000; adcH <= 45000; adcH += 1250)
+            {
+                raw.temperature_raw = adcT;
+                raw.pressure_raw = adcP;
+                raw.humidity_raw = adcH;
+                BME280_compensate(&gCal, &raw, &out, 1);
+                tFine = refTFine(&gCal, adcT);
+
+                ref = tFine / 5120.0;
+                if((ref < -40.0) || (ref > 85.0))
+                {
+                    continue;
+                }
+                errT = fmax(errT, fabs(out.temperature / 100.0 - ref));
+
+                ref = refPressure(&gCal, tFine, adcP);
+                if((ref >= 30000.0) && (ref <= 110000.0))
+                {
+                    errP = fmax(errP, fabs(out.pressure / 256.0 - ref));
+                }
+
+                ref = refHumidity(&gCal, tFine, adcH);
+                errH = fmax(errH, fabs(out.humidity / 1024.0 - ref));
+                samples++;
+            }
+        }
+    }
+
+    printf("bme280: %u samples, max error %.4f degC, %.3f Pa, %.4f %%RH\n",
+           samples, errT, errP, errH);
+    /* one output LSB of temperature, a pascal, a hundredth of %RH */
+    CHECK(samples > 0);
+    CHECK(errT <= 0.01);
+    CHECK(errP <= 1.0);
+    CHECK(errH <= 0.01);
+}
+
+static void testOpen(void)
+{
+    BME280_Object bme;
+
+    loadChip(&gCal);
+    gFailReg = 0;
+    BME280_init(&bme, gBus, BOSCH_SENSORTEC_BME280_I2CSLAVE_DEFAULT);
+    CHECK(BME280_open(&bme));
+    CHECK(!memcmp(BME280_getCalibration(&bme), &gCal, sizeof(gCal)));
+    CHECK(BME280_getProfile(&bme) == BME280_PROFILE_DEFAULT);
+
+    /* either calibration block missing fails the open */
+    loadChip(&gCal);
+    gFailReg = BME280_REG_CALIB00;
+    BME280_init(&bme, gBus, BOSCH_SENSORTEC_BME280_I2CSLAVE_DEFAULT);
+    CHECK(!BME280_open(&bme));
+
+    loadChip(&gCal);
+    gFailReg = BME280_REG_CALIB26;
+    BME280_init(&bme, gBus, BOSCH_SENSORTEC_BME280_I2CSLAVE_DEFAULT);
+    CHECK(!BME280_open(&bme));
+    CHECK(BME280_getProfile(&bme) == BME280_Profile_Max);
+
+    gFailReg = 0;
+}
+
+/* batch compensation against the per reading calls the sensor task used */
+static void benchmark(void)
+{
+    static BME280_RawData raw[BENCH_SAMPLES];
+    static BME280_Compensated out[BENCH_SAMPLES];
+    BME280_Object bme;
+    volatile uint32_t sink = 0;
+    clock_t start;
+    double batchNs, singleNs;
+    uint32_t round, idx;
+
+    bme.cal = gCal;
+    for(idx = 0; idx < BENCH_SAMPLES; idx++)
+    {
+        raw[idx].temperature_raw = 500000 + idx * 37;
+        raw[idx].pressure_raw = 400000 + idx * 53;
+        raw[idx].humidity_raw = 30000 + idx * 7;
+    }
+
+    start = clock();
+    for(round = 0; round < BENCH_ROUNDS; round++)
+    {
+        BME280_compensate(&gCal, raw, out, BENCH_SAMPLES);
+        sink += out[round % BENCH_SAMPLES].pressure;
+    }
+    batchNs = (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC /
+              ((double)BENCH_ROUNDS * BENCH_SAMPLES);
+
+    start = clock();
+    for(round = 0; round < BENCH_ROUNDS; round++)
+    {
+        for(idx = 0; idx < BENCH_SAMPLES; idx++)
+        {
+            sink += BME280_compensated_Temperature(&bme, &raw[idx]);
+            sink += BME280_compensated_Pressure(&bme, &raw[idx]);
+            sink += BME280_compensated_Humidity(&bme, &raw[idx]);
+        }
+    }
+    singleNs = (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC /
+               ((double)BENCH_ROUNDS * BENCH_SAMPLES);
+
+    printf("bme280: %.1f ns per reading in batch, %.1f ns with the single "
+           "calls on the host\n", batchNs, singleNs);
+}
+
+int main(void)
+{
+    testVector();
+    testParse();
+    testSweep();
+    testOpen();
+    benchmark();
+
+    printf("bme280: %s\n", gFailures ? "FAILED" : "passed");
+
+    return(gFailures ? 1 : 0);
+}
+
+#endif /* __TI_COMPILER_VERSION__ */
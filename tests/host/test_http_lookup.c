@@ -0,0 +1,374 @@
+/*
+ * test_http_lookup.c
+ *
+ *  Host test and benchmark of the route and characteristic lookup. The
+ *  tables mirror httpRequest[] and gRouteOrder of link_local_task.c, and the
+ *  reference is the linear strncmp scan the parser used before. A second,
+ *  grown route table shows how both scale as endpoints are added.
+ */
+
+#ifndef __TI_COMPILER_VERSION__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "http_lookup.h"
+
+#define BENCH_ROUNDS    (200000)
+
+/* SL_NETAPP_REQUEST_HTTP_* */
+#define HTTP_GET        (1)
+#define HTTP_POST       (2)
+#define HTTP_PUT        (3)
+
+#define ROUTE_NUM       (13)
+#define GROWN_NUM       (HTTP_LOOKUP_MAX_ENTRIES)
+
+#define HTTP_STR(str)   (str), (sizeof(str) - 1)
+
+/* laid out as http_charValuesPair_t and http_RequestObj_t */
+typedef struct
+{
+    HttpLookup_Key_t characteristic;
+    char    *value[5];
+}TestChar_t;
+
+typedef struct
+{
+    HttpLookup_Key_t service;
+    uint8_t requestIdx;
+    const uint8_t *charOrder;
+    uint8_t charNum;
+    TestChar_t charValues[10];
+    void *serviceCallback;
+}TestRoute_t;
+
+static const uint8_t gEnviroCharOrder[] = {4, 0, 6, 2, 5, 1, 3, 7};
+static const uint8_t gStateCharOrder[] = {0, 1, 2, 4, 3, 5, 6};
+
+static TestRoute_t gRoutes[GROWN_NUM] =
+{
+    {{HTTP_STR("/ota"), HTTP_GET}, 0},
+    {{HTTP_STR("/ota"), HTTP_PUT}, 1},
+    {{HTTP_STR("/light"), HTTP_GET}, 2},
+    {{HTTP_STR("/light"), HTTP_POST}, 3},
+    {{HTTP_STR("/sensor"), HTTP_GET}, 4},
+    {{HTTP_STR("/device"), HTTP_GET}, 5},
+    {{HTTP_STR("/enviro"), HTTP_GET}, 6,
+     gEnviroCharOrder, sizeof(gEnviroCharOrder), {
+         {{HTTP_STR("inTemp")}},
+         {{HTTP_STR("outTemp")}},
+         {{HTTP_STR("inHumid")}},
+         {{HTTP_STR("outHumid")}},
+         {{HTTP_STR("inPres")}},
+         {{HTTP_STR("outPres")}},
+         {{HTTP_STR("oxygen")}},
+         {{HTTP_STR("airQuality")}}
+     }},
+    {{HTTP_STR("/state"), HTTP_GET}, 7,
+     gStateCharOrder, sizeof(gStateCharOrder), {
+         {{HTTP_STR("fans")}, {"off", "on", "toggle"}},
+         {{HTTP_STR("lights")}, {"off", "on", "toggle"}},
+         {{HTTP_STR("cooling")}, {"off", "on", "toggle"}},
+         {{HTTP_STR("goalTemp")}},
+         {{HTTP_STR("dataFreq")}},
+         {{HTTP_STR("lastDump")}},
+         {{HTTP_STR("lastCheckin")}}
+     }},
+    {{HTTP_STR("/state"), HTTP_POST}, 8},
+    {{HTTP_STR("/api/snapshot"), HTTP_GET}, 9},
+    {{HTTP_STR("/accel"), HTTP_GET}, 10},
+    {{HTTP_STR("/history"), HTTP_GET}, 11},
+    {{HTTP_STR("/log"), HTTP_GET}, 12},
+};
+
+/* gRouteOrder of link_local_task.c */
+static const uint8_t gRouteOrder[ROUTE_NUM] =
+{
+    12, 0, 1, 10, 2, 3, 7, 8, 5, 6, 4, 11, 9
+};
+
+static uint8_t gGrownOrder[GROWN_NUM];
+static char gGrownNames[GROWN_NUM][16];
+
+/* requests as the pages poll them */
+static const struct
+{
+    const char *pUri;
+    uint8_t method;
+}gRequests[] =
+{
+    {"/enviro", HTTP_GET}, {"/state", HTTP_GET}, {"/api/snapshot", HTTP_GET},
+    {"/light", HTTP_POST}, {"/history", HTTP_GET}, {"/log", HTTP_GET},
+    {"/ota", HTTP_PUT}, {"/sensor", HTTP_GET}, {"/device", HTTP_GET},
+    {"/accel", HTTP_GET}, {"/state", HTTP_POST}, {"/light", HTTP_GET},
+};
+
+#define REQUEST_NUM     (sizeof(gRequests) / sizeof(gRequests[0]))
+
+static int gFailures;
+
+#define CHECK(cond)     do { if(!(cond)) { gFailures++; \
+                             printf("FAIL %s:%d %s\n", __FILE__, __LINE__, \
+                                    #cond); } } while(0)
+
+/* the route scan of parseHttpRequestMetadata() before the lookup tables */
+static int32_t refRoute(const char *pUri, uint8_t method, uint8_t num)
+{
+    uint8_t idx;
+
+    for(idx = 0; idx < num; idx++)
+    {
+        if((strncmp(pUri, gRoutes[idx].service.pName,
+                    strlen(gRoutes[idx].service.pName)) == 0) &&
+           (method == gRoutes[idx].service.method))
+        {
+            return(idx);
+        }
+    }
+
+    return(-1);
+}
+
+/* the characteristic scan of parseUrlEncoded() before the lookup tables */
+static int32_t refCharacteristic(const TestRoute_t *pRoute, const char *pName)
+{
+    uint8_t idx = 0;
+
+    while(pRoute->charValues[idx].characteristic.pName != NULL)
+    {
+        if(!strncmp(pName, pRoute->charValues[idx].characteristic.pName,
+                    strlen(pRoute->charValues[idx].characteristic.pName)))
+        {
+            return(idx);
+        }
+        idx++;
+    }
+
+    return(-1);
+}
+
+static int32_t findRoute(const char *pUri, uint8_t method,
+                         const uint8_t *pOrder, uint8_t num)
+{
+    return(HttpLookup_find(gRoutes, sizeof(gRoutes[0]), pOrder, num,
+                           (const uint8_t *)pUri, strlen(pUri), method));
+}
+
+static int compareGrown(const void *pA, const void *pB)
+{
+    const HttpLookup_Key_t *pKeyA = &gRoutes[*(const uint8_t *)pA].service;
+    const HttpLookup_Key_t *pKeyB = &gRoutes[*(const uint8_t *)pB].service;
+    int32_t order;
+
+    order = HttpLookup_compare((const uint8_t *)pKeyA->pName, pKeyA->nameLen,
+                               pKeyB->pName, pKeyB->nameLen);
+    if(order == 0)
+    {
+        order = (int32_t)pKeyA->method - (int32_t)pKeyB->method;
+    }
+
+    return(order);
+}
+
+/* the current routes plus endpoints of varied length up to the limit */
+static void growRoutes(void)
+{
+    uint8_t idx;
+
+    for(idx = ROUTE_NUM; idx < GROWN_NUM; idx++)
+    {
+        snprintf(gGrownNames[idx], sizeof(gGrownNames[idx]), "/api/%.*s%02u",
+                 idx % 5, "xyzzy", idx);
+        gRoutes[idx].service.pName = gGrownNames[idx];
+        gRoutes[idx].service.nameLen = strlen(gGrownNames[idx]);
+        gRoutes[idx].service.method = HTTP_GET;
+        gRoutes[idx].requestIdx = idx;
+    }
+    for(idx = 0; idx < GROWN_NUM; idx++)
+    {
+        gGrownOrder[idx] = idx;
+    }
+    qsort(gGrownOrder, GROWN_NUM, 1, compareGrown);
+}
+
+static void testTables(void)
+{
+    static const uint8_t badOrder[] = {0, 1, 2, 3, 4, 5, 6};
+    static const uint8_t shortOrder[] = {0, 1, 2, 3, 4, 5};
+    const TestRoute_t *pState = &gRoutes[7];
+    uint8_t order[ROUTE_NUM];
+    uint32_t idx, kept = 0;
+
+    CHECK(HttpLookup_checkOrder(gRoutes, sizeof(gRoutes[0]), ROUTE_NUM,
+                                gRouteOrder, ROUTE_NUM) == 0);
+    CHECK(HttpLookup_checkOrder(gRoutes[6].charValues,
+                                sizeof(gRoutes[6].charValues[0]), 10,
+                                gEnviroCharOrder,
+                                sizeof(gEnviroCharOrder)) == 0);
+    CHECK(HttpLookup_checkOrder(pState->charValues,
+                                sizeof(pState->charValues[0]), 10,
+                                gStateCharOrder,
+                                sizeof(gStateCharOrder)) == 0);
+
+    /* goalTemp ahead of dataFreq, then lastCheckin left out */
+    CHECK(HttpLookup_checkOrder(pState->charValues,
+                                sizeof(pState->charValues[0]), 10, badOrder,
+                                sizeof(badOrder)) == HTTP_LOOKUP_NOT_SORTED);
+    CHECK(HttpLookup_checkOrder(pState->charValues,
+                                sizeof(pState->charValues[0]), 10,
+                                shortOrder, sizeof(shortOrder)) ==
+          HTTP_LOOKUP_BAD_ORDER);
+
+    for(idx = 0; idx < REQUEST_NUM; idx++)
+    {
+        CHECK(findRoute(gRequests[idx].pUri, gRequests[idx].method,
+                        gRouteOrder, ROUTE_NUM) ==
+              refRoute(gRequests[idx].pUri, gRequests[idx].method,
+                       ROUTE_NUM));
+        CHECK(HttpLookup_scan(gRoutes, sizeof(gRoutes[0]), ROUTE_NUM,
+                              (const uint8_t *)gRequests[idx].pUri,
+                              strlen(gRequests[idx].pUri),
+                              gRequests[idx].method) ==
+              refRoute(gRequests[idx].pUri, gRequests[idx].method,
+                       ROUTE_NUM));
+    }
+    for(idx = 0; idx < sizeof(gStateCharOrder); idx++)
+    {
+        const HttpLookup_Key_t *pKey = &pState->charValues[idx].characteristic;
+
+        CHECK(HttpLookup_find(pState->charValues,
+                              sizeof(pState->charValues[0]), gStateCharOrder,
+                              sizeof(gStateCharOrder),
+                              (const uint8_t *)pKey->pName, pKey->nameLen,
+                              0) == (int32_t)idx);
+    }
+
+    /* exact match, the old scan took any URI starting with a route */
+    CHECK(findRoute("/state", HTTP_PUT, gRouteOrder, ROUTE_NUM) == -1);
+    CHECK(findRoute("/lights", HTTP_GET, gRouteOrder, ROUTE_NUM) == -1);
+    CHECK(refRoute("/lights", HTTP_GET, ROUTE_NUM) == 2);
+    CHECK(findRoute("", HTTP_GET, gRouteOrder, ROUTE_NUM) == -1);
+
+    growRoutes();
+    CHECK(HttpLookup_checkOrder(gRoutes, sizeof(gRoutes[0]), GROWN_NUM,
+                                gGrownOrder, GROWN_NUM) == 0);
+    /* left without the added routes, the sorted order is gRouteOrder */
+    for(idx = 0; idx < GROWN_NUM; idx++)
+    {
+        if(gGrownOrder[idx] < ROUTE_NUM)
+        {
+            order[kept++] = gGrownOrder[idx];
+        }
+    }
+    CHECK((kept == ROUTE_NUM) && !memcmp(order, gRouteOrder, ROUTE_NUM));
+    for(idx = 0; idx < GROWN_NUM; idx++)
+    {
+        CHECK(findRoute(gRoutes[idx].service.pName,
+                        gRoutes[idx].service.method, gGrownOrder,
+                        GROWN_NUM) == (int32_t)idx);
+    }
+}
+
+/* every route of the table once per round */
+static double benchRoutes(uint8_t useRef, const uint8_t *pOrder, uint8_t num)
+{
+    volatile int32_t sink = 0;
+    clock_t start;
+    uint32_t round, idx;
+
+    start = clock();
+    for(round = 0; round < BENCH_ROUNDS; round++)
+    {
+        for(idx = 0; idx < num; idx++)
+        {
+            if(useRef)
+            {
+                sink += refRoute(gRoutes[idx].service.pName,
+                                 gRoutes[idx].service.method, num);
+            }
+            else
+            {
+                sink += findRoute(gRoutes[idx].service.pName,
+                                  gRoutes[idx].service.method, pOrder, num);
+            }
+        }
+    }
+
+    return((double)(clock() - start) * 1e9 / CLOCKS_PER_SEC /
+           ((double)BENCH_ROUNDS * num));
+}
+
+/* every /enviro characteristic, as a full poll of the page asks them */
+static void benchCharacteristics(void)
+{
+    const TestRoute_t *pEnviro = &gRoutes[6];
+    volatile int32_t sink = 0;
+    clock_t start;
+    double refNs, findNs;
+    uint32_t round, idx;
+
+    start = clock();
+    for(round = 0; round < BENCH_ROUNDS; round++)
+    {
+        for(idx = 0; idx < sizeof(gEnviroCharOrder); idx++)
+        {
+            sink += refCharacteristic(pEnviro, pEnviro->charValues[idx].
+                                      characteristic.pName);
+        }
+    }
+    refNs = (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC /
+            ((double)BENCH_ROUNDS * sizeof(gEnviroCharOrder));
+
+    start = clock();
+    for(round = 0; round < BENCH_ROUNDS; round++)
+    {
+        for(idx = 0; idx < sizeof(gEnviroCharOrder); idx++)
+        {
+            const HttpLookup_Key_t *pKey =
+                &pEnviro->charValues[idx].characteristic;
+
+            sink += HttpLookup_find(pEnviro->charValues,
+                                    sizeof(pEnviro->charValues[0]),
+                                    gEnviroCharOrder,
+                                    sizeof(gEnviroCharOrder),
+                                    (const uint8_t *)pKey->pName,
+                                    strlen(pKey->pName), 0);
+        }
+    }
+    findNs = (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC /
+             ((double)BENCH_ROUNDS * sizeof(gEnviroCharOrder));
+
+    printf("http_lookup: characteristic %.1f ns linear, %.1f ns sorted "
+           "(8 entries)\n", refNs, findNs);
+}
+
+static void benchmark(void)
+{
+    double ref13, find13, ref32, find32;
+
+    ref13 = benchRoutes(1, gRouteOrder, ROUTE_NUM);
+    find13 = benchRoutes(0, gRouteOrder, ROUTE_NUM);
+    ref32 = benchRoutes(1, gGrownOrder, GROWN_NUM);
+    find32 = benchRoutes(0, gGrownOrder, GROWN_NUM);
+
+    printf("http_lookup: route %.1f ns linear, %.1f ns sorted (%u routes)\n",
+           ref13, find13, ROUTE_NUM);
+    printf("http_lookup: route %.1f ns linear, %.1f ns sorted (%u routes)\n",
+           ref32, find32, GROWN_NUM);
+    benchCharacteristics();
+}
+
+int main(void)
+{
+    testTables();
+    benchmark();
+
+    printf("http_lookup: %s\n", gFailures ? "FAILED" : "passed");
+
+    return(gFailures ? 1 : 0);
+}
+
+#endif /* __TI_COMPILER_VERSION__ */
@@ -0,0 +1,234 @@
+/*
+ * test_http_writer.c
+ *
+ *  Host test and benchmark of the payload writer. The integer formatting is
+ *  checked against snprintf, and the /sensor and /enviro payloads are built
+ *  both the way the GET callbacks did before the writer (strlen per name,
+ *  snprintf per value, strlen of the payload for the metadata and the send)
+ *  and with HttpWriter_*.
+ */
+
+#ifndef __TI_COMPILER_VERSION__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "http_writer.h"
+
+#define BENCH_ROUNDS    (1000000)
+
+/* NETAPP_MAX_RX_FRAGMENT_LEN */
+#define PAYLOAD_LEN     (1472)
+
+/* SENSOR_VALUE_STR_LEN and ENVIRO_VALUE_STR_LEN of the old callbacks */
+#define VALUE_STR_LEN   (12)
+
+#define HTTP_STR(str)   (str), (sizeof(str) - 1)
+
+typedef struct
+{
+    char    *pName;
+    uint8_t nameLen;
+}TestChar_t;
+
+/* /sensor and /enviro characteristics, in the order the pages ask them */
+static const TestChar_t gSensorChars[] =
+{
+    {HTTP_STR("axisx")}, {HTTP_STR("axisy")}, {HTTP_STR("axisz")},
+    {HTTP_STR("temp")}
+};
+
+static const TestChar_t gEnviroChars[] =
+{
+    {HTTP_STR("inTemp")}, {HTTP_STR("outTemp")}, {HTTP_STR("inHumid")},
+    {HTTP_STR("outHumid")}, {HTTP_STR("inPres")}, {HTTP_STR("outPres")},
+    {HTTP_STR("oxygen")}, {HTTP_STR("airQuality")}
+};
+
+/* readings as getSensorValue() and getEnviroValue() return them */
+static const int32_t gSensorValues[] = {-12, 3, 64, 77};
+static const int32_t gEnviroValues[] =
+{
+    23, -4, 46312, 81920, 100651, 99873, 20, 612
+};
+
+#define SENSOR_NUM      (sizeof(gSensorChars) / sizeof(gSensorChars[0]))
+#define ENVIRO_NUM      (sizeof(gEnviroChars) / sizeof(gEnviroChars[0]))
+
+static uint8_t gPayload[PAYLOAD_LEN];
+
+static int gFailures;
+
+#define CHECK(cond)     do { if(!(cond)) { gFailures++; \
+                             printf("FAIL %s:%d %s\n", __FILE__, __LINE__, \
+                                    #cond); } } while(0)
+
+/* the payload loop of sensorGetCallback() and environGetCallback() before
+   the writer, returning the length it sent */
+static int32_t refPayload(const TestChar_t *pChars, const int32_t *pValues,
+                          uint8_t num, int32_t offset)
+{
+    uint8_t *pPayload = gPayload;
+    uint8_t idx;
+    int32_t len;
+
+    for(idx = 0; idx < num; idx++)
+    {
+        memcpy(pPayload, pChars[idx].pName, strlen(pChars[idx].pName));
+        pPayload += strlen(pChars[idx].pName);
+        *pPayload++ = '=';
+
+        snprintf((char *)pPayload, VALUE_STR_LEN, "%d",
+                 (int)(pValues[idx] + offset));
+        pPayload += strlen((const char *)pPayload);
+        *pPayload++ = '&';
+    }
+
+    *(pPayload - 1) = '\0';
+
+    /* once for prepareGetMetadata(), once for sl_NetAppSend() */
+    len = strlen((const char *)gPayload);
+    len += strlen((const char *)gPayload);
+
+    return(len / 2);
+}
+
+/* the same payload through appendCharacteristic() and the writer */
+static int32_t writerPayload(const TestChar_t *pChars, const int32_t *pValues,
+                             uint8_t num, int32_t offset)
+{
+    HttpWriter_t writer;
+    uint8_t idx;
+
+    HttpWriter_init(&writer, gPayload, PAYLOAD_LEN);
+    for(idx = 0; idx < num; idx++)
+    {
+        if(writer.len > 0)
+        {
+            HttpWriter_appendChar(&writer, '&');
+        }
+        HttpWriter_append(&writer, pChars[idx].pName, pChars[idx].nameLen);
+        HttpWriter_appendChar(&writer, '=');
+        HttpWriter_appendInt(&writer, pValues[idx] + offset);
+    }
+
+    return(HttpWriter_finish(&writer));
+}
+
+static void testFormat(void)
+{
+    static const int32_t ints[] =
+    {
+        0, 1, -1, 9, 10, 99, 100, -100, 12345, -98765, 1000000000,
+        INT32_MAX, INT32_MIN
+    };
+    char expect[24];
+    uint8_t buf[24];
+    HttpWriter_t writer;
+    uint32_t idx, value;
+
+    for(idx = 0; idx < sizeof(ints) / sizeof(ints[0]); idx++)
+    {
+        HttpWriter_init(&writer, buf, sizeof(buf));
+        HttpWriter_appendInt(&writer, ints[idx]);
+        snprintf(expect, sizeof(expect), "%d", (int)ints[idx]);
+        CHECK((HttpWriter_finish(&writer) == (int32_t)strlen(expect)) &&
+              !strcmp((const char *)buf, expect));
+    }
+
+    /* every magnitude, with and without padding */
+    for(value = 1; value < 4000000000u; value = value * 7 + 3)
+    {
+        HttpWriter_init(&writer, buf, sizeof(buf));
+        HttpWriter_appendUint(&writer, value, 6);
+        HttpWriter_appendChar(&writer, ' ');
+        HttpWriter_appendHex(&writer, value, 4);
+        HttpWriter_finish(&writer);
+        snprintf(expect, sizeof(expect), "%06u %04x", (unsigned int)value,
+                 (unsigned int)value);
+        CHECK(!strcmp((const char *)buf, expect));
+    }
+
+    HttpWriter_init(&writer, buf, sizeof(buf));
+    HttpWriter_appendFixed(&writer, -2508, 2, 8);
+    HttpWriter_appendFixed(&writer, 5, 3, 0);
+    HttpWriter_finish(&writer);
+    CHECK(!strcmp((const char *)buf, "  -25.080.005"));
+
+    /* the sign still fits, the digits are dropped and nothing is written
+       past the size */
+    memset(buf, 'x', sizeof(buf));
+    HttpWriter_init(&writer, buf, 8);
+    HttpWriter_appendStr(&writer, "axisx=");
+    HttpWriter_appendInt(&writer, -123);
+    CHECK(HttpWriter_finish(&writer) == -1);
+    CHECK(!strcmp((const char *)buf, "axisx=-") && (buf[8] == 'x'));
+}
+
+static void testPayloads(void)
+{
+    char expect[PAYLOAD_LEN];
+    int32_t len;
+
+    len = refPayload(gSensorChars, gSensorValues, SENSOR_NUM, 0);
+    memcpy(expect, gPayload, len + 1);
+    CHECK(writerPayload(gSensorChars, gSensorValues, SENSOR_NUM, 0) == len);
+    CHECK(!strcmp((const char *)gPayload, expect));
+
+    len = refPayload(gEnviroChars, gEnviroValues, ENVIRO_NUM, 0);
+    memcpy(expect, gPayload, len + 1);
+    CHECK(writerPayload(gEnviroChars, gEnviroValues, ENVIRO_NUM, 0) == len);
+    CHECK(!strcmp((const char *)gPayload, expect));
+}
+
+static double benchPayload(int32_t (*pBuild)(const TestChar_t *,
+                                             const int32_t *, uint8_t,
+                                             int32_t),
+                           const TestChar_t *pChars, const int32_t *pValues,
+                           uint8_t num)
+{
+    volatile int32_t sink = 0;
+    clock_t start;
+    uint32_t round;
+
+    start = clock();
+    for(round = 0; round < BENCH_ROUNDS; round++)
+    {
+        /* readings move between polls */
+        sink += pBuild(pChars, pValues, num, (int32_t)(round & 7));
+    }
+
+    return((double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / BENCH_ROUNDS);
+}
+
+static void benchmark(void)
+{
+    double refNs, writerNs;
+
+    refNs = benchPayload(refPayload, gSensorChars, gSensorValues, SENSOR_NUM);
+    writerNs = benchPayload(writerPayload, gSensorChars, gSensorValues,
+                            SENSOR_NUM);
+    printf("http_writer: /sensor %.1f ns before, %.1f ns with the writer\n",
+           refNs, writerNs);
+
+    refNs = benchPayload(refPayload, gEnviroChars, gEnviroValues, ENVIRO_NUM);
+    writerNs = benchPayload(writerPayload, gEnviroChars, gEnviroValues,
+                            ENVIRO_NUM);
+    printf("http_writer: /enviro %.1f ns before, %.1f ns with the writer\n",
+           refNs, writerNs);
+}
+
+int main(void)
+{
+    testFormat();
+    testPayloads();
+    benchmark();
+
+    printf("http_writer: %s\n", gFailures ? "FAILED" : "passed");
+
+    return(gFailures ? 1 : 0);
+}
+
+#endif /* __TI_COMPILER_VERSION__ */
@@ -0,0 +1,132 @@
+/*
+ * test_tmp006.c
+ *
+ *  Host accuracy sweep and benchmark of the TMP006 object temperature. The
+ *  reference is the double precision code the driver used before, run over
+ *  the whole die temperature range and thermopile span.
+ *
+ *  Host timings only rank the two versions. Cycles per call on the target
+ *  have to be taken on a LaunchPad, by reading the DWT cycle counter around
+ *  a loop of TMP006ComputeTemperature() calls.
+ */
+
+#ifndef __TI_COMPILER_VERSION__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+
+#include "tmp006calc.h"
+
+#define BENCH_CALLS     (10000000)
+
+/* thermopile voltage, 156.25 nV per LSB */
+#define VOBJECT_LSB     (156.25e-9)
+
+/* 1/32 degC, the die temperature resolution */
+#define MAX_ERROR_C     (1.0 / 32.0)
+
+static int gFailures;
+
+#define CHECK(cond)     do { if(!(cond)) { gFailures++; \
+                             printf("FAIL %s:%d %s\n", __FILE__, __LINE__, \
+                                    #cond); } } while(0)
+
+/* the driver before the single precision rewrite */
+static double refComputeTemperature(double dVobject, double dTAmbient)
+{
+    double Tdie2 = dTAmbient + 273.15;
+    const double S0 = 6.4E-14;
+    const double a1 = 1.75E-3;
+    const double a2 = -1.678E-5;
+    const double b0 = -2.94E-5;
+    const double b1 = -5.7E-7;
+    const double b2 = 4.63E-9;
+    const double c2 = 13.4;
+    const double Tref = 298.15;
+    double S = S0 * (1 + a1 * (Tdie2 - Tref) + a2 * pow((Tdie2 - Tref), 2));
+    double Vos = b0 + b1 * (Tdie2 - Tref) + b2 * pow((Tdie2 - Tref), 2);
+    double fObj = (dVobject - Vos) + c2 * pow((dVobject - Vos), 2);
+    double tObj = pow(pow(Tdie2, 4) + (fObj / S), .25);
+
+    return(tObj - 273.15);
+}
+
+/* die -40..125 degC in 1/4 degC steps, Vobject +-2000 LSB */
+static void testSweep(void)
+{
+    double ref, err, maxErr = 0, maxAt = 0, maxV = 0;
+    uint32_t samples = 0;
+    int32_t ambient, vobject;
+
+    for(ambient = -40 * 32; ambient <= 125 * 32; ambient += 8)
+    {
+        for(vobject = -2000; vobject <= 2000; vobject += 5)
+        {
+            ref = refComputeTemperature(vobject * VOBJECT_LSB,
+                                        ambient / 32.0);
+            if(isnan(ref))
+            {
+                /* colder than the sensor can see, both give no reading */
+                continue;
+            }
+            err = fabs(TMP006ComputeTemperature(
+                           (float)(vobject * VOBJECT_LSB),
+                           (float)(ambient / 32.0)) - ref);
+            if(err > maxErr)
+            {
+                maxErr = err;
+                maxAt = ambient / 32.0;
+                maxV = vobject;
+            }
+            samples++;
+        }
+    }
+
+    printf("tmp006: %u samples, max error %.4f degC (die %.2f degC, "
+           "Vobject %.0f LSB)\n", samples, maxErr, maxAt, maxV);
+    CHECK(samples > 500000);
+    CHECK(maxErr < MAX_ERROR_C);
+}
+
+static void benchmark(void)
+{
+    volatile float sinkF = 0;
+    volatile double sinkD = 0;
+    clock_t start;
+    double floatNs, doubleNs;
+    uint32_t call;
+
+    start = clock();
+    for(call = 0; call < BENCH_CALLS; call++)
+    {
+        sinkF += TMP006ComputeTemperature((call & 1023) * 156.25e-9f,
+                                          25.0f + (call & 63) * 0.25f);
+    }
+    floatNs = (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / BENCH_CALLS;
+
+    start = clock();
+    for(call = 0; call < BENCH_CALLS; call++)
+    {
+        sinkD += refComputeTemperature((call & 1023) * VOBJECT_LSB,
+                                       25.0 + (call & 63) * 0.25);
+    }
+    doubleNs = (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC /
+               BENCH_CALLS;
+
+    printf("tmp006: %.1f ns per call in float, %.1f ns in double on the "
+           "host\n", floatNs, doubleNs);
+}
+
+int main(void)
+{
+    testSweep();
+    benchmark();
+
+    printf("tmp006: %s\n", gFailures ? "FAILED" : "passed");
+
+    return(gFailures ? 1 : 0);
+}
+
+#endif /* __TI_COMPILER_VERSION__ */
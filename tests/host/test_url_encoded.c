@@ -0,0 +1,205 @@
+/*
+ * test_url_encoded.c
+ *
+ *  Host test and benchmark of the url-encoded tokenizer. The corpus holds
+ *  query strings and form bodies the web pages and the OTA client send.
+ */
+
+#ifndef __TI_COMPILER_VERSION__
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "url_encoded.h"
+
+#define BENCH_ROUNDS    (200000)
+
+/* requests as they reach parseUrlEncoded(), without the URI */
+static const char * const gCorpus[] =
+{
+    "redled=on&orangeled=toggle&greenled=off",
+    "redled=toggle",
+    "axisx&axisy&axisz&temp",
+    "ssid&ipaddress&macaddress&appname",
+    "inTemp&outTemp&inHumid&outHumid&inPres&outPres&oxygen&airQuality",
+    "fans&lights&cooling&goalTemp&dataFreq&lastDump&lastCheckin",
+    "bmeProfile=highres",
+    "o2Cal=air",
+    "since=1024&count=64",
+    "tier=1m&since=120&count=48",
+    "format=json&from=1760659200&to=1760745600",
+    "format=csv",
+    "version",
+    "filename=%2Fsys%2Fmcuflashimg.bin",
+    "filename=ota+image%20v1.2.tar",
+};
+
+static int gFailures;
+
+#define CHECK(cond)     do { if(!(cond)) { gFailures++; \
+                             printf("FAIL %s:%d %s\n", __FILE__, __LINE__, \
+                                    #cond); } } while(0)
+
+/* splits a phrase, the pairs are written as name[=value] separated by '|' */
+static void split(const char *pPhrase, size_t len, char *pOut, size_t outLen)
+{
+    const uint8_t *pCurr = (const uint8_t *)pPhrase;
+    const uint8_t *pEnd = pCurr + len;
+    UrlEncoded_Pair_t pair;
+    size_t used = 0;
+    int count = 0;
+
+    pOut[0] = '\0';
+    while(UrlEncoded_next(&pCurr, pEnd, &pair))
+    {
+        used += snprintf(pOut + used, outLen - used, "%s%.*s",
+                         (count++ > 0) ? "|" : "",
+                         pair.nameLen, (const char *)pair.pName);
+        if(pair.pValue != NULL)
+        {
+            used += snprintf(pOut + used, outLen - used, "=%.*s",
+                             pair.valueLen, (const char *)pair.pValue);
+        }
+    }
+}
+
+static int32_t decode(const char *pToken, char *pOut, uint16_t outLen)
+{
+    int32_t len;
+
+    len = UrlEncoded_decode((const uint8_t *)pToken, strlen(pToken),
+                            (uint8_t *)pOut, outLen);
+    if(len >= 0)
+    {
+        pOut[len] = '\0';
+    }
+
+    return(len);
+}
+
+static void testTokenizer(void)
+{
+    char out[512];
+
+    split("a=1&b=2", 7, out, sizeof(out));
+    CHECK(!strcmp(out, "a=1|b=2"));
+
+    /* names without values, as the GET reading lists are sent */
+    split("axisx&axisy", 11, out, sizeof(out));
+    CHECK(!strcmp(out, "axisx|axisy"));
+
+    /* empty value keeps its '=', the parser rejects it */
+    split("a=&b", 4, out, sizeof(out));
+    CHECK(!strcmp(out, "a=|b"));
+
+    /* empty pairs come back with no name, the parser skips them */
+    split("&a&&b&", 6, out, sizeof(out));
+    CHECK(!strcmp(out, "|a||b"));
+
+    /* a value without a name */
+    split("=1", 2, out, sizeof(out));
+    CHECK(!strcmp(out, "=1"));
+
+    /* repeated keys are all returned, the callbacks keep the last */
+    split("since=1&since=2", 15, out, sizeof(out));
+    CHECK(!strcmp(out, "since=1|since=2"));
+
+    /* '=' inside a value belongs to the value */
+    split("a=b=c", 5, out, sizeof(out));
+    CHECK(!strcmp(out, "a=b=c"));
+
+    /* an embedded NULL ends the phrase, so does the length */
+    split("a=1\0b=2", 7, out, sizeof(out));
+    CHECK(!strcmp(out, "a=1"));
+    split("a=12&b=2", 3, out, sizeof(out));
+    CHECK(!strcmp(out, "a=1"));
+
+    split("", 0, out, sizeof(out));
+    CHECK(!strcmp(out, ""));
+}
+
+static void testDecode(void)
+{
+    char out[300];
+    char big[300];
+
+    CHECK(decode("%2Fsys%2fmcu", out, sizeof(out)) == 8);
+    CHECK(!strcmp(out, "/sys/mcu"));
+    CHECK(decode("a+b%20c", out, sizeof(out)) == 5);
+    CHECK(!strcmp(out, "a b c"));
+    CHECK(decode("%41%4a%4A", out, sizeof(out)) == 3);
+    CHECK(!strcmp(out, "AJJ"));
+    CHECK(decode("%00x", out, sizeof(out)) == 2);
+
+    /* bad and truncated escapes */
+    CHECK(decode("%G1", out, sizeof(out)) == -1);
+    CHECK(decode("%4", out, sizeof(out)) == -1);
+    CHECK(decode("ab%", out, sizeof(out)) == -1);
+
+    /* oversize: exactly fits, then one more than the destination */
+    CHECK(decode("abcd", out, 4) == 4);
+    CHECK(decode("abcde", out, 4) == -1);
+    CHECK(decode("%41%42", out, 1) == -1);
+    memset(big, 'x', 255);
+    big[255] = '\0';
+    CHECK(decode(big, out, 254) == -1);
+    big[254] = '\0';
+    CHECK(decode(big, out, 254) == 254);
+}
+
+static void benchmark(void)
+{
+    const uint8_t *pCurr, *pEnd;
+    UrlEncoded_Pair_t pair;
+    struct timespec start, end;
+    uint8_t decoded[256];
+    size_t lens[sizeof(gCorpus) / sizeof(gCorpus[0])];
+    volatile uint32_t sink = 0;
+    uint32_t round, idx, phrases = 0;
+    double ns;
+
+    for(idx = 0; idx < sizeof(gCorpus) / sizeof(gCorpus[0]); idx++)
+    {
+        lens[idx] = strlen(gCorpus[idx]);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(round = 0; round < BENCH_ROUNDS; round++)
+    {
+        for(idx = 0; idx < sizeof(gCorpus) / sizeof(gCorpus[0]); idx++)
+        {
+            pCurr = (const uint8_t *)gCorpus[idx];
+            pEnd = pCurr + lens[idx];
+            while(UrlEncoded_next(&pCurr, pEnd, &pair))
+            {
+                sink += UrlEncoded_decode(pair.pName, pair.nameLen, decoded,
+                                          sizeof(decoded));
+                if(pair.pValue != NULL)
+                {
+                    sink += UrlEncoded_decode(pair.pValue, pair.valueLen,
+                                              decoded, sizeof(decoded));
+                }
+            }
+            phrases++;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    ns = ((end.tv_sec - start.tv_sec) * 1e9) + (end.tv_nsec - start.tv_nsec);
+    printf("url_encoded: %u phrases, %.1f ns per phrase on the host\n",
+           phrases, ns / phrases);
+}
+
+int main(void)
+{
+    testTokenizer();
+    testDecode();
+    benchmark();
+
+    printf("url_encoded: %s\n", gFailures ? "FAILED" : "passed");
+
+    return(gFailures ? 1 : 0);
+}
+
+#endif /* __TI_COMPILER_VERSION__ */
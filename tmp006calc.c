@@ -0,0 +1,43 @@
+/*
+ * tmp006calc.c
+ *
+ *  TMP006 object temperature. Kept free of driver calls so it builds on a
+ *  host, see tests/host.
+ */
+
+/* standard includes */
+#include <math.h>
+
+#include "tmp006calc.h"
+
+float TMP006ComputeTemperature(float fVobject,
+                               float fTAmbient)
+{
+    /*
+     * This algo is obtained from
+     * http://processors.wiki.ti.com/index.php/SensorTag_User_Guide
+     * #IR_Temperature_Sensor
+     *
+     * Single precision, the FPU has no double: the polynomials are in
+     * Horner form, the offset from Tref is taken in Celsius so it does not
+     * cancel, and the fourth root is two VSQRT.F32.
+     */
+    const float S0inv = 1.0f / 6.4E-14f;  /* Calibration factor */
+    const float a1 = 1.75E-3f;
+    const float a2 = -1.678E-5f;
+    const float b0 = -2.94E-5f;
+    const float b1 = -5.7E-7f;
+    const float b2 = 4.63E-9f;
+    const float c2 = 13.4f;
+    const float TrefC = 25.0f;          /* 298.15 K */
+    float Tdie = fTAmbient + 273.15f;
+    float dT = fTAmbient - TrefC;
+    float S = 1.0f + dT * (a1 + a2 * dT);
+    float Vos = b0 + dT * (b1 + b2 * dT);
+    float Vx = fVobject - Vos;
+    float fObj = Vx * (1.0f + c2 * Vx);
+    float Tdie2 = Tdie * Tdie;
+    float tObj = sqrtf(sqrtf((Tdie2 * Tdie2) + ((fObj / S) * S0inv)));
+
+    return(tObj - 273.15f);
+}
@@ -0,0 +1,25 @@
+/*
+ * tmp006calc.h
+ *
+ *  TMP006 object temperature, from the thermopile voltage and the die
+ *  temperature. Kept apart from the I2C driver so it builds on a host,
+ *  see tests/host.
+ */
+
+#ifndef TMP006CALC_H_
+#define TMP006CALC_H_
+
+//****************************************************************************
+//
+//! \brief Compute the temperature value from the sensor voltage and die temp.
+//!
+//! \param[in] fVobject     the sensor voltage value, in volts
+//! \param[in] fTAmbient    the local die temperature, in degrees C
+//!
+//! \return object temperature in degrees C
+//
+//****************************************************************************
+float TMP006ComputeTemperature(float fVobject,
+                               float fTAmbient);
+
+#endif /* TMP006CALC_H_ */
@@ -37,15 +37,14 @@
 //
 //*****************************************************************************
 
-/* standard includes */
-#include <math.h>
-
 /* TI-DRIVERS Header files */
 #include <uart_term.h>
 
 /* Example/Board Header files */
 #include "tmp006drv.h"
+#include "tmp006calc.h"
 #include "out_of_box.h"
+#include "i2c_bus.h"
 
 /* driverlib Header files */
 #include <ti/devices/cc32xx/inc/hw_memmap.h>
@@ -73,19 +72,6 @@ static int GetRegisterValue(I2C_Handle i2cHandle,
                             unsigned char ucRegAddr,
                             unsigned short *pusRegValue);
 
-//****************************************************************************
-//
-//! \brief Compute the temperature value from the sensor voltage and die temp.
-//!
-//! \param[in] dVobject     the sensor voltage value
-//! \param[in] dTAmbient    the local die temperature
-//!
-//! \return temperature value
-//
-//****************************************************************************
-static double ComputeTemperature(double dVobject,
-                                 double dTAmbient);
-
 //*****************************************************************************
 //                 Local Functions
 //*****************************************************************************
@@ -114,11 +100,11 @@ GetRegisterValue(I2C_Handle i2cHandle,
     /* Check if deviceType is CC3235X or CC3220X */
     if((HWREG(GPRCM_BASE + GPRCM_O_GPRCM_DIEID_READ_REG4) >> 24) & 0x02)
     {
-        tmpSensorAddr = 0x0049; // CC3235X
+        tmpSensorAddr = TMP006_I2C_ADDR_CC3235X;
     }
     else
     {
-        tmpSensorAddr = 0x0041; // CC3220X
+        tmpSensorAddr = TMP006_I2C_ADDR_CC3220X;
     }
 
     /* Invoke the readfrom I2C API to get the required bytes */
@@ -128,7 +114,7 @@ GetRegisterValue(I2C_Handle i2cHandle,
     i2cTransaction.readBuf = ucRegData;
     i2cTransaction.readCount = 2;
 
-    status = I2C_transfer(i2cHandle, &i2cTransaction);
+    status = I2CBus_transfer(i2cHandle, &i2cTransaction);
 
     if(status != true)
     {
@@ -140,43 +126,6 @@ GetRegisterValue(I2C_Handle i2cHandle,
     return(SUCCESS);
 }
 
-//****************************************************************************
-//
-//! \brief Compute the temperature value from the sensor voltage and die temp.
-//!
-//! \param[in] dVobject     the sensor voltage value
-//! \param[in] dTAmbient    the local die temperature
-//!
-//! \return temperature value
-//
-//****************************************************************************
-double ComputeTemperature(double dVobject,
-                          double dTAmbient)
-{
-    /*
-     * This algo is obtained from
-     * http://processors.wiki.ti.com/index.php/SensorTag_User_Guide
-     * #IR_Temperature_Sensor
-     */
-    double Tdie2 = dTAmbient + 273.15;
-    const double S0 = 6.4E-14;            /* Calibration factor */
-    const double a1 = 1.75E-3;
-    const double a2 = -1.678E-5;
-    const double b0 = -2.94E-5;
-    const double b1 = -5.7E-7;
-    const double b2 = 4.63E-9;
-    const double c2 = 13.4;
-    const double Tref = 298.15;
-    double S = S0 * (1 + a1 * (Tdie2 - Tref) + a2 * pow((Tdie2 - Tref),2));
-    double Vos = b0 + b1 * (Tdie2 - Tref) + b2* pow((Tdie2 - Tref),
-                                                    2);
-    double fObj = (dVobject - Vos) + c2* pow((dVobject - Vos),
-                                             2);
-    double tObj = pow(pow(Tdie2,4) + (fObj / S),.25);
-    tObj = (tObj - 273.15);
-    return(tObj);
-}
-
 //****************************************************************************
 //                            MAIN FUNCTION
 //****************************************************************************
@@ -256,7 +205,7 @@ TMP006DrvGetTemp(I2C_Handle i2cHandle,
                  float *pfCurrTemp)
 {
     unsigned short usVObjectRaw, usTAmbientRaw;
-    double dVObject, dTAmbient;
+    float fVObject, fTAmbient;
     int status;
 
     /* Get the sensor voltage register value */
@@ -275,11 +224,11 @@ TMP006DrvGetTemp(I2C_Handle i2cHandle,
         return(FAILURE);
     }
 
-    /* Apply the format conversion */
-    dVObject = ((short)usVObjectRaw) * 156.25e-9;
-    dTAmbient = ((short)usTAmbientRaw) / 128;
+    /* Apply the format conversion, 1/32 C per LSB in the top 14 bits */
+    fVObject = ((short)usVObjectRaw) * 156.25e-9f;
+    fTAmbient = ((short)usTAmbientRaw) / 128.0f;
 
-    *pfCurrTemp = ComputeTemperature(dVObject, dTAmbient);
+    *pfCurrTemp = TMP006ComputeTemperature(fVObject, fTAmbient);
 
     /*dont Convert to Farenheit */
    // *pfCurrTemp = ((*pfCurrTemp * 9) / 5) + 32;
@@ -287,6 +236,39 @@ TMP006DrvGetTemp(I2C_Handle i2cHandle,
     return(SUCCESS);
 }
 
+//****************************************************************************
+//
+//! \brief Collect the temperature of a completed conversion
+//!         1. Check the DRDY bit of the configuration register
+//!         2. Get the temperature if it is set, reading the results clears it
+//!
+//! \param[in]  i2cHandle   the handle to the openned i2c device
+//! \param[out]     pfCurrTemp  the pointer to the temperature value store
+//!
+//! \return 0: Success, TMP006_NOT_READY: no new conversion, < 0: Failure.
+//
+//****************************************************************************
+int
+TMP006DrvCollect(I2C_Handle i2cHandle,
+                 float *pfCurrTemp)
+{
+    unsigned short usConfigReg;
+    int status;
+
+    status = GetRegisterValue(i2cHandle, TMP006_CONFIG_REG_ADDR, &usConfigReg);
+    if(status != 0)
+    {
+        return(FAILURE);
+    }
+
+    if(!(usConfigReg & TMP006_CONFIG_DRDY))
+    {
+        return(TMP006_NOT_READY);
+    }
+
+    return(TMP006DrvGetTemp(i2cHandle, pfCurrTemp));
+}
+
 //*****************************************************************************
 //
 // Close the Doxygen group.
@@ -65,6 +65,23 @@ extern "C"
 #define TMP006_MANUFAC_ID       0x5449
 #define TMP006_DEVICE_ID        0x0067
 
+//*****************************************************************************
+// TMP006 I2C address, it depends on the LaunchPad
+//*****************************************************************************
+#define TMP006_I2C_ADDR_CC3220X 0x41
+#define TMP006_I2C_ADDR_CC3235X 0x49
+
+//*****************************************************************************
+// TMP006 Configuration register bits
+//*****************************************************************************
+#define TMP006_CONFIG_DRDY      0x0080
+
+//*****************************************************************************
+// TMP006DrvCollect() return value when no conversion completed since the
+// last read
+//*****************************************************************************
+#define TMP006_NOT_READY        1
+
 //*****************************************************************************
 //
 // API Function prototypes
@@ -99,6 +116,20 @@ int TMP006DrvOpen(I2C_Handle i2cHandle);
 int TMP006DrvGetTemp(I2C_Handle i2cHandle,
                      float *pfCurrTemp);
 
+//****************************************************************************
+//! \brief Collect the temperature of a completed conversion. The sensor
+//!         converts continuously, so there is nothing to start: the DRDY
+//!         bit tells whether a conversion completed since the last read.
+//!
+//! \param[in]  i2cHandle   the handle to the openned i2c device
+//! \param[out]     pfCurrTemp  the pointer to the temperature value store,
+//!                             untouched when no conversion completed
+//!
+//! \return 0: Success, TMP006_NOT_READY: no new conversion, < 0: Failure.
+//****************************************************************************
+int TMP006DrvCollect(I2C_Handle i2cHandle,
+                     float *pfCurrTemp);
+
 //*****************************************************************************
 //
 // Mark the end of the C bindings section for C++ compilers.
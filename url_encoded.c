@@ -0,0 +1,120 @@
+/*
+ * url_encoded.c
+ *
+ *  Tokenizer for url-encoded query strings and form bodies. Kept free of
+ *  SimpleLink calls so it builds on a host, see tests/host.
+ */
+
+/* standard includes */
+#include <stddef.h>
+
+#include "url_encoded.h"
+
+//*****************************************************************************
+//
+//! \brief Converts an hex digit to its value
+//!
+//! \param[in]  digit         ascii hex digit
+//!
+//! \return digit value or -1 if not an hex digit
+//!
+//****************************************************************************
+static int32_t urlHexDigitValue(uint8_t digit)
+{
+    if((digit >= '0') && (digit <= '9'))
+    {
+        return(digit - '0');
+    }
+    digit |= 0x20;          /* lower case */
+    if((digit >= 'a') && (digit <= 'f'))
+    {
+        return(digit - 'a' + 10);
+    }
+
+    return(-1);
+}
+
+uint8_t UrlEncoded_next(const uint8_t **ppCurr, const uint8_t *pEnd,
+                        UrlEncoded_Pair_t *pPair)
+{
+    const uint8_t *pCurr = *ppCurr;
+
+    if((pCurr >= pEnd) || (*pCurr == '\0'))
+    {
+        return(0);
+    }
+
+    /* name runs until '=', '&' or the end */
+    pPair->pName = pCurr;
+    while((pCurr < pEnd) && (*pCurr != '=') && (*pCurr != '&') &&
+          (*pCurr != '\0'))
+    {
+        pCurr++;
+    }
+    pPair->nameLen = pCurr - pPair->pName;
+
+    /* value, if any, runs until '&' or the end */
+    pPair->pValue = NULL;
+    pPair->valueLen = 0;
+    if((pCurr < pEnd) && (*pCurr == '='))
+    {
+        pCurr++;
+        pPair->pValue = pCurr;
+        while((pCurr < pEnd) && (*pCurr != '&') && (*pCurr != '\0'))
+        {
+            pCurr++;
+        }
+        pPair->valueLen = pCurr - pPair->pValue;
+    }
+    if((pCurr < pEnd) && (*pCurr == '&'))
+    {
+        pCurr++;
+    }
+
+    *ppCurr = pCurr;
+
+    return(1);
+}
+
+int32_t UrlEncoded_decode(const uint8_t *pSrc, uint16_t srcLen,
+                          uint8_t *pDst, uint16_t dstLen)
+{
+    const uint8_t *pEnd = pSrc + srcLen;
+    int32_t high, low;
+    uint16_t decodedLen = 0;
+
+    while(pSrc < pEnd)
+    {
+        if(decodedLen == dstLen)
+        {
+            return(-1);
+        }
+
+        if(*pSrc == '%')
+        {
+            if((pEnd - pSrc) < 3)
+            {
+                return(-1);
+            }
+            high = urlHexDigitValue(pSrc[1]);
+            low = urlHexDigitValue(pSrc[2]);
+            if((high < 0) || (low < 0))
+            {
+                return(-1);
+            }
+            pDst[decodedLen++] = (uint8_t)((high << 4) | low);
+            pSrc += 3;
+        }
+        else if(*pSrc == '+')
+        {
+            pDst[decodedLen++] = ' ';
+            pSrc++;
+        }
+        else
+        {
+            pDst[decodedLen++] = *pSrc++;
+        }
+    }
+
+    return(decodedLen);
+}
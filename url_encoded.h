@@ -0,0 +1,58 @@
+/*
+ * url_encoded.h
+ *
+ *  Tokenizer for url-encoded query strings and form bodies. The phrase is
+ *  walked once and never written, every pair is returned as spans into it
+ *  and decoded ('+' and %XX escapes) only into a buffer the caller gives.
+ */
+
+#ifndef URL_ENCODED_H_
+#define URL_ENCODED_H_
+
+#include <stdint.h>
+
+typedef struct
+{
+    const uint8_t *pName;
+    uint16_t nameLen;
+    const uint8_t *pValue;      /* NULL if the pair has no '=' */
+    uint16_t valueLen;
+}UrlEncoded_Pair_t;
+
+//*****************************************************************************
+//
+//! \brief Returns the next name[=value] pair of a phrase. Pairs are split on
+//!        '&', an embedded NULL ends the phrase. Empty pairs, as in "a&&b",
+//!        are returned with a zero name length.
+//!
+//! \param[in,out] ppCurr     position in the phrase, moved past the pair
+//!
+//! \param[in]  pEnd          end of the phrase
+//!
+//! \param[out] pPair         spans of the name and the value
+//!
+//! \return 1 if a pair was returned, 0 at the end of the phrase
+//!
+//****************************************************************************
+uint8_t UrlEncoded_next(const uint8_t **ppCurr, const uint8_t *pEnd,
+                        UrlEncoded_Pair_t *pPair);
+
+//*****************************************************************************
+//
+//! \brief Decodes an url-encoded token ('+' and %XX escapes)
+//!
+//! \param[in]  pSrc          token, not NULL terminated
+//!
+//! \param[in]  srcLen        token length
+//!
+//! \param[out] pDst          decoded token, not NULL terminated
+//!
+//! \param[in]  dstLen        size of the destination
+//!
+//! \return decoded length or -1 on bad escape or if it does not fit
+//!
+//****************************************************************************
+int32_t UrlEncoded_decode(const uint8_t *pSrc, uint16_t srcLen,
+                          uint8_t *pDst, uint16_t dstLen);
+
+#endif /* URL_ENCODED_H_ */
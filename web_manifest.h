@@ -0,0 +1,27 @@
+/*
+ * web_manifest.h
+ *
+ *  Generated by WebFiles/build_assets.py, do not edit. Fingerprinted
+ *  web assets served by the link local task, sorted by URI length and
+ *  then by URI bytes. Only link_local_task.c includes it.
+ */
+
+#ifndef WEB_MANIFEST_H_
+#define WEB_MANIFEST_H_
+
+#define WEB_ASSET_NUM                  (9)
+
+const http_WebAsset_t gWebAssets[WEB_ASSET_NUM] =
+{
+    {HTTP_STR("/static/help.e99824df.png"), HttpContentTypeList_ImagePNG, 0, 1289, "\"e99824df\""},
+    {HTTP_STR("/static/menu.33093eec.png"), HttpContentTypeList_ImagePNG, 0, 975, "\"33093eec\""},
+    {HTTP_STR("/static/style.8d6d8500.css"), HttpContentTypeList_TextCSS, 1, 2663, "\"8d6d8500\""},
+    {HTTP_STR("/static/scripts.123a7219.js"), HttpContentTypeList_ApplicationJavascript, 1, 866, "\"123a7219\""},
+    {HTTP_STR("/static/tilogo.8ebf57ba.gif"), HttpContentTypeList_ImageGIF, 0, 7182, "\"8ebf57ba\""},
+    {HTTP_STR("/static/wireless.63672226.png"), HttpContentTypeList_ImagePNG, 0, 1176, "\"63672226\""},
+    {HTTP_STR("/static/jquery.min.8258d046.js"), HttpContentTypeList_ApplicationJavascript, 1, 29543, "\"8258d046\""},
+    {HTTP_STR("/static/rotate360.e8604c5e.jpg"), HttpContentTypeList_ImageJPEG, 0, 1030073, "\"e8604c5e\""},
+    {HTTP_STR("/static/wirelessfull.c9857ea5.png"), HttpContentTypeList_ImagePNG, 0, 1080, "\"c9857ea5\""},
+};
+
+#endif /* WEB_MANIFEST_H_ */